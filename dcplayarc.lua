@@ -168,6 +168,14 @@ if type(filetype_add) == "function" then
    filetype_add("text", nil, ".txt\0.doc")
 end
 
+-- Song length database (HVSC Songlengths.md5 format).
+if type(songlen_load) == "function" and type(test) == "function" then
+   local songlen = home.."songlengths.md5"
+   if test("-f",songlen) then
+      songlen_load(songlen)
+   end
+end
+
 -- Load this driver as soon as possible
 if type(test) == "function" and type(driver_load) == "function" then
    if type(plug_jpeg) == "string" and test("-f",plug_jpeg) then
@@ -37,6 +37,11 @@
 #include "playa.h"
 #include "vmu_file.h"
 #include "fs_ramdisk.h"
+#include "fs_cache.h"
+#include "songlen.h"
+#include "luacache.h"
+#include "luaprof.h"
+#include "luasrc.h"
 #include "draw/texture.h"
 #include "translator/translator.h"
 #include "translator/SHAtranslator/SHAtranslatorBlitter.h"
@@ -54,8 +59,10 @@ lua_State * shell_lua_state;
 typedef void (* shutdown_func_t)();
 
 static shell_command_func_t old_command_func;
+static shell_yield_func_t old_yield_func;
 
 static int song_tag;
+static int luasrc_tag;
 
 static const char home[256];
 static const char initfile[256];
@@ -70,29 +77,122 @@ static void lua_assert_func(lua_State * L, const char * msg)
   lua_error(L, msg);
 }
 
-#define CR_SIZE 32
-static spinlock_t cr_inmutex;
-static spinlock_t cr_outmutex;
-static int cr_in;
-static int cr_out;
-static char * cr[CR_SIZE];
+/* Run pending commands of at least min_prio. Returns number of commands. */
+static int run_commands(lua_State * L, int min_prio)
+{
+  shell_queued_t * q;
+  int n = 0, top = lua_gettop(L);
+
+  while (q = shell_pop_command(min_prio), q) {
+    lua_getglobal(L, "doshellcommand");
+    lua_pushstring(L, q->command);
+    shell_command_done(q, lua_call(L, 1, 0) ? -1 : 0);
+    lua_settop(L, top);
+    ++n;
+  }
+  return n;
+}
 
-static int lua_get_shell_command(lua_State * L)
+static int lua_run_shell_commands(lua_State * L)
 {
-  int result = 0;
+  int min_prio = lua_isnumber(L, 1)
+    ? lua_tonumber(L, 1) : SHELL_PRIO_BACKGROUND;
+  int n;
+
+  lua_settop(L, 0);
+  n = run_commands(L, min_prio);
+  lua_pushnumber(L, n);
+  return 1;
+}
 
-  spinlock_lock(&cr_outmutex);
-  if ( cr_in != cr_out ) {
-    lua_pushstring(L, cr[cr_out]);
-    free(cr[cr_out]);
-    cr[cr_out] = 0;
-    cr_out = (cr_out+1)&(CR_SIZE-1);
+/* Yield point : run interactive commands inside long C functions. */
+static void dynshell_yield(void)
+{
+  static int inner;
 
-    result = 1;
+  if (inner) {
+    return;
   }
-  spinlock_unlock(&cr_outmutex);
+  inner = 1;
+  run_commands(shell_lua_state, SHELL_PRIO_INTERACTIVE);
+  inner = 0;
+}
 
-  return result;
+/* Completion command of a command posted from lua. */
+typedef struct {
+  int prio;
+  char command[1];
+} post_done_t;
+
+/* Command posted from lua is done : queue its completion command with the
+ * same priority. */
+static void post_done(const char * command, int result, void * cookie)
+{
+  post_done_t * done = cookie;
+
+  shell_command_prio(done->command, done->prio, 0, 0);
+  free(done);
+}
+
+static int lua_shell_post(lua_State * L)
+{
+  const char * com = lua_tostring(L, 1);
+  int prio = lua_isnumber(L, 2) ? lua_tonumber(L, 2) : SHELL_PRIO_NORMAL;
+  const char * oncomplete = lua_isstring(L, 3) ? lua_tostring(L, 3) : 0;
+  post_done_t * done = 0;
+  int err;
+
+  if (!com) {
+    printf("shell_post : missing command\n");
+    return 0;
+  }
+  if (oncomplete) {
+    done = malloc(sizeof(*done) + strlen(oncomplete));
+    if (!done) {
+      printf("shell_post : out of memory\n");
+      return 0;
+    }
+    done->prio = prio;
+    strcpy(done->command, oncomplete);
+  }
+  err = shell_command_prio(com, prio, done ? post_done : 0, done);
+  lua_settop(L, 0);
+  if (err) {
+    if (done) {
+      free(done);
+    }
+    return 0;
+  }
+  lua_pushnumber(L, 1);
+  return 1;
+}
+
+static int lua_shell_latency(lua_State * L)
+{
+  static const char * names[SHELL_PRIO_MAX] = {
+    "background", "normal", "interactive"
+  };
+  shell_latency_t lat;
+  int i, reset = lua_gettop(L) >= 1 && !lua_isnil(L,1);
+
+  lua_settop(L,0);
+  lua_newtable(L);
+  for (i=0; i<SHELL_PRIO_MAX; ++i) {
+    shell_latency(i, &lat, reset);
+    lua_pushstring(L, names[i]);
+    lua_newtable(L);
+    lua_pushstring(L, "count");
+    lua_pushnumber(L, lat.count);
+    lua_settable(L, 3);
+    lua_pushstring(L, "avg_ms");
+    lua_pushnumber(L, lat.count ? (float)lat.wait_ms / lat.count : 0);
+    lua_settable(L, 3);
+    lua_pushstring(L, "max_ms");
+    lua_pushnumber(L, lat.max_ms);
+    lua_settable(L, 3);
+    lua_settable(L, 1);
+  }
+  return 1;
 }
 
 //static int dynshell_command(const char * fmt, ...)
@@ -112,15 +212,7 @@ static int dynshell_command(const char * com)
 /*     va_end(args); */
     printf("QUEUE COMMAND <%s>\n", com);
 
-    spinlock_lock(&cr_inmutex);
-    if ( ((cr_in + 1)&(CR_SIZE-1)) != cr_out ) {
-      cr[cr_in] = strdup(com);
-      cr_in = (cr_in+1)&(CR_SIZE-1);
-      result = 0;
-    }
-    spinlock_unlock(&cr_inmutex);
-
-    return result;
+    return shell_command(com);
   }
 
   inner = 1;
@@ -437,7 +529,7 @@ static int lua_malloc_stats(lua_State * L)
 static int push_dir_as_2_tables(lua_State * L, fu_dirent_t * dir, int count,
 				fu_sortdir_f sortdir, int parent)
 {
-  int k,j,i;
+  int k,j,i,ndir;
 
   lua_settop(L,0);
   /*   if (!dir) { */
@@ -447,8 +539,12 @@ static int push_dir_as_2_tables(lua_State * L, fu_dirent_t * dir, int count,
     fu_sort_dir(dir, count, sortdir);
   }
 
+  for (i=ndir=0; i<count; ++i) {
+    ndir += dir[i].size == -1;
+  }
+
   for (k=0; k<2; ++k) {
-    lua_newtable(L);
+    lua_createtable(L, k ? count-ndir : ndir, 1);
     for (j=i=0; i<count; ++i) {
       fu_dirent_t * d = dir+i;
 
@@ -484,7 +580,7 @@ static int push_dir_as_struct(lua_State * L, fu_dirent_t * dir, int count,
     fu_sort_dir(dir, count, sortdir);
   }
 
-  lua_newtable(L);
+  lua_createtable(L, count, 2); /* entries + "n" and "path" */
   table = lua_gettop(L);
 
 
@@ -499,7 +595,7 @@ static int push_dir_as_struct(lua_State * L, fu_dirent_t * dir, int count,
     }
 
     lua_pushnumber(L, ++j);
-    lua_newtable(L);
+    lua_createtable(L, 0, 2);
     entry=lua_gettop(L);
 
     lua_pushstring(L, "name");
@@ -536,6 +632,14 @@ static int push_dir_as_struct(lua_State * L, fu_dirent_t * dir, int count,
  *  -n : sort by name
  *  -h : hide parent and root entry.
  */
+/* Accepts all entries. Reading large directories on slow media is long :
+ * let interactive commands run. */
+static int dirlist_filter(const fu_dirent_t * dir)
+{
+  shell_yield();
+  return dir ? 0 : -1;
+}
+
 static int lua_dirlist(lua_State * L)
 {
   char rpath[2048];
@@ -598,7 +702,7 @@ static int lua_dirlist(lua_State * L)
     rpath[1] = 0;
   }
 
-  count = fu_read_dir(rpath, &dir, 0);
+  count = fu_read_dir(rpath, &dir, dirlist_filter);
   if (count < 0) {
     printf("dirlist : %s [%s] \n", fu_strerr(count), rpath);
     return -3;
@@ -1227,9 +1331,10 @@ static int lua_copy(lua_State * L)
 static int lua_dcar(lua_State * L)
 {
   int nparam = lua_gettop(L);
-  int count=-1, com, value = -1; 
+  int count=-1, com, value = -1, threads = 0;
   const char * command=0, *archive=0, *path=0, *error="bad arguments";
   dcar_option_t opt;
+  uint64 start;
 
   /* Get lua parms */
   if (nparam >= 1) {
@@ -1265,6 +1370,13 @@ static int lua_dcar(lua_State * L)
       break;
     case 'f':
       break;
+    case 'j':
+      threads = 0;
+      while ( (c = command[1] & 255), (c>='0' && c<='9')) {
+	threads = threads * 10 + (c-'0');
+	++command;
+      }
+      break;
     default:
       if (c>='0' && c<='9' && value==-1) {
 	value = c - '0';
@@ -1279,12 +1391,13 @@ static int lua_dcar(lua_State * L)
     }
   }
 
-  
+  start = timer_ms_gettime64();
   switch(com) {
   case 'c': case 'a':
     if (archive && path) {
       int size;
       if (value >= 0) opt.in.compress = value % 10u;
+      opt.in.threads = threads;
       if (com == 'a' && (size=fu_size(archive), size > 0)) {
 	opt.in.skip = size;
       }
@@ -1338,6 +1451,9 @@ static int lua_dcar(lua_State * L)
       printf(" uncompressed : %d\n", opt.out.ubytes);
       printf(" compression  : %d\n",opt.out.cbytes*100/opt.out.ubytes);
     }
+    if (opt.in.threads)
+      printf(" threads      : %d\n",opt.in.threads);
+    printf(" time (ms)    : %d\n",(int)(timer_ms_gettime64() - start));
   }
   lua_settop(L,0);
   lua_pushnumber(L,count);
@@ -1417,6 +1533,21 @@ static int lua_fade(lua_State * L)
   return 1;
 }
 
+static int lua_seek(lua_State * L)
+{
+  int err = -1;
+
+  if (lua_isnumber(L, 1) && lua_tonumber(L, 1) >= 0) {
+    err = playa_seek(1024.0f * lua_tonumber(L, 1));
+  }
+  lua_settop(L,0);
+  if (err) {
+    return 0;
+  }
+  lua_pushnumber(L,1);
+  return 1;
+}
+
 static int lua_volume(lua_State * L)
 {
   int nparam = lua_gettop(L);
@@ -2989,6 +3120,335 @@ static int lua_ramdisk_notify_path(lua_State * L)
   return 0;
 }
 
+static int lua_ramdisk_usage(lua_State * L)
+{
+  fs_ramdisk_usage_t usage;
+  static const struct {
+    const char * name;
+    int offset;
+  } fields[] = {
+    { "max",     offsetof(fs_ramdisk_usage_t, max)     },
+    { "used",    offsetof(fs_ramdisk_usage_t, used)    },
+    { "bytes",   offsetof(fs_ramdisk_usage_t, bytes)   },
+    { "shared",  offsetof(fs_ramdisk_usage_t, shared)  },
+    { "files",   offsetof(fs_ramdisk_usage_t, files)   },
+    { "dirs",    offsetof(fs_ramdisk_usage_t, dirs)    },
+    { "extents", offsetof(fs_ramdisk_usage_t, extents) },
+    { 0 }
+  };
+  int i;
+
+  lua_settop(L,0);
+  if (fs_ramdisk_usage(&usage) < 0) {
+    return 0;
+  }
+  lua_newtable(L);
+  for (i=0; fields[i].name; ++i) {
+    lua_pushstring(L, fields[i].name);
+    lua_pushnumber(L, *(int *)((char *)&usage + fields[i].offset));
+    lua_settable(L, 1);
+  }
+  return 1;
+}
+
+static int lua_cache_stats(lua_State * L)
+{
+  fs_cache_stats_t stats;
+  static const struct {
+    const char * name;
+    int offset;
+  } fields[] = {
+    { "hits",      offsetof(fs_cache_stats_t, hits)      },
+    { "misses",    offsetof(fs_cache_stats_t, misses)    },
+    { "waits",     offsetof(fs_cache_stats_t, waits)     },
+    { "readahead", offsetof(fs_cache_stats_t, readahead) },
+    { "unused",    offsetof(fs_cache_stats_t, unused)    },
+    { "stall_ms",  offsetof(fs_cache_stats_t, stall_ms)  },
+    { "bytes",     offsetof(fs_cache_stats_t, bytes)     },
+    { 0 }
+  };
+  int i, reset = lua_gettop(L) >= 1 && !lua_isnil(L,1);
+
+  lua_settop(L,0);
+  if (fs_cache_stats(&stats, reset) < 0) {
+    return 0;
+  }
+  lua_newtable(L);
+  for (i=0; fields[i].name; ++i) {
+    lua_pushstring(L, fields[i].name);
+    lua_pushnumber(L, *(int *)((char *)&stats + fields[i].offset));
+    lua_settable(L, 1);
+  }
+  return 1;
+}
+
+static int lua_cache_media(lua_State * L)
+{
+  int enable = -1;
+
+  if (lua_gettop(L) >= 1) {
+    enable = !lua_isnil(L,1) && lua_tonumber(L,1) != 0;
+  }
+  enable = fs_cache_media(enable);
+  lua_settop(L,0);
+  if (enable) {
+    lua_pushnumber(L, 1);
+    return 1;
+  }
+  return 0;
+}
+
+static int lua_songlen_load(lua_State * L)
+{
+  const char * fname = lua_isstring(L,1) ? lua_tostring(L,1) : 0;
+  int count = songlen_load(fname);
+
+  lua_settop(L,0);
+  if (count < 0) {
+    return 0;
+  }
+  lua_pushnumber(L, count);
+  return 1;
+}
+
+/* dofile() replacement loading scripts through the bytecode cache. */
+static int lua_cached_dofile(lua_State * L)
+{
+  static const char *const errornames[] =
+    {"ok", "run-time error", "file error", "syntax error",
+     "memory error", "error in error handling"};
+  int oldtop = lua_gettop(L);
+  const char * fname = lua_isstring(L,1) ? lua_tostring(L,1) : 0;
+  int status = luacache_dofile(L, fname);
+
+  if (status == 0) {
+    int nresults = lua_gettop(L) - oldtop;
+    if (nresults > 0) {
+      return nresults;
+    }
+    lua_pushuserdata(L, NULL);  /* at least one result to signal no errors */
+    return 1;
+  }
+  lua_pushnil(L);
+  lua_pushstring(L, errornames[status]);
+  return 2;
+}
+
+static int lua_luacache(lua_State * L)
+{
+  const char * dir;
+
+  if (lua_gettop(L) >= 1) {
+    if (luacache_set_dir(lua_isnil(L,1) ? 0 : lua_tostring(L,1)) < 0) {
+      return 0;
+    }
+  }
+  lua_settop(L,0);
+  dir = luacache_get_dir();
+  if (!dir) {
+    return 0;
+  }
+  lua_pushstring(L, dir);
+  return 1;
+}
+
+static int lua_luacache_stats(lua_State * L)
+{
+  luacache_stats_t stats;
+  static const struct {
+    const char * name;
+    int offset;
+  } fields[] = {
+    { "files",     offsetof(luacache_stats_t, files)    },
+    { "hits",      offsetof(luacache_stats_t, hits)     },
+    { "parse_ms",  offsetof(luacache_stats_t, parse_ms) },
+    { "load_ms",   offsetof(luacache_stats_t, load_ms)  },
+    { "errors",    offsetof(luacache_stats_t, errors)   },
+    { 0 }
+  };
+  int i, reset = lua_gettop(L) >= 1 && !lua_isnil(L,1);
+
+  lua_settop(L,0);
+  luacache_stats(&stats, reset);
+  lua_newtable(L);
+  for (i=0; fields[i].name; ++i) {
+    lua_pushstring(L, fields[i].name);
+    lua_pushnumber(L, *(int *)((char *)&stats + fields[i].offset));
+    lua_settable(L, 1);
+  }
+  return 1;
+}
+
+static int lua_luaprof_start(lua_State * L)
+{
+  int period = lua_tonumber(L,1);
+
+  lua_settop(L,0);
+  if (luaprof_start(L, period) < 0) {
+    return 0;
+  }
+  lua_pushnumber(L, 1);
+  return 1;
+}
+
+static int lua_luaprof_stop(lua_State * L)
+{
+  lua_settop(L,0);
+  lua_pushnumber(L, luaprof_stop());
+  return 1;
+}
+
+static int lua_luaprof_dump(lua_State * L)
+{
+  const char * fname = lua_isstring(L,1)
+    ? lua_tostring(L,1) : "/ram/luaprof.txt";
+  int n = luaprof_dump(fname);
+
+  lua_settop(L,0);
+  if (n < 0) {
+    return 0;
+  }
+  lua_pushnumber(L, n);
+  return 1;
+}
+
+static int lua_luaprof_stats(lua_State * L)
+{
+  luaprof_stats_t stats;
+  static const struct {
+    const char * name;
+    int offset;
+  } fields[] = {
+    { "running",   offsetof(luaprof_stats_t, running)   },
+    { "period_ms", offsetof(luaprof_stats_t, period_ms) },
+    { "samples",   offsetof(luaprof_stats_t, samples)   },
+    { "stacks",    offsetof(luaprof_stats_t, stacks)    },
+    { "lost",      offsetof(luaprof_stats_t, lost)      },
+    { 0 }
+  };
+  int i;
+
+  lua_settop(L,0);
+  luaprof_stats(&stats);
+  lua_newtable(L);
+  for (i=0; fields[i].name; ++i) {
+    lua_pushstring(L, fields[i].name);
+    lua_pushnumber(L, *(int *)((char *)&stats + fields[i].offset));
+    lua_settable(L, 1);
+  }
+  return 1;
+}
+
+static luasrc_t * check_luasrc(lua_State * L)
+{
+  if (lua_tag(L, 1) != luasrc_tag) {
+    printf("luasrc : bad argument, lua source expected.\n");
+    return 0;
+  }
+  return lua_touserdata(L, 1);
+}
+
+static int lua_luasrc_gc(lua_State * L)
+{
+  luasrc_free(lua_touserdata(L, 1));
+  return 0;
+}
+
+static int lua_luasrc_load(lua_State * L)
+{
+  luasrc_t * src = lua_isstring(L,1) ? luasrc_load(lua_tostring(L,1)) : 0;
+
+  lua_settop(L,0);
+  if (!src) {
+    return 0;
+  }
+  lua_pushusertag(L, src, luasrc_tag);
+  return 1;
+}
+
+static int lua_luasrc_lines(lua_State * L)
+{
+  luasrc_t * src = check_luasrc(L);
+
+  if (!src) {
+    return 0;
+  }
+  lua_settop(L,0);
+  lua_pushnumber(L, luasrc_lines(src));
+  return 1;
+}
+
+/* Lines range arguments (starting at 1) to luasrc ones. */
+static void luasrc_range(lua_State * L, luasrc_t * src, int * first, int * last)
+{
+  *first = lua_isnumber(L,2) ? lua_tonumber(L,2) - 1 : 0;
+  *last = lua_isnumber(L,3) ? lua_tonumber(L,3) - 1 : luasrc_lines(src) - 1;
+}
+
+static int lua_luasrc_zml(lua_State * L)
+{
+  luasrc_t * src = check_luasrc(L);
+  int first, last, len;
+  char * zml;
+
+  if (!src) {
+    return 0;
+  }
+  luasrc_range(L, src, &first, &last);
+  lua_settop(L,0);
+  zml = luasrc_zml(src, first, last, &len);
+  if (!zml) {
+    return 0;
+  }
+  lua_pushlstring(L, zml, len);
+  free(zml);
+  return 1;
+}
+
+static int lua_luasrc_spans(lua_State * L)
+{
+  static const char * kinds[LUA_LEXKINDS] = {
+    "space", "name", "keyword", "comment", "string", "number", "punct",
+    "funcname", "funcdef"
+  };
+  luasrc_t * src = check_luasrc(L);
+  lua_LexSpan * spans;
+  int first, last, i;
+
+  if (!src) {
+    return 0;
+  }
+  luasrc_range(L, src, &first, &last);
+  if (!lua_isnumber(L,3)) {
+    last = first;
+  }
+  lua_settop(L,0);
+  spans = malloc((luasrc_maxlen(src) + 1) * sizeof(*spans));
+  if (!spans) {
+    return 0;
+  }
+  lua_newtable(L);
+  for (i=first; i<=last; ++i) {
+    const char * text;
+    int len, n, k;
+
+    n = luasrc_spans(src, i, spans, luasrc_maxlen(src) + 1, &text, &len);
+    if (n < 0) {
+      break;
+    }
+    lua_newtable(L);
+    for (k=0; k<n; ++k) {
+      lua_pushstring(L, kinds[spans[k].kind]);
+      lua_rawseti(L, 2, 2*k+1);
+      lua_pushlstring(L, text + spans[k].start, spans[k].len);
+      lua_rawseti(L, 2, 2*k+2);
+    }
+    lua_rawseti(L, 1, i - first + 1);
+  }
+  free(spans);
+  return 1;
+}
+
 /* defined in keyboard.c */
 extern volatile int kbd_present;
 static int lua_keyboard_present(lua_State * L)
@@ -3027,11 +3487,127 @@ static int LUA_getgccount(lua_State * L)
 
 static int lua_collect(lua_State * L)
 {
-  luaC_collect(L, (int) lua_tonumber(L, 1));
+  if (lua_gettop(L) < 1 || lua_isnil(L, 1)) {
+    /* Frame slice */
+    lua_gcstep(L, shell_gc_budget());
+  } else {
+    luaC_collect(L, (int) lua_tonumber(L, 1));
+  }
   //  printf("collect %d\n", (int) lua_tonumber(L, 1));
   return 0;
 }
 
+static int lua_gcpace(lua_State * L)
+{
+  int pause, stepmul, minkb;
+
+  lua_setgcpace(L,
+		lua_isnumber(L, 1) ? lua_tonumber(L, 1) : 0,
+		lua_isnumber(L, 2) ? lua_tonumber(L, 2) : -1,
+		lua_isnumber(L, 3) ? lua_tonumber(L, 3) : -1);
+  lua_getgcpace(L, &pause, &stepmul, &minkb);
+  lua_settop(L, 0);
+  lua_pushnumber(L, pause);
+  lua_pushnumber(L, stepmul);
+  lua_pushnumber(L, minkb);
+  return 3;
+}
+
+static int lua_gcstats(lua_State * L)
+{
+  lua_GCStats stats;
+  static const struct {
+    const char * name;
+    int offset;
+  } fields[] = {
+    { "cycles",   offsetof(lua_GCStats, cycles)   },
+    { "steps",    offsetof(lua_GCStats, steps)    },
+    { "forced",   offsetof(lua_GCStats, forced)   },
+    { "totalms",  offsetof(lua_GCStats, totalms)  },
+    { "maxpause", offsetof(lua_GCStats, maxpause) },
+    { 0 }
+  };
+  int i, reset = lua_gettop(L) >= 1 && !lua_isnil(L,1);
+
+  lua_getgcstats(L, &stats, reset);
+  lua_settop(L,0);
+  lua_newtable(L);
+  for (i=0; fields[i].name; ++i) {
+    lua_pushstring(L, fields[i].name);
+    lua_pushnumber(L,
+		   *(unsigned long *)((char *)&stats + fields[i].offset));
+    lua_settable(L, 1);
+  }
+  lua_pushstring(L, "histo");
+  lua_newtable(L);
+  for (i=0; i<LUA_GCHISTO; ++i) {
+    lua_pushnumber(L, stats.histo[i]);
+    lua_rawseti(L, 3, i+1);
+  }
+  lua_settable(L, 1);
+  return 1;
+}
+
+static int lua_memstats(lua_State * L)
+{
+  lua_MemStats stats;
+  static const struct {
+    const char * name;
+    int offset;
+  } fields[] = {
+    { "chunks",    offsetof(lua_MemStats, chunks)    },
+    { "freepages", offsetof(lua_MemStats, freepages) },
+    { "small",     offsetof(lua_MemStats, small)     },
+    { "big",       offsetof(lua_MemStats, big)       },
+    { "peak",      offsetof(lua_MemStats, peak)      },
+    { "limit",     offsetof(lua_MemStats, limit)     },
+    { "fails",     offsetof(lua_MemStats, fails)     },
+    { "allocs",    offsetof(lua_MemStats, allocs)    },
+    { 0 }
+  };
+  int i, reset = lua_gettop(L) >= 1 && !lua_isnil(L,1);
+
+  lua_getmemstats(L, &stats, reset);
+  lua_settop(L,0);
+  lua_newtable(L);
+  for (i=0; fields[i].name; ++i) {
+    lua_pushstring(L, fields[i].name);
+    lua_pushnumber(L,
+		   *(unsigned long *)((char *)&stats + fields[i].offset));
+    lua_settable(L, 1);
+  }
+  lua_pushstring(L, "classes");
+  lua_newtable(L);
+  for (i=0; i<LUA_MEMCLASSES; ++i) {
+    lua_newtable(L);
+    lua_pushstring(L, "size");
+    lua_pushnumber(L, stats.cls[i].size);
+    lua_settable(L, 4);
+    lua_pushstring(L, "pages");
+    lua_pushnumber(L, stats.cls[i].pages);
+    lua_settable(L, 4);
+    lua_pushstring(L, "live");
+    lua_pushnumber(L, stats.cls[i].live);
+    lua_settable(L, 4);
+    lua_rawseti(L, 3, i+1);
+  }
+  lua_settable(L, 1);
+  return 1;
+}
+
+static int lua_memlimit(lua_State * L)
+{
+  lua_MemStats stats;
+
+  if (lua_isnumber(L, 1)) {
+    lua_setmemlimit(L, lua_tonumber(L, 1));
+  }
+  lua_getmemstats(L, &stats, 0);
+  lua_settop(L, 0);
+  lua_pushnumber(L, stats.limit >> 10);
+  return 1;
+}
+
 #include "fifo.h"
 static int lua_fifo_used(lua_State * L)
 {
@@ -3194,6 +3770,128 @@ static luashell_command_description_t commands[] = {
     ,
     SHELL_COMMAND_C, lua_ramdisk_notify_path
   },
+  {
+    "ramdisk_usage",0,0,
+    "ramdisk_usage() : "
+    "Get ramdisk memory usage table {max, used, bytes, shared, files, dirs,"
+    " extents}."
+    ,
+    SHELL_COMMAND_C, lua_ramdisk_usage
+  },
+  {
+    "cache_stats",0,0,
+    "cache_stats([reset]) : "
+    "Get \"/cache\" filesystem statistics table {hits, misses, waits,"
+    " readahead, unused, stall_ms, bytes}. Clear them if reset is set."
+    ,
+    SHELL_COMMAND_C, lua_cache_stats
+  },
+  {
+    "cache_media",0,0,
+    "cache_media([enable]) : "
+    "Get or set whether music on slow media (\"/cd\", \"/pc\") is played"
+    " through the \"/cache\" filesystem. Returns previous state."
+    ,
+    SHELL_COMMAND_C, lua_cache_media
+  },
+  {
+    "songlen_load",0,0,
+    "songlen_load([file]) : "
+    "Load a song length database (HVSC Songlengths.md5 format) used by"
+    " chip music players instead of detecting track ends. Clear it if no"
+    " file is given. Returns the number of files or nil on error."
+    ,
+    SHELL_COMMAND_C, lua_songlen_load
+  },
+  {
+    "dofile",0,0,
+    "dofile(filename) : "
+    "Run a lua script. Precompiled bytecode is saved in the lua cache"
+    " directory and used while the script is unchanged."
+    ,
+    SHELL_COMMAND_C, lua_cached_dofile
+  },
+  {
+    "luacache",0,0,
+    "luacache([dir]) : "
+    "Get or set lua bytecode cache directory. \"\" (default) saves bytecode"
+    " next to the scripts, except on /cd, /ram and /vmu. nil disables the"
+    " cache. Returns the directory or nil."
+    ,
+    SHELL_COMMAND_C, lua_luacache
+  },
+  {
+    "luacache_stats",0,0,
+    "luacache_stats([reset]) : "
+    "Get lua bytecode cache statistics table {files, hits, parse_ms,"
+    " load_ms, errors}. Clear them if reset is set."
+    ,
+    SHELL_COMMAND_C, lua_luacache_stats
+  },
+  {
+    "luaprof_start",0,0,
+    "luaprof_start([period_ms]) : "
+    "Start sampling lua call stacks every period_ms (default 5)."
+    " Previous samples are cleared. Returns nil on error."
+    ,
+    SHELL_COMMAND_C, lua_luaprof_start
+  },
+  {
+    "luaprof_stop",0,0,
+    "luaprof_stop() : "
+    "Stop lua profiler and return the number of samples."
+    ,
+    SHELL_COMMAND_C, lua_luaprof_stop
+  },
+  {
+    "luaprof_dump",0,0,
+    "luaprof_dump([filename]) : "
+    "Write lua profiler samples as flamegraph folded stacks (default"
+    " /ram/luaprof.txt). Returns the number of stacks or nil on error."
+    ,
+    SHELL_COMMAND_C, lua_luaprof_dump
+  },
+  {
+    "luaprof_stats",0,0,
+    "luaprof_stats() : "
+    "Get lua profiler statistics table {running, period_ms, samples,"
+    " stacks, lost}."
+    ,
+    SHELL_COMMAND_C, lua_luaprof_stats
+  },
+  {
+    "luasrc_load",0,0,
+    "luasrc_load(filename) : "
+    "Load a lua source for viewing. Returns a lua source or nil."
+    ,
+    SHELL_COMMAND_C, lua_luasrc_load
+  },
+  {
+    "luasrc_lines",0,0,
+    "luasrc_lines(src) : "
+    "Get number of lines of a lua source."
+    ,
+    SHELL_COMMAND_C, lua_luasrc_lines
+  },
+  {
+    "luasrc_zml",0,0,
+    "luasrc_zml(src, [first], [last]) : "
+    "Get colorized zml of lines first to last (default all) of a lua"
+    " source, using lua_colorize.lua macros. Only the lines before last"
+    " not scanned yet are scanned."
+    ,
+    SHELL_COMMAND_C, lua_luasrc_zml
+  },
+  {
+    "luasrc_spans",0,0,
+    "luasrc_spans(src, first, [last]) : "
+    "Get tokens of lines first to last (default first) of a lua source,"
+    " as a list of lines. Each line is a list of kind and text pairs;"
+    " kinds are space, name, keyword, comment, string, number, punct,"
+    " funcname and funcdef."
+    ,
+    SHELL_COMMAND_C, lua_luasrc_spans
+  },
 
   /* file commands */
   { 
@@ -3250,6 +3948,8 @@ static luashell_command_description_t commands[] = {
     "  options:\n"
     "    v : verbose.\n"
     "    f : ignored.\n"
+    "    0-9 : compression level.\n"
+    "    jN : compress with N threads.\n"
     ,
     SHELL_COMMAND_C, lua_dcar
   },
@@ -3424,6 +4124,15 @@ static luashell_command_description_t commands[] = {
     SHELL_COMMAND_C, lua_fade
   },
 
+  {
+    "playa_seek","seek",0,
+    "seek(seconds) : Seek current music to seconds from its start.\n"
+    " Returns nil if the music driver can not seek or seconds is past\n"
+    " the end of the music."
+    ,
+    SHELL_COMMAND_C, lua_seek
+  },
+
   {
     "playa_volume","volume",0,
     "volume([volume]) : Get/Set music volume.\n"
@@ -3580,12 +4289,56 @@ static luashell_command_description_t commands[] = {
 
   {
     "collect",0,0,
-    "collect(step) :\n"
-    "Perform the given number of step of garbage collection."
+    "collect([step]) :\n"
+    "Perform the given number of step of garbage collection. Without"
+    " step, perform the frame slice of the incremental collector within"
+    " the current frame budget."
     ,
     SHELL_COMMAND_C, lua_collect
   },
 
+  {
+    "gcpace",0,0,
+    "gcpace([pause], [stepmul], [min]) :\n"
+    "Set and return incremental garbage collector pacing. pause is the"
+    " threshold after a cycle in percent of memory in use, stepmul the work"
+    " of a step triggered by allocation (0 for a full cycle) and min the"
+    " minimum threshold in Kbytes."
+    ,
+    SHELL_COMMAND_C, lua_gcpace
+  },
+
+  {
+    "gcstats",0,0,
+    "gcstats([reset]) :\n"
+    "Get garbage collector statistics table {cycles, steps, forced,"
+    " totalms, maxpause, histo}. histo counts steps by duration"
+    " (0, 1, 2-3, 4-7, 8-15, 16+ ms). Clear them if reset is set."
+    ,
+    SHELL_COMMAND_C, lua_gcstats
+  },
+
+  {
+    "memstats",0,0,
+    "memstats([reset]) :\n"
+    "Get lua memory arena statistics table {chunks, freepages, small, big,"
+    " peak, limit, fails, allocs, classes}. classes lists {size, pages,"
+    " live} for each small block size class; pages are 4K. Reset clears"
+    " peak, fails and allocs."
+    ,
+    SHELL_COMMAND_C, lua_memstats
+  },
+
+  {
+    "memlimit",0,0,
+    "memlimit([kb]) :\n"
+    "Get or set the hard cap on lua memory in Kbytes (0 for none)."
+    " Near the cap the collector runs full cycles; allocations above it"
+    " fail with a memory error."
+    ,
+    SHELL_COMMAND_C, lua_memlimit
+  },
+
 
   /* general commands */
   {
@@ -3679,11 +4432,31 @@ static luashell_command_description_t commands[] = {
   },
 
   {
-    "shell_get_command",0,"shell",
-    "shell_get_command() :\n"
-    " Get next external command from queue.\n"
+    "shell_run_commands",0,"shell",
+    "shell_run_commands([min_prio]) :\n"
+    " Run pending commands, highest priority first, and return their"
+    " number. Only commands with at least min_prio priority are run.\n"
     ,
-    SHELL_COMMAND_C, lua_get_shell_command
+    SHELL_COMMAND_C, lua_run_shell_commands
+  },
+  {
+    "shell_post",0,"shell",
+    "shell_post(command, [prio], [oncomplete]) :\n"
+    " Queue a command with given priority (shell_prio_background,"
+    " shell_prio_normal or shell_prio_interactive, default normal). Interactive commands also run inside long"
+    " operations (copy, dcar, dirlist). The oncomplete command is queued"
+    " with the same priority once command has run.\n"
+    ,
+    SHELL_COMMAND_C, lua_shell_post
+  },
+  {
+    "shell_latency",0,"shell",
+    "shell_latency([reset]) :\n"
+    " Get time spent by commands in queue per priority, as a table"
+    " {background, normal, interactive} of {count, avg_ms, max_ms}."
+    " Clear them if reset is set.\n"
+    ,
+    SHELL_COMMAND_C, lua_shell_latency
   },
 
   {
@@ -3736,6 +4509,19 @@ static void shell_register_lua_commands()
   // song type
   song_tag = lua_newtag(L);
 
+  // lua source type (see luasrc_load())
+  luasrc_tag = lua_newtag(L);
+  lua_pushcfunction(L, lua_luasrc_gc);
+  lua_settagmethod(L, luasrc_tag, "gc");
+
+  /* shell command priorities (see shell_post()) */
+  lua_pushnumber(L, SHELL_PRIO_BACKGROUND);
+  lua_setglobal(L, "shell_prio_background");
+  lua_pushnumber(L, SHELL_PRIO_NORMAL);
+  lua_setglobal(L, "shell_prio_normal");
+  lua_pushnumber(L, SHELL_PRIO_INTERACTIVE);
+  lua_setglobal(L, "shell_prio_interactive");
+
   /* New garbage collection threshold adaptative behaviour */
 /*  lua_pushcfunction(L, setgcthreshold);
   lua_settagmethod(L, LUA_TNIL, "gc");*/
@@ -3765,7 +4551,7 @@ static void shell_register_lua_commands()
 
   /* luanch the init script */
   printf("running init file [%s]\n",initfile);
-  lua_dofile(L, initfile);
+  luacache_dofile(L, initfile);
 
   /* register helps */
   for (i=0; commands[i].name; i++) {
@@ -3796,23 +4582,17 @@ void shell_lua_fputs(const char * s)
 
 static void shutdown()
 {
-  int i;
-
   printf("shell: Shutting down dynamic shell\n");
 
   lua_dostring(shell_lua_state, "dynshell_shutdown()");
 
   shell_set_command_func(old_command_func);
+  shell_set_yield_func(old_yield_func);
 
   lua_close(shell_lua_state);
   
   controler_binding(-1,-1);
 
-  spinlock_lock(&cr_inmutex);
-  for (i=0; i<CR_SIZE; i++)
-    if (cr[i])
-      free(cr[i]);
-
   sem_destroy(framecounter_sema);
 }
 
@@ -3842,6 +4622,7 @@ shutdown_func_t lef_main()
   shell_register_lua_commands();
 
   old_command_func = shell_set_command_func(dynshell_command);
+  old_yield_func = shell_set_yield_func(dynshell_yield);
 
   printf("shell: dynamic shell initialized.\n");
 
@@ -24,6 +24,11 @@ DCPLAYA_EXTERN_C_START
  *    dcar is a tar-like file archiver. Like tar the archive could be
  *    compressed with gzip. The whole archive file is compressed at once.
  *
+ *    When creating an archive, data is deflated by independent chunks that
+ *    may be processed by a pool of threads (see dcar_option_t::in::threads).
+ *    Chunks are written in order as a single gzip stream, so the archive
+ *    format is not changed.
+ *
  *    dcar is used for dcplaya vmu files. 
  *
  *    @b limitations: filename are limited to 32 characters.
@@ -79,6 +84,7 @@ typedef struct {
     dcar_filter_f filter;   /**< Filter function to use. 0 for default.     */
     int compress;           /**< Compress level [0..9].                     */
     int skip;               /**< Number of byte to skip at start of file.   */
+    int threads;            /**< Number of compression threads (0:none).    */
   } in;
 
   /** dcplaya archive returned info. */
@@ -145,6 +151,9 @@ int dcar_simulate(const char *path, dcar_option_t * opt);
 /** Create an archive.
  *
  *    The dcar_create() function creates a new archive from a given path.
+ *    If opt->in.threads is not zero, compression is done by that many
+ *    worker threads while the caller thread reads files and writes
+ *    compressed chunks in order.
  *
  *  @param  name  Name of archive file to create.
  *  @param  path  Directory to archive
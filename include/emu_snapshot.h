@@ -0,0 +1,102 @@
+/**
+ * @ingroup dcplaya_emusnap_devel
+ * @file    emu_snapshot.h
+ * @brief   Emulator state snapshots for seeking.
+ *
+ * $Id$
+ */
+
+#ifndef _EMU_SNAPSHOT_H_
+#define _EMU_SNAPSHOT_H_
+
+#include "extern_def.h"
+
+DCPLAYA_EXTERN_C_START
+
+/** @defgroup dcplaya_emusnap_devel Emulator snapshots
+ *  @ingroup  dcplaya_devel
+ *  @brief    emulator state snapshots for seeking.
+ *
+ *    Chip music emulators can only reach a position by emulating from
+ *    the start. Input drivers save their emulator state every period
+ *    while playing (and while fast emulating for a seek), so a seek
+ *    restores the nearest snapshot before the target and only emulates
+ *    the remainder.
+ *
+ *    Time is in the driver unit (frames or samples), it only has to
+ *    increase with the song position. When a new snapshot would exceed
+ *    the memory budget one snapshot out of two is freed and the period
+ *    is doubled, so a long song keeps snapshots all along.
+ *
+ *  @warning  Not thread safe : use it from the decoder thread only.
+ *  @{
+ */
+
+/** Snapshot list. */
+typedef struct emu_snapshot_s emu_snapshot_t;
+
+/** Snapshot list statistics. */
+typedef struct {
+  int count;            /**< Number of snapshots.                 */
+  int bytes;            /**< Memory used by snapshots.            */
+  unsigned int period;  /**< Current period (driver unit).        */
+  unsigned int last;    /**< Time of the last snapshot.           */
+} emu_snapshot_stats_t;
+
+/** Create a snapshot list.
+ *
+ *  @param  period     Time between two snapshots (driver unit).
+ *  @param  max_bytes  Memory budget.
+ *
+ *  @return snapshot list
+ *  @retval 0 error
+ */
+emu_snapshot_t * emu_snapshot_create(unsigned int period, int max_bytes);
+
+/** Destroy a snapshot list (0 is ignored). */
+void emu_snapshot_destroy(emu_snapshot_t * snap);
+
+/** Free all snapshots and restore the initial period (new song). */
+void emu_snapshot_clear(emu_snapshot_t * snap);
+
+/** Get the time at which the next snapshot should be taken. */
+unsigned int emu_snapshot_next(const emu_snapshot_t * snap);
+
+/** Allocate a new snapshot.
+ *
+ *    Snapshots are kept in time order : a time not after the last
+ *    snapshot is refused.
+ *
+ *  @param  snap  Snapshot list.
+ *  @param  time  Snapshot time.
+ *  @param  size  State size in bytes.
+ *
+ *  @return buffer to save the emulator state into
+ *  @retval 0 refused or no memory
+ */
+void * emu_snapshot_add(emu_snapshot_t * snap, unsigned int time, int size);
+
+/** Remove the last snapshot (its state could not be saved). */
+void emu_snapshot_cancel(emu_snapshot_t * snap);
+
+/** Find the latest snapshot at or before a time.
+ *
+ *  @param  snap  Snapshot list.
+ *  @param  time  Target time.
+ *  @param  at    Returned snapshot time.
+ *
+ *  @return saved emulator state
+ *  @retval 0 no snapshot before time
+ */
+const void * emu_snapshot_find(const emu_snapshot_t * snap,
+			       unsigned int time, unsigned int * at);
+
+/** Get snapshot list statistics. */
+void emu_snapshot_stats(const emu_snapshot_t * snap,
+			emu_snapshot_stats_t * stats);
+
+/**@}*/
+
+DCPLAYA_EXTERN_C_END
+
+#endif /* #ifndef _EMU_SNAPSHOT_H_ */
@@ -0,0 +1,112 @@
+/**
+ * @ingroup dcplaya_cache_devel
+ * @file    fs_cache.h
+ * @brief   Read-ahead block cache for KOS file system
+ *
+ * $Id$
+ */
+
+#ifndef _FS_CACHE_H_
+#define _FS_CACHE_H_
+
+#include "extern_def.h"
+
+DCPLAYA_EXTERN_C_START
+
+#include <arch/types.h>
+#include <kos/fs.h>
+
+/** @defgroup dcplaya_cache_devel Cache Filesystem
+ *  @ingroup  dcplaya_fs_devel
+ *  @brief    read-ahead block cache filesystem
+ *
+ *    The cache filesystem is mounted on "/cache". It gives a cached read
+ *    only access to any other filesystem path : "/cache/cd/foo.mp3" reads
+ *    "/cd/foo.mp3". It is intended for slow media (CD, tcpfs, httpfs).
+ *
+ *    Files are read by blocks kept in a LRU pool. When a file is read
+ *    sequentially, a background thread reads the following blocks ahead,
+ *    so that decoders small reads do not stall on the media.
+ *
+ *  @{
+ */
+
+/** Cache parameters. */
+typedef struct {
+  int block_size; /**< Block size in bytes, power of 2 (0:default).      */
+  int max_bytes;  /**< Memory used by blocks (0:default).                */
+  int readahead;  /**< Number of blocks read ahead (0:default, <0:none). */
+} fs_cache_param_t;
+
+/** Cache statistics. */
+typedef struct {
+  int hits;       /**< Block found in cache.                          */
+  int misses;     /**< Block read synchronously.                      */
+  int waits;      /**< Block found being read ahead.                  */
+  int readahead;  /**< Blocks read ahead.                             */
+  int unused;     /**< Blocks read ahead and evicted without use.     */
+  int stall_ms;   /**< Time spent by readers waiting for media (ms).  */
+  int bytes;      /**< Bytes read through the cache.                  */
+} fs_cache_stats_t;
+
+/** @name Initialization functions
+ *  @{
+ */
+
+/** Initialize the cache filesystem.
+ *
+ *  @param  param  Cache parameters (0 for default).
+ *
+ *  @return error-code
+ *  @retval 0 success
+ *  @retval -1 error
+ */
+int dcpfs_cache_init(const fs_cache_param_t * param);
+
+/** Shutdown the cache filesystem. */
+int dcpfs_cache_shutdown(void);
+
+/**@}*/
+
+/** Get cache statistics.
+ *
+ *  @param  stats  Pointer to statistics to fill (may be 0).
+ *  @param  reset  Clear statistics after reading.
+ *
+ *  @return error-code
+ *  @retval 0 success
+ *  @retval -1 error (no cache)
+ */
+int fs_cache_stats(fs_cache_stats_t * stats, int reset);
+
+/** Select slow media read through the cache by fs_cache_path().
+ *
+ *    "/cd" and "/pc" (tcpfs) paths are routed through the cache by
+ *    default.
+ *
+ *  @param  enable  0:disable, 1:enable, <0:no change.
+ *
+ *  @return previous state
+ */
+int fs_cache_media(int enable);
+
+/** Get the path to open a file with.
+ *
+ *    Used by the player before starting a decoder, so that slow media
+ *    files are read through the cache : "/cd/foo.mp3" gives
+ *    "/cache/cd/foo.mp3". Other paths, or all paths if the cache is not
+ *    initialized or disabled by fs_cache_media(), are returned unchanged.
+ *
+ *  @param  tmp  Buffer for the rewritten path.
+ *  @param  max  Size of tmp.
+ *  @param  fn   Path to open.
+ *
+ *  @return either fn or tmp
+ */
+const char * fs_cache_path(char * tmp, int max, const char * fn);
+
+/**@}*/
+
+DCPLAYA_EXTERN_C_END
+
+#endif /* #ifndef _FS_CACHE_H_ */
@@ -37,7 +37,8 @@ DCPLAYA_EXTERN_C_START
 
 /** Initialize the RAMdisk filesystem.
  *
- *  @param max_size Maximum size of ramdisk (0:default) (NOT USED!!)
+ *  @param max_size Maximum memory used by the ramdisk in bytes, including
+ *                  nodes and allocation overhead (0:unlimited).
  *  @return error-code
  *  @retval 0 success
  *  @retval -1 error
@@ -74,6 +75,47 @@ int fs_ramdisk_notify_path(const char *path);
 
 /**@}*/
 
+/** @name Storage functions
+ *  @{
+ */
+
+/** Ramdisk memory usage. */
+typedef struct {
+  int max;      /**< Memory budget in bytes (0:unlimited).           */
+  int used;     /**< Allocated bytes (data, nodes and tables).       */
+  int bytes;    /**< Sum of file sizes.                              */
+  int shared;   /**< Bytes saved by copy-on-write sharing.           */
+  int files;    /**< Number of regular files.                        */
+  int dirs;     /**< Number of directories (root excluded).          */
+  int extents;  /**< Number of allocated data extents.               */
+} fs_ramdisk_usage_t;
+
+/** Get ramdisk memory usage.
+ *
+ *  @param  usage  Pointer to usage structure to fill.
+ *
+ *  @return error-code
+ *  @retval 0 success
+ *  @retval -1 error (no ramdisk)
+ */
+int fs_ramdisk_usage(fs_ramdisk_usage_t * usage);
+
+/** Copy a ramdisk file to another ramdisk file without copying data.
+ *
+ *    The fs_ramdisk_copy() function creates (or replaces) dstname
+ *    sharing srcname data. Data is really copied only when one of the
+ *    file is written (copy on write).
+ *
+ *  @param  dstname  Destination file full path ("/ram/...").
+ *  @param  srcname  Source file full path ("/ram/...").
+ *
+ *  @return number of bytes copied
+ *  @retval -1 error (including non ramdisk paths)
+ */
+int fs_ramdisk_copy(const char * dstname, const char * srcname);
+
+/**@}*/
+
 /**@}*/
 
 DCPLAYA_EXTERN_C_END
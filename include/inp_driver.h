@@ -66,6 +66,13 @@ typedef struct
   /** Get file info. Can be use as is_mine() function. */
   int (*info)(playa_info_t * info, const char *fn);
 
+  /** Seek current file to ms milliseconds (1000th of second) from its
+   *  start. Called by the decoder thread between two decode() calls,
+   *  it must drop any pending PCM. 0 if the driver can not seek.
+   *  Returns 0 on success, -1 on error or if ms is past the end.
+   */
+  int (*seek)(unsigned int ms, playa_info_t *info);
+
 } inp_driver_t;
 
 /**@}*/
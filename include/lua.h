@@ -137,6 +137,7 @@ LUA_API void  lua_getglobals (lua_State *L);
 LUA_API void  lua_gettagmethod (lua_State *L, int tag, const char *event);
 LUA_API int   lua_getref (lua_State *L, int ref);
 LUA_API void  lua_newtable (lua_State *L);
+LUA_API void  lua_createtable (lua_State *L, int narr, int nrec);
 
 
 /*
@@ -159,6 +160,11 @@ LUA_API void  lua_rawcall (lua_State *L, int nargs, int nresults);
 LUA_API int   lua_dofile (lua_State *L, const char *filename);
 LUA_API int   lua_dostring (lua_State *L, const char *str);
 LUA_API int   lua_dobuffer (lua_State *L, const char *buff, size_t size, const char *name);
+LUA_API int   lua_loadbuffer (lua_State *L, const char *buff, size_t size, const char *name);
+
+/* save the Lua function on top of the stack as a binary chunk */
+typedef int (*lua_Writer) (const void *p, size_t size, void *ud);
+LUA_API int   lua_dump (lua_State *L, lua_Writer writer, void *data);
 
 /*
 ** Garbage-collection functions
@@ -167,6 +173,46 @@ LUA_API int   lua_getgcthreshold (lua_State *L);
 LUA_API int   lua_getgccount (lua_State *L);
 LUA_API void  lua_setgcthreshold (lua_State *L, int newthreshold);
 
+/* incremental collector pacing */
+#define LUA_GCHISTO	6	/* pause histogram size */
+
+typedef struct lua_GCStats {
+  unsigned long cycles;    /* completed collection cycles */
+  unsigned long steps;     /* collection steps */
+  unsigned long forced;    /* steps triggered by allocation */
+  unsigned long totalms;   /* time spent collecting (ms) */
+  unsigned long maxpause;  /* longest step (ms) */
+  unsigned long histo[LUA_GCHISTO];  /* steps by duration: 0, 1, 2-3,
+                                        4-7, 8-15, 16+ ms */
+} lua_GCStats;
+
+LUA_API void  lua_gcstep (lua_State *L, int work);
+LUA_API void  lua_setgcpace (lua_State *L, int pause, int stepmul, int minkb);
+LUA_API void  lua_getgcpace (lua_State *L, int *pause, int *stepmul, int *minkb);
+LUA_API void  lua_getgcstats (lua_State *L, lua_GCStats *stats, int reset);
+
+/* memory arena: small blocks by size class, shared by all states */
+#define LUA_MEMCLASSES	16
+
+typedef struct lua_MemStats {
+  unsigned long chunks;     /* 64K chunks taken from the system */
+  unsigned long freepages;  /* 4K pages of the chunks used by no class */
+  unsigned long small;      /* bytes used by small blocks (class sizes) */
+  unsigned long big;        /* bytes used by big blocks (system allocator) */
+  unsigned long peak;       /* highest small+big */
+  unsigned long limit;      /* hard cap on small+big (0: none) */
+  unsigned long fails;      /* allocations refused by the cap */
+  unsigned long allocs;     /* allocations */
+  struct {
+    unsigned long size;     /* block size */
+    unsigned long pages;    /* pages serving this class */
+    unsigned long live;     /* bytes in use */
+  } cls[LUA_MEMCLASSES];
+} lua_MemStats;
+
+LUA_API void  lua_setmemlimit (lua_State *L, int limitkb);
+LUA_API void  lua_getmemstats (lua_State *L, lua_MemStats *stats, int reset);
+
 /*
 ** miscellaneous functions
 */
@@ -0,0 +1,89 @@
+/**
+ * @ingroup dcplaya_luacache_devel
+ * @file    luacache.h
+ * @brief   Precompiled lua script cache
+ *
+ * $Id$
+ */
+
+#ifndef _LUACACHE_H_
+#define _LUACACHE_H_
+
+#include "extern_def.h"
+
+DCPLAYA_EXTERN_C_START
+
+#include "lua.h"
+
+/** @defgroup dcplaya_luacache_devel Lua script cache
+ *  @ingroup  dcplaya_shell_devel
+ *  @brief    precompiled lua script cache
+ *
+ *    Lua scripts loaded through luacache_dofile() are compiled once and
+ *    their bytecode is saved in the cache directory. Next loads of an
+ *    unchanged script run the saved bytecode instead of parsing the source
+ *    again. A cache entry is keyed on the source size and CRC (KOS file
+ *    systems do not give modification time).
+ *
+ *    By default bytecode is saved next to the sources ("foo.lua" gives
+ *    "foo.luac"), which persists across boots on /pc. Scripts on /cd,
+ *    /ram and /vmu are not cached in this mode, so a CD boot does not use
+ *    the cache unless a cache directory is set.
+ *
+ *  @{
+ */
+
+/** Lua script cache statistics. */
+typedef struct {
+  int files;      /**< Scripts loaded.                              */
+  int hits;       /**< Scripts loaded from precompiled bytecode.    */
+  int parse_ms;   /**< Time spent parsing sources (ms).             */
+  int load_ms;    /**< Time spent loading bytecode (ms).            */
+  int errors;     /**< Cache files that could not be written.       */
+} luacache_stats_t;
+
+/** Load and run a lua script through the cache.
+ *
+ *    Behaves like lua_dofile().
+ *
+ *  @param  L      Lua state.
+ *  @param  fname  Script filename.
+ *
+ *  @return lua_dofile() status
+ */
+int luacache_dofile(lua_State * L, const char * fname);
+
+/** Set cache directory.
+ *
+ *  @param  dir  Cache directory ("" : next to sources, the default,
+ *               0 : disable cache).
+ *
+ *  @return error-code
+ *  @retval 0 success
+ *  @retval -1 error (directory can not be created)
+ */
+int luacache_set_dir(const char * dir);
+
+/** Get cache directory (0 if cache is disabled). */
+const char * luacache_get_dir(void);
+
+/** Enable or disable per script timing report.
+ *
+ *  @param  report  New report status (<0 to leave it unchanged).
+ *
+ *  @return previous report status
+ */
+int luacache_report(int report);
+
+/** Get cache statistics.
+ *
+ *  @param  stats  Pointer to statistics to fill (may be 0).
+ *  @param  reset  Clear statistics after reading.
+ */
+void luacache_stats(luacache_stats_t * stats, int reset);
+
+/**@}*/
+
+DCPLAYA_EXTERN_C_END
+
+#endif /* #ifndef _LUACACHE_H_ */
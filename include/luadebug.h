@@ -15,6 +15,7 @@ typedef struct lua_Debug lua_Debug;  /* activation record */
 typedef struct lua_Localvar lua_Localvar;
 
 typedef void (*lua_Hook) (lua_State *L, lua_Debug *ar);
+typedef void (*lua_SampleHook) (lua_State *L, int ticks, const char *leaf);
 
 
 LUA_API int lua_getstack (lua_State *L, int level, lua_Debug *ar);
@@ -24,6 +25,10 @@ LUA_API const char *lua_setlocal (lua_State *L, const lua_Debug *ar, int n);
 
 LUA_API lua_Hook lua_setcallhook (lua_State *L, lua_Hook func);
 LUA_API lua_Hook lua_setlinehook (lua_State *L, lua_Hook func);
+LUA_API lua_SampleHook lua_setsamplehook (lua_State *L, lua_SampleHook func);
+LUA_API void lua_sampletick (lua_State *L);
+
+LUA_API int lua_getopprofile (lua_State *L, int reset);
 
 
 #define LUA_IDSIZE	60
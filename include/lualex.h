@@ -0,0 +1,46 @@
+/*
+** $Id$
+** Line scanner for source viewers
+** See Copyright Notice in lua.h
+*/
+
+
+#ifndef lualex_h
+#define lualex_h
+
+#include "lua.h"
+
+
+/* span kinds */
+#define LUA_LEXSPACE	0	/* blanks */
+#define LUA_LEXNAME	1	/* names */
+#define LUA_LEXKEYWORD	2	/* reserved words */
+#define LUA_LEXCOMMENT	3
+#define LUA_LEXSTRING	4	/* quoted and [[long]] strings */
+#define LUA_LEXNUMBER	5
+#define LUA_LEXPUNCT	6	/* operators and punctuation */
+#define LUA_LEXFUNCNAME	7	/* name of a called function */
+#define LUA_LEXFUNCDEF	8	/* name of a defined function (parts and `.' `:') */
+
+#define LUA_LEXKINDS	9
+
+typedef struct lua_LexSpan {
+  int start;  /* offset in line */
+  int len;
+  int kind;
+} lua_LexSpan;
+
+
+/*
+** Scan one line of Lua source (without its end of line). `state' is the
+** scanner state at the start of the line (0 at the start of a source);
+** the state at the start of the next line is returned, so lines can be
+** scanned in any order once their start state is known. Spans cover the
+** whole line; at most `maxspans' are stored and `*nspans' gets their
+** number. The scanner never fails: malformed tokens end at end of line.
+*/
+LUA_API int lua_scanline (const char *line, int len, int state,
+                          lua_LexSpan *spans, int maxspans, int *nspans);
+
+
+#endif
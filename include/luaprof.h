@@ -0,0 +1,79 @@
+/**
+ * @ingroup dcplaya_luaprof_devel
+ * @file    luaprof.h
+ * @brief   Lua sampling profiler
+ *
+ * $Id$
+ */
+
+#ifndef _LUAPROF_H_
+#define _LUAPROF_H_
+
+#include "extern_def.h"
+
+DCPLAYA_EXTERN_C_START
+
+#include "lua.h"
+
+/** @defgroup dcplaya_luaprof_devel Lua profiler
+ *  @ingroup  dcplaya_shell_devel
+ *  @brief    lua sampling profiler
+ *
+ *    A timer thread ticks the profiled lua state every period. Ticks are
+ *    only counted while lua runs, and are charged at the next function
+ *    call or return to the lua call stack, C bindings included. Time
+ *    spent in the garbage collector is charged to a "[gc]" leaf.
+ *
+ *    Samples are dumped as flamegraph folded stacks : one line per
+ *    distinct stack, frames from outermost to innermost separated by ';'
+ *    followed by the number of samples.
+ *
+ *    While the profiler is stopped the lua VM only tests a counter on
+ *    function calls.
+ *
+ *  @{
+ */
+
+/** Lua profiler statistics. */
+typedef struct {
+  int running;    /**< Profiler is sampling.                        */
+  int period_ms;  /**< Sampling period (ms).                        */
+  int samples;    /**< Samples recorded.                            */
+  int stacks;     /**< Distinct stacks.                             */
+  int lost;       /**< Samples lost (too many stacks, no memory).   */
+} luaprof_stats_t;
+
+/** Start sampling a lua state. Previous samples are cleared.
+ *
+ *  @param  L          Lua state.
+ *  @param  period_ms  Sampling period in ms (<=0 for default).
+ *
+ *  @return error-code
+ *  @retval 0 success
+ *  @retval -1 error (sampling thread could not be created)
+ */
+int luaprof_start(lua_State * L, int period_ms);
+
+/** Stop sampling. Samples are kept until next luaprof_start().
+ *
+ *  @return number of samples recorded
+ */
+int luaprof_stop(void);
+
+/** Write samples as folded stacks.
+ *
+ *  @param  fname  Output filename (e.g. on ramdisk or host).
+ *
+ *  @return number of stacks written
+ *  @retval -1 error
+ */
+int luaprof_dump(const char * fname);
+
+/** Get profiler statistics. */
+void luaprof_stats(luaprof_stats_t * stats);
+
+/**@}*/
+
+DCPLAYA_EXTERN_C_END
+
+#endif /* #ifndef _LUAPROF_H_ */
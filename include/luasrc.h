@@ -0,0 +1,86 @@
+/**
+ * @ingroup dcplaya_luasrc_devel
+ * @file    luasrc.h
+ * @brief   Lua source tokenizer for viewers
+ *
+ * $Id$
+ */
+
+#ifndef _LUASRC_H_
+#define _LUASRC_H_
+
+#include "extern_def.h"
+
+DCPLAYA_EXTERN_C_START
+
+#include "lualex.h"
+
+/** @defgroup dcplaya_luasrc_devel Lua source tokenizer
+ *  @ingroup  dcplaya_shell_devel
+ *  @brief    lua source tokenizer for viewers
+ *
+ *    A loaded source keeps the lua_scanline() state at the start of each
+ *    line already scanned. Getting the tokens of a line only scans the
+ *    lines before it once, so the cost of viewing a window of lines does
+ *    not depend on the file size.
+ *
+ *  @{
+ */
+
+/** Loaded lua source. */
+typedef struct luasrc_s luasrc_t;
+
+/** Load a lua source file.
+ *
+ *  @param  fname  Source filename.
+ *
+ *  @return source
+ *  @retval 0 error
+ */
+luasrc_t * luasrc_load(const char * fname);
+
+/** Free a source. */
+void luasrc_free(luasrc_t * src);
+
+/** Get number of lines. */
+int luasrc_lines(const luasrc_t * src);
+
+/** Get token spans of a line.
+ *
+ *  @param  src    Source.
+ *  @param  line   Line number (starting at 0).
+ *  @param  spans  Spans buffer.
+ *  @param  max    Spans buffer size (one span per character is enough).
+ *  @param  text   Returned line text (not zero terminated).
+ *  @param  len    Returned line length.
+ *
+ *  @return number of spans
+ *  @retval -1 bad line
+ */
+int luasrc_spans(luasrc_t * src, int line, lua_LexSpan * spans, int max,
+		 const char ** text, int * len);
+
+/** Get the longest line length. */
+int luasrc_maxlen(const luasrc_t * src);
+
+/** Build colorized zml for a range of lines.
+ *
+ *    Tokens are enclosed in the lua_colorize.lua macros (\<c\>, \<k\>,
+ *    \<r\>, \<s\>, \<n\>, \<t\>, \<f\>). Function definitions are \<d\>
+ *    inside an anchor named after the function.
+ *
+ *  @param  src    Source.
+ *  @param  first  First line (starting at 0).
+ *  @param  last   Last line (included).
+ *  @param  len    Returned zml length.
+ *
+ *  @return zml string (to free with free())
+ *  @retval 0 error
+ */
+char * luasrc_zml(luasrc_t * src, int first, int last, int * len);
+
+/**@}*/
+
+DCPLAYA_EXTERN_C_END
+
+#endif /* #ifndef _LUASRC_H_ */
@@ -0,0 +1,67 @@
+/**
+ * @ingroup dcplaya_md5_devel
+ * @file    md5.h
+ * @brief   MD5 message digest.
+ *
+ * $Id$
+ */
+
+#ifndef _MD5_H_
+#define _MD5_H_
+
+#include "extern_def.h"
+
+DCPLAYA_EXTERN_C_START
+
+/** @defgroup dcplaya_md5_devel MD5 digest
+ *  @ingroup  dcplaya_devel
+ *  @brief    MD5 message digest (RFC 1321).
+ *
+ *    Used to identify files whatever their name, e.g. by the song length
+ *    database. This file does not depend on KOS, so host tools can use
+ *    it as well.
+ *
+ *  @{
+ */
+
+/** MD5 digest size in bytes. */
+#define MD5_SIZE 16
+
+/** MD5 computation context. */
+typedef struct {
+  unsigned int state[4];       /**< Digest state.                     */
+  unsigned int count[2];       /**< Message length in bits (lo, hi).  */
+  unsigned char buffer[64];    /**< Pending input block.              */
+} md5_t;
+
+/** Start a digest. */
+void md5_init(md5_t * md5);
+
+/** Add data to a digest. */
+void md5_update(md5_t * md5, const void * data, unsigned int size);
+
+/** Finish a digest.
+ *
+ *  @param  md5     Context (must be initialized again for reuse).
+ *  @param  digest  Returned digest.
+ */
+void md5_final(md5_t * md5, unsigned char digest[MD5_SIZE]);
+
+/** Digest a buffer at once. */
+void md5_sum(const void * data, unsigned int size,
+	     unsigned char digest[MD5_SIZE]);
+
+/** Convert a digest to a lower case hexadecimal string.
+ *
+ *  @param  str     Returned string (2*MD5_SIZE+1 chars).
+ *  @param  digest  Digest.
+ *
+ *  @return str
+ */
+char * md5_str(char * str, const unsigned char digest[MD5_SIZE]);
+
+/**@}*/
+
+DCPLAYA_EXTERN_C_END
+
+#endif /* #ifndef _MD5_H_ */
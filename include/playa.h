@@ -67,6 +67,19 @@ int playa_stop(int flush);
 /** Pause or resume play. */
 int playa_pause(int v);
 
+/** Seek current music.
+ *
+ *    The decoder thread seeks the driver and drops the PCM of the old
+ *    position still in the fifo. The function waits for it.
+ *
+ *  @param  ms  Position in milli-second (exactly a 1024th of second).
+ *
+ *  @return error-code
+ *  @retval 0 success
+ *  @retval -1 error (not playing, driver can not seek, past the end)
+ */
+int playa_seek(unsigned int ms);
+
 /** Get/Set playa volume.
  *  @param  volume  new volume [0..255], -1 for get current volume.
  *  @return previous volume
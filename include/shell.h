@@ -18,6 +18,42 @@
 typedef void (* shell_shutdown_func_t)();
 /** shell output command fucntion. */
 typedef int (* shell_command_func_t)(const char * command, ...);
+/** shell yield point function. */
+typedef void (* shell_yield_func_t)(void);
+/** shell command completion function. */
+typedef void (* shell_done_func_t)(const char * command, int result,
+				   void * cookie);
+
+/** Shell command priorities.
+ *
+ *    Pending commands are always run highest priority first. Interactive
+ *    commands are also run at yield points of long running commands.
+ *
+ *  @see shell_yield()
+ */
+enum {
+  SHELL_PRIO_BACKGROUND = 0, /**< Long running work (copy, archive ...). */
+  SHELL_PRIO_NORMAL,         /**< Default priority, see shell_command(). */
+  SHELL_PRIO_INTERACTIVE,    /**< User interface commands.               */
+  SHELL_PRIO_MAX
+};
+
+/** Queued shell command. */
+typedef struct shell_queued_s {
+  struct shell_queued_s * next; /**< Next command of same priority.   */
+  int prio;                     /**< Command priority.                */
+  shell_done_func_t done;       /**< Completion function (may be 0).  */
+  void * cookie;                /**< Completion function cookie.      */
+  unsigned int stamp;           /**< Enqueue time (ms).               */
+  char command[1];              /**< Command string.                  */
+} shell_queued_t;
+
+/** Shell command latency for one priority. */
+typedef struct {
+  int count;    /**< Commands run.                         */
+  int wait_ms;  /**< Total time spent in queue (ms).       */
+  int max_ms;   /**< Longest time spent in queue (ms).     */
+} shell_latency_t;
 
 /** initialize shell. */
 int shell_init();
@@ -30,11 +66,79 @@ void shell_shutdown();
  */
 void shell_update(float frameTime);
 
+/** Get the Lua garbage collector work budget for a frame.
+ *
+ *    The budget is adapted by shell_update() : it is halved each time a
+ *    frame is dropped and slowly raised while the frame rate holds.
+ *
+ *  @return number of collector work units (see lua_gcstep())
+ */
+int shell_gc_budget(void);
+
 /** Issue the given command on currently loaded shell.
  *  @param command command string
+ *  @see shell_command_prio()
  */
 int shell_command(const char * command);
 
+/** Issue the given command with a priority and a completion function.
+ *
+ *  @param  command  command string
+ *  @param  prio     command priority (SHELL_PRIO_*)
+ *  @param  done     function called once the command has run (may be 0)
+ *  @param  cookie   done function parameter
+ *
+ *  @return error-code
+ *  @retval 0  command queued
+ *  @retval -1 queue full or out of memory
+ */
+int shell_command_prio(const char * command, int prio,
+		       shell_done_func_t done, void * cookie);
+
+/** Get next pending command.
+ *
+ *    Used by the loaded shell to run commands issued while it is busy.
+ *    The command must be released with shell_command_done().
+ *
+ *  @param  min_prio  lowest priority to consider
+ *
+ *  @return highest priority pending command
+ *  @retval 0 no pending command
+ */
+shell_queued_t * shell_pop_command(int min_prio);
+
+/** Release a command returned by shell_pop_command().
+ *
+ *    Call its completion function.
+ *
+ *  @param  q       command
+ *  @param  result  command result
+ */
+void shell_command_done(shell_queued_t * q, int result);
+
+/** Cooperative yield point.
+ *
+ *    Long running C functions call it regularly. When called from a shell
+ *    command, it runs the pending interactive commands (through the
+ *    yield function set by the loaded shell) and lets other threads run.
+ *    It does nothing in other threads and when called too often.
+ */
+void shell_yield(void);
+
+/** Set the shell yield point handler.
+ *  @param func new yield handler.
+ *  @return old yield handler.
+ */
+shell_yield_func_t shell_set_yield_func(shell_yield_func_t func);
+
+/** Get command latency statistics.
+ *
+ *  @param  prio   priority (SHELL_PRIO_*)
+ *  @param  lat    statistics to fill (may be 0)
+ *  @param  reset  clear statistics after reading
+ */
+void shell_latency(int prio, shell_latency_t * lat, int reset);
+
 /** Set the shell command handler.
  *  @param func new command handler.
  *  @return old command handler ?
@@ -0,0 +1,70 @@
+/**
+ * @ingroup dcplaya_songlen_devel
+ * @file    songlen.h
+ * @brief   Song length database.
+ *
+ * $Id$
+ */
+
+#ifndef _SONGLEN_H_
+#define _SONGLEN_H_
+
+#include "extern_def.h"
+
+DCPLAYA_EXTERN_C_START
+
+#include "md5.h"
+
+/** @defgroup dcplaya_songlen_devel Song length database
+ *  @ingroup  dcplaya_devel
+ *  @brief    song length database for chip music.
+ *
+ *    Chip music files have no duration : drivers emulate and detect
+ *    silence to find the end of a track. The database gives the length
+ *    of each subtune from the MD5 of the whole file, in the HVSC
+ *    Songlengths.md5 format. The older Songlengths.txt, keyed on a
+ *    partial MD5 of PSID files, is not supported : its digests do not
+ *    match.
+ *
+ *    @code
+ *    [Database]
+ *    ; /path/music.sid
+ *    0123456789abcdef0123456789abcdef=3:25 1:02.500 0:45(G)
+ *    @endcode
+ *
+ *    Lengths are m:ss with optional milliseconds, flags in parenthesis
+ *    are ignored and a 0:00 length is unknown. The whole database is
+ *    kept in a hash table indexed by the digest. The host tools
+ *    nsfinfo --L (plugins/inp/nsf) and sidlen (plugins/inp/sidplay/host)
+ *    write entries for NSF and PSID files.
+ *
+ *  @{
+ */
+
+/** Load a database, replacing the current one.
+ *
+ *  @param  fname  Database file (0 to clear the database).
+ *
+ *  @return number of files in the database
+ *  @retval -1 error (current database is kept)
+ */
+int songlen_load(const char * fname);
+
+/** Get number of files in the database. */
+int songlen_count(void);
+
+/** Get a subtune length.
+ *
+ *  @param  digest  File MD5.
+ *  @param  track   Subtune number (starting at 1).
+ *
+ *  @return length in ms
+ *  @retval 0 unknown
+ */
+unsigned int songlen_find(const unsigned char digest[MD5_SIZE], int track);
+
+/**@}*/
+
+DCPLAYA_EXTERN_C_END
+
+#endif /* #ifndef _SONGLEN_H_ */
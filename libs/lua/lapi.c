@@ -312,7 +312,20 @@ LUA_API int lua_getref (lua_State *L, int ref) {
 
 
 LUA_API void lua_newtable (lua_State *L) {
-  hvalue(L->top) = luaH_new(L, 0);
+  hvalue(L->top) = luaH_new(L, 0, 0);
+  ttype(L->top) = LUA_TTABLE;
+  api_incr_top(L);
+}
+
+
+/*
+** new table with room for `narr' integer keys (1..narr) in its array part
+** and `nrec' other keys, so that filling it does not rehash
+*/
+LUA_API void lua_createtable (lua_State *L, int narr, int nrec) {
+  if (narr < 0) narr = 0;
+  if (nrec < 0) nrec = 0;
+  hvalue(L->top) = luaH_new(L, narr, nrec);
   ttype(L->top) = LUA_TTABLE;
   api_incr_top(L);
 }
@@ -344,8 +357,8 @@ LUA_API void lua_rawset (lua_State *L, int index) {
   LUA_ASSERT(ttype(t) == LUA_TTABLE, "table expected");
   *luaH_set(L, hvalue(t), L->top-2) = *(L->top-1);
 
-  markobject(L->top - 1, L, 0);
-  markobject(L->top - 2, L, 0);
+  luaC_barrier(L, hvalue(t), L->top - 1);
+  luaC_barrier(L, hvalue(t), L->top - 2);
 
   L->top -= 2;
 }
@@ -356,7 +369,7 @@ LUA_API void lua_rawseti (lua_State *L, int index, int n) {
   LUA_ASSERT(ttype(o) == LUA_TTABLE, "table expected");
   *luaH_setint(L, hvalue(o), n) = *(L->top-1);
 
-  markobject(L->top - 1, L, 0);
+  luaC_barrier(L, hvalue(o), L->top - 1);
 
   L->top--;
 }
@@ -426,7 +439,28 @@ LUA_API void lua_setgcthreshold (lua_State *L, int newthreshold) {
   else {
     L->GCthreshold = GCunscale(newthreshold);
   }
-  luaC_checkGC(L);
+  luaC_fullgc(L);
+}
+
+LUA_API void lua_gcstep (lua_State *L, int work) {
+  luaC_step(L, work);
+}
+
+LUA_API void lua_setgcpace (lua_State *L, int pause, int stepmul, int minkb) {
+  if (pause > 0) L->gcpause = pause;
+  if (stepmul >= 0) L->gcstepmul = stepmul;
+  if (minkb >= 0) L->gcmin = GCunscale(minkb);
+}
+
+LUA_API void lua_getgcpace (lua_State *L, int *pause, int *stepmul, int *minkb) {
+  if (pause) *pause = L->gcpause;
+  if (stepmul) *stepmul = L->gcstepmul;
+  if (minkb) *minkb = GCscale(L->gcmin);
+}
+
+LUA_API void lua_getgcstats (lua_State *L, lua_GCStats *stats, int reset) {
+  if (stats) *stats = L->gcstats;
+  if (reset) memset(&L->gcstats, 0, sizeof(L->gcstats));
 }
 
 
@@ -461,12 +495,8 @@ LUA_API void lua_unref (lua_State *L, int ref) {
 
 LUA_API int lua_next (lua_State *L, int index) {
   StkId t = luaA_index(L, index);
-  Node *n;
   LUA_ASSERT(ttype(t) == LUA_TTABLE, "table expected");
-  n = luaH_next(L, hvalue(t), luaA_index(L, -1));
-  if (n) {
-    *(L->top-1) = *key(n);    
-    *L->top = *val(n);
+  if (luaH_next(L, hvalue(t), L->top-1, L->top-1)) {
     api_incr_top(L);
     return 1;
   }
@@ -484,8 +514,12 @@ LUA_API int lua_getn (lua_State *L, int index) {
     return (int)nvalue(value);
   else {
     Number max = 0;
-    int i = h->size;
+    int i = h->sizearray;
     Node *n = h->node;
+    while (i > 0 && ttype(&h->array[i-1]) == LUA_TNIL)
+      i--;
+    max = i;  /* last non nil element of the array part */
+    i = h->size;
     while (i--) {
       if (ttype(key(n)) == LUA_TNUMBER &&
           ttype(val(n)) != LUA_TNIL &&
@@ -173,9 +173,19 @@ static int setlinehook (lua_State *L) {
 }
 
 
+#ifdef LUA_OPPROFILE
+static int opprofile (lua_State *L) {
+  return lua_getopprofile(L, !lua_isnull(L, 1) && !lua_isnil(L, 1));
+}
+#endif
+
+
 static const struct luaL_reg dblib[] = {
   {"getlocal", getlocal},
   {"getinfo", getinfo},
+#ifdef LUA_OPPROFILE
+  {"opprofile", opprofile},
+#endif
   {"setcallhook", setcallhook},
   {"setlinehook", setlinehook},
   {"setlocal", setlocal}
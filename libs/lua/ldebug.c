@@ -5,7 +5,9 @@
 */
 
 
+#include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include "lua.h"
 
@@ -21,6 +23,7 @@
 #include "ltable.h"
 #include "ltm.h"
 #include "luadebug.h"
+#include "lvm.h"
 
 
 
@@ -55,6 +58,25 @@ LUA_API lua_Hook lua_setlinehook (lua_State *L, lua_Hook func) {
 }
 
 
+LUA_API lua_SampleHook lua_setsamplehook (lua_State *L, lua_SampleHook func) {
+  lua_SampleHook oldhook = L->samplehook;
+  L->samplehook = func;
+  L->sampleticks = 0;
+  return oldhook;
+}
+
+
+/*
+** May be called from another thread: a tick is only counted while `L'
+** runs (inside a protected call). The sample hook gets it at the next
+** function call or return.
+*/
+LUA_API void lua_sampletick (lua_State *L) {
+  if (L->samplehook && L->errorJmp)
+    L->sampleticks++;
+}
+
+
 static StkId aux_stackedfunction (lua_State *L, int level, StkId top) {
   int i;
   for (i = (top-1) - L->stack; i>=0; i--) {
@@ -464,3 +486,78 @@ void luaG_ordererror (lua_State *L, StkId top) {
     luaO_verror(L, "attempt to compare %.10s with %.10s", t1, t2);
 }
 
+
+
+/*
+** {======================================================
+** Opcode profile (VM built with LUA_OPPROFILE)
+** =======================================================
+*/
+
+#ifdef LUA_OPPROFILE
+
+static const char *const opnames[NUM_OPCODES] = {
+  "END", "RETURN", "CALL", "TAILCALL", "PUSHNIL", "POP", "PUSHINT",
+  "PUSHSTRING", "PUSHNUM", "PUSHNEGNUM", "PUSHUPVALUE", "GETLOCAL",
+  "GETGLOBAL", "GETTABLE", "GETDOTTED", "GETINDEXED", "PUSHSELF",
+  "CREATETABLE", "SETLOCAL", "SETGLOBAL", "SETTABLE", "SETLIST", "SETMAP",
+  "ADD", "ADDI", "SUB", "MULT", "DIV", "POW", "CONCAT", "MINUS", "NOT",
+  "JMPNE", "JMPEQ", "JMPLT", "JMPLE", "JMPGT", "JMPGE", "JMPT", "JMPF",
+  "JMPONT", "JMPONF", "JMP", "PUSHNILJMP", "FORPREP", "FORLOOP", "LFORPREP",
+  "LFORLOOP", "CLOSURE"
+};
+
+
+static void setcount (lua_State *L, const char *name, unsigned long n) {
+  lua_pushstring(L, name);
+  lua_pushnumber(L, n);
+  lua_settable(L, -3);
+}
+
+
+/*
+** pushes a table {total = n, ops = {name = n}, pairs = {["a b"] = n}}
+** with executed opcodes and pairs of consecutive opcodes
+*/
+LUA_API int lua_getopprofile (lua_State *L, int reset) {
+  char pair[32];
+  unsigned long total = 0;
+  int i, j;
+  lua_newtable(L);
+  lua_pushstring(L, "ops");
+  lua_newtable(L);
+  for (i=0; i<NUM_OPCODES; i++) {
+    total += luaV_opcount[i];
+    if (luaV_opcount[i])
+      setcount(L, opnames[i], luaV_opcount[i]);
+  }
+  lua_settable(L, -3);
+  lua_pushstring(L, "pairs");
+  lua_newtable(L);
+  for (i=0; i<NUM_OPCODES; i++) {
+    for (j=0; j<NUM_OPCODES; j++) {
+      if (luaV_oppair[i][j]) {
+        sprintf(pair, "%s %s", opnames[i], opnames[j]);
+        setcount(L, pair, luaV_oppair[i][j]);
+      }
+    }
+  }
+  lua_settable(L, -3);
+  setcount(L, "total", total);
+  if (reset) {
+    memset(luaV_opcount, 0, sizeof(luaV_opcount));
+    memset(luaV_oppair, 0, sizeof(luaV_oppair));
+  }
+  return 1;
+}
+
+#else
+
+LUA_API int lua_getopprofile (lua_State *L, int reset) {
+  (void)L; (void)reset;
+  return 0;  /* not available */
+}
+
+#endif
+
+/* }====================================================== */
@@ -146,6 +146,19 @@ void luaD_callTM (lua_State *L, Closure *f, int nParams, int nResults) {
 }
 
 
+/*
+** Pass pending sampling ticks to the sample hook. They are charged to
+** the active functions (level 0 is the running one) and to `leaf', a
+** pseudo function such as the garbage collector, if not NULL.
+*/
+void luaD_sample (lua_State *L, const char *leaf) {
+  int ticks = L->sampleticks;
+  L->sampleticks = 0;
+  if (ticks > 0 && L->samplehook)
+    (*L->samplehook)(L, ticks, leaf);
+}
+
+
 /*
 ** Call a function (C or Lua). The function to be called is at *func.
 ** The arguments are on the stack, right after the function.
@@ -158,6 +171,7 @@ void luaD_call (lua_State *L, StkId func, int nResults) {
   StkId firstResult;
   CallInfo ci;
   Closure *cl;
+  luaD_checksample(L, NULL);  /* time spent so far goes to the caller */
   if (ttype(func) != LUA_TFUNCTION) {
     /* `func' is not a function; check the `function' tag method */
     Closure *tm = luaT_gettmbyObj(L, func, TM_FUNCTION);
@@ -178,6 +192,10 @@ void luaD_call (lua_State *L, StkId func, int nResults) {
                            luaV_execute(L, cl, func+1));
   if (callhook)  /* same hook that was active at entry */
     luaD_callHook(L, func, callhook, "return");
+  if (L->sampleticks) {  /* time spent so far goes to the callee */
+    ci.pc = NULL;  /* function is not active */
+    luaD_sample(L, NULL);
+  }
   LUA_ASSERT(ttype(func) == LUA_TMARK, "invalid tag");
   /* move results to `func' (to erase parameters and function) */
   if (nResults == LUA_MULTRET) {
@@ -305,6 +323,23 @@ static int parse_buffer (lua_State *L, const char *buff, size_t size,
 }
 
 
+/*
+** parse a buffer (source or binary chunk) and leave the main function on
+** the stack without running it
+*/
+LUA_API int lua_loadbuffer (lua_State *L, const char *buff, size_t size, const char *name) {
+  return parse_buffer(L, buff, size, name);
+}
+
+
+LUA_API int lua_dump (lua_State *L, lua_Writer writer, void *data) {
+  StkId o = L->top - 1;
+  if (L->top <= L->Cbase || ttype(o) != LUA_TFUNCTION || clvalue(o)->isC)
+    return -1;  /* not a Lua function */
+  return luaU_dump(clvalue(o)->f.l, writer, data);
+}
+
+
 LUA_API int lua_dobuffer (lua_State *L, const char *buff, size_t size, const char *name) {
   int status = parse_buffer(L, buff, size, name);
   if (status == 0)  /* parse OK? */
@@ -18,11 +18,18 @@
 */
 #define incr_top {if (L->top == L->stack_last) luaD_checkstack(L, 1); L->top++;}
 
+/*
+** give pending sampling ticks to the sample hook (see lua_sampletick).
+** It only costs a test while the profiler is off.
+*/
+#define luaD_checksample(L,leaf)  if ((L)->sampleticks) luaD_sample(L, leaf)
+
 
 void luaD_init (lua_State *L, int stacksize);
 void luaD_adjusttop (lua_State *L, StkId base, int extra);
 void luaD_lineHook (lua_State *L, StkId func, int line, lua_Hook linehook);
 void luaD_call (lua_State *L, StkId func, int nResults);
+void luaD_sample (lua_State *L, const char *leaf);
 void luaD_callTM (lua_State *L, Closure *f, int nParams, int nResults);
 void luaD_checkstack (lua_State *L, int n);
 
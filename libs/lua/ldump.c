@@ -0,0 +1,138 @@
+/*
+** $Id$
+** save bytecodes (counterpart of lundump.c)
+** See Copyright Notice in lua.h
+*/
+
+#include <stddef.h>
+
+#include "lobject.h"
+#include "lopcodes.h"
+#include "lundump.h"
+
+typedef struct {
+ luaU_Writer w;
+ void* ud;
+ int status;
+} DumpState;
+
+static void DumpBlock (const void* b, size_t size, DumpState* D)
+{
+ if (D->status==0 && size>0)
+  D->status=(*D->w)(b,size,D->ud);
+}
+
+static void DumpByte (int y, DumpState* D)
+{
+ char x=(char)y;
+ DumpBlock(&x,sizeof(x),D);
+}
+
+static void DumpInt (int x, DumpState* D)
+{
+ DumpBlock(&x,sizeof(x),D);
+}
+
+static void DumpSize (size_t x, DumpState* D)
+{
+ DumpBlock(&x,sizeof(x),D);
+}
+
+static void DumpNumber (Number x, DumpState* D)
+{
+ DumpBlock(&x,sizeof(x),D);
+}
+
+static void DumpString (const TString* s, DumpState* D)
+{
+ if (s==NULL)
+  DumpSize(0,D);
+ else
+ {
+  DumpSize(s->len+1,D);			/* include trailing '\0' */
+  DumpBlock(s->str,s->len+1,D);
+ }
+}
+
+static void DumpCode (const Proto* tf, DumpState* D)
+{
+ DumpInt(tf->ncode,D);
+ DumpBlock(tf->code,tf->ncode*sizeof(*tf->code),D);
+}
+
+static void DumpLocals (const Proto* tf, DumpState* D)
+{
+ int i,n=tf->nlocvars;
+ DumpInt(n,D);
+ for (i=0; i<n; i++)
+ {
+  DumpString(tf->locvars[i].varname,D);
+  DumpInt(tf->locvars[i].startpc,D);
+  DumpInt(tf->locvars[i].endpc,D);
+ }
+}
+
+static void DumpLines (const Proto* tf, DumpState* D)
+{
+ DumpInt(tf->nlineinfo,D);
+ DumpBlock(tf->lineinfo,tf->nlineinfo*sizeof(*tf->lineinfo),D);
+}
+
+static void DumpFunction (const Proto* tf, DumpState* D);
+
+static void DumpConstants (const Proto* tf, DumpState* D)
+{
+ int i,n;
+ DumpInt(n=tf->nkstr,D);
+ for (i=0; i<n; i++)
+  DumpString(tf->kstr[i],D);
+ DumpInt(tf->nknum,D);
+ DumpBlock(tf->knum,tf->nknum*sizeof(*tf->knum),D);
+ DumpInt(n=tf->nkproto,D);
+ for (i=0; i<n; i++)
+  DumpFunction(tf->kproto[i],D);
+}
+
+static void DumpFunction (const Proto* tf, DumpState* D)
+{
+ DumpString(tf->source,D);
+ DumpInt(tf->lineDefined,D);
+ DumpInt(tf->numparams,D);
+ DumpByte(tf->is_vararg,D);
+ DumpInt(tf->maxstacksize,D);
+ DumpLocals(tf,D);
+ DumpLines(tf,D);
+ DumpConstants(tf,D);
+ DumpCode(tf,D);
+}
+
+static void DumpHeader (DumpState* D)
+{
+ DumpByte(ID_CHUNK,D);
+ DumpBlock(SIGNATURE,sizeof(SIGNATURE)-1,D);
+ DumpByte(VERSION,D);
+ DumpByte(luaU_endianess(),D);
+ DumpByte(sizeof(int),D);
+ DumpByte(sizeof(size_t),D);
+ DumpByte(sizeof(Instruction),D);
+ DumpByte(SIZE_INSTRUCTION,D);
+ DumpByte(SIZE_OP,D);
+ DumpByte(SIZE_B,D);
+ DumpByte(sizeof(Number),D);
+ DumpNumber(TEST_NUMBER,D);
+}
+
+/*
+** dump one chunk in the format read by luaU_undump
+** return 0 or the first non-zero writer status
+*/
+int luaU_dump (const Proto* Main, luaU_Writer w, void* ud)
+{
+ DumpState D;
+ D.w=w;
+ D.ud=ud;
+ D.status=0;
+ DumpHeader(&D);
+ DumpFunction(Main,&D);
+ return D.status;
+}
@@ -25,6 +25,7 @@
 
 /* dcplaya specific */
 #include "sysdebug.h"
+#include <arch/timer.h>
 
 
 
@@ -71,8 +72,8 @@ static void invalidaterefs (lua_State *L) {
   LUA_ASSERT(VALIDLINK(L, L->refFree, n), "inconsistent ref table");
 }
 
-static void checktab (lua_State *L, stringtable *tb) {
-  if (tb->nuse < (lint32)(tb->size/4) && tb->size > 10)
+static void checktab (lua_State *L, stringtable *tb, int minsize) {
+  if (tb->nuse < (lint32)(tb->size/4) && tb->size > minsize)
     luaS_resize(L, tb, tb->size/2);  /* table is too big */
 }
 
@@ -247,6 +248,8 @@ static void markhash (Hash *h, lua_State *L) {
     
     blackmark(h);
     
+    for (i=0; i<h->sizearray; i++)
+      markobject(&h->array[i], L, 0);
     for (i=0; i<h->size; i++) {
       Node *n = node(h, i);
       if (ttype(key(n)) != LUA_TNIL) {
@@ -388,6 +391,12 @@ static int _luaC_collect (lua_State *L, int *count, int flag) {
   return 0;
 }
 
+/* threshold for the next cycle, proportional to memory in use */
+static void setthreshold (lua_State *L) {
+  unsigned long t = L->nblocks / 100 * L->gcpause;
+  L->GCthreshold = (t < L->gcmin) ? L->gcmin : t;
+}
+
 void luaC_collectgarbage (lua_State *L, int count) {
   if (L->gcstage == LUA_GCIDLE) {	/* let's start marking important stuffs */
     VCOLOR(255, 255, 0);
@@ -401,6 +410,7 @@ void luaC_collectgarbage (lua_State *L, int count) {
     int r;
     VCOLOR(255, 128, 128);
     markstack(L); /* mark stack objects */
+    marklock(L); /* objects locked since last step */
     VCOLOR(255, 0, 255);
     r = luaC_mark(L, &count);
     if (r == 1) {	/* reach the end of it, should change to sweep */    
@@ -424,8 +434,8 @@ void luaC_collectgarbage (lua_State *L, int count) {
     if (r == 1) {	/* finish collecting */
       L->gcstage = LUA_GCIDLE;
       L->gcptr = NULL;
-      checktab(L, &L->strt);
-      checktab(L, &L->udt);
+      checktab(L, &L->strt, MINSTRTABSIZE);
+      checktab(L, &L->udt, 10);
       checkMbuffer(L);
       L->gcstage = LUA_GCTMCALLBACK;
     }
@@ -439,6 +449,8 @@ void luaC_collectgarbage (lua_State *L, int count) {
     if (r) {
       L->gcstage = LUA_GCIDLE;
       L->gcTM = 0;        
+      L->gcstats.cycles++;
+      setthreshold(L);
       callgcTM(L, &luaO_nilobject);
       //SDDEBUG("collect done %ld %ld\n", L->GCthreshold, L->nblocks);
     }
@@ -447,8 +459,23 @@ void luaC_collectgarbage (lua_State *L, int count) {
   VCOLOR(0, 0, 0);
 }
 
+/* record a collector pause in the statistics */
+static void addpause (lua_State *L, unsigned long ms) {
+  lua_GCStats *s = &L->gcstats;
+  int i = 0;
+  while (i < LUA_GCHISTO-1 && ms >= (1ul << i))
+    i++;
+  s->histo[i]++;
+  s->steps++;
+  s->totalms += ms;
+  if (ms > s->maxpause)
+    s->maxpause = ms;
+}
+
 int luaC_collect (lua_State *L, int step) {
+  uint64 start = timer_ms_gettime64();
 
+  luaD_checksample(L, NULL);
   L->last_gcalloc = -L->gcalloc;
 
   if (step < 0) { /* collect everything! */
@@ -466,21 +493,70 @@ int luaC_collect (lua_State *L, int step) {
 
   L->last_gcalloc = L->gcalloc;
 
+  luaD_checksample(L, "[gc]");
+  addpause(L, (unsigned long)(timer_ms_gettime64() - start));
   return 0;
 }
 
+/*
+   Allocation driven collection. Once the threshold is reached, a cycle
+   is run incrementally: each step does `gcstepmul' units of work and the
+   next one happens after LUA_GCSTEPSIZE more bytes are allocated. The
+   threshold is set back from memory in use when the cycle completes.
+*/
 void luaC_checkGC (lua_State *L) {
 
   if (L->last_gcalloc < 0) return;	/* to avoid recursively checking GC */
 
+  if (luaM_needcollect()) {  /* close to the memory cap: collect all */
+    L->gcstats.forced++;
+    while (L->gcstage != LUA_GCIDLE)  /* end current cycle */
+      luaC_collect(L, 10000);
+    do {  /* and run a whole new one */
+      luaC_collect(L, 10000);
+    } while (L->gcstage != LUA_GCIDLE);
+    luaM_collected();
+    return;
+  }
+
   if (L->GCthreshold < L->nblocks) {
-      do {
-      	luaC_collect(L, 10000);
-      } while (L->gcstage != LUA_GCIDLE);
-      L->GCthreshold = L->nblocks * 2;
-      //      L->GCthreshold = L->nblocks + 100*1024;
-      //      L->GCthreshold = L->nblocks * 1.2;
-/*      L->GCthreshold = L->GCthreshold < 4096*1024? 4096*1024 : L->GCthreshold;*/
+    L->gcstats.forced++;
+    if (L->gcstepmul <= 0) {
+      luaC_fullgc(L);
+      return;
+    }
+    luaC_collect(L, L->gcstepmul);
+    if (L->gcstage != LUA_GCIDLE)
+      L->GCthreshold = L->nblocks + LUA_GCSTEPSIZE;
+  }
+}
+
+/* Run the current cycle to its end. */
+void luaC_fullgc (lua_State *L) {
+
+  if (L->last_gcalloc < 0) return;
+
+  if (L->GCthreshold < L->nblocks || L->gcstage != LUA_GCIDLE) {
+    do {
+      luaC_collect(L, 10000);
+    } while (L->gcstage != LUA_GCIDLE);
   }
 }
 
+/*
+   Frame slice: called once per frame with the frame work budget. A new
+   cycle is started a bit before the threshold so that it is done by
+   frame slices rather than by allocation steps in the middle of a frame.
+*/
+void luaC_step (lua_State *L, int work) {
+
+  if (L->last_gcalloc < 0 || work <= 0) return;
+
+  if (L->gcstage == LUA_GCIDLE &&
+      L->nblocks < L->GCthreshold - L->GCthreshold/4)
+    return;  /* nothing to do yet */
+
+  luaC_collect(L, work);
+  if (L->gcstage != LUA_GCIDLE)
+    L->GCthreshold = L->nblocks + LUA_GCSTEPSIZE;
+}
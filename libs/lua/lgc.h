@@ -16,8 +16,20 @@
 
 #define LUA_GCSTEP		100
 
+/* incremental pacing defaults */
+#define LUA_GCPAUSE		200	/* next cycle when memory doubled */
+#define LUA_GCSTEPMUL		1000	/* work units of an allocation step */
+#define LUA_GCSTEPSIZE		8192	/* bytes allocated between steps */
+
+/*
+   new values are grey while a cycle runs, so that they survive it. Out of
+   a cycle they are white like any other value: they will be reached from
+   the roots or through the write barrier.
+*/
+#define ingccycle(L)	((L)->gcstage >= LUA_GCMARK && (L)->gcstage <= LUA_GCSWEEP)
+
 #define mark_newvalue(L, v) { 			\
-  v->marked = -1; 				\
+  v->marked = ingccycle(L) ? -1 : 0;		\
   L->gcalloc++;					\
   if (!L->gcroot) {				\
     v->gcprev = v->gcnext = (GCValue*)v;	\
@@ -73,6 +85,15 @@
   }								\
 }
       
+/*
+   write barrier: object o is stored into table h. If h is already black
+   it will not be traversed again during this cycle, so o is greymarked.
+   Out of the mark stage there is nothing to do: the stored value would
+   otherwise survive the next cycle even if dropped in between.
+*/
+#define luaC_barrier(L, h, o)					\
+  if ((L)->gcstage == LUA_GCMARK && isblack(h)) { markobject(o, L, 0); }
+
 #define blackmark(v)	(v)->marked = (v)->marked ? abs((v)->marked) : 1
 
 #define iswhite(v)	((v)->marked == 0)
@@ -88,4 +109,7 @@ void luaC_checkGC (lua_State *L);
 
 void luaC_collectgarbage (lua_State *L, int count);
 
+void luaC_step (lua_State *L, int work);
+void luaC_fullgc (lua_State *L);
+
 #endif
@@ -10,6 +10,7 @@
 #include <stdlib.h>
 #include <string.h>
 //#include <time.h>
+#include <arch/timer.h>
 
 #include "lua.h"
 
@@ -535,6 +536,8 @@ static int io_getenv (lua_State *L) {
 
 static int io_clock (lua_State *L) {
 /*  lua_pushnumber(L, ((double)clock())/CLOCKS_PER_SEC); */
+  /* no clock() on dreamcast : seconds since timer start */
+  lua_pushnumber(L, (double)timer_ms_gettime64() / 1000.0);
   return 1;
 }
 
@@ -19,6 +19,7 @@
 #include "lstring.h"
 #include "ltable.h"
 #include "luadebug.h"
+#include "lualex.h"
 #include "lzio.h"
 
 
@@ -378,3 +379,177 @@ int luaX_lex (LexState *LS, SemInfo *seminfo) {
   }
 }
 
+
+
+/*
+** {======================================================================
+** Line scanner for source viewers (see lualex.h).
+** Same lexical rules as luaX_lex, without semantic values and errors.
+** State at line start: low byte is the open token (SCODE, SQUOTE,
+** SDQUOTE or SLONG with the [[ nesting level in next byte); SFUNCTION is
+** set while the name of a defined function is expected.
+** =======================================================================
+*/
+
+#define SCODE		0
+#define SQUOTE		1
+#define SDQUOTE		2
+#define SLONG		3
+#define SFUNCTION	0x10000
+
+#define smode(s)	((s) & 0xff)
+#define slevel(s)	(((s) >> 8) & 0xff)
+
+
+static void addspan (lua_LexSpan *spans, int maxspans, int *n,
+                     int start, int end, int kind) {
+  if (end <= start) return;
+  if (*n > 0 && spans && *n <= maxspans && spans[*n-1].kind == kind &&
+      kind != LUA_LEXFUNCDEF && spans[*n-1].start + spans[*n-1].len == start)
+    spans[*n-1].len += end - start;  /* merge with previous span */
+  else {
+    if (spans && *n < maxspans) {
+      spans[*n].start = start;
+      spans[*n].len = end - start;
+      spans[*n].kind = kind;
+    }
+    (*n)++;
+  }
+}
+
+
+static int isreserved (const char *s, int len) {
+  int i;
+  for (i=0; i<NUM_RESERVED; i++) {
+    if ((int)strlen(token2string[i]) == len && !memcmp(token2string[i], s, len))
+      return i+FIRST_RESERVED;
+  }
+  return 0;
+}
+
+
+/* end of a quoted string opened before `i'; -1 if it goes on next line */
+static int scanquote (const char *l, int len, int i, int del, int *cont) {
+  *cont = 0;
+  while (i < len) {
+    if (l[i] == '\\') {
+      if (i+1 == len) {  /* escaped end of line */
+        *cont = 1;
+        return len;
+      }
+      i += 2;
+    }
+    else if (l[i++] == del)
+      return i;
+  }
+  return len;  /* unfinished string: ends with the line */
+}
+
+
+/* end of a long string of nesting `*level'; stops at end of line */
+static int scanlong (const char *l, int len, int i, int *level) {
+  while (i < len) {
+    if (l[i] == '[' && i+1 < len && l[i+1] == '[') {
+      (*level)++;
+      i += 2;
+    }
+    else if (l[i] == ']' && i+1 < len && l[i+1] == ']') {
+      i += 2;
+      if (--(*level) == 0) return i;
+    }
+    else i++;
+  }
+  return len;
+}
+
+
+LUA_API int lua_scanline (const char *l, int len, int state,
+                          lua_LexSpan *spans, int maxspans, int *nspans) {
+  int n = 0, i = 0, fdef = state & SFUNCTION;
+  int level, cont;
+  switch (smode(state)) {  /* token left open by previous line */
+    case SQUOTE: case SDQUOTE:
+      i = scanquote(l, len, 0, smode(state) == SQUOTE ? '\'' : '"', &cont);
+      addspan(spans, maxspans, &n, 0, i, LUA_LEXSTRING);
+      if (cont) goto done;
+      state = SCODE;
+      break;
+    case SLONG:
+      level = slevel(state);
+      i = scanlong(l, len, 0, &level);
+      addspan(spans, maxspans, &n, 0, i, LUA_LEXSTRING);
+      if (level) {
+        state = SLONG | (level << 8);
+        goto done;
+      }
+      state = SCODE;
+      break;
+  }
+  while (i < len) {
+    int c = (unsigned char)l[i], start = i;
+    if (isspace(c)) {
+      while (i < len && isspace((unsigned char)l[i])) i++;
+      addspan(spans, maxspans, &n, start, i, LUA_LEXSPACE);
+    }
+    else if (c == '-' && i+1 < len && l[i+1] == '-') {
+      addspan(spans, maxspans, &n, start, len, LUA_LEXCOMMENT);
+      i = len;
+    }
+    else if (c == '"' || c == '\'') {
+      i = scanquote(l, len, i+1, c, &cont);
+      addspan(spans, maxspans, &n, start, i, LUA_LEXSTRING);
+      if (cont) {
+        state = (c == '\'') ? SQUOTE : SDQUOTE;
+        goto done;
+      }
+    }
+    else if (c == '[' && i+1 < len && l[i+1] == '[') {
+      level = 1;
+      i = scanlong(l, len, i+2, &level);
+      addspan(spans, maxspans, &n, start, i, LUA_LEXSTRING);
+      if (level) {
+        state = SLONG | (level << 8);
+        goto done;
+      }
+    }
+    else if (isdigit(c) || (c == '.' && i+1 < len && isdigit((unsigned char)l[i+1]))) {
+      while (i < len && (isdigit((unsigned char)l[i]) || l[i] == '.')) i++;
+      if (i < len && toupper((unsigned char)l[i]) == 'E') {
+        i++;
+        if (i < len && (l[i] == '+' || l[i] == '-')) i++;
+        while (i < len && isdigit((unsigned char)l[i])) i++;
+      }
+      addspan(spans, maxspans, &n, start, i, LUA_LEXNUMBER);
+    }
+    else if (isalpha(c) || c == '_') {
+      int tok, j;
+      while (i < len && (isalnum((unsigned char)l[i]) || l[i] == '_')) i++;
+      tok = isreserved(l+start, i-start);
+      if (tok) {
+        addspan(spans, maxspans, &n, start, i, LUA_LEXKEYWORD);
+        fdef = (tok == TK_FUNCTION) ? SFUNCTION : 0;
+        continue;
+      }
+      for (j = i; j < len && isspace((unsigned char)l[j]); j++) ;
+      addspan(spans, maxspans, &n, start, i,
+              fdef ? LUA_LEXFUNCDEF :
+              (j < len && l[j] == '(') ? LUA_LEXFUNCNAME : LUA_LEXNAME);
+      continue;
+    }
+    else {
+      i++;
+      if (fdef && (c == '.' || c == ':')) {
+        addspan(spans, maxspans, &n, start, i, LUA_LEXFUNCDEF);
+        continue;
+      }
+      addspan(spans, maxspans, &n, start, i, LUA_LEXPUNCT);
+    }
+    if (!isspace(c)) fdef = 0;
+  }
+  state = SCODE;
+ done:
+  if (nspans) *nspans = (n < maxspans) ? n : maxspans;
+  return state | fdef;
+}
+
+/* }====================================================================== */
@@ -7,6 +7,7 @@
 #undef MALLOC_DEBUG
 
 #include <stdlib.h>
+#include <string.h>
 
 #include "lua.h"
 
@@ -117,6 +118,374 @@ static void *debug_realloc (void *block, size_t size) {
 #endif
 
 
+#ifndef LUA_NOARENA
+/*
+** {======================================================================
+** Arena for small blocks.
+** Blocks up to MAXSMALL bytes are rounded to a size class and taken from
+** pages of CHUNKSIZE chunks obtained from the system. A page serves one
+** class: blocks are handed out by bumping an index, freed blocks go to
+** the page free list. Bigger blocks are given to the system allocator
+** with a header holding their size. The arena is shared by all states.
+** =======================================================================
+*/
+
+#define PAGESHIFT	12
+#define PAGESIZE	(1<<PAGESHIFT)
+#define CHUNKSHIFT	16
+#define CHUNKSIZE	(1<<CHUNKSHIFT)
+#define NPAGES		(CHUNKSIZE/PAGESIZE)
+#define MAXSMALL	256
+#define MAPSIZE		256	/* chunk lookup table (by 64K window) */
+
+/* header of big blocks, keeps maximum alignment */
+#define BIGHEADER	(sizeof(union L_Umaxalign))
+#define bigsize(b)	(*(size_t *)((char *)(b) - BIGHEADER))
+
+#define pageof(c,b)	(&(c)->page[((char *)(b) - (c)->base) >> PAGESHIFT])
+#define sizeclass(s)	(arena.sizeclass[((s)+7)>>3])
+
+static const unsigned short classsize[LUA_MEMCLASSES] = {
+  8, 16, 24, 32, 40, 48, 56, 64, 80, 96, 112, 128, 160, 192, 224, 256
+};
+
+typedef struct Page {
+  struct Page *next, *prev;  /* class list (pages with free blocks) or free pages */
+  void *freeblocks;  /* freed blocks of this page */
+  char *mem;
+  short cls;  /* size class; -1 for a free page */
+  unsigned short used;  /* blocks in use */
+  unsigned short bump;  /* blocks handed out so far */
+  unsigned short max;  /* blocks in the page */
+} Page;
+
+typedef struct ChunkLink {
+  struct ChunkLink *next;
+  struct Chunk *chunk;
+} ChunkLink;
+
+/* a chunk spans two 64K windows: it is linked in both */
+typedef struct Chunk {
+  ChunkLink link[2];
+  char *base;
+  int nfree;  /* free pages */
+  Page page[NPAGES];
+} Chunk;
+
+static struct {
+  unsigned char sizeclass[MAXSMALL/8+1];  /* (size+7)/8 -> class */
+  Page *partial[LUA_MEMCLASSES];  /* pages with free blocks */
+  Page *freepages;  /* free pages of all chunks */
+  ChunkLink *map[MAPSIZE];
+  unsigned long softlimit;  /* full collection above this (see luaM_needcollect) */
+  lua_MemStats stats;
+} arena;
+
+
+static void linkpage (Page **l, Page *p) {
+  p->prev = NULL;
+  p->next = *l;
+  if (*l) (*l)->prev = p;
+  *l = p;
+}
+
+
+static void unlinkpage (Page **l, Page *p) {
+  if (p->prev) p->prev->next = p->next;
+  else *l = p->next;
+  if (p->next) p->next->prev = p->prev;
+}
+
+
+static void initarena (void) {
+  int i, c = 0;
+  for (i=0; i<=MAXSMALL/8; i++) {
+    while (classsize[c] < i*8) c++;
+    arena.sizeclass[i] = (unsigned char)c;
+  }
+  for (i=0; i<LUA_MEMCLASSES; i++)
+    arena.stats.cls[i].size = classsize[i];
+}
+
+
+static Chunk *findchunk (const void *b) {
+  ChunkLink *l = arena.map[((unsigned long)b >> CHUNKSHIFT) & (MAPSIZE-1)];
+  for (; l; l = l->next) {
+    Chunk *c = l->chunk;
+    if ((const char *)b >= c->base && (const char *)b < c->base + CHUNKSIZE)
+      return c;
+  }
+  return NULL;
+}
+
+
+static void mapchunk (Chunk *c, int add) {
+  int i;
+  for (i=0; i<2; i++) {
+    ChunkLink **l = &arena.map[(((unsigned long)c->base >> CHUNKSHIFT) + i)
+                                & (MAPSIZE-1)];
+    if (add) {
+      c->link[i].chunk = c;
+      c->link[i].next = *l;
+      *l = &c->link[i];
+    }
+    else {
+      while (*l != &c->link[i]) l = &(*l)->next;
+      *l = c->link[i].next;
+    }
+  }
+}
+
+
+static int newchunk (void) {
+  Chunk *c = (Chunk *)malloc(sizeof(Chunk) + CHUNKSIZE + BIGHEADER);
+  int i;
+  if (c == NULL) return 0;
+  c->base = (char *)(c+1);
+  c->base += (BIGHEADER - (unsigned long)c->base % BIGHEADER) % BIGHEADER;
+  c->nfree = NPAGES;
+  for (i=0; i<NPAGES; i++) {
+    Page *p = &c->page[i];
+    p->mem = c->base + i*PAGESIZE;
+    p->cls = -1;
+    linkpage(&arena.freepages, p);
+  }
+  mapchunk(c, 1);
+  arena.stats.chunks++;
+  arena.stats.freepages += NPAGES;
+  return 1;
+}
+
+
+static void freechunk (Chunk *c) {
+  int i;
+  for (i=0; i<NPAGES; i++)
+    unlinkpage(&arena.freepages, &c->page[i]);
+  mapchunk(c, 0);
+  arena.stats.chunks--;
+  arena.stats.freepages -= NPAGES;
+  free(c);
+}
+
+
+static Page *newpage (int cls) {
+  Page *p = arena.freepages;
+  if (p == NULL) {
+    if (!newchunk()) return NULL;
+    p = arena.freepages;
+  }
+  unlinkpage(&arena.freepages, p);
+  findchunk(p->mem)->nfree--;
+  arena.stats.freepages--;
+  arena.stats.cls[cls].pages++;
+  p->cls = (short)cls;
+  p->freeblocks = NULL;
+  p->used = p->bump = 0;
+  p->max = PAGESIZE / classsize[cls];
+  linkpage(&arena.partial[cls], p);
+  return p;
+}
+
+
+/* an empty page goes back to its chunk; empty chunks go back to the
+   system once enough other free pages are left */
+static void freepage (Chunk *c, Page *p) {
+  arena.stats.cls[p->cls].pages--;
+  p->cls = -1;
+  linkpage(&arena.freepages, p);
+  arena.stats.freepages++;
+  if (++c->nfree == NPAGES && arena.stats.freepages >= NPAGES + NPAGES/2)
+    freechunk(c);
+}
+
+
+static void *smallalloc (int cls) {
+  Page *p = arena.partial[cls];
+  void *b;
+  if (p == NULL && (p = newpage(cls)) == NULL)
+    return NULL;
+  if (p->freeblocks) {
+    b = p->freeblocks;
+    p->freeblocks = *(void **)b;
+  }
+  else
+    b = p->mem + (p->bump++) * classsize[cls];
+  if (++p->used == p->max)  /* page is full */
+    unlinkpage(&arena.partial[cls], p);
+  arena.stats.cls[cls].live += classsize[cls];
+  arena.stats.small += classsize[cls];
+  return b;
+}
+
+
+static void smallfree (Chunk *c, void *b) {
+  Page *p = pageof(c, b);
+  int cls = p->cls;
+  *(void **)b = p->freeblocks;
+  p->freeblocks = b;
+  if (p->used-- == p->max)  /* page was full */
+    linkpage(&arena.partial[cls], p);
+  arena.stats.cls[cls].live -= classsize[cls];
+  arena.stats.small -= classsize[cls];
+  if (p->used == 0) {
+    unlinkpage(&arena.partial[cls], p);
+    freepage(c, p);
+  }
+}
+
+
+static void *bigalloc (size_t size) {
+  char *b = (char *)malloc(BIGHEADER + size);
+  if (b == NULL) return NULL;
+  *(size_t *)b = size;
+  arena.stats.big += size;
+  return b + BIGHEADER;
+}
+
+
+static void afree (void *b) {
+  Chunk *c = findchunk(b);
+  if (c)
+    smallfree(c, b);
+  else {
+    arena.stats.big -= bigsize(b);
+    free((char *)b - BIGHEADER);
+  }
+}
+
+
+static void *aalloc (size_t size) {
+  unsigned long used;
+  void *b = NULL;
+  if (arena.stats.cls[0].size == 0) initarena();
+  arena.stats.allocs++;
+  if (size <= MAXSMALL)
+    b = smallalloc(sizeclass(size));
+  if (b == NULL)  /* big block (or no more chunk) */
+    b = bigalloc(size);
+  used = arena.stats.small + arena.stats.big;
+  if (used > arena.stats.peak) arena.stats.peak = used;
+  return b;
+}
+
+
+/* size of a block, as seen by the arena (0 for NULL) */
+static size_t asize (const void *b) {
+  Chunk *c;
+  if (b == NULL) return 0;
+  c = findchunk(b);
+  if (c) return classsize[pageof(c, b)->cls];
+  return bigsize(b);
+}
+
+
+static void *arealloc (void *block, size_t size) {
+  Chunk *c;
+  size_t osize;
+  void *b;
+  if (block == NULL)
+    return aalloc(size);
+  c = findchunk(block);
+  if (c == NULL) {
+    osize = bigsize(block);
+    if (size > MAXSMALL) {  /* big to big: the system may grow it in place */
+      char *nb = (char *)realloc((char *)block - BIGHEADER, BIGHEADER + size);
+      unsigned long used;
+      if (nb == NULL) return NULL;
+      *(size_t *)nb = size;
+      arena.stats.big += size - osize;
+      used = arena.stats.small + arena.stats.big;
+      if (used > arena.stats.peak) arena.stats.peak = used;
+      return nb + BIGHEADER;
+    }
+  }
+  else {
+    osize = classsize[pageof(c, block)->cls];
+    if (size <= MAXSMALL && classsize[sizeclass(size)] == osize)
+      return block;  /* same class */
+  }
+  b = aalloc(size);
+  if (b) {
+    memcpy(b, block, osize < size ? osize : size);
+    afree(block);
+  }
+  return b;
+}
+
+
+/*
+** Hard cap: luaC_checkGC runs a full collection once memory in use is
+** above `softlimit', set between the memory left after the last full
+** collection and the cap. Allocations above the cap fail.
+*/
+static void setsoftlimit (void) {
+  unsigned long used = arena.stats.small + arena.stats.big;
+  unsigned long l = arena.stats.limit;
+  unsigned long s = used < l ? used + (l - used)/2 : l;
+  arena.softlimit = (s > l - l/8) ? s : l - l/8;
+}
+
+
+int luaM_needcollect (void) {
+  return arena.stats.limit &&
+         arena.stats.small + arena.stats.big > arena.softlimit;
+}
+
+
+void luaM_collected (void) {
+  if (arena.stats.limit) setsoftlimit();
+}
+
+
+LUA_API void lua_setmemlimit (lua_State *L, int limitkb) {
+  (void)L;
+  arena.stats.limit = (limitkb > 0) ? (unsigned long)limitkb << 10 : 0;
+  if (arena.stats.limit) setsoftlimit();
+}
+
+
+LUA_API void lua_getmemstats (lua_State *L, lua_MemStats *stats, int reset) {
+  (void)L;
+  if (arena.stats.cls[0].size == 0) initarena();
+  if (stats) *stats = arena.stats;
+  if (reset) {
+    arena.stats.peak = arena.stats.small + arena.stats.big;
+    arena.stats.fails = 0;
+    arena.stats.allocs = 0;
+  }
+}
+
+
+#define overlimit(b,s)	(arena.stats.limit && \
+	arena.stats.small + arena.stats.big + (s) > arena.stats.limit + asize(b))
+#define countfail()	(arena.stats.fails++)
+
+#undef realloc
+#undef free
+#define realloc(b, s)	arealloc(b, s)
+#define free(b)		afree(b)
+
+/* }====================================================================== */
+#else
+
+int luaM_needcollect (void) { return 0; }
+void luaM_collected (void) {}
+
+LUA_API void lua_setmemlimit (lua_State *L, int limitkb) {
+  (void)L; (void)limitkb;
+}
+
+LUA_API void lua_getmemstats (lua_State *L, lua_MemStats *stats, int reset) {
+  (void)L; (void)reset;
+  if (stats) memset(stats, 0, sizeof(*stats));
+}
+
+#define overlimit(b,s)	0
+#define countfail()	((void)0)
+
+#endif
+
+
 void *luaM_growaux (lua_State *L, void *block, size_t nelems,
                int inc, size_t size, const char *errormsg, size_t limit) {
   size_t newn = nelems+inc;
@@ -139,7 +508,12 @@ void *luaM_realloc (lua_State *L, void *block, lint32 size) {
   }
   else if (size >= MAX_SIZET)
     lua_error(L, "memory allocation error: block too big");
-  block = realloc(block, size);
+  if (overlimit(block, size)) {
+    countfail();
+    block = NULL;
+  }
+  else
+    block = realloc(block, size);
   if (block == NULL) {
     if (L)
       luaD_breakrun(L, LUA_ERRMEM);  /* break run without error message */
@@ -148,4 +522,3 @@ void *luaM_realloc (lua_State *L, void *block, lint32 size) {
   return block;
 }
 
-
@@ -18,6 +18,9 @@ void *luaM_growaux (lua_State *L, void *block, size_t nelems,
                     int inc, size_t size, const char *errormsg,
                     size_t limit);
 
+int luaM_needcollect (void);
+void luaM_collected (void);
+
 #define luaM_free(L, b)		luaM_realloc(L, (b), 0)
 #define luaM_malloc(L, t)	luaM_realloc(L, NULL, (t))
 #define luaM_new(L, t)          ((t *)luaM_malloc(L, sizeof(t)))
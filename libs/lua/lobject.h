@@ -192,6 +192,8 @@ typedef struct Hash {
   int htag;
   int size;
   Node *firstfree;  /* this position is free; all positions after it are full */
+  TObject *array;  /* array part: values of integer keys 1..sizearray */
+  int sizearray;
 } Hash;
 
 
@@ -157,6 +157,20 @@ OP_CLOSURE/*	A B	v_b-v_1		closure(KPROTO[a], v_1-v_b)	*/
 
 
 
+/*
+** initial sizes of a table constructor, packed in the argU of
+** OP_CREATETABLE: list items in the high bits, record items in the low
+** ones. They are only hints: larger counts are clamped.
+*/
+#define CREATETABLE_BITS	(SIZE_U/2)
+#define CREATETABLE_MAX		((1<<CREATETABLE_BITS)-1)
+#define CREATETABLE_ARG(na,nh)	\
+	(((na) < CREATETABLE_MAX ? (na) : CREATETABLE_MAX) << CREATETABLE_BITS | \
+	 ((nh) < CREATETABLE_MAX ? (nh) : CREATETABLE_MAX))
+#define CREATETABLE_NARRAY(u)	((int)((u) >> CREATETABLE_BITS))
+#define CREATETABLE_NHASH(u)	((int)((u) & CREATETABLE_MAX))
+
+
 /* special code to fit a LUA_MULTRET inside an argB */
 #define MULT_RET        255	/* (<=MAXARG_B) */
 #if MULT_RET>MAXARG_B
@@ -581,20 +581,23 @@ static void constructor (LexState *ls) {
   FuncState *fs = ls->fs;
   int line = ls->linenumber;
   int pc = luaK_code1(fs, OP_CREATETABLE, 0);
-  int nelems;
+  int nelems[2];  /* list and record items */
   Constdesc cd;
   check(ls, '{');
   constructor_part(ls, &cd);
-  nelems = cd.n;
+  nelems[0] = nelems[1] = 0;
+  nelems[cd.k == 1] = cd.n;
   if (optional(ls, ';')) {
     Constdesc other_cd;
     constructor_part(ls, &other_cd);
     check_condition(ls, (cd.k != other_cd.k), "invalid constructor syntax");
-    nelems += other_cd.n;
+    nelems[other_cd.k == 1] += other_cd.n;
   }
   check_match(ls, '}', '{', line);
-  luaX_checklimit(ls, nelems, MAXARG_U, "elements in a table constructor");
-  SETARG_U(fs->f->code[pc], nelems);  /* set initial table size */
+  luaX_checklimit(ls, nelems[0]+nelems[1], MAXARG_U,
+                  "elements in a table constructor");
+  /* set initial table sizes */
+  SETARG_U(fs->f->code[pc], CREATETABLE_ARG(nelems[0], nelems[1]));
 }
 
 /* }====================================================================== */
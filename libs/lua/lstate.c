@@ -6,6 +6,7 @@
 
 
 #include <stdio.h>
+#include <string.h>
 
 #include "lua.h"
 
@@ -47,7 +48,7 @@ static void f_luaopen (lua_State *L, void *ud) {
     stacksize = DEFAULT_STACK_SIZE;
   else
     stacksize += LUA_MINSTACK;
-  L->gt = luaH_new(L, 10);  /* table of globals */
+  L->gt = luaH_new(L, 0, 10);  /* table of globals */
   luaD_init(L, stacksize);
   luaS_init(L);
   luaX_init(L);
@@ -85,8 +86,14 @@ LUA_API lua_State *lua_open (int stacksize) {
   L->gcstage = 0;
   L->gcTM = 0;
   L->GCthreshold = MAX_INT;  /* to avoid GC during pre-definitions */
+  L->gcpause = LUA_GCPAUSE;
+  L->gcstepmul = LUA_GCSTEPMUL;
+  L->gcmin = 0;
+  memset(&L->gcstats, 0, sizeof(L->gcstats));
   L->callhook = NULL;
   L->linehook = NULL;
+  L->samplehook = NULL;
+  L->sampleticks = 0;
   L->allowhooks = 1;
   L->errorJmp = NULL;
   if (luaD_runprotected(L, f_luaopen, &stacksize) != 0) {
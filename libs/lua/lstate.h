@@ -69,8 +69,14 @@ struct lua_State {
   int gcalloc, last_gcalloc;  /* it is used to calculate the rate of mem allocation */
   unsigned long GCthreshold;
   unsigned long nblocks;  /* number of `bytes' currently allocated */
+  int gcpause;  /* threshold after a cycle, in % of memory in use */
+  int gcstepmul;  /* work of a step triggered by allocation (0: full cycle) */
+  unsigned long gcmin;  /* minimum threshold */
+  lua_GCStats gcstats;  /* collector pauses statistics */
   lua_Hook callhook;
   lua_Hook linehook;
+  lua_SampleHook samplehook;
+  volatile int sampleticks;  /* ticks counted by lua_sampletick */
   int allowhooks;
 };
 
@@ -26,12 +26,15 @@ union L_UTString {
 
 
 void luaS_init (lua_State *L) {
-  L->strt.hash = luaM_newvector(L, 1, TString *);
+  int i;
+  L->strt.hash = luaM_newvector(L, MINSTRTABSIZE, TString *);
   L->udt.hash = luaM_newvector(L, 1, TString *);
-  L->nblocks += 2*sizeof(TString *);
-  L->strt.size = L->udt.size = 1;
+  L->nblocks += (MINSTRTABSIZE+1)*sizeof(TString *);
+  L->strt.size = MINSTRTABSIZE;
+  L->udt.size = 1;
   L->strt.nuse = L->udt.nuse = 0;
-  L->strt.hash[0] = L->udt.hash[0] = NULL;
+  for (i=0; i<MINSTRTABSIZE; i++) L->strt.hash[i] = NULL;
+  L->udt.hash[0] = NULL;
 }
 
 
@@ -44,11 +47,17 @@ void luaS_freeall (lua_State *L) {
 }
 
 
+/*
+** strings up to HASHFULL chars are hashed on their whole length. Longer
+** ones are sampled from their end, where file paths usually differ.
+*/
+#define HASHFULL	128
+
 static unsigned long hash_s (const char *s, size_t l) {
   unsigned long h = l;  /* seed */
-  size_t step = (l>>5)|1;  /* if string is too long, don't hash all its chars */
+  size_t step = (l <= HASHFULL) ? 1 : (l>>6)+1;
   for (; l>=step; l-=step)
-    h = h ^ ((h<<5)+(h>>2)+(unsigned char)*(s++));
+    h = h ^ ((h<<5)+(h>>2)+(unsigned char)s[l-1]);
   return h;
 }
 
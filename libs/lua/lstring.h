@@ -20,6 +20,13 @@
 #define RESERVEDMARK	3
 
 
+/*
+** initial (and minimum) size of the string table; scripts create a few
+** thousand strings at startup, so start big enough to skip first rehashes
+*/
+#define MINSTRTABSIZE	512
+
+
 #define sizestring(l)	((long)sizeof(TString) + \
                          ((long)(l+1)-TSPACK)*(long)sizeof(char))
 
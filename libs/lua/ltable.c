@@ -15,6 +15,10 @@
 ** same main position (i.e. the same hash values for that table size).
 ** Because of that, the load factor of these tables can be 100% without
 ** performance penalties.
+**
+** Values of integer keys 1..sizearray are kept apart in a plain array.
+** Sizes of both parts are computed on rehash, so that the array part is
+** at least half used.
 */
 
 
@@ -28,12 +32,36 @@
 #include "lgc.h"
 
 #define gcsize(L, n)	(sizeof(Hash)+(n)*sizeof(Node))
+#define gcarraysize(n)	((n)*sizeof(TObject))
 
 
+/* max size of array part is 2^MAXBITS */
+#define MAXBITS		24
+#define MAXASIZE	(1 << MAXBITS)
+
 
 #define TagDefault LUA_TTABLE
 
 
+/*
+** returns `k' if it is a valid index of the array part of `t', 0 otherwise
+*/
+#define inarray(t, k)	((unsigned int)((k)-1) < (unsigned int)(t)->sizearray)
+
+
+/*
+** returns `key' as a positive integer, or 0 if it is not one
+*/
+static int arrayindex (const TObject *key) {
+  if (ttype(key) == LUA_TNUMBER) {
+    int k = (int)nvalue(key);
+    if ((Number)k == nvalue(key) && k > 0)
+      return k;
+  }
+  return 0;
+}
+
+
 
 /*
 ** returns the `main' position of an element in a table (that is, the index
@@ -82,7 +110,11 @@ static const TObject *luaH_getany (lua_State *L, const Hash *t,
 
 /* specialized version for numbers */
 const TObject *luaH_getnum (const Hash *t, Number key) {
-  Node *n = &t->node[(unsigned long)(long)key&(t->size-1)];
+  int k = (int)key;
+  Node *n;
+  if (inarray(t, k) && (Number)k == key)
+    return &t->array[k-1];
+  n = &t->node[(unsigned long)(long)key&(t->size-1)];
   do {
     if (ttype(&n->key) == LUA_TNUMBER && nvalue(&n->key) == key)
       return &n->val;
@@ -113,23 +145,50 @@ const TObject *luaH_get (lua_State *L, const Hash *t, const TObject *key) {
 }
 
 
-Node *luaH_next (lua_State *L, const Hash *t, const TObject *key) {
-  int i;
+/*
+** traversal order is the array part (0..sizearray-1) then the hash
+** part (sizearray..); returns the index following `key' in that order
+*/
+static int nextindex (lua_State *L, const Hash *t, const TObject *key) {
+  const TObject *v;
+  int k;
   if (ttype(key) == LUA_TNIL)
-    i = 0;  /* first iteration */
-  else {
-    const TObject *v = luaH_get(L, t, key);
-    if (v == &luaO_nilobject)
-      lua_error(L, "invalid key for `next'");
-    i = (int)(((const char *)v -
-               (const char *)(&t->node[0].val)) / sizeof(Node)) + 1;
+    return 0;  /* first iteration */
+  k = arrayindex(key);
+  if (inarray(t, k))
+    return k;
+  v = luaH_get(L, t, key);
+  if (v == &luaO_nilobject)
+    lua_error(L, "invalid key for `next'");
+  return (int)(((const char *)v -
+                (const char *)(&t->node[0].val)) / sizeof(Node)) + 1
+         + t->sizearray;
+}
+
+
+/*
+** stores the key and value following `key' in res[0] and res[1];
+** `res' may be `key'. Returns 0 when there are no more elements.
+*/
+int luaH_next (lua_State *L, const Hash *t, const TObject *key, TObject *res) {
+  int i = nextindex(L, t, key);
+  for (; i<t->sizearray; i++) {
+    if (ttype(&t->array[i]) != LUA_TNIL) {
+      ttype(res) = LUA_TNUMBER;
+      nvalue(res) = i+1;
+      res[1] = t->array[i];
+      return 1;
+    }
   }
-  for (; i<t->size; i++) {
+  for (i -= t->sizearray; i<t->size; i++) {
     Node *n = node(t, i);
-    if (ttype(val(n)) != LUA_TNIL)
-      return n;
+    if (ttype(val(n)) != LUA_TNIL) {
+      res[0] = *key(n);
+      res[1] = *val(n);
+      return 1;
+    }
   }
-  return NULL;  /* no more elements */
+  return 0;  /* no more elements */
 }
 
 
@@ -158,6 +217,16 @@ void luaH_remove (Hash *t, TObject *key) {
 }
 
 
+static void setarrayvector (lua_State *L, Hash *t, int size) {
+  int i;
+  luaM_reallocvector(L, t->array, size, TObject);
+  for (i=t->sizearray; i<size; i++)
+    ttype(&t->array[i]) = LUA_TNIL;
+  L->nblocks += gcarraysize(size) - gcarraysize(t->sizearray);
+  t->sizearray = size;
+}
+
+
 static void setnodevector (lua_State *L, Hash *t, lint32 size) {
   int i;
   if (size > MAX_INT)
@@ -173,7 +242,7 @@ static void setnodevector (lua_State *L, Hash *t, lint32 size) {
 }
 
 
-Hash *luaH_new (lua_State *L, int size) {
+Hash *luaH_new (lua_State *L, int narray, int nhash) {
   Hash *t = luaM_new(L, Hash);
   t->htag = TagDefault;
   t->vtype = LUA_VHash;
@@ -181,53 +250,153 @@ Hash *luaH_new (lua_State *L, int size) {
   t->size = 0;
   L->nblocks += gcsize(L, 0);
   t->node = NULL;
-  setnodevector(L, t, luaO_power2(size));
+  t->array = NULL;
+  t->sizearray = 0;
+  if (narray > 0)
+    setarrayvector(L, t, narray);
+  setnodevector(L, t, luaO_power2(nhash));
   return t;
 }
 
 
 void luaH_free (lua_State *L, Hash *t) {
-  L->nblocks -= gcsize(L, t->size);
+  L->nblocks -= gcsize(L, t->size) + gcarraysize(t->sizearray);
+  luaM_free(L, t->array);
   luaM_free(L, t->node);
   luaM_free(L, t);
 }
 
 
-static int numuse (const Hash *t) {
-  Node *v = t->node;
-  int size = t->size;
-  int realuse = 0;
+/*
+** {=============================================================
+** Rehash: integer keys are counted by slices (2^(i-1), 2^i] in nums[i].
+** The array part gets the largest size n such that more than n/2 of
+** the slots 1..n are used; all other keys go to the hash part.
+** ==============================================================
+*/
+
+static int ceillog2 (unsigned int x) {
+  int l = 0;
+  x--;
+  while (x) { l++; x >>= 1; }
+  return l;
+}
+
+
+static int computesizes (int nums[], int *narray) {
   int i;
-  for (i=0; i<size; i++) {
-    if (ttype(&v[i].val) != LUA_TNIL)
-      realuse++;
+  int twotoi;  /* 2^i */
+  int a = 0;  /* number of elements smaller than 2^i */
+  int na = 0;  /* number of elements to go to array part */
+  int n = 0;  /* optimal size for array part */
+  for (i = 0, twotoi = 1; twotoi/2 < *narray; i++, twotoi *= 2) {
+    if (nums[i] > 0) {
+      a += nums[i];
+      if (a > twotoi/2) {  /* more than half elements present? */
+        n = twotoi;
+        na = a;  /* all elements smaller than n go to array part */
+      }
+    }
+    if (a == *narray) break;  /* all elements already counted */
   }
-  return realuse;
+  *narray = n;
+  return na;
 }
 
 
-static void rehash (lua_State *L, Hash *t) {
-  int oldsize = t->size;
-  Node *nold = t->node;
-  int nelems = numuse(t);
+static int countint (const TObject *key, int *nums) {
+  int k = arrayindex(key);
+  if (k > 0 && k <= MAXASIZE) {
+    nums[ceillog2(k)]++;
+    return 1;
+  }
+  return 0;
+}
+
+
+static int numusearray (const Hash *t, int *nums) {
+  int lg, ttlg;  /* 2^lg */
+  int ause = 0;
+  int i = 1;
+  for (lg=0, ttlg=1; lg<=MAXBITS; lg++, ttlg*=2) {  /* for each slice */
+    int lc = 0;
+    int lim = ttlg;
+    if (lim > t->sizearray) {
+      lim = t->sizearray;
+      if (i > lim)
+        break;  /* no more elements */
+    }
+    for (; i <= lim; i++) {
+      if (ttype(&t->array[i-1]) != LUA_TNIL)
+        lc++;
+    }
+    nums[lg] += lc;
+    ause += lc;
+  }
+  return ause;
+}
+
+
+static int numusehash (const Hash *t, int *nums, int *pnasize) {
+  int totaluse = 0;
+  int ause = 0;
+  int i = t->size;
+  while (i--) {
+    Node *n = &t->node[i];
+    if (ttype(val(n)) != LUA_TNIL) {
+      ause += countint(key(n), nums);
+      totaluse++;
+    }
+  }
+  *pnasize += ause;
+  return totaluse;
+}
+
+
+static void resize (lua_State *L, Hash *t, int nasize, int nhsize) {
   int i;
-  LUA_ASSERT(nelems<=oldsize, "wrong count");
-  if (nelems >= oldsize-oldsize/4)  /* using more than 3/4? */
-    setnodevector(L, t, (lint32)oldsize*2);
-  else if (nelems <= oldsize/4 &&  /* less than 1/4? */
-           oldsize > MINPOWER2)
-    setnodevector(L, t, oldsize/2);
-  else
-    setnodevector(L, t, oldsize);
-  for (i=0; i<oldsize; i++) {
+  int oldasize = t->sizearray;
+  int oldhsize = t->size;
+  Node *nold = t->node;
+  if (nasize > oldasize)
+    setarrayvector(L, t, nasize);
+  setnodevector(L, t, luaO_power2(nhsize));
+  if (nasize < oldasize) {  /* array part must shrink? */
+    t->sizearray = nasize;
+    /* move vanishing slice to the hash part */
+    for (i=nasize; i<oldasize; i++) {
+      if (ttype(&t->array[i]) != LUA_TNIL)
+        *luaH_setint(L, t, i+1) = t->array[i];
+    }
+    t->sizearray = oldasize;
+    setarrayvector(L, t, nasize);
+  }
+  for (i=oldhsize-1; i>=0; i--) {
     Node *old = nold+i;
     if (ttype(&old->val) != LUA_TNIL)
       *luaH_set(L, t, &old->key) = old->val;
   }
-  luaM_free(L, nold);  /* free old array */
+  luaM_free(L, nold);  /* free old node vector */
 }
 
 
+static void rehash (lua_State *L, Hash *t, const TObject *ek) {
+  int nums[MAXBITS+1];
+  int nasize, na, totaluse;
+  int i;
+  for (i=0; i<=MAXBITS; i++) nums[i] = 0;
+  nasize = numusearray(t, nums);  /* count keys in array part */
+  totaluse = nasize;
+  totaluse += numusehash(t, nums, &nasize);  /* count keys in hash part */
+  nasize += countint(ek, nums);  /* count extra key */
+  totaluse++;
+  na = computesizes(nums, &nasize);
+  resize(L, t, nasize, totaluse - na);
+}
+
+/* }============================================================= */
+
+
 /*
 ** inserts a key into a hash table; first, check whether key is
 ** already present; if not, check whether key's main position is free;
@@ -237,8 +406,13 @@ static void rehash (lua_State *L, Hash *t) {
 ** new key goes to an empty position.
 */
 TObject *luaH_set (lua_State *L, Hash *t, const TObject *key) {
-  Node *mp = luaH_mainposition(t, key);
-  Node *n = mp;
+  Node *mp, *n;
+  if (ttype(key) == LUA_TNUMBER) {
+    int k = arrayindex(key);
+    if (inarray(t, k))
+      return &t->array[k-1];
+  }
+  mp = n = luaH_mainposition(t, key);
   if (!mp)
     lua_error(L, "table index is nil");
   do {  /* check whether `key' is somewhere in the chain */
@@ -273,13 +447,16 @@ TObject *luaH_set (lua_State *L, Hash *t, const TObject *key) {
     else if (t->firstfree == t->node) break;  /* cannot decrement from here */
     else (t->firstfree)--;
   }
-  rehash(L, t);  /* no more free places */
+  ttype(&mp->val) = LUA_TNIL;  /* not counted by rehash */
+  rehash(L, t, key);  /* no more free places */
   return luaH_set(L, t, key);  /* `rehash' invalidates this insertion */
 }
 
 
 TObject *luaH_setint (lua_State *L, Hash *t, int key) {
   TObject index;
+  if (inarray(t, key))
+    return &t->array[key-1];
   ttype(&index) = LUA_TNUMBER;
   nvalue(&index) = key;
   return luaH_set(L, t, &index);
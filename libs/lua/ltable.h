@@ -14,14 +14,14 @@
 #define key(n)		(&(n)->key)
 #define val(n)		(&(n)->val)
 
-Hash *luaH_new (lua_State *L, int nhash);
+Hash *luaH_new (lua_State *L, int narray, int nhash);
 void luaH_free (lua_State *L, Hash *t);
 const TObject *luaH_get (lua_State *L, const Hash *t, const TObject *key);
 const TObject *luaH_getnum (const Hash *t, Number key);
 const TObject *luaH_getstr (const Hash *t, TString *key);
 void luaH_remove (Hash *t, TObject *key);
 TObject *luaH_set (lua_State *L, Hash *t, const TObject *key);
-Node * luaH_next (lua_State *L, const Hash *t, const TObject *r);
+int luaH_next (lua_State *L, const Hash *t, const TObject *key, TObject *res);
 TObject *luaH_setint (lua_State *L, Hash *t, int key);
 void luaH_setstrnum (lua_State *L, Hash *t, TString *key, Number val);
 unsigned long luaH_hash (lua_State *L, const TObject *key);
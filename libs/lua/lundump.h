@@ -16,9 +16,13 @@ Proto* luaU_undump (lua_State* L, ZIO* Z);
 /* find byte order */
 int luaU_endianess (void);
 
+/* save one chunk; writer returns 0 on success */
+typedef int (*luaU_Writer) (const void* p, size_t size, void* ud);
+int luaU_dump (const Proto* Main, luaU_Writer w, void* ud);
+
 /* definitions for headers of binary files */
-#define	VERSION		0x40		/* last format change was in 4.0 */
-#define	VERSION0	0x40		/* last major  change was in 4.0 */
+#define	VERSION		0x41		/* last format change : OP_CREATETABLE */
+#define	VERSION0	0x41		/* array/hash sizes (see lopcodes.h) */
 #define ID_CHUNK	27		/* binary files start with ESC... */
 #define	SIGNATURE	"Lua"		/* ...followed by this signature */
 
@@ -162,8 +162,8 @@ void luaV_settable (lua_State *L, StkId t, StkId key) {
         luaT_gettm(L, tg, TM_SETTABLE) == NULL)) { /* or no TM? */
     *luaH_set(L, hvalue(t), key) = *(L->top-1);  /* do a primitive set */
 
-    markobject(key, L, 0);
-    markobject(L->top - 1, L, 0);
+    luaC_barrier(L, hvalue(t), key);
+    luaC_barrier(L, hvalue(t), L->top - 1);
 
   }
   else {  /* try a `settable' tag method */
@@ -210,6 +210,7 @@ void luaV_setglobal (lua_State *L, TString *s) {
     if (oldvalue != &luaO_nilobject) {
       /* cast to remove `const' is OK, because `oldvalue' != luaO_nilobject */
       *(TObject *)oldvalue = *(L->top - 1);
+      luaC_barrier(L, L->gt, L->top - 1);
     }
     else {
       TObject key;
@@ -217,8 +218,8 @@ void luaV_setglobal (lua_State *L, TString *s) {
       tsvalue(&key) = s;
       *luaH_set(L, L->gt, &key) = *(L->top - 1);
 
-      markobject(&key, L, 0);
-      markobject(L->top - 1, L, 0);
+      luaC_barrier(L, L->gt, &key);
+      luaC_barrier(L, L->gt, L->top - 1);
 
     }
   }
@@ -334,11 +335,11 @@ void luaV_strconc (lua_State *L, int total, StkId top) {
 
 static void luaV_pack (lua_State *L, StkId firstelem) {
   int i;
-  Hash *htab = luaH_new(L, 0);
+  Hash *htab = luaH_new(L, L->top-firstelem, 1);
   for (i=0; firstelem+i<L->top; i++) {
     *luaH_setint(L, htab, i+1) = *(firstelem+i);
 
-    markobject(firstelem+i, L, 0);
+    luaC_barrier(L, htab, firstelem+i);
 
   }
   /* store counter in field `n' */
@@ -361,6 +362,62 @@ static void adjust_varargs (lua_State *L, StkId base, int nfixargs) {
 
 #define dojump(pc, i)	{ int d = GETARG_S(i); pc += d; }
 
+
+/*
+** Instruction dispatch. With GCC `labels as values' each instruction
+** jumps directly to the code of the next one (threaded code) instead of
+** going back to a single switch. Define LUA_NO_JUMPTABLE to force the
+** portable switch.
+*/
+#if defined(__GNUC__) && !defined(LUA_NO_JUMPTABLE)
+#define LUA_USE_JUMPTABLE	1
+#else
+#define LUA_USE_JUMPTABLE	0
+#endif
+
+#ifdef LUA_OPPROFILE
+/* opcode and opcode pair frequencies, see lua_getopprofile() */
+unsigned long luaV_opcount[NUM_OPCODES];
+unsigned long luaV_oppair[NUM_OPCODES][NUM_OPCODES];
+static int lastop;
+#define opprofile(o)	(luaV_opcount[o]++, luaV_oppair[lastop][o]++, \
+			 lastop = (o))
+#else
+#define opprofile(o)	((void)0)
+#endif
+
+#define vmfetch()	{ i = *pc++; \
+			  if (linehook) traceexec(L, base, top, linehook); \
+			  opprofile(GET_OPCODE(i)); }
+
+#if LUA_USE_JUMPTABLE
+#define vmdispatch(o)	goto *disptab[o];
+#define vmcase(l)	L_##l:
+#define vmbreak		vmfetch(); vmdispatch(GET_OPCODE(i))
+#else
+#define vmdispatch(o)	switch (o)
+#define vmcase(l)	case l:
+#define vmbreak		break
+#endif
+
+
+/*
+** Fast `t.name' for tables without `gettable' tag method and a non nil
+** field. Returns NULL when luaV_gettable() is needed.
+*/
+static const TObject *fastgetstr (lua_State *L, const TObject *t,
+                                  TString *ks) {
+  if (ttype(t) == LUA_TTABLE) {
+    const Hash *h = hvalue(t);
+    if (h->htag == LUA_TTABLE || luaT_gettm(L, h->htag, TM_GETTABLE) == NULL) {
+      const TObject *v = luaH_getstr(h, ks);
+      if (ttype(v) != LUA_TNIL)
+        return v;
+    }
+  }
+  return NULL;
+}
+
 /*
 ** Executes the given Lua function. Parameters are between [base,top).
 ** Returns n such that the the results are between [n,top).
@@ -371,6 +428,60 @@ StkId luaV_execute (lua_State *L, const Closure *cl, StkId base) {
   const Instruction *pc = tf->code;
   TString **const kstr = tf->kstr;
   const lua_Hook linehook = L->linehook;
+  Instruction i;
+#if LUA_USE_JUMPTABLE
+  static const void *const disptab[NUM_OPCODES] = {
+    &&L_OP_END,
+    &&L_OP_RETURN,
+    &&L_OP_CALL,
+    &&L_OP_TAILCALL,
+    &&L_OP_PUSHNIL,
+    &&L_OP_POP,
+    &&L_OP_PUSHINT,
+    &&L_OP_PUSHSTRING,
+    &&L_OP_PUSHNUM,
+    &&L_OP_PUSHNEGNUM,
+    &&L_OP_PUSHUPVALUE,
+    &&L_OP_GETLOCAL,
+    &&L_OP_GETGLOBAL,
+    &&L_OP_GETTABLE,
+    &&L_OP_GETDOTTED,
+    &&L_OP_GETINDEXED,
+    &&L_OP_PUSHSELF,
+    &&L_OP_CREATETABLE,
+    &&L_OP_SETLOCAL,
+    &&L_OP_SETGLOBAL,
+    &&L_OP_SETTABLE,
+    &&L_OP_SETLIST,
+    &&L_OP_SETMAP,
+    &&L_OP_ADD,
+    &&L_OP_ADDI,
+    &&L_OP_SUB,
+    &&L_OP_MULT,
+    &&L_OP_DIV,
+    &&L_OP_POW,
+    &&L_OP_CONCAT,
+    &&L_OP_MINUS,
+    &&L_OP_NOT,
+    &&L_OP_JMPNE,
+    &&L_OP_JMPEQ,
+    &&L_OP_JMPLT,
+    &&L_OP_JMPLE,
+    &&L_OP_JMPGT,
+    &&L_OP_JMPGE,
+    &&L_OP_JMPT,
+    &&L_OP_JMPF,
+    &&L_OP_JMPONT,
+    &&L_OP_JMPONF,
+    &&L_OP_JMP,
+    &&L_OP_PUSHNILJMP,
+    &&L_OP_FORPREP,
+    &&L_OP_FORLOOP,
+    &&L_OP_LFORPREP,
+    &&L_OP_LFORLOOP,
+    &&L_OP_CLOSURE
+  };
+#endif
 
 #if 0
   if (pc == NULL) { /* Added by VP, is this necessary ?? */
@@ -388,136 +499,160 @@ StkId luaV_execute (lua_State *L, const Closure *cl, StkId base) {
   top = L->top;
   /* main loop of interpreter */
   for (;;) {
-    const Instruction i = *pc++;
-    if (linehook)
-      traceexec(L, base, top, linehook);
-    switch (GET_OPCODE(i)) {
-      case OP_END: {
+    vmfetch();
+    vmdispatch(GET_OPCODE(i)) {
+      vmcase(OP_END) {
         L->top = top;
         return top;
       }
-      case OP_RETURN: {
+      vmcase(OP_RETURN) {
         L->top = top;
         return base+GETARG_U(i);
       }
-      case OP_CALL: {
+      vmcase(OP_CALL) {
         int nres = GETARG_B(i);
         if (nres == MULT_RET) nres = LUA_MULTRET;
         L->top = top;
         luaD_call(L, base+GETARG_A(i), nres);
         top = L->top;
-        break;
+        vmbreak;
       }
-      case OP_TAILCALL: {
+      vmcase(OP_TAILCALL) {
         L->top = top;
         luaD_call(L, base+GETARG_A(i), LUA_MULTRET);
         return base+GETARG_B(i);
       }
-      case OP_PUSHNIL: {
+      vmcase(OP_PUSHNIL) {
         int n = GETARG_U(i);
         LUA_ASSERT(n>0, "invalid argument");
         do {
           ttype(top++) = LUA_TNIL;
         } while (--n > 0);
-        break;
+        vmbreak;
       }
-      case OP_POP: {
+      vmcase(OP_POP) {
         top -= GETARG_U(i);
-        break;
+        if (GET_OPCODE(*pc) == OP_FORLOOP && !linehook) {
+          /* fused end of a numeric `for' body */
+          i = *pc++;
+          opprofile(OP_FORLOOP);
+          goto forloop;
+        }
+        vmbreak;
       }
-      case OP_PUSHINT: {
+      vmcase(OP_PUSHINT) {
         ttype(top) = LUA_TNUMBER;
         nvalue(top) = (Number)GETARG_S(i);
         top++;
-        break;
+        vmbreak;
       }
-      case OP_PUSHSTRING: {
+      vmcase(OP_PUSHSTRING) {
         ttype(top) = LUA_TSTRING;
         tsvalue(top) = kstr[GETARG_U(i)];
         top++;
-        break;
+        vmbreak;
       }
-      case OP_PUSHNUM: {
+      vmcase(OP_PUSHNUM) {
         ttype(top) = LUA_TNUMBER;
         nvalue(top) = tf->knum[GETARG_U(i)];
         top++;
-        break;
+        vmbreak;
       }
-      case OP_PUSHNEGNUM: {
+      vmcase(OP_PUSHNEGNUM) {
         ttype(top) = LUA_TNUMBER;
         nvalue(top) = -tf->knum[GETARG_U(i)];
         top++;
-        break;
+        vmbreak;
       }
-      case OP_PUSHUPVALUE: {
+      vmcase(OP_PUSHUPVALUE) {
         *top++ = cl->upvalue[GETARG_U(i)];
-        break;
-      }
-      case OP_GETLOCAL: {
-        *top++ = *(base+GETARG_U(i));
-        break;
+        vmbreak;
+      }
+      vmcase(OP_GETLOCAL) {
+        StkId l = base+GETARG_U(i);
+        if (GET_OPCODE(*pc) == OP_GETDOTTED && !linehook) {
+          /* fused `local.name' */
+          const TObject *v = fastgetstr(L, l, kstr[GETARG_U(*pc)]);
+          if (v != NULL) {
+            opprofile(OP_GETDOTTED);
+            pc++;
+            *top++ = *v;
+            vmbreak;
+          }
+        }
+        *top++ = *l;
+        vmbreak;
       }
-      case OP_GETGLOBAL: {
+      vmcase(OP_GETGLOBAL) {
         L->top = top;
         *top = *luaV_getglobal(L, kstr[GETARG_U(i)]);
         top++;
-        break;
+        vmbreak;
       }
-      case OP_GETTABLE: {
+      vmcase(OP_GETTABLE) {
         L->top = top;
         top--;
         *(top-1) = *luaV_gettable(L, top-1);
-        break;
-      }
-      case OP_GETDOTTED: {
-        ttype(top) = LUA_TSTRING;
-        tsvalue(top) = kstr[GETARG_U(i)];
-        L->top = top+1;
-        *(top-1) = *luaV_gettable(L, top-1);
-        break;
+        vmbreak;
+      }
+      vmcase(OP_GETDOTTED) {
+        const TObject *v = fastgetstr(L, top-1, kstr[GETARG_U(i)]);
+        if (v == NULL) {
+          ttype(top) = LUA_TSTRING;
+          tsvalue(top) = kstr[GETARG_U(i)];
+          L->top = top+1;
+          v = luaV_gettable(L, top-1);
+        }
+        *(top-1) = *v;
+        vmbreak;
       }
-      case OP_GETINDEXED: {
+      vmcase(OP_GETINDEXED) {
         *top = *(base+GETARG_U(i));
         L->top = top+1;
         *(top-1) = *luaV_gettable(L, top-1);
-        break;
+        vmbreak;
       }
-      case OP_PUSHSELF: {
+      vmcase(OP_PUSHSELF) {
         TObject receiver;
+        const TObject *v = fastgetstr(L, top-1, kstr[GETARG_U(i)]);
         receiver = *(top-1);
-        ttype(top) = LUA_TSTRING;
-        tsvalue(top++) = kstr[GETARG_U(i)];
-        L->top = top;
-        *(top-2) = *luaV_gettable(L, top-2);
-        *(top-1) = receiver;
-        break;
+        if (v == NULL) {
+          ttype(top) = LUA_TSTRING;
+          tsvalue(top) = kstr[GETARG_U(i)];
+          L->top = top+1;
+          v = luaV_gettable(L, top-1);
+        }
+        *(top-1) = *v;
+        *top++ = receiver;
+        vmbreak;
       }
-      case OP_CREATETABLE: {
+      vmcase(OP_CREATETABLE) {
         L->top = top;
         luaC_checkGC(L);
-        hvalue(top) = luaH_new(L, GETARG_U(i));
+        hvalue(top) = luaH_new(L, CREATETABLE_NARRAY(GETARG_U(i)),
+                                  CREATETABLE_NHASH(GETARG_U(i)));
         ttype(top) = LUA_TTABLE;
         top++;
-        break;
+        vmbreak;
       }
-      case OP_SETLOCAL: {
+      vmcase(OP_SETLOCAL) {
         *(base+GETARG_U(i)) = *(--top);
-        break;
+        vmbreak;
       }
-      case OP_SETGLOBAL: {
+      vmcase(OP_SETGLOBAL) {
         L->top = top;
         luaV_setglobal(L, kstr[GETARG_U(i)]);
         top--;
-        break;
+        vmbreak;
       }
-      case OP_SETTABLE: {
+      vmcase(OP_SETTABLE) {
         StkId t = top-GETARG_A(i);
         L->top = top;
         luaV_settable(L, t, t+1);
         top -= GETARG_B(i);  /* pop values */
-        break;
+        vmbreak;
       }
-      case OP_SETLIST: {
+      vmcase(OP_SETLIST) {
         int aux = GETARG_A(i) * LFIELDS_PER_FLUSH;
         int n = GETARG_B(i);
         Hash *arr = hvalue(top-n-1);
@@ -525,12 +660,12 @@ StkId luaV_execute (lua_State *L, const Closure *cl, StkId base) {
         for (; n; n--) { 
           *luaH_setint(L, arr, n+aux) = *(--top);
 
-          markobject(top, L, 0);
+          luaC_barrier(L, arr, top);
 
         }
-        break;
+        vmbreak;
       }
-      case OP_SETMAP: {
+      vmcase(OP_SETMAP) {
         int n = GETARG_U(i);
         StkId finaltop = top-2*n;
         Hash *arr = hvalue(finaltop-1);
@@ -539,21 +674,21 @@ StkId luaV_execute (lua_State *L, const Closure *cl, StkId base) {
           top-=2;
           *luaH_set(L, arr, top) = *(top+1);
 
-	  markobject(top, L, 0);
-	  markobject(top + 1, L, 0);
+	  luaC_barrier(L, arr, top);
+	  luaC_barrier(L, arr, top + 1);
 
         }
-        break;
+        vmbreak;
       }
-      case OP_ADD: {
+      vmcase(OP_ADD) {
         if (tonumber(top-2) || tonumber(top-1))
           call_arith(L, top, TM_ADD);
         else
           nvalue(top-2) += nvalue(top-1);
         top--;
-        break;
+        vmbreak;
       }
-      case OP_ADDI: {
+      vmcase(OP_ADDI) {
         if (tonumber(top-1)) {
           ttype(top) = LUA_TNUMBER;
           nvalue(top) = (Number)GETARG_S(i);
@@ -561,119 +696,119 @@ StkId luaV_execute (lua_State *L, const Closure *cl, StkId base) {
         }
         else
           nvalue(top-1) += (Number)GETARG_S(i);
-        break;
+        vmbreak;
       }
-      case OP_SUB: {
+      vmcase(OP_SUB) {
         if (tonumber(top-2) || tonumber(top-1))
           call_arith(L, top, TM_SUB);
         else
           nvalue(top-2) -= nvalue(top-1);
         top--;
-        break;
+        vmbreak;
       }
-      case OP_MULT: {
+      vmcase(OP_MULT) {
         if (tonumber(top-2) || tonumber(top-1))
           call_arith(L, top, TM_MUL);
         else
           nvalue(top-2) *= nvalue(top-1);
         top--;
-        break;
+        vmbreak;
       }
-      case OP_DIV: {
+      vmcase(OP_DIV) {
         if (tonumber(top-2) || tonumber(top-1))
           call_arith(L, top, TM_DIV);
         else
           nvalue(top-2) /= nvalue(top-1);
         top--;
-        break;
+        vmbreak;
       }
-      case OP_POW: {
+      vmcase(OP_POW) {
         if (!call_binTM(L, top, TM_POW))
           lua_error(L, "undefined operation");
         top--;
-        break;
+        vmbreak;
       }
-      case OP_CONCAT: {
+      vmcase(OP_CONCAT) {
         int n = GETARG_U(i);
         luaV_strconc(L, n, top);
         top -= n-1;
         L->top = top;
         luaC_checkGC(L);
-        break;
+        vmbreak;
       }
-      case OP_MINUS: {
+      vmcase(OP_MINUS) {
         if (tonumber(top-1)) {
           ttype(top) = LUA_TNIL;
           call_arith(L, top+1, TM_UNM);
         }
         else
           nvalue(top-1) = -nvalue(top-1);
-        break;
+        vmbreak;
       }
-      case OP_NOT: {
+      vmcase(OP_NOT) {
         ttype(top-1) =
            (ttype(top-1) == LUA_TNIL) ? LUA_TNUMBER : LUA_TNIL;
         nvalue(top-1) = 1;
-        break;
+        vmbreak;
       }
-      case OP_JMPNE: {
+      vmcase(OP_JMPNE) {
         top -= 2;
         if (!luaO_equalObj(top, top+1)) dojump(pc, i);
-        break;
+        vmbreak;
       }
-      case OP_JMPEQ: {
+      vmcase(OP_JMPEQ) {
         top -= 2;
         if (luaO_equalObj(top, top+1)) dojump(pc, i);
-        break;
+        vmbreak;
       }
-      case OP_JMPLT: {
+      vmcase(OP_JMPLT) {
         top -= 2;
         if (luaV_lessthan(L, top, top+1, top+2)) dojump(pc, i);
-        break;
+        vmbreak;
       }
-      case OP_JMPLE: {  /* a <= b  ===  !(b<a) */
+      vmcase(OP_JMPLE) {  /* a <= b  ===  !(b<a) */
         top -= 2;
         if (!luaV_lessthan(L, top+1, top, top+2)) dojump(pc, i);
-        break;
+        vmbreak;
       }
-      case OP_JMPGT: {  /* a > b  ===  (b<a) */
+      vmcase(OP_JMPGT) {  /* a > b  ===  (b<a) */
         top -= 2;
         if (luaV_lessthan(L, top+1, top, top+2)) dojump(pc, i);
-        break;
+        vmbreak;
       }
-      case OP_JMPGE: {  /* a >= b  ===  !(a<b) */
+      vmcase(OP_JMPGE) {  /* a >= b  ===  !(a<b) */
         top -= 2;
         if (!luaV_lessthan(L, top, top+1, top+2)) dojump(pc, i);
-        break;
+        vmbreak;
       }
-      case OP_JMPT: {
+      vmcase(OP_JMPT) {
         if (ttype(--top) != LUA_TNIL) dojump(pc, i);
-        break;
+        vmbreak;
       }
-      case OP_JMPF: {
+      vmcase(OP_JMPF) {
         if (ttype(--top) == LUA_TNIL) dojump(pc, i);
-        break;
+        vmbreak;
       }
-      case OP_JMPONT: {
+      vmcase(OP_JMPONT) {
         if (ttype(top-1) == LUA_TNIL) top--;
         else dojump(pc, i);
-        break;
+        vmbreak;
       }
-      case OP_JMPONF: {
+      vmcase(OP_JMPONF) {
         if (ttype(top-1) != LUA_TNIL) top--;
         else dojump(pc, i);
-        break;
+        vmbreak;
       }
-      case OP_JMP: {
+      vmcase(OP_JMP) {
         dojump(pc, i);
-        break;
+        vmbreak;
       }
-      case OP_PUSHNILJMP: {
+      vmcase(OP_PUSHNILJMP) {
         ttype(top++) = LUA_TNIL;
         pc++;
-        break;
+        vmbreak;
       }
-      case OP_FORPREP: {
+      vmcase(OP_FORPREP) {
         if (tonumber(top-1))
           lua_error(L, "`for' step must be a number");
         if (tonumber(top-2))
@@ -686,57 +821,49 @@ StkId luaV_execute (lua_State *L, const Closure *cl, StkId base) {
           top -= 3;  /* remove control variables */
           dojump(pc, i);  /* jump to loop end */
         }
-        break;
+        vmbreak;
       }
-      case OP_FORLOOP: {
+      vmcase(OP_FORLOOP) {
+        Number step, index;
+      forloop:
         LUA_ASSERT(ttype(top-1) == LUA_TNUMBER, "invalid step");
         LUA_ASSERT(ttype(top-2) == LUA_TNUMBER, "invalid limit");
         if (ttype(top-3) != LUA_TNUMBER)
           lua_error(L, "`for' index must be a number");
-        nvalue(top-3) += nvalue(top-1);  /* increment index */
-        if (nvalue(top-1) > 0 ?
-            nvalue(top-3) > nvalue(top-2) :
-            nvalue(top-3) < nvalue(top-2))
+        step = nvalue(top-1);
+        index = nvalue(top-3) + step;  /* increment index */
+        nvalue(top-3) = index;
+        if (step > 0 ? index > nvalue(top-2) : index < nvalue(top-2))
           top -= 3;  /* end loop: remove control variables */
         else
           dojump(pc, i);  /* repeat loop */
-        break;
+        vmbreak;
       }
-      case OP_LFORPREP: {
-        Node *node;
+      vmcase(OP_LFORPREP) {
         if (ttype(top-1) != LUA_TTABLE)
           lua_error(L, "`for' table must be a table");
-        node = luaH_next(L, hvalue(top-1), &luaO_nilobject);
-        if (node == NULL) {  /* `empty' loop? */
-          top--;  /* remove table */
+        if (!luaH_next(L, hvalue(top-1), &luaO_nilobject, top)) {
+          top--;  /* `empty' loop: remove table */
           dojump(pc, i);  /* jump to loop end */
         }
-        else {
+        else
           top += 2;  /* index,value */
-          *(top-2) = *key(node);
-          *(top-1) = *val(node);
-        }
-        break;
+        vmbreak;
       }
-      case OP_LFORLOOP: {
-        Node *node;
+      vmcase(OP_LFORLOOP) {
         LUA_ASSERT(ttype(top-3) == LUA_TTABLE, "invalid table");
-        node = luaH_next(L, hvalue(top-3), top-2);
-        if (node == NULL)  /* end loop? */
-          top -= 3;  /* remove table, key, and value */
-        else {
-          *(top-2) = *key(node);
-          *(top-1) = *val(node);
+        if (!luaH_next(L, hvalue(top-3), top-2, top-2))
+          top -= 3;  /* end loop: remove table, key, and value */
+        else
           dojump(pc, i);  /* repeat loop */
-        }
-        break;
+        vmbreak;
       }
-      case OP_CLOSURE: {
+      vmcase(OP_CLOSURE) {
         L->top = top;
         luaV_Lclosure(L, tf->kproto[GETARG_A(i)], GETARG_B(i));
         top = L->top;
         luaC_checkGC(L);
-        break;
+        vmbreak;
       }
     }
   }
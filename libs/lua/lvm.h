@@ -29,4 +29,10 @@ void luaV_Lclosure (lua_State *L, Proto *l, int nelems);
 int luaV_lessthan (lua_State *L, const TObject *l, const TObject *r, StkId top);
 void luaV_strconc (lua_State *L, int total, StkId top);
 
+#ifdef LUA_OPPROFILE
+#include "lopcodes.h"
+extern unsigned long luaV_opcount[NUM_OPCODES];
+extern unsigned long luaV_oppair[NUM_OPCODES][NUM_OPCODES];
+#endif
+
 #endif
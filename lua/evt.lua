@@ -126,11 +126,8 @@ function evt_peek()
    local frametime
 
    repeat
-      local com = shell_get_command()
-      while com do
-	 doshellcommand(com)
-	 com = shell_get_command()
-      end
+      -- pending commands, highest priority first
+      shell_run_commands()
 
       key = evt_origpeekchar()
       
@@ -152,8 +149,7 @@ function evt_peek()
       else
 	 -- do collect garbage once per frame for smoother animation
 --	 vcolor(255, 255, 0)
-	 collectgarbage(4096)
-	 collect(300)
+	 collect()
 --	 vcolor(0, 0, 0)
 	 --collectgarbage()
 	 
@@ -504,7 +504,68 @@ function luacolor_file_wrap(fname)
    collectgarbage()
 end
 
+--
+--- Convert a range of lines of a loaded lua source into colored zml.
+---
+---   The source is tokenized by the luasrc_zml() C function, which only
+---   scans the lines before the range once per loaded source.
+---
+---  @param  src    lua source (see luasrc_load())
+---  @param  first  first line (starting at 1, default 1)
+---  @param  last   last line (default last source line)
+---  @return zml string
+---  @retval nil on error
+--
+function luacolor_src(src, first, last)
+   local zml = luasrc_zml(src, first, last)
+   if not zml then return end
+   return lua_color_modes[1].start .. lua_color_modes[1].stop
+      .. zml .. lua_color_modes[2].start
+end
+
+--- Number of lines per page for luacolor_pages().
+--: number lua_color_page_lines;
+lua_color_page_lines = 200
+
+--
+--- Get a lua source file as pages of colored zml for gui_text_viewer().
+---
+---   Pages are named after their line range ("1-200", "201-400" ...) and
+---   listed in order in the pages member. Each page is a function building
+---   its zml, so only the viewed pages are colorized.
+---
+---  @param  fname  Path to lua file
+---  @param  lines  Lines per page (default lua_color_page_lines)
+---  @return texts table for gui_text_viewer()
+---  @retval nil on error or if the luasrc functions are missing
+--
+function luacolor_pages(fname, lines)
+   if type(luasrc_load) ~= "function" then return end
+   local src = luasrc_load(fname)
+   if not src then return end
+   lines = lines or lua_color_page_lines
+   local n = luasrc_lines(src)
+   local texts = { pages = {} }
+   local first
+   for first = 1, max(n,1), lines do
+      local last = min(first + lines - 1, n)
+      local name = format("%d-%d", first, last)
+      tinsert(texts.pages, name)
+      texts[name] = function()
+		       return luacolor_src(%src, %first, %last)
+		    end
+   end
+   texts.pages.n = nil
+   return texts
+end
+
 function luacolor_file(fname)
+   if type(luasrc_load) == "function" then
+      local src = luasrc_load(fname)
+      if src then
+	 return luacolor_src(src)
+      end
+   end
    if type(dostring_print) ~= "function" then return end
    if not test("-f",fname) then return end
    local file = openfile(fname,"r")
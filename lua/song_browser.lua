@@ -872,7 +872,9 @@ function song_browser_view_file(sb, entry_path)
 
    if major == "lua" then
       if not sb.no_lua_colorize and type(luacolor_file) == "function" then
- 	 gui_text_viewer(nil, { [leaf] = luacolor_file(entry_path) },
+	 local texts = type(luacolor_pages) == "function"
+	    and luacolor_pages(entry_path)
+ 	 gui_text_viewer(nil, texts or { [leaf] = luacolor_file(entry_path) },
  			 width, leaf, nil,
 			 '<center><font color="text_color">'
 			    .. '\018 .. Context menu (goto function)<br>'
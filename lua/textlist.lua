@@ -64,6 +64,7 @@ if not dolib("taggedtext") then return end
 --:   flentry dir[];     ///< Current fllist object
 --:   table dirinfo[];   ///< dir supplemental information
 --:   pos;       ///< Current select item
+--:   virtual;   ///< Set when dir is an entrylist browsed through entry views
 --:   top;       ///< Top displayed line
 --:   lines;     ///< Computed max displayed lines
 --:   maxlines;  ///< Real maximum od displayed lines
@@ -255,8 +256,17 @@ function textlist_create(flparm, owner)
    end
 
    --- Measure dimension of the whole textlist and set dirinfo.
+   ---
+   --- In virtual mode all lines have the same height and the list is
+   --- as large as the maximum box, so that no entry needs to be read.
    --
    function textlist_measure(fl)
+      if fl.virtual then
+	 local w,h = dl_measure_text(fl.dl, "|")
+	 fl.lineh = h + 2*fl.span
+	 fl.linew = (fl.minmax and fl.minmax[3] or 400) - 2*fl.border
+	 return fl.linew, fl.lineh * fl.dir.n
+      end
       if fl.dir.n < 1 then return 0,0 end
 
       -- Measure text --
@@ -276,6 +286,47 @@ function textlist_create(flparm, owner)
       return w, h
    end
 
+   --- Get entry @b idx for reading.
+   ---
+   --- In virtual mode this is a read-only entrylist entry view, no table
+   --- is created.
+   --
+   function textlist_view_entry(fl, idx)
+      if fl.virtual then
+	 return entrylist_entry(fl.dir, idx)
+      end
+      return fl.dir[idx]
+   end
+
+   --- Get entry @b idx position and size.
+   ---
+   --- @return y,w,h
+   --- @retval nil invalid entry
+   --
+   function textlist_entry_info(fl, idx)
+      if fl.virtual then
+	 if idx < 1 or idx > fl.dir.n then return end
+	 return (idx-1) * fl.lineh, fl.linew, fl.lineh
+      end
+      local info = fl.dirinfo and fl.dirinfo[idx]
+      if info then
+	 return info.y, info.w, info.h
+      end
+   end
+
+   --- Get first and last entries inside the textlist box.
+   --
+   function textlist_visible_range(fl)
+      local mat = dl_get_trans(fl.idl)
+      local ytop = -mat[4][2]
+      local wh = fl.bo2[2] - 2 * fl.border
+      local first = floor(ytop / fl.lineh) + 1
+      local last = floor((ytop + wh) / fl.lineh) + 1
+      if first < 1 then first = 1 end
+      if last > fl.dir.n then last = fl.dir.n end
+      return first, last
+   end
+
    --- Measure an entry.
    function textlist_measure_text(fl, entry)
       if not fl.not_use_tt then
@@ -299,8 +350,8 @@ function textlist_create(flparm, owner)
 	 dl = fl.idl
       end
 
-      local entry = fl.dir[idx]
-      local info = fl.dirinfo[idx]
+      local entry = textlist_view_entry(fl, idx)
+      if not entry then return end
       local color = fl.dircolor
       if entry.size and entry.size >= 0 then
 	 color = fl.filecolor
@@ -427,11 +478,18 @@ function textlist_create(flparm, owner)
    --- Change the textlist content.
    --
    function textlist_change_dir(fl, dir, pos)
+      local prof = textlist_profile and { gcinfo(), clock() }
       dir = dir or {}
       if not dir.n then dir.n = getn(dir) or 0 end
       fl.dir = dir
       fl.dirinfo = {}
 
+      -- Entrylist with default measure : only visible rows are read.
+      fl.virtual = fl.not_use_tt and entrylist_entry
+	 and tag(dir) == entrylist_tag
+	 and fl.measure_text == textlist_measure_text
+      fl.vfirst, fl.vlast = nil, nil
+
       -- Measure new list.
       local w,h = textlist_measure(fl)
       fl:set_box(nil,nil,
@@ -441,6 +499,11 @@ function textlist_create(flparm, owner)
       pos = (pos < dir.n and pos) or (dir.n - 1)
       fl.pos = (pos >= 0 and pos) or 0
       fl:draw()
+      if prof then
+	 printf("textlist: %d entries%s, first draw %d ms, lua heap %+dK",
+		dir.n, (fl.virtual and " (virtual)") or "",
+		(clock() - prof[2]) * 1000, gcinfo() - prof[1])
+      end
       return 1
    end
 
@@ -519,7 +582,8 @@ function textlist_create(flparm, owner)
       end
       dl_clear(dl)
       local i = (fl.pos or 0) + 1
-      if not fl.dirinfo or not fl.dirinfo[i] then
+      local y,w,h = textlist_entry_info(fl, i)
+      if not y then
 	 -- $$$ There is a bug here ...
 	 print("-------------------------")
 	 print("-------------------------")
@@ -534,7 +598,6 @@ function textlist_create(flparm, owner)
 	 return
       end
 
-      local y,w,h = fl.dirinfo[i].y, fl.dirinfo[i].w, fl.dirinfo[i].h
       local ww = fl.bo2[1] - 2 * fl.border
       if ww > w then w = ww end
       
@@ -558,6 +621,18 @@ function textlist_create(flparm, owner)
       local i
       --- $$$ Added by ben for updating TT drawing
       textlist_measure(fl)
+      if fl.virtual then
+	 -- Visible entries plus one page above and below.
+	 local first, last = textlist_visible_range(fl)
+	 local page = last - first + 1
+	 first = max(1, first - page)
+	 last = min(fl.dir.n, last + page)
+	 for i=first, last do
+	    fl:draw_entry(dl, i, 0, (i-1)*fl.lineh+fl.span, 50)
+	 end
+	 fl.vfirst, fl.vlast = first, last
+	 return
+      end
       local max = getn(fl.dirinfo)
       for i=1, max, 1 do
 	 fl:draw_entry(dl, i, 0, fl.dirinfo[i].y+fl.span, 50)
@@ -613,7 +688,7 @@ function textlist_create(flparm, owner)
    function textlist_get_text(fl,pos)
       pos = fl:get_pos(pos)
       if pos then
-	 local entry = fl.dir[pos]
+	 local entry = textlist_view_entry(fl, pos)
 -- 	 local tt = entry.tt
 -- 	 if tt and tt.mode and tt.mode.text_nude then
 -- 	    return tt.mode.text_nude
@@ -652,7 +727,7 @@ function textlist_create(flparm, owner)
       if fl.dir.n < 1 or not regexpr then return end
       local i
       for i=1, fl.dir.n, 1 do
-	 if strfind(fl.dir[i].name,regexpr) then
+	 if strfind(textlist_view_entry(fl, i).name,regexpr) then
 	    return fl:move_cursor(i-1-fl.pos)
 	 end
       end
@@ -664,7 +739,7 @@ function textlist_create(flparm, owner)
       if fl.dir.n < 1 or not name then return end
       local i
       for i=1, fl.dir.n, 1 do
-	 if fl.dir[i].name == name then
+	 if textlist_view_entry(fl, i).name == name then
 	    return fl:move_cursor(i-1-fl.pos)
 	 end
       end
@@ -676,8 +751,7 @@ function textlist_create(flparm, owner)
    function textlist_screen_coor(fl,pos)
       pos = fl:get_pos(pos)
       if not pos then return end
-      local xentry = fl.dirinfo[pos]
-      local ye = (xentry and xentry.y) or 0
+      local ye = textlist_entry_info(fl, pos) or 0
       local m1,m2 = dl_get_trans(fl.dl), dl_get_trans(fl.cdl)
       return m1[4][1], m1[4][2] + m2[4][2] + ye
    end
@@ -786,10 +860,10 @@ function textlist_update(fl, frametime)
       fl:set_color(a,r,g,b)
    end
 
-   local i
+   local i, y, w, h
    i = fl.pos+1
-   if type(fl.dirinfo) == "table" and fl.dirinfo[i] then
-      local y,h = fl.dirinfo[i].y, fl.dirinfo[i].h
+   y, w, h = textlist_entry_info(fl, i)
+   if y then
       local wh = fl.bo2[2] - 2 * fl.border
       local mat = dl_get_trans(fl.cdl) 
 
@@ -811,6 +885,15 @@ function textlist_update(fl, frametime)
       dl_set_trans(fl.idl, mat)
    end
 
+   -- Virtual list scrolled out of drawn entries : redraw them.
+   if fl.virtual and fl.vfirst then
+      local first, last = textlist_visible_range(fl)
+      if first < fl.vfirst or last > fl.vlast then
+	 dl_clear(fl.idl)
+	 fl:draw_list(fl.idl)
+      end
+   end
+
 end
 
 --- Create a textlist application from a textlist object.
@@ -48,7 +48,12 @@ end
 --- Create a text view gui application.
 --
 --- @param  owner  owner applciation (default is desktop)
---- @param  texts  string or table of string.
+--- @param  texts  string or table of string. Table values may also be
+---                functions returning the text, they are only called when
+---                the text is displayed. The optionnal texts.pages list
+---                gives the names of texts to be viewed as consecutive
+---                pages : scrolling past a page edge goes to the next or
+---                previous page.
 --- @param  box    application box
 --- @param  label  dialog label (optionnal)
 --- @param  mode   label mode.
@@ -84,10 +89,13 @@ function gui_text_viewer(owner, texts, box, label, mode, help)
 	 local mf = "[%w%s%_%-%,%/%.]"
 	 local start, stop, tt_name, hash, tt_anchor =
 	    strfind(tt,"("..mf.."*)(#?)("..mf.."*)")
-	 tt = (type(tt_name) == "string" and
-	       type(dial.tts) == "table" and
-		  dial.tts[tt_name]
-	    ) or dial.cur_tt
+	 if type(tt_name) == "string" and type(dial.tts) == "table" then
+	    tt = dial.tts[tt_name] or gui_text_viewer_load_tt(dial, tt_name)
+	    if tt then
+	       dial.cur_name = tt_name
+	    end
+	 end
+	 tt = tt or dial.cur_tt
 	 if tag(tt) == tt_tag and type(tt_anchor) == "string" and
 	    tt.anchors[tt_anchor] then
 	    x,y = -tt.anchors[tt_anchor].x,-tt.anchors[tt_anchor].y
@@ -106,6 +114,40 @@ function gui_text_viewer(owner, texts, box, label, mode, help)
       dial.tt_a = 1
    end
 
+   --- Build a text given as a function, the first time it is displayed.
+   --- @internal
+   function gui_text_viewer_load_tt(dial, name)
+      local f = dial.lazy_texts and dial.lazy_texts[name]
+      if type(f) ~= "function" then return end
+      local tt = text_viever_tt_build(f(), { box = dial.tbox })
+      if tag(tt) ~= tt_tag then return end
+      dial.lazy_texts[name] = nil
+      dial.tts[name] = tt
+      gui_text_viewer_desactive_tt(tt)
+      dl_sublist(dial.tt_dl, tt.dl)
+      tt_draw(tt)
+      return tt
+   end
+
+   --- Go to previous (dir=-1) or next (dir=1) page of texts.pages.
+   --- @internal
+   function gui_text_viewer_page(dial, dir)
+      if type(dial.pages) ~= "table" then return end
+      local i,v
+      for i,v in dial.pages do
+	 if v == dial.cur_name then
+	    local name = dial.pages[i+dir]
+	    if name then
+	       -- Previous page is entered by its bottom.
+	       gui_text_viewer_set_tt(dial, name, 0,
+				      (dir < 0 and -65536) or 0)
+	       return 1
+	    end
+	    return
+	 end
+      end
+   end
+
    --- Set current tagged text-scrolling position.
    --- This function ensure that scrolling position is inside taged-text box.
    --- @param dial text-viewer dialog
@@ -178,6 +220,7 @@ function gui_text_viewer(owner, texts, box, label, mode, help)
 
    -- Creates tagged texts
    local tts = {}
+   local lazy_texts = {}
 
    local ttbox0 = { 0,0,tw,th }
    
@@ -192,6 +235,8 @@ function gui_text_viewer(owner, texts, box, label, mode, help)
 	    tts[i] = text_viever_tt_build(v, { box = ttbox0 })
 	 elseif tag(v) == tt_tag then
 	    tts[i] = v
+	 elseif type(v) == "function" then
+	    lazy_texts[i] = v
 	 end
       end
    end
@@ -259,6 +304,7 @@ function gui_text_viewer(owner, texts, box, label, mode, help)
 	 gui_text_viewer_desactive_tt(v)
 	 if not dial.cur_tt then
 	    gui_text_viewer_set_tt(dial, v, 0, 0)
+	    dial.cur_name = i
 	 end
 	 dl_sublist(tt_dl2, v.dl)
 	 tt_draw(v)
@@ -267,6 +313,16 @@ function gui_text_viewer(owner, texts, box, label, mode, help)
    dl_sublist(dial.viewer.dl,tt_dl)
    dial.tt_dl = tt_dl2
    dial.tts = tts
+   dial.lazy_texts = lazy_texts
+   dial.pages = type(texts) == "table" and type(texts.pages) == "table"
+      and texts.pages
+   if not dial.cur_tt then
+      -- Only lazy texts : display the first page (or any text).
+      local name = dial.pages and dial.pages[1] or next(lazy_texts)
+      if name then
+	 gui_text_viewer_set_tt(dial, name, 0, 0)
+      end
+   end
 
    --- Process tagged text fading.
    --- @internal
@@ -344,6 +400,10 @@ function gui_text_viewer(owner, texts, box, label, mode, help)
       local mat = dl_get_trans(dial.tt_dl)
       if mat then
 	 gui_text_viewer_set_scroll(dial, mat[4][1]+x, mat[4][2] + y)
+	 -- Already at the page edge : go to the adjacent page.
+	 if y ~= 0 and dial.tt_y == mat[4][2] then
+	    gui_text_viewer_page(dial, (y > 0 and -1) or 1)
+	 end
       end
 
    end
@@ -429,13 +489,21 @@ function gui_text_viewer(owner, texts, box, label, mode, help)
       local root = ":" .. target.name .. ":" .. 
 	 "view >view,anchor >anchor"
       local view = ":view:"
-      if type(dial.tts) == "table" then
+      if type(dial.pages) == "table" then
+	 local i,v
+	 for i,v in dial.pages do
+	    view = view .. tostring(v) .. "{settext},"
+	 end
+      elseif type(dial.tts) == "table" then
 	 local i,v
 	 for i,v in dial.tts do
 	    if tag(v) == tt_tag then
 	       view = view .. tostring(i) .. "{settext},"
 	    end
 	 end
+	 for i,v in dial.lazy_texts do
+	    view = view .. tostring(i) .. "{settext},"
+	 end
       end
       local anchor = ":anchor:"
       if tag(dial.cur_tt) == tt_tag and 
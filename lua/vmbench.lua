@@ -0,0 +1,228 @@
+--- @ingroup dcplaya_lua_shell
+--- @file    vmbench.lua
+--- @author  benjamin gerard
+--- @brief   Lua virtual machine benchmark.
+---
+--- $Id$
+---
+--- Each test reproduces an idiom of the GUI scripts. Run it with
+--- dofile(home.."lua/vmbench.lua") or with any stand-alone lua 4
+--- interpreter. When the VM is built with LUA_OPPROFILE, the number of
+--- executed instructions and instructions per second are reported.
+--- When memstats() is available, lua memory arena usage is reported.
+---
+
+--- Build a fake textlist with n entries.
+function vmbench_textlist(n)
+   local fl = {
+      dir = { n = n }, dirinfo = {},
+      border = 3, span = 1, bo2 = { 256, 210, 0 },
+   }
+   local i
+   for i=1,n do
+      fl.dir[i] = { name = "file"..i..".mod", size = i * 100 }
+   end
+   fl.measure_text = function (fl, entry)
+			return strlen(entry.name) * 8, 16 + 2 * fl.span
+		     end
+   return fl
+end
+
+--- textlist_measure() : numeric for, field access, method call, table
+--- constructor.
+function vmbench_measure(fl)
+   local i, w, h, y
+   y,w,h = 0,0,0
+   for i=1, fl.dir.n, 1 do
+      local w2,h2
+      w2,h2 = fl:measure_text(fl.dir[i])
+      if w2 > w then w = w2 end
+      h = h + h2
+      fl.dirinfo[i] = { y = y, w = w2, h = h2 }
+      y = y + h2
+   end
+   return w, h
+end
+
+--- textlist_locate_entry() : local.field.field comparisons.
+function vmbench_locate(fl, name)
+   local i
+   for i=1, fl.dir.n, 1 do
+      if fl.dir[i].name == name then
+	 return i
+      end
+   end
+end
+
+--- textlist_update() : box arithmetic on fields.
+function vmbench_update(fl, n)
+   local k, ytop
+   ytop = 0
+   for k=1,n do
+      local i = mod(k, fl.dir.n) + 1
+      local y,h = fl.dirinfo[i].y, fl.dirinfo[i].h
+      local wh = fl.bo2[2] - 2 * fl.border
+      if y < ytop then
+	 ytop = y
+      elseif y+h > ytop+wh then
+	 ytop = y+h-wh
+      end
+   end
+   return ytop
+end
+
+--- evt_update() : walking a linked list of applications.
+function vmbench_evt(napp, n)
+   local root = { sub = nil }
+   local k
+   for k=1,napp do
+      root.sub = { next = root.sub, frames = 0,
+		   update = function (app, t) app.frames = app.frames + t end }
+   end
+   for k=1,n do
+      local i = root.sub
+      while i do
+	 local nxt = i.next
+	 if i.update then
+	    i:update(1)
+	 end
+	 i = nxt
+      end
+   end
+   return root.sub.frames
+end
+
+--- textlist_fullpath() : string building.
+function vmbench_fullpath(fl, n)
+   local k, s, l
+   l = 0
+   for k=1,n do
+      local entry = fl.dir[mod(k, fl.dir.n) + 1]
+      s = (entry.path or "/pc/music") .. "/" .. entry.name
+      if strfind(s, "%.mod$") then
+	 l = l + strlen(s)
+      end
+   end
+   return l
+end
+
+--- Directory load : entry table, string and closure churn.
+function vmbench_alloc(n)
+   local k, l
+   l = 0
+   for k=1,n do
+      local e = { name = "file"..k..".mod", size = k, info = { k, k+1 } }
+      e.draw = function () return %e.size end
+      l = l + strlen(e.name) + e.draw()
+   end
+   return l
+end
+
+--- Song database : long file paths as table keys. The 80 chars paths
+--- share a long prefix and differ in the middle, which used to collide
+--- in the string hash.
+vmbench_path_fmt = "/pc/home/dcplaya/music/modules/%05d/amiga/protracker/unsorted/misc/track001.mod"
+
+function vmbench_paths(n, loops)
+   local db, l, k, found = {}, 0, 0, 0
+   for l=1,loops do
+      for k=1,n do
+	 local path = format(vmbench_path_fmt, k)
+	 if l == 1 then
+	    db[path] = k
+	 elseif db[path] == k then
+	    found = found + 1
+	 end
+      end
+   end
+   return found
+end
+
+--- Directory listing : n small records, grown from empty tables or
+--- presized. Table constructors size new tables as lua_createtable()
+--- does for the tables built from C (dirlist, entrylist).
+function vmbench_records(n, presize)
+   local dir, k = {}
+   if presize then
+      for k=1,n do
+	 dir[k] = { name = "file"..k..".mod", size = k, type = 1, path = "/cd" }
+      end
+   else
+      for k=1,n do
+	 local e = {}
+	 e.name = "file"..k..".mod"
+	 e.size = k
+	 e.type = 1
+	 e.path = "/cd"
+	 dir[k] = e
+      end
+   end
+   dir.n = n
+   return dir
+end
+
+--- Run all tests.
+---
+--- @param  scale  Work multiplier (default 1).
+---
+--- @return total time in second
+function vmbench(scale)
+   scale = scale or 1
+   local fl = vmbench_textlist(1000)
+   local tests = {
+      { "measure",  function (s) local i for i=1,s*10 do vmbench_measure(%fl) end end },
+      { "locate",   function (s) local i for i=1,s*20 do vmbench_locate(%fl, "file1000.mod") end end },
+      { "update",   function (s) vmbench_update(%fl, s*20000) end },
+      { "evt",      function (s) vmbench_evt(20, s*1000) end },
+      { "fullpath", function (s) vmbench_fullpath(%fl, s*10000) end },
+      { "alloc",    function (s) vmbench_alloc(s*5000) end },
+      { "paths",    function (s) vmbench_paths(s*2000, 10) end },
+      { "records",  function (s) local i for i=1,s*10 do vmbench_records(2000) end end },
+      { "presized", function (s) local i for i=1,s*10 do vmbench_records(2000, 1) end end },
+   }
+   local i, total, ops
+   total, ops = 0, 0
+   print(format("%-10s %9s %12s %10s", "test", "ms", "instr", "Minstr/s"))
+   for i=1,getn(tests) do
+      local n = opprofile and opprofile().total or 0
+      local start = clock()
+      tests[i][2](scale)
+      local t = clock() - start
+      n = (opprofile and opprofile().total or 0) - n
+      total, ops = total + t, ops + n
+      print(format("%-10s %9.1f %12d %10.2f", tests[i][1], t * 1000, n,
+		   (t > 0 and n / t / 1000000) or 0))
+   end
+   print(format("%-10s %9.1f %12d %10.2f", "total", total * 1000, ops,
+		(total > 0 and ops / total / 1000000) or 0))
+   if memstats then
+      local m = memstats()
+      print(format("arena: %d chunks, small %dK, big %dK, peak %dK, %d allocs",
+		   m.chunks, m.small / 1024, m.big / 1024, m.peak / 1024,
+		   m.allocs))
+   end
+   return total
+end
+
+--- Print the n most frequent entries of an opcode profile table.
+function vmbench_top(title, t, total, n)
+   local l, k, v = {}
+   for k,v in t do tinsert(l, { k, v }) end
+   sort(l, function (a, b) return a[2] > b[2] end)
+   print(title)
+   for k=1,min(n, getn(l)) do
+      print(format("  %-24s %12d %5.1f%%", l[k][1], l[k][2],
+		   l[k][2] * 100 / total))
+   end
+end
+
+if opprofile then opprofile(1) end
+vmbench(vmbench_scale)
+if opprofile then
+   -- Whole run profile, to choose the fast paths.
+   local p = opprofile(1)
+   vmbench_top("opcodes", p.ops, p.total, 12)
+   vmbench_top("opcode pairs", p.pairs, p.total, 12)
+end
+
+return 1
@@ -257,7 +257,7 @@ EL_FUNCTION_START(gettable)
     if (!e) {
       printf("%s : index #%d out of range\n", __FUNCTION__, n+1);
     } else {
-      lua_newtable(L);
+      lua_createtable(L, 0, 6);
       lua_pushstring(L,"type");
       lua_pushnumber(L,e->type);
       lua_rawset(L, 1);
@@ -303,6 +303,87 @@ EL_FUNCTION_START(gettable)
 }
 EL_FUNCTION_END()
 
+/* Entry view : a read-only copy of one entry in a userdata. Fields are
+ * pushed when they are read, so browsing a list creates neither a table nor
+ * strings for each entry.
+ */
+EL_FUNCTION_START(entry)
+{
+  iarray_elt_t * ae;
+  el_entry_t * v;
+  int n = lua_tonumber(L,2) - 1;
+  int size;
+
+  lua_settop(L,0);
+  entrylist_lock(el);
+  ae = iarray_eltof(&el->a, n);
+  size = (ae && ae->addr) ? ae->size : 0;
+  entrylist_unlock(el);
+  if (size <= 0) {
+    return 0;
+  }
+
+  /* Allocate unlocked : lua may raise an error. */
+  v = lua_newuserdata(L, size);
+  entrylist_lock(el);
+  ae = iarray_eltof(&el->a, n);
+  if (ae && ae->addr && ae->size == size) {
+    memcpy(v, ae->addr, size);
+    elpath_addref(v->path);
+  } else {
+    v = 0;
+  }
+  entrylist_unlock(el);
+  if (!v) {
+    /* entry changed meanwhile */
+    return 0;
+  }
+  lua_settag(L, entrylist_entry_tag);
+  return 1;
+}
+EL_FUNCTION_END()
+
+EL_ENTRY_FUNCTION_START(gc)
+{
+  elpath_del(e->path);
+  e->path = 0;
+  return 0;
+}
+EL_FUNCTION_END()
+
+EL_ENTRY_FUNCTION_START(gettable)
+{
+  const char * field = lua_tostring(L,2);
+
+  lua_settop(L,0);
+  if (!field) {
+    return 0;
+  }
+  if (!strcmp(field, "name")) {
+    lua_pushstring(L, e->buffer+e->iname);
+  } else if (!strcmp(field, "file")) {
+    lua_pushstring(L, e->buffer+e->ifile);
+  } else if (!strcmp(field, "size")) {
+    lua_pushnumber(L, e->size);
+  } else if (!strcmp(field, "type")) {
+    lua_pushnumber(L, e->type);
+  } else if (!strcmp(field, "path")) {
+    if (e->path) {
+      lua_pushstring(L, e->path->path);
+    }
+  }
+  return lua_gettop(L);
+}
+EL_FUNCTION_END()
+
+EL_ENTRY_FUNCTION_START(settable)
+{
+  printf("%s : entry view is read-only\n", __FUNCTION__);
+  lua_settop(L,0);
+  return 0;
+}
+EL_FUNCTION_END()
+
 EL_FUNCTION_START(settable)
 {
   char tmp[1024];
@@ -30,9 +30,15 @@ EL_FUNCTION_DECLARE(clear);
 EL_FUNCTION_DECLARE(load);
 EL_FUNCTION_DECLARE(sort);
 EL_FUNCTION_DECLARE(dump);
+EL_FUNCTION_DECLARE(entry);
+EL_FUNCTION_DECLARE(entry_gc);
+EL_FUNCTION_DECLARE(entry_gettable);
+EL_FUNCTION_DECLARE(entry_settable);
 
 /** Entrylist user tag. */
 int entrylist_tag;
+/** Entry view user tag. */
+int entrylist_entry_tag;
 /** Holds all entrylist. */
 allocator_t * lists;
 /** Holds standard entries. */
@@ -63,6 +69,20 @@ static void lua_init_el_type(lua_State * L)
 
   lua_pushcfunction(L, lua_entrylist_settable);
   lua_settagmethod(L, entrylist_tag, "settable");
+
+  /* Entry view */
+  entrylist_entry_tag = lua_newtag(L);
+  lua_pushnumber(L,entrylist_entry_tag);
+  lua_setglobal(L,"entrylist_entry_tag");
+
+  lua_pushcfunction(L, lua_entrylist_entry_gc);
+  lua_settagmethod(L, entrylist_entry_tag, "gc");
+
+  lua_pushcfunction(L, lua_entrylist_entry_gettable);
+  lua_settagmethod(L, entrylist_entry_tag, "gettable");
+
+  lua_pushcfunction(L, lua_entrylist_entry_settable);
+  lua_settagmethod(L, entrylist_entry_tag, "settable");
 }
 
 /* Shutdown  entrylist user tag. */
@@ -78,10 +98,23 @@ static void lua_shutdown_el_type(lua_State * L)
   lua_pushnil(L);
   lua_settagmethod(L, entrylist_tag, "settable");
 
-  /* Unset entrylist user tag */
+  lua_pushnil(L);
+  lua_settagmethod(L, entrylist_entry_tag, "gc");
+
+  lua_pushnil(L);
+  lua_settagmethod(L, entrylist_entry_tag, "gettable");
+
+  lua_pushnil(L);
+  lua_settagmethod(L, entrylist_entry_tag, "settable");
+
+  /* Unset entrylist user tags */
   lua_pushnil(L);
   lua_setglobal(L,"entrylist_tag");
   entrylist_tag = 0;
+
+  lua_pushnil(L);
+  lua_setglobal(L,"entrylist_entry_tag");
+  entrylist_entry_tag = 0;
 }
 
 static int driver_shutdown(any_driver_t * d);
@@ -91,6 +124,7 @@ static int driver_init(any_driver_t *d)
 {
   printf("%s_driver_init ... \n", d->name);
   entrylist_tag = -1;
+  entrylist_entry_tag = -1;
   lists = 0;
   entries = 0;
   init = 0;
@@ -286,6 +320,19 @@ static luashell_command_description_t driver_commands[] = {
     SHELL_COMMAND_C, lua_entrylist_sort
   },
 
+  /* entry view command */
+  {
+    /* long names, short names and topic */
+    DRIVER_NAME"_entry", "el_entry", 0,
+    /* usage */
+    DRIVER_NAME"_entry(entrylist, index) : "
+    "Get a read-only view of an entry. Unlike entrylist[index] no table is"
+    " created : fields (type, size, name, file, path) are only converted"
+    " when they are read.",
+    /* function */
+    SHELL_COMMAND_C, lua_entrylist_entry
+  },
+
   /* dump command */
   {
     /* long names, short names and topic */
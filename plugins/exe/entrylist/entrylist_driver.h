@@ -32,6 +32,11 @@
  */
 extern int entrylist_tag;
 
+/** entry view user tag.
+ *  @ingroup dcplaya_el_exe_plugin_devel
+ */
+extern int entrylist_entry_tag;
+
 /** Holds all entrylist.
  *  @ingroup dcplaya_el_exe_plugin_devel
  */
@@ -71,6 +76,19 @@ int lua_entrylist_init(lua_State * L);
 
 #define EL_FUNCTION_END() }
 
+#define EL_ENTRY_FUNCTION_START(name) \
+  int lua_entrylist_entry_##name(lua_State * L) \
+  { \
+    el_entry_t * e; \
+    if (lua_tag(L, 1) != entrylist_entry_tag) { \
+      printf("el_entry_" #name " : first parameter is not an entry\n"); \
+      return 0; \
+    } \
+    if (e = lua_touserdata(L, 1), !e) { \
+      printf("el_entry_" #name " : Null pointer.\n"); \
+      return 0; \
+    }
+
 #define GET_ENTRYLIST(EL,N) \
     if (lua_tag(L, N) != entrylist_tag) { \
       printf("%s : parameter #%d is not an entry-list\n",__FUNCTION__, N); \
@@ -0,0 +1,419 @@
+/*	mixtest.c : host test of the virtch.c software mixer
+
+	Usage: mixtest [voices [seconds [threads]]]
+
+	1) The unrolled 32 bit mixers are checked against the one sample loops
+	   they replace (copied below from the previous virtch.c), and the last
+	   voice mixers converting to 16 bit against mixing then Mix32To16().
+	2) Random voices (looped, bidi and one shot 16 bit samples, volume, pan
+	   and pitch changing every tick) are mixed in each output mode. The
+	   output checksums must match the ones recorded with the previous
+	   virtch.c (the one sample mixers, no last voice conversion). The cost
+	   per voice and per output sample is printed.
+	3) With HAVE_PTHREAD (mixtest_pthread), the voices are mixed again with
+	   1 to threads mixing threads (default 8). The output must be the same
+	   for all thread counts. As only single thread mixing uses the last
+	   voice conversion, this also checks it against the separate
+	   Mix32To16() pass. The speedup over one thread is printed.
+
+	Returns 0 if all checks pass.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "../playercode/virtch.c"
+
+/*========== libmikmod globals and functions used by virtch.c */
+
+UWORD md_mode, md_mixfreq=44100, md_bpm=125;
+UBYTE md_reverb, md_softchn, md_mixthreads;
+void (*md_player)(void);
+int _mm_errno;
+
+void* _mm_malloc(size_t size) { return calloc(1,size); }
+void* _mm_calloc(size_t nitems,size_t size) { return calloc(nitems,size); }
+void SL_SampleSigned(struct SAMPLOAD* s) { }
+void SL_Sample8to16(struct SAMPLOAD* s) { }
+BOOL SL_Load(void* buffer,struct SAMPLOAD* s,ULONG length) { return 0; }
+BOOL VC2_Init(void) { return 1; }
+void VC_SetupPointers(void) { }
+
+/*========== Test data */
+
+#define NSAMPLES 16
+#define SRCLEN   4096
+
+static ULONG rnd;
+
+static ULONG Random(void)
+{
+	rnd=(rnd*1103515245+12345)&0xffffffff;
+	return (rnd>>8)&0xffffff;
+}
+
+static int failed;
+
+static void Check(int ok,const char* what,int n)
+{
+	if(!ok) {
+		fprintf(stderr,"mixtest: %s #%d differs\n",what,n);
+		failed=1;
+	}
+}
+
+/*========== Previous one sample mixers (reference) */
+
+static SLONG RefMonoNormal(SWORD* srce,SLONG* dest,SLONG index,SLONG increment,SLONG todo)
+{
+	SWORD sample;
+	SLONG lvolsel = vnf->lvolsel;
+
+	while(todo--) {
+		sample = srce[index >> FRACBITS];
+		index += increment;
+
+		*dest++ += lvolsel * sample;
+	}
+	return index;
+}
+
+static SLONG RefStereoNormal(SWORD* srce,SLONG* dest,SLONG index,SLONG increment,SLONG todo)
+{
+	SWORD sample;
+	SLONG lvolsel = vnf->lvolsel;
+	SLONG rvolsel = vnf->rvolsel;
+
+	while(todo--) {
+		sample=srce[index >> FRACBITS];
+		index += increment;
+
+		*dest++ += lvolsel * sample;
+		*dest++ += rvolsel * sample;
+	}
+	return index;
+}
+
+static SLONG RefMonoInterp(SWORD* srce,SLONG* dest,SLONG index,SLONG increment,SLONG todo)
+{
+	SLONG sample;
+	SLONG lvolsel = vnf->lvolsel;
+	SLONG rampvol = vnf->rampvol;
+
+	if (rampvol) {
+		SLONG oldlvol = vnf->oldlvol - lvolsel;
+		while(todo--) {
+			sample=(SLONG)srce[index>>FRACBITS]+
+			       ((SLONG)(srce[(index>>FRACBITS)+1]-srce[index>>FRACBITS])
+			        *(index&FRACMASK)>>FRACBITS);
+			index += increment;
+
+			*dest++ += ((lvolsel << CLICK_SHIFT) + oldlvol * rampvol)
+			           * sample >> CLICK_SHIFT;
+			if (!--rampvol)
+				break;
+		}
+		vnf->rampvol = rampvol;
+		if (todo < 0)
+			return index;
+	}
+
+	while(todo--) {
+		sample=(SLONG)srce[index>>FRACBITS]+
+		       ((SLONG)(srce[(index>>FRACBITS)+1]-srce[index>>FRACBITS])
+		        *(index&FRACMASK)>>FRACBITS);
+		index += increment;
+
+		*dest++ += lvolsel * sample;
+	}
+	return index;
+}
+
+static SLONG RefStereoInterp(SWORD* srce,SLONG* dest,SLONG index,SLONG increment,SLONG todo)
+{
+	SLONG sample;
+	SLONG lvolsel = vnf->lvolsel;
+	SLONG rvolsel = vnf->rvolsel;
+	SLONG rampvol = vnf->rampvol;
+
+	if (rampvol) {
+		SLONG oldlvol = vnf->oldlvol - lvolsel;
+		SLONG oldrvol = vnf->oldrvol - rvolsel;
+		while(todo--) {
+			sample=(SLONG)srce[index>>FRACBITS]+
+			       ((SLONG)(srce[(index>>FRACBITS)+1]-srce[index>>FRACBITS])
+			        *(index&FRACMASK)>>FRACBITS);
+			index += increment;
+
+			*dest++ += ((lvolsel << CLICK_SHIFT) + oldlvol * rampvol)
+			           * sample >> CLICK_SHIFT;
+			*dest++ += ((rvolsel << CLICK_SHIFT) + oldrvol * rampvol)
+					   * sample >> CLICK_SHIFT;
+			if (!--rampvol)
+				break;
+		}
+		vnf->rampvol = rampvol;
+		if (todo < 0)
+			return index;
+	}
+
+	while(todo--) {
+		sample=(SLONG)srce[index>>FRACBITS]+
+		       ((SLONG)(srce[(index>>FRACBITS)+1]-srce[index>>FRACBITS])
+		        *(index&FRACMASK)>>FRACBITS);
+		index += increment;
+
+		*dest++ += lvolsel * sample;
+		*dest++ += rvolsel * sample;
+	}
+	return index;
+}
+
+/*========== 1) Mixer functions */
+
+typedef SLONG (*MIXER)(SWORD*,SLONG*,SLONG,SLONG,SLONG);
+typedef SLONG (*MIXER16)(SWORD*,SLONG*,SWORD*,SLONG,SLONG,SLONG);
+
+static const struct {
+	const char* name;
+	MIXER   mix,ref;
+	MIXER16 mix16;
+	int     stereo,ramp;
+} mixers[] = {
+	{ "Mix32MonoNormal",   Mix32MonoNormal,  RefMonoNormal,  Mix32MonoNormalTo16,  0,0 },
+	{ "Mix32StereoNormal", Mix32StereoNormal,RefStereoNormal,Mix32StereoNormalTo16,1,0 },
+	{ "Mix32MonoInterp",   Mix32MonoInterp,  RefMonoInterp,  Mix32MonoInterpTo16,  0,1 },
+	{ "Mix32StereoInterp", Mix32StereoInterp,RefStereoInterp,Mix32StereoInterpTo16,1,1 },
+};
+
+static void TestMixers(void)
+{
+	static SWORD srce[SRCLEN+16];
+	static SLONG dest[2][1024],init[1024];
+	static SWORD out[2][1024];
+	VINFO v;
+	int m,n,i;
+
+	rnd=1;
+	for(i=0;i<SRCLEN+16;i++)
+		srce[i]=(SWORD)Random();
+	vnf=&v;
+
+	for(m=0;m<sizeof(mixers)/sizeof(mixers[0]);m++) {
+		int stereo=mixers[m].stereo;
+
+		for(n=0;n<2000;n++) {
+			SLONG todo=Random()%500,increment=1+Random()%(4<<FRACBITS);
+			SLONG index=Random()%((SRCLEN<<FRACBITS)-todo*increment);
+			SLONG count=stereo?todo<<1:todo,end[2];
+			int ramp,endramp[2];
+
+			memset(&v,0,sizeof(v));
+			v.lvolsel=Random()%257;
+			v.rvolsel=Random()%257;
+			v.oldlvol=Random()%257;
+			v.oldrvol=Random()%257;
+			/* mixing buffer values up to 2^23, some outputs clip */
+			for(i=0;i<count;i++)
+				init[i]=(SLONG)(Random()&0xffffff)-0x800000;
+
+			/* unrolled against one sample loops (with ramp if any) */
+			ramp=mixers[m].ramp?(Random()&1)*(1+Random()%CLICK_BUFFER):0;
+			for(i=0;i<2;i++) {
+				memcpy(dest[i],init,count*sizeof(SLONG));
+				v.rampvol=ramp;
+				end[i]=(i?mixers[m].ref:mixers[m].mix)
+				       (srce,dest[i],index,increment,todo);
+				endramp[i]=v.rampvol;
+			}
+			Check(end[0]==end[1]&&endramp[0]==endramp[1]&&
+			      !memcmp(dest[0],dest[1],count*sizeof(SLONG)),
+			      mixers[m].name,n);
+
+			/* last voice conversion against mixing then Mix32To16() */
+			v.rampvol=0;
+			memcpy(dest[0],init,count*sizeof(SLONG));
+			end[0]=mixers[m].mix16(srce,dest[0],out[0],index,increment,todo);
+			memcpy(dest[1],init,count*sizeof(SLONG));
+			end[1]=mixers[m].ref(srce,dest[1],index,increment,todo);
+			Mix32To16(out[1],dest[1],count);
+			Check(end[0]==end[1]&&
+			      !memcmp(out[0],out[1],count*sizeof(SWORD)),
+			      mixers[m].name,n);
+		}
+	}
+}
+
+/*========== 2) Mixing random voices */
+
+static ULONG len[NSAMPLES];
+static int nvoices;
+
+static void Tick(void)
+{
+	int v;
+
+	for(v=0;v<nvoices;v++) {
+		int h=Random()%NSAMPLES;
+
+		if(!(Random()%4)) {
+			UWORD flags=(Random()%3)?SF_LOOP|((Random()&1)?SF_BIDI:0):0;
+
+			VC1_VoicePlay(v,h,0,len[h],len[h]/4,len[h]-len[h]/8,
+			              flags|SF_16BITS);
+		}
+		VC1_VoiceSetVolume(v,Random()%257);
+		VC1_VoiceSetPanning(v,(Random()%8)?Random()%256:PAN_SURROUND);
+		VC1_VoiceSetFrequency(v,2000+Random()%60000);
+	}
+}
+
+static const struct {
+	const char* name;
+	UWORD       mode;
+	UBYTE       reverb;
+	ULONG       sum;         /* checksum with the previous mixers (32 voices, 10 s) */
+} modes[] = {
+	{ "mono 8",             0,                                     0,0x28e1f0b2 },
+	{ "mono 16",            DMODE_16BITS,                          0,0x9d6ea7f0 },
+	{ "stereo 8",           DMODE_STEREO,                          0,0x27391e11 },
+	{ "stereo 16",          DMODE_STEREO|DMODE_16BITS,             0,0x3f78aa05 },
+	{ "mono 16 interp",     DMODE_16BITS|DMODE_INTERP,             0,0x004474ae },
+	{ "stereo 16 interp",   DMODE_STEREO|DMODE_16BITS|DMODE_INTERP,0,0x6ed18b9b },
+	{ "stereo 16 surround", DMODE_STEREO|DMODE_16BITS|DMODE_SURROUND,
+	                                                               0,0xe892af0a },
+	{ "stereo 16 interp surround",
+	                        DMODE_STEREO|DMODE_16BITS|DMODE_INTERP|DMODE_SURROUND,
+	                                                               0,0xf46e1bbd },
+	{ "stereo 16 reverb",   DMODE_STEREO|DMODE_16BITS,             6,0x76f48b25 },
+	/* no previous cubic mixer : checksum of its first version */
+	{ "stereo 16 cubic",    DMODE_STEREO|DMODE_16BITS|DMODE_INTERP|DMODE_CUBIC,
+	                                                               0,0x43edc7c6 },
+};
+
+/* Mix seconds of random voices. Returns output checksum, time in ns. */
+static ULONG Render(UWORD mode,UBYTE reverb,int seconds,double* ns)
+{
+	static SWORD out[44100*2];
+	struct timespec t0,t1;
+	ULONG sum=0;
+	int i,j,s;
+
+	md_mode=mode|DMODE_SOFT_MUSIC;
+	md_reverb=reverb;
+	md_softchn=nvoices;
+	md_player=Tick;
+	rnd=1234;
+
+	if(VC1_Init()) {
+		fprintf(stderr,"mixtest: VC1_Init failed\n");
+		exit(2);
+	}
+	VC1_SetNumVoices();
+	for(i=0;i<NSAMPLES;i++) {
+		len[i]=1000+Random()%20000;
+		Samples[i]=(SWORD*)malloc((len[i]+20)*sizeof(SWORD));
+		for(j=0;j<len[i];j++)
+			Samples[i][j]=(SWORD)Random();
+		/* loop unclick samples, as VC1_SampleLoad() does */
+		for(j=0;j<16;j++)
+			Samples[i][len[i]+j]=Samples[i][len[i]/4+j];
+	}
+	VC1_PlayStart();
+
+	*ns=0;
+	for(s=0;s<seconds;s++) {
+		clock_gettime(CLOCK_MONOTONIC,&t0);
+		VC1_WriteSamples((SBYTE*)out,md_mixfreq);
+		clock_gettime(CLOCK_MONOTONIC,&t1);
+		*ns+=(t1.tv_sec-t0.tv_sec)*1e9+(t1.tv_nsec-t0.tv_nsec);
+
+		if(mode & DMODE_16BITS)
+			for(i=0;i<samples2bytes(md_mixfreq)/2;i++)
+				sum=(sum*31+(UWORD)out[i])&0xffffffff;
+		else
+			for(i=0;i<samples2bytes(md_mixfreq);i++)
+				sum=(sum*31+((UBYTE*)out)[i])&0xffffffff;
+	}
+
+	VC1_PlayStop();
+	for(i=0;i<NSAMPLES;i++)
+		free(Samples[i]);
+	VC1_Exit();
+	return sum;
+}
+
+#ifdef HAVE_PTHREAD
+
+/*========== 3) Mixing threads */
+
+static void TestThreads(int seconds,int threads)
+{
+	static const struct {
+		const char* name;
+		UWORD       mode;
+	} thrmodes[] = {
+		{ "stereo 16",        DMODE_STEREO|DMODE_16BITS },
+		{ "stereo 16 interp", DMODE_STEREO|DMODE_16BITS|DMODE_INTERP },
+	};
+	int m,t;
+
+	printf("%d voices, %d s, mixing threads, ns per voice per output sample\n",
+	       nvoices,seconds);
+	for(m=0;m<sizeof(thrmodes)/sizeof(thrmodes[0]);m++) {
+		ULONG sum,ref=0;
+		double ns,ns1=0;
+
+		for(t=1;t<=threads;t++) {
+			md_mixthreads=t;
+			sum=Render(thrmodes[m].mode,0,seconds,&ns);
+			if(t==1) {
+				ref=sum;
+				ns1=ns;
+			}
+			printf("  %-18s %2d threads %6.2f  x%4.2f  %08lx %s\n",
+			       thrmodes[m].name,t,
+			       ns/((double)seconds*md_mixfreq*nvoices),ns1/ns,
+			       (unsigned long)sum,(sum==ref)?"":"DIFFERS");
+			failed|=(sum!=ref);
+		}
+	}
+	md_mixthreads=0;
+}
+#endif
+
+int main(int argc,char** argv)
+{
+	int seconds,threads,m;
+
+	nvoices=(argc>1)?atoi(argv[1]):32;
+	seconds=(argc>2)?atoi(argv[2]):10;
+	threads=(argc>3)?atoi(argv[3]):8;
+	if(nvoices<1||nvoices>255||seconds<1||threads<1||threads>64) {
+		fprintf(stderr,"Usage: mixtest [voices [seconds [threads]]]\n");
+		return 2;
+	}
+
+	TestMixers();
+	printf("mixers: %s\n",failed?"FAILED":"ok");
+
+	printf("%d voices, %d s, ns per voice per output sample\n",
+	       nvoices,seconds);
+	for(m=0;m<sizeof(modes)/sizeof(modes[0]);m++) {
+		double ns;
+		ULONG sum=Render(modes[m].mode,modes[m].reverb,seconds,&ns);
+		int ok=(nvoices!=32||seconds!=10||sum==modes[m].sum);
+
+		printf("  %-26s %6.2f  %08lx %s\n",modes[m].name,
+		       ns/((double)seconds*md_mixfreq*nvoices),
+		       (unsigned long)sum,ok?"":"DIFFERS");
+		failed|=!ok;
+	}
+
+#ifdef HAVE_PTHREAD
+	TestThreads(seconds,threads);
+#endif
+	return failed;
+}
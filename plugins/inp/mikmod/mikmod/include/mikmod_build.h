@@ -593,6 +593,7 @@ enum {
 #define DMODE_SURROUND   0x0100 /* enable surround sound */
 #define DMODE_INTERP     0x0200 /* enable interpolation */
 #define DMODE_REVERSE    0x0400 /* reverse stereo */
+#define DMODE_CUBIC      0x0800 /* cubic interpolation (with DMODE_INTERP) */
 
 struct SAMPLOAD;
 typedef struct MDRIVER {
@@ -646,6 +647,7 @@ MIKMODAPI extern UBYTE md_pansep;      /* 0 = mono;  128 == 100% (full left/righ
 MIKMODAPI extern UWORD md_device;      /* device */
 MIKMODAPI extern UWORD md_mixfreq;     /* mixing frequency */
 MIKMODAPI extern UWORD md_mode;        /* mode. See DMODE_? flags above */
+MIKMODAPI extern UBYTE md_mixthreads;  /* software mixer threads (0,1 = none) */
 
 /* The following variable should not be changed! */
 MIKMODAPI extern MDRIVER* md_driver;   /* Current driver in use. */
@@ -60,6 +60,7 @@ MIKMODAPI	UWORD md_mixfreq        = 44100;
 MIKMODAPI	UWORD md_mode           = DMODE_STEREO | DMODE_16BITS |
 DMODE_SURROUND |DMODE_SOFT_MUSIC |
 DMODE_SOFT_SNDFX;
+MIKMODAPI	UBYTE md_mixthreads     = 0;	/* mix in the caller thread */
 MIKMODAPI	UBYTE md_pansep         = 128;	/* 128 == 100% (full left/right) */
 MIKMODAPI	UBYTE md_reverb         = 0;	/* no reverb */
 MIKMODAPI	UBYTE md_volume         = 128;	/* global sound volume (0-128) */
@@ -32,6 +32,8 @@
     (a) 4-step reverb (for 16 bit output only)
     (b) Interpolation of sample data during mixing
     (c) Dolby Surround Sound
+    (d) Cubic interpolation (DMODE_CUBIC with DMODE_INTERP)
+    (e) Voices mixed by md_mixthreads threads (HAVE_PTHREAD only)
 */
 
 #ifdef HAVE_CONFIG_H
@@ -68,6 +70,10 @@
 #define FRACBITS 11
 #define FRACMASK ((1L<<FRACBITS)-1L)
 
+/* Linear interpolation of srce at index (32 bit mixers) */
+#define INTERP32(i) ((SLONG)srce[(i)>>FRACBITS]+ \
+	((SLONG)(srce[((i)>>FRACBITS)+1]-srce[(i)>>FRACBITS])*((i)&FRACMASK)>>FRACBITS))
+
 #define TICKLSIZE 8192
 #define TICKWSIZE (TICKLSIZE<<1)
 #define TICKBSIZE (TICKWSIZE<<1)
@@ -100,11 +106,19 @@ typedef struct VINFO {
 	SLONGLONG increment;         /* increment value */
 } VINFO;
 
+/* Voice being mixed : one per mixing thread */
+#ifdef HAVE_PTHREAD
+#define VC_LOCAL __thread
+#else
+#define VC_LOCAL
+#endif
+
 static	SWORD **Samples;
-static	VINFO *vinf=NULL,*vnf;
+static	VINFO *vinf=NULL;
+static	VC_LOCAL VINFO *vnf;
 static	long tickleft,samplesthatfit,vc_memory=0;
 static	int vc_softchn;
-static	SLONGLONG idxsize,idxlpos,idxlend;
+static	VC_LOCAL SLONGLONG idxsize,idxlpos,idxlend;
 static	SLONG *vc_tickbuf=NULL;
 static	UWORD vc_mode;
 
@@ -130,11 +144,26 @@ static	SLONG *RVbufR1=NULL,*RVbufR2=NULL,*RVbufR3=NULL,*RVbufR4=NULL,
 /*========== 32 bit sample mixers - only for 32 bit platforms */
 #ifndef NATIVE_64BIT_INT
 
+/* $$$ ben: The 32 bit mixers do 4 samples per loop (loads first, then the
+   multiply-adds) so that the SH4 can pair and pipeline them. Results are
+   the same as the one sample loops. */
+
 static SLONG Mix32MonoNormal(SWORD* srce,SLONG* dest,SLONG index,SLONG increment,SLONG todo)
 {
 	SWORD sample;
+	SLONG s0,s1,s2,s3;
 	SLONG lvolsel = vnf->lvolsel;
 
+	for(;todo>=4;todo-=4) {
+		s0 = srce[index >> FRACBITS]; index += increment;
+		s1 = srce[index >> FRACBITS]; index += increment;
+		s2 = srce[index >> FRACBITS]; index += increment;
+		s3 = srce[index >> FRACBITS]; index += increment;
+
+		dest[0] += lvolsel * s0; dest[1] += lvolsel * s1;
+		dest[2] += lvolsel * s2; dest[3] += lvolsel * s3;
+		dest += 4;
+	}
 	while(todo--) {
 		sample = srce[index >> FRACBITS];
 		index += increment;
@@ -147,9 +176,22 @@ static SLONG Mix32MonoNormal(SWORD* srce,SLONG* dest,SLONG index,SLONG increment
 static SLONG Mix32StereoNormal(SWORD* srce,SLONG* dest,SLONG index,SLONG increment,SLONG todo)
 {
 	SWORD sample;
+	SLONG s0,s1,s2,s3;
 	SLONG lvolsel = vnf->lvolsel;
 	SLONG rvolsel = vnf->rvolsel;
 
+	for(;todo>=4;todo-=4) {
+		s0 = srce[index >> FRACBITS]; index += increment;
+		s1 = srce[index >> FRACBITS]; index += increment;
+		s2 = srce[index >> FRACBITS]; index += increment;
+		s3 = srce[index >> FRACBITS]; index += increment;
+
+		dest[0] += lvolsel * s0; dest[1] += rvolsel * s0;
+		dest[2] += lvolsel * s1; dest[3] += rvolsel * s1;
+		dest[4] += lvolsel * s2; dest[5] += rvolsel * s2;
+		dest[6] += lvolsel * s3; dest[7] += rvolsel * s3;
+		dest += 8;
+	}
 	while(todo--) {
 		sample=srce[index >> FRACBITS];
 		index += increment;
@@ -210,10 +252,20 @@ static SLONG Mix32MonoInterp(SWORD* srce,SLONG* dest,SLONG index,SLONG increment
 			return index;
 	}
 
-	while(todo--) {
-		sample=(SLONG)srce[index>>FRACBITS]+
-		       ((SLONG)(srce[(index>>FRACBITS)+1]-srce[index>>FRACBITS])
-		        *(index&FRACMASK)>>FRACBITS);
+	for(;todo>=4;todo-=4) {
+		SLONG s0,s1,s2,s3;
+
+		s0 = INTERP32(index); index += increment;
+		s1 = INTERP32(index); index += increment;
+		s2 = INTERP32(index); index += increment;
+		s3 = INTERP32(index); index += increment;
+
+		dest[0] += lvolsel * s0; dest[1] += lvolsel * s1;
+		dest[2] += lvolsel * s2; dest[3] += lvolsel * s3;
+		dest += 4;
+	}
+	while(todo-- > 0) {
+		sample = INTERP32(index);
 		index += increment;
 
 		*dest++ += lvolsel * sample;
@@ -249,10 +301,22 @@ static SLONG Mix32StereoInterp(SWORD* srce,SLONG* dest,SLONG index,SLONG increme
 			return index;
 	}
 
-	while(todo--) {
-		sample=(SLONG)srce[index>>FRACBITS]+
-		       ((SLONG)(srce[(index>>FRACBITS)+1]-srce[index>>FRACBITS])
-		        *(index&FRACMASK)>>FRACBITS);
+	for(;todo>=4;todo-=4) {
+		SLONG s0,s1,s2,s3;
+
+		s0 = INTERP32(index); index += increment;
+		s1 = INTERP32(index); index += increment;
+		s2 = INTERP32(index); index += increment;
+		s3 = INTERP32(index); index += increment;
+
+		dest[0] += lvolsel * s0; dest[1] += rvolsel * s0;
+		dest[2] += lvolsel * s1; dest[3] += rvolsel * s1;
+		dest[4] += lvolsel * s2; dest[5] += rvolsel * s2;
+		dest[6] += lvolsel * s3; dest[7] += rvolsel * s3;
+		dest += 8;
+	}
+	while(todo-- > 0) {
+		sample = INTERP32(index);
 		index += increment;
 
 		*dest++ += lvolsel * sample;
@@ -309,6 +373,87 @@ static SLONG Mix32SurroundInterp(SWORD* srce,SLONG* dest,SLONG index,SLONG incre
 	}
 	return index;
 }
+
+/* Catmull-Rom interpolation of srce at index. The point before the first
+   sample is the first sample itself, the ones after the end are in the 16
+   unclick samples. */
+static SLONG Cubic32(SWORD* srce,SLONG index)
+{
+	SLONG i = index >> FRACBITS, f = index & FRACMASK;
+	SLONG p0 = srce[i-(i>0)], p1 = srce[i], p2 = srce[i+1], p3 = srce[i+2];
+	SLONG a = 3*(p1-p2)-p0+p3;
+	SLONG b = 2*(p2+p2+p0)-5*p1-p3;
+	SLONG c = p2-p0;
+
+	return p1+(((((a*f>>FRACBITS)+b)*f>>FRACBITS)+c)*f>>(FRACBITS+1));
+}
+
+static SLONG Mix32MonoCubic(SWORD* srce,SLONG* dest,SLONG index,SLONG increment,SLONG todo)
+{
+	SLONG sample;
+	SLONG lvolsel = vnf->lvolsel;
+	SLONG rampvol = vnf->rampvol;
+
+	if (rampvol) {
+		SLONG oldlvol = vnf->oldlvol - lvolsel;
+		while(todo--) {
+			sample = Cubic32(srce,index);
+			index += increment;
+
+			*dest++ += ((lvolsel << CLICK_SHIFT) + oldlvol * rampvol)
+			           * sample >> CLICK_SHIFT;
+			if (!--rampvol)
+				break;
+		}
+		vnf->rampvol = rampvol;
+		if (todo < 0)
+			return index;
+	}
+
+	while(todo--) {
+		sample = Cubic32(srce,index);
+		index += increment;
+
+		*dest++ += lvolsel * sample;
+	}
+	return index;
+}
+
+static SLONG Mix32StereoCubic(SWORD* srce,SLONG* dest,SLONG index,SLONG increment,SLONG todo)
+{
+	SLONG sample;
+	SLONG lvolsel = vnf->lvolsel;
+	SLONG rvolsel = vnf->rvolsel;
+	SLONG rampvol = vnf->rampvol;
+
+	if (rampvol) {
+		SLONG oldlvol = vnf->oldlvol - lvolsel;
+		SLONG oldrvol = vnf->oldrvol - rvolsel;
+		while(todo--) {
+			sample = Cubic32(srce,index);
+			index += increment;
+
+			*dest++ += ((lvolsel << CLICK_SHIFT) + oldlvol * rampvol)
+			           * sample >> CLICK_SHIFT;
+			*dest++ += ((rvolsel << CLICK_SHIFT) + oldrvol * rampvol)
+					   * sample >> CLICK_SHIFT;
+			if (!--rampvol)
+				break;
+		}
+		vnf->rampvol = rampvol;
+		if (todo < 0)
+			return index;
+	}
+
+	while(todo--) {
+		sample = Cubic32(srce,index);
+		index += increment;
+
+		*dest++ += lvolsel * sample;
+		*dest++ += rvolsel * sample;
+	}
+	return index;
+}
 #endif
 
 /*========== 64 bit sample mixers - all platforms */
@@ -620,20 +765,101 @@ static void Mix32To8(SBYTE* dste,SLONG* srce,NATIVE count)
 	}
 }
 
-static void AddChannel(SLONG* ptr,NATIVE todo)
+/*========== Last voice mixers : mix and convert to 16 bit in one pass */
+#ifndef NATIVE_64BIT_INT
+
+/* $$$ ben: The last voice adds its samples to the mixing buffer and writes
+   the 16 bit output at once, saving the Mix32To16() pass over the buffer.
+   Same results as mixing then converting. No volume ramp here. */
+
+#define MIX_TO16(var,acc) var=(acc)>>BITSHIFT;CHECK_SAMPLE(var,32768)
+
+static SLONG Mix32MonoNormalTo16(SWORD* srce,SLONG* dest,SWORD* dste,SLONG index,SLONG increment,SLONG todo)
+{
+	SLONG sample,x1;
+	SLONG lvolsel = vnf->lvolsel;
+
+	while(todo--) {
+		sample = srce[index >> FRACBITS];
+		index += increment;
+
+		MIX_TO16(x1,*dest++ + lvolsel*sample);
+		PUT_SAMPLE(x1);
+	}
+	return index;
+}
+
+static SLONG Mix32StereoNormalTo16(SWORD* srce,SLONG* dest,SWORD* dste,SLONG index,SLONG increment,SLONG todo)
+{
+	SLONG sample,x1,x2;
+	SLONG lvolsel = vnf->lvolsel;
+	SLONG rvolsel = vnf->rvolsel;
+
+	while(todo--) {
+		sample = srce[index >> FRACBITS];
+		index += increment;
+
+		MIX_TO16(x1,dest[0] + lvolsel*sample);
+		MIX_TO16(x2,dest[1] + rvolsel*sample);
+		dest += 2;
+		PUT_SAMPLE(x1); PUT_SAMPLE(x2);
+	}
+	return index;
+}
+
+static SLONG Mix32MonoInterpTo16(SWORD* srce,SLONG* dest,SWORD* dste,SLONG index,SLONG increment,SLONG todo)
+{
+	SLONG sample,x1;
+	SLONG lvolsel = vnf->lvolsel;
+
+	while(todo--) {
+		sample = INTERP32(index);
+		index += increment;
+
+		MIX_TO16(x1,*dest++ + lvolsel*sample);
+		PUT_SAMPLE(x1);
+	}
+	return index;
+}
+
+static SLONG Mix32StereoInterpTo16(SWORD* srce,SLONG* dest,SWORD* dste,SLONG index,SLONG increment,SLONG todo)
+{
+	SLONG sample,x1,x2;
+	SLONG lvolsel = vnf->lvolsel;
+	SLONG rvolsel = vnf->rvolsel;
+
+	while(todo--) {
+		sample = INTERP32(index);
+		index += increment;
+
+		MIX_TO16(x1,dest[0] + lvolsel*sample);
+		MIX_TO16(x2,dest[1] + rvolsel*sample);
+		dest += 2;
+		PUT_SAMPLE(x1); PUT_SAMPLE(x2);
+	}
+	return index;
+}
+#endif
+
+/* Mix current voice in ptr. If dste is set, the mixed samples are also
+   converted to 16 bit there. Returns the number of samples converted. */
+static NATIVE AddChannel(SLONG* ptr,NATIVE todo,SWORD* dste)
 {
 	SLONGLONG end,done;
 	SWORD *s;
+	NATIVE converted=0;
 
 	if(!(s=Samples[vnf->handle])) {
 		vnf->current = vnf->active  = 0;
-		return;
+		return 0;
 	}
 
 	/* update the 'current' index so the sample loops, or stops playing if it
 	   reached the end of the sample */
 	while(todo>0) {
 		SLONGLONG endpos;
+		NATIVE count;
+		int fused;
 
 		if(vnf->flags & SF_REVERSE) {
 			/* The sample is playing in reverse */
@@ -700,20 +926,53 @@ static void AddChannel(SLONG* ptr,NATIVE todo)
 		}
 
 		endpos=vnf->current+done*vnf->increment;
+		count=(vc_mode & DMODE_STEREO)?(done<<1):done;
+		fused=0;
 
 		if(vnf->vol) {
 #ifndef NATIVE_64BIT_INT
+			int surround=(vc_mode & DMODE_STEREO)&&
+			             (vnf->pan==PAN_SURROUND)&&(md_mode&DMODE_SURROUND);
+
+			/* last voice : mix and convert in one pass when possible */
+			if(dste&&!surround&&(vnf->current<0x7fffffff)&&(endpos<0x7fffffff)) {
+				if(!(md_mode & DMODE_INTERP)) {
+					fused=1;
+					if(vc_mode & DMODE_STEREO)
+						vnf->current=Mix32StereoNormalTo16
+						       (s,ptr,dste,vnf->current,vnf->increment,done);
+					else
+						vnf->current=Mix32MonoNormalTo16
+						       (s,ptr,dste,vnf->current,vnf->increment,done);
+				} else if(!vnf->rampvol && !(md_mode & DMODE_CUBIC)) {
+					fused=1;
+					if(vc_mode & DMODE_STEREO)
+						vnf->current=Mix32StereoInterpTo16
+						       (s,ptr,dste,vnf->current,vnf->increment,done);
+					else
+						vnf->current=Mix32MonoInterpTo16
+						       (s,ptr,dste,vnf->current,vnf->increment,done);
+				}
+			}
+			if(fused)
+				;
 			/* use the 32 bit mixers as often as we can (they're much faster) */
-			if((vnf->current<0x7fffffff)&&(endpos<0x7fffffff)) {
+			else if((vnf->current<0x7fffffff)&&(endpos<0x7fffffff)) {
 				if((md_mode & DMODE_INTERP)) {
 					if(vc_mode & DMODE_STEREO) {
-						if((vnf->pan==PAN_SURROUND)&&(md_mode&DMODE_SURROUND))
+						if(surround)
 							vnf->current=Mix32SurroundInterp
 							           (s,ptr,vnf->current,vnf->increment,done);
+						else if(md_mode & DMODE_CUBIC)
+							vnf->current=Mix32StereoCubic
+							           (s,ptr,vnf->current,vnf->increment,done);
 						else
 							vnf->current=Mix32StereoInterp
 							           (s,ptr,vnf->current,vnf->increment,done);
-					} else
+					} else if(md_mode & DMODE_CUBIC)
+						vnf->current=Mix32MonoCubic
+						               (s,ptr,vnf->current,vnf->increment,done);
+					else
 						vnf->current=Mix32MonoInterp
 						               (s,ptr,vnf->current,vnf->increment,done);
 				} else if(vc_mode & DMODE_STEREO) {
@@ -755,20 +1014,195 @@ static void AddChannel(SLONG* ptr,NATIVE todo)
 			/* update sample position */
 			vnf->current=endpos;
 
+		if(dste) {
+			if(!fused) Mix32To16(dste,ptr,count);
+			dste+=count;
+			converted+=done;
+		}
 		todo-=done;
-		ptr +=(vc_mode & DMODE_STEREO)?(done<<1):done;
+		ptr +=count;
 	}
+	return converted;
 }
 
 #define _IN_VIRTCH_
 #include "virtch_common.c"
 #undef _IN_VIRTCH_
 
+/* Setup and mix voice v in buf, see AddChannel() for dste. Returns the
+   number of samples converted. */
+static NATIVE MixVoice(VINFO* v,SLONG* buf,NATIVE portion,SWORD* dste)
+{
+	int pan, vol;
+
+	vnf = v;
+	if(vnf->kick) {
+		vnf->current=((SLONGLONG)vnf->start)<<FRACBITS;
+		vnf->kick   =0;
+		vnf->active =1;
+	}
+
+	if(!vnf->frq) vnf->active = 0;
+
+	if(!vnf->active)
+		return 0;
+
+	vnf->increment=((SLONGLONG)(vnf->frq<<FRACBITS))/md_mixfreq;
+	if(vnf->flags&SF_REVERSE) vnf->increment=-vnf->increment;
+	vol = vnf->vol;  pan = vnf->pan;
+
+	vnf->oldlvol=vnf->lvolsel;vnf->oldrvol=vnf->rvolsel;
+	if(vc_mode & DMODE_STEREO) {
+		if(pan != PAN_SURROUND) {
+			vnf->lvolsel=(vol*(PAN_RIGHT-pan))>>8;
+			vnf->rvolsel=(vol*pan)>>8;
+		} else
+			vnf->lvolsel=vnf->rvolsel=vol/2;
+	} else
+		vnf->lvolsel=vol;
+
+	idxsize = (vnf->size)? ((SLONGLONG)vnf->size << FRACBITS)-1 : 0;
+	idxlend = (vnf->repend)? ((SLONGLONG)vnf->repend << FRACBITS)-1 : 0;
+	idxlpos = (SLONGLONG)vnf->reppos << FRACBITS;
+	return AddChannel(buf, portion, dste);
+}
+
+/*========== Mixing threads */
+#ifdef HAVE_PTHREAD
+
+/* $$$ ben: Thread k mixes voices k, k+n, k+2n ... (n threads) in its own
+   buffer, the caller being thread 0 mixing in vc_tickbuf. Buffers are then
+   added in thread order : integer sums, so the output is the same as
+   mixing all voices in the caller whatever the number of threads. */
+
+typedef struct VC_WORKER {
+	pthread_t thread;
+	int       first;             /* first voice */
+	SLONG    *acc;               /* private mixing buffer */
+} VC_WORKER;
+
+static	VC_WORKER *vc_workers=NULL;
+static	int vc_nthreads=0;           /* workers + caller (0 : no workers) */
+static	pthread_mutex_t vc_poolmutex=PTHREAD_MUTEX_INITIALIZER;
+static	pthread_cond_t vc_poolstart=PTHREAD_COND_INITIALIZER;
+static	pthread_cond_t vc_pooldone=PTHREAD_COND_INITIALIZER;
+static	int vc_job,vc_pending,vc_quit;
+static	NATIVE vc_portion;
+
+static void MixVoices(int first,SLONG* buf,NATIVE portion)
+{
+	int t;
+
+	for(t=first;t<vc_softchn;t+=vc_nthreads)
+		MixVoice(&vinf[t],buf,portion,NULL);
+}
+
+static void* VC_Worker(void* arg)
+{
+	VC_WORKER* w=(VC_WORKER*)arg;
+	int job=0;
+
+	for(;;) {
+		pthread_mutex_lock(&vc_poolmutex);
+		while(job==vc_job && !vc_quit)
+			pthread_cond_wait(&vc_poolstart,&vc_poolmutex);
+		if(vc_quit) {
+			pthread_mutex_unlock(&vc_poolmutex);
+			break;
+		}
+		job=vc_job;
+		pthread_mutex_unlock(&vc_poolmutex);
+
+		memset(w->acc,0,(vc_mode & DMODE_STEREO ? vc_portion<<1 : vc_portion)
+		                *sizeof(SLONG));
+		MixVoices(w->first,w->acc,vc_portion);
+
+		pthread_mutex_lock(&vc_poolmutex);
+		if(!--vc_pending)
+			pthread_cond_signal(&vc_pooldone);
+		pthread_mutex_unlock(&vc_poolmutex);
+	}
+	return NULL;
+}
+
+static void VC_StopWorkers(void)
+{
+	int k;
+
+	if(!vc_workers) return;
+
+	pthread_mutex_lock(&vc_poolmutex);
+	vc_quit=1;
+	pthread_cond_broadcast(&vc_poolstart);
+	pthread_mutex_unlock(&vc_poolmutex);
+
+	for(k=1;k<vc_nthreads;k++) {
+		pthread_join(vc_workers[k].thread,NULL);
+		free(vc_workers[k].acc);
+	}
+	free(vc_workers);
+	vc_workers=NULL;
+	vc_nthreads=0;
+}
+
+/* Start n-1 workers. Mixes in the caller only if some fail to start. */
+static void VC_StartWorkers(int n)
+{
+	int k;
+
+	VC_StopWorkers();
+	if(n<2) return;
+
+	if(!(vc_workers=(VC_WORKER*)_mm_calloc(n,sizeof(VC_WORKER))))
+		return;
+	vc_quit=vc_job=0;
+	vc_nthreads=n;
+	for(k=1;k<n;k++) {
+		vc_workers[k].first=k;
+		if(!(vc_workers[k].acc=(SLONG*)_mm_malloc((TICKLSIZE+32)*sizeof(SLONG)))
+		   ||pthread_create(&vc_workers[k].thread,NULL,VC_Worker,&vc_workers[k])) {
+			if(vc_workers[k].acc) free(vc_workers[k].acc);
+			vc_nthreads=k;
+			VC_StopWorkers();
+			return;
+		}
+	}
+}
+
+/* Mix all voices in vc_tickbuf with the workers. */
+static void MixThreaded(NATIVE portion,NATIVE count)
+{
+	int k;
+	NATIVE i;
+
+	pthread_mutex_lock(&vc_poolmutex);
+	vc_portion=portion;
+	vc_pending=vc_nthreads-1;
+	vc_job++;
+	pthread_cond_broadcast(&vc_poolstart);
+	pthread_mutex_unlock(&vc_poolmutex);
+
+	MixVoices(0,vc_tickbuf,portion);
+
+	pthread_mutex_lock(&vc_poolmutex);
+	while(vc_pending)
+		pthread_cond_wait(&vc_pooldone,&vc_poolmutex);
+	pthread_mutex_unlock(&vc_poolmutex);
+
+	for(k=1;k<vc_nthreads;k++) {
+		SLONG *acc=vc_workers[k].acc;
+		for(i=0;i<count;i++)
+			vc_tickbuf[i]+=acc[i];
+	}
+}
+#endif
+
 void VC1_WriteSamples(SBYTE* buf,ULONG todo)
 {
 	int left,portion=0,count;
 	SBYTE  *buffer;
-	int t, pan, vol;
+	int t, last;
+	NATIVE converted;
 
 	while(todo) {
 		if(!tickleft) {
@@ -784,38 +1218,27 @@ void VC1_WriteSamples(SBYTE* buf,ULONG todo)
 		while(left) {
 			portion = MIN(left, samplesthatfit);
 			count   = (vc_mode & DMODE_STEREO)?(portion<<1):portion;
-			memset(vc_tickbuf, 0, count<<2);
-			for(t=0;t<vc_softchn;t++) {
-				vnf = &vinf[t];
-
-				if(vnf->kick) {
-					vnf->current=((SLONGLONG)vnf->start)<<FRACBITS;
-					vnf->kick   =0;
-					vnf->active =1;
-				}
+			memset(vc_tickbuf, 0, count*sizeof(SLONG));
+			converted=0;
 
-				if(!vnf->frq) vnf->active = 0;
-
-				if(vnf->active) {
-					vnf->increment=((SLONGLONG)(vnf->frq<<FRACBITS))/md_mixfreq;
-					if(vnf->flags&SF_REVERSE) vnf->increment=-vnf->increment;
-					vol = vnf->vol;  pan = vnf->pan;
-
-					vnf->oldlvol=vnf->lvolsel;vnf->oldrvol=vnf->rvolsel;
-					if(vc_mode & DMODE_STEREO) {
-						if(pan != PAN_SURROUND) {
-							vnf->lvolsel=(vol*(PAN_RIGHT-pan))>>8;
-							vnf->rvolsel=(vol*pan)>>8;
-						} else
-							vnf->lvolsel=vnf->rvolsel=vol/2;
-					} else
-						vnf->lvolsel=vol;
-
-					idxsize = (vnf->size)? ((SLONGLONG)vnf->size << FRACBITS)-1 : 0;
-					idxlend = (vnf->repend)? ((SLONGLONG)vnf->repend << FRACBITS)-1 : 0;
-					idxlpos = (SLONGLONG)vnf->reppos << FRACBITS;
-					AddChannel(vc_tickbuf, portion);
-				}
+#ifdef HAVE_PTHREAD
+			if(vc_nthreads>1)
+				MixThreaded(portion,count);
+			else
+#endif
+			{
+				/* last voice to mix converts the output (no reverb pass) */
+				last=-1;
+				if((vc_mode & DMODE_16BITS)&&!md_reverb)
+					for(t=vc_softchn-1;t>=0;t--)
+						if(vinf[t].frq&&(vinf[t].kick||vinf[t].active)) {
+							last=t;
+							break;
+						}
+
+				for(t=0;t<vc_softchn;t++)
+					converted+=MixVoice(&vinf[t], vc_tickbuf, portion,
+					                    (t==last)?(SWORD*)buffer:NULL);
 			}
 
 			if(md_reverb) {
@@ -823,9 +1246,12 @@ void VC1_WriteSamples(SBYTE* buf,ULONG todo)
 				MixReverb(vc_tickbuf, portion);
 			}
 
-			if(vc_mode & DMODE_16BITS)
-				Mix32To16((SWORD*) buffer, vc_tickbuf, count);
-			else
+			if(vc_mode & DMODE_16BITS) {
+				/* convert what the last voice did not */
+				if(vc_mode & DMODE_STEREO) converted<<=1;
+				Mix32To16((SWORD*) buffer + converted, vc_tickbuf + converted,
+				          count - converted);
+			} else
 				Mix32To8((SBYTE*) buffer, vc_tickbuf, count);
 
 			buffer += samples2bytes(portion);
@@ -890,11 +1316,17 @@ BOOL VC1_PlayStart(void)
 	if(!(RVbufR8=(SLONG*)_mm_calloc((RVc8+1),sizeof(SLONG)))) return 1;
 
 	RVRindex = 0;
+#ifdef HAVE_PTHREAD
+	VC_StartWorkers(md_mixthreads);
+#endif
 	return 0;
 }
 
 void VC1_PlayStop(void)
 {
+#ifdef HAVE_PTHREAD
+	VC_StopWorkers();
+#endif
 	if(RVbufL1) free(RVbufL1);
 	if(RVbufL2) free(RVbufL2);
 	if(RVbufL3) free(RVbufL3);
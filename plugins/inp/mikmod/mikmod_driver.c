@@ -41,6 +41,23 @@ typedef struct DCMLOADER_S {
 /* defined in drv_dcplaya.c */
 extern volatile int dcmikmod_status;
 
+/* $$$ ben: Get this form mikmod_internals.h too. */
+extern void Player_HandleTick(void);
+
+/* Seek keyframe : player state just before first entering a song
+   position, so that playing can restart from there. */
+typedef struct {
+  ULONG time;          /* song time in 2^-10 seconds (0 : unknown) */
+  UWORD remainder;
+  UWORD row;           /* entry row (pattern break) */
+  UWORD sngspd;
+  UWORD bpm;
+  SWORD volume;
+} keyframe_t;
+
+static keyframe_t * keyframes;
+static int keyframes_size;
+
 static int disk_info(playa_info_t *info, MODULE * mod);
 
 /* $$$ ben: for load_it.c */
@@ -134,11 +151,14 @@ static int init(any_driver_t *d)
 
   usedpos = 0;
   usedpos_size = 0;
+  keyframes = 0;
+  keyframes_size = 0;
   SDDEBUG("Init\n");
   if (err = MikMod_Init(0), err) {
     SDERROR("failed : [%s]\n", MikMod_strerror(MikMod_errno));
     goto error;
   }
+  MikMod_RegisterPlayer(player_tick);
 
  error:
   if (err) {
@@ -150,6 +170,35 @@ static int init(any_driver_t *d)
   return err;
 }
 
+/* Player tick : records keyframes while playing or seeking. */
+static void player_tick(void)
+{
+  MODULE * mod = Player_GetModule();
+  keyframe_t kf;
+  int pos;
+
+  if (!mod) {
+    Player_HandleTick();
+    return;
+  }
+  pos = mod->sngpos;
+  kf.time = mod->sngtime;
+  kf.remainder = mod->sngremainder;
+  kf.sngspd = mod->sngspd;
+  kf.bpm = mod->bpm;
+  kf.volume = mod->volume;
+
+  Player_HandleTick();
+
+  if (mod->sngpos != pos && mod->sngpos >= 0
+      && mod->sngpos < keyframes_size && !keyframes[mod->sngpos].time) {
+    kf.row = mod->patpos;
+    /* Time 0 is the unknown mark, position 0 is always known. */
+    kf.time += !kf.time;
+    keyframes[mod->sngpos] = kf;
+  }
+}
+
 static int stop(void)
 {
   int err = 0;
@@ -160,6 +209,7 @@ static int stop(void)
   SDDEBUG("Player free\n");
   Player_Free(Player_GetModule());
   prev_pos = -1;
+  keyframes_size = 0;
   
   SDUNINDENT;
   SDDEBUG("<< %s() := [%d]\n", __FUNCTION__ , err);
@@ -179,6 +229,8 @@ static int shutdown(any_driver_t *d)
     free(usedpos);
     usedpos_size = 0;
   }
+  free(keyframes);
+  keyframes = 0;
 
   SDUNINDENT;
   SDDEBUG("<< %s(%s) := [%d]\n", __FUNCTION__, d->name, err);
@@ -246,6 +298,9 @@ static int start(const char *fn, int track, playa_info_t *info)
     if (usedpos) {
       memset(usedpos,0,usedpos_size);
     }
+    free(keyframes);
+    keyframes = calloc(mod->numpos, sizeof(*keyframes));
+    keyframes_size = keyframes ? mod->numpos : 0;
     err = 0;
   }
   disk_info(info,mod);
@@ -293,6 +348,51 @@ static int decoder(playa_info_t *info)
   return status;
 }
 
+/* Seek : restart from the latest keyframe before ms, or from the start,
+   then run player ticks without mixing up to ms. Going forward past
+   known positions records their keyframes. */
+static int seek(unsigned int ms, playa_info_t *info)
+{
+  MODULE * mod = Player_GetModule();
+  ULONG target = ((unsigned long long)ms << 10) / 1000;
+  keyframe_t * best = 0;
+  int i, best_pos = 0;
+
+  if (!mod) {
+    return -1;
+  }
+  for (i=0; i<keyframes_size; ++i) {
+    keyframe_t * kf = keyframes + i;
+    if (kf->time && kf->time <= target && (!best || kf->time > best->time)) {
+      best = kf;
+      best_pos = i;
+    }
+  }
+
+  Player_SetPosition(best_pos);
+  if (best) {
+    mod->sngtime = best->time;
+    mod->sngremainder = best->remainder;
+    mod->sngspd = best->sngspd;
+    mod->vbtick = best->sngspd;
+    mod->bpm = best->bpm;
+    mod->volume = best->volume;
+    mod->patbrk = best->row;
+  }
+  while (Player_Active() && mod->sngtime < target) {
+    player_tick();
+  }
+
+  /* Positions before ms are not a loop. */
+  prev_pos = -1;
+  if (usedpos) {
+    memset(usedpos,0,usedpos_size);
+  }
+  SDDEBUG("mikmod : seek %ums -> position %d row %d (from %d)\n",
+	  ms, mod->sngpos, mod->patpos, best_pos);
+  return Player_Active() ? 0 : -1;
+}
+
 static driver_option_t * options(any_driver_t * d, int idx,
 				 driver_option_t * o)
 {
@@ -458,6 +558,7 @@ inp_driver_t mikmod_driver =
   stop,
   decoder,
   info,
+  seek,
 };
 
 EXPORT_DRIVER(mikmod_driver)
@@ -0,0 +1,380 @@
+/* aputest : NES APU renderer tests and realtime factor (host tool).
+ *
+ * by benjamin gerard <ben@sashipa.com>
+ *
+ * Usage: `aputest [seconds]'
+ *
+ * The APU is driven by random register writes at random cycles of each
+ * 60Hz frame (rectangles, sweeps, triangle, noise, DMC, DAC, channel
+ * enables).
+ *
+ * - The block renderer of apu_process() must give the same output as
+ *   the per-sample loop it replaces (copied below), for each filter and
+ *   for 8 and 16 bit output.
+ * - The checksums of these outputs must match the ones recorded with
+ *   the previous nes_apu.c (per-sample loop only, each run in a new
+ *   process : its noise shift register was shared by all the APUs).
+ * - The realtime factor of the per-sample loop, the block renderer and
+ *   the band-limited mode (apu_setbandlimit()) is printed.
+ * - A 50% rectangle is rendered at a few pitches, with and without
+ *   band-limited edges. The power that is not on a harmonic of the tone
+ *   (aliasing) is measured; band-limited edges must lower it by 10dB at
+ *   least.
+ *
+ * Returns 0 if all checks pass.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+
+#include "nes_apu.c"
+
+#define  SAMPLE_RATE    44100
+#define  REFRESH_RATE   60
+#define  FRAME_CYCLES   29830 /* NTSC cycles per 60Hz frame */
+#define  FRAME_SAMPLES  (SAMPLE_RATE / REFRESH_RATE)
+#define  DEF_SECONDS    60
+
+/* 6502 emulation used by the APU : only the cycle counter. */
+static uint32 cpu_cycles;
+
+uint32 nes6502_getcycles(boolean reset_flag)
+{
+   return cpu_cycles;
+}
+
+void nes6502_irq(void)
+{
+}
+
+void nes6502_setdma(int cycles)
+{
+}
+
+uint8 nes6502_getbyte(uint32 address)
+{
+   /* DMC sample data */
+   return (address * 2654435761u) >> 24;
+}
+
+static uint32 seed;
+
+static uint32 rnd(void)
+{
+   seed = seed * 1103515245 + 12345;
+   return seed >> 16;
+}
+
+static void write_at(uint32 cycle, uint32 address, uint8 value)
+{
+   cpu_cycles = cycle;
+   apu_write(address, value);
+}
+
+/* Random register writes during the frame starting at base. */
+static void song_frame(uint32 base)
+{
+   int k, n = rnd() % 12;
+
+   for (k = 0; k < n; k++)
+   {
+      uint32 t = base + rnd() % FRAME_CYCLES;
+      uint32 a;
+
+      switch (rnd() % 10)
+      {
+      case 0: case 1:
+         a = 0x4000 + 4 * (rnd() & 1);
+         write_at(t, a, rnd());
+         write_at(t + 10, a + 1, (rnd() & 1) ? rnd() : 0);
+         write_at(t + 20, a + 2, rnd());
+         write_at(t + 30, a + 3, rnd());
+         break;
+      case 2:
+         write_at(t, 0x4000 + 4 * (rnd() & 1), rnd());
+         break;
+      case 3:
+         write_at(t, 0x4008, rnd());
+         write_at(t + 10, 0x400A, rnd());
+         write_at(t + 20, 0x400B, rnd());
+         break;
+      case 4:
+         write_at(t, 0x400C, rnd());
+         write_at(t + 10, 0x400E, rnd());
+         write_at(t + 20, 0x400F, rnd());
+         break;
+      case 5:
+         write_at(t, 0x4011, rnd() & 0x7F);
+         break;
+      case 6:
+         write_at(t, 0x4010, rnd() & 0x4F);
+         write_at(t + 10, 0x4012, rnd());
+         write_at(t + 20, 0x4013, rnd() & 15);
+         write_at(t + 30, 0x4015, 0x1F);
+         break;
+      case 7:
+         write_at(t, 0x4015, (rnd() & 0x1F) | 0x0F);
+         break;
+      default:
+         write_at(t, 0x4002 + 4 * (rnd() & 1), rnd());
+         break;
+      }
+   }
+}
+
+/* Previous apu_process() : one sample at a time (reference). */
+static void apu_process_ref(void *buffer, int num_samples)
+{
+   apudata_t *d;
+   uint32 elapsed_cycles;
+   static int32 prev_sample = 0;
+   int32 next_sample, accum;
+   int16 *buf16 = (int16 *) buffer;
+   uint8 *buf8 = (uint8 *) buffer;
+
+   ASSERT(apu);
+
+   /* grab it, keep it local for speed */
+   elapsed_cycles = (uint32) apu->elapsed_cycles;
+
+   /* BLEH */
+   apu->buffer = buffer;
+
+   while (num_samples--)
+   {
+      while ((FALSE == APU_QEMPTY()) && (apu->queue[apu->q_tail].timestamp <= elapsed_cycles))
+      {
+         d = apu_dequeue();
+         apu_regwrite(d->address, d->value);
+      }
+
+      elapsed_cycles += APU_FROM_FIXED(apu->cycle_rate);
+
+      accum = 0;
+      if (APU_MIX_ENABLE(0)) accum += apu_rectangle(&apu->rectangle[0]);
+      if (APU_MIX_ENABLE(1)) accum += apu_rectangle(&apu->rectangle[1]);
+      if (APU_MIX_ENABLE(2)) accum += apu_triangle(&apu->triangle);
+      if (APU_MIX_ENABLE(3)) accum += apu_noise(&apu->noise);
+      if (APU_MIX_ENABLE(4)) accum += apu_dmc(&apu->dmc);
+
+      if (apu->ext && APU_MIX_ENABLE(5)) accum += apu->ext->process();
+
+      /* do any filtering */
+      if (APU_FILTER_NONE != apu->filter_type)
+      {
+         next_sample = accum;
+
+         if (APU_FILTER_LOWPASS == apu->filter_type)
+         {
+            accum += prev_sample;
+            accum >>= 1;
+         }
+         else
+            accum = (accum + accum + accum + prev_sample) >> 2;
+
+         prev_sample = next_sample;
+      }
+
+      /* little extra kick for the kids */
+      accum <<= 1;
+
+      /* prevent clipping */
+      if (accum > 0x7FFF)
+         accum = 0x7FFF;
+      else if (accum < -0x8000)
+         accum = -0x8000;
+
+      /* signed 16-bit output, unsigned 8-bit */
+      if (16 == apu->sample_bits)
+         *buf16++ = (int16) accum;
+      else
+         *buf8++ = (accum >> 8) ^ 0x80;
+   }
+
+   /* resync cycle counter */
+   apu->elapsed_cycles = nes6502_getcycles(FALSE);
+}
+
+typedef struct
+{
+   int ref;          /* per-sample loop */
+   int bits;         /* 8 or 16 */
+   int filter;       /* APU_FILTER_xxx */
+   int bandlimit;
+} run_t;
+
+/* Plays seconds of random writes. Returns output checksum, time in *sec. */
+static uint32 render(const run_t *r, int seconds, double *sec)
+{
+   static int16 buf[FRAME_SAMPLES];
+   int frames = seconds * REFRESH_RATE;
+   int bytes = FRAME_SAMPLES * r->bits / 8;
+   uint32 sum = 0, base = 0;
+   clock_t t = 0, t0;
+   apu_t *p;
+   int f, i;
+
+   /* The filter keeps its last input in a static : start from the first
+   ** sample of a new APU, whatever ran before.
+   */
+   cpu_cycles = 0;
+   p = apu_create(SAMPLE_RATE, REFRESH_RATE, r->bits, FALSE);
+   if (NULL == p)
+   {
+      fprintf(stderr, "aputest : apu_create failed\n");
+      exit(2);
+   }
+   apu_setfilter(APU_FILTER_LOWPASS);
+   if (r->ref)
+      apu_process_ref(buf, 1);
+   else
+      apu_process(buf, 1);
+   apu_destroy(p);
+
+   p = apu_create(SAMPLE_RATE, REFRESH_RATE, r->bits, FALSE);
+   apu_setfilter(r->filter);
+   apu_setbandlimit(r->bandlimit);
+
+   seed = 12345;
+   for (f = 0; f < frames; f++)
+   {
+      song_frame(base);
+      base += FRAME_CYCLES;
+      t0 = clock();
+      if (r->ref)
+         apu_process_ref(buf, FRAME_SAMPLES);
+      else
+         apu_process(buf, FRAME_SAMPLES);
+      t += clock() - t0;
+      cpu_cycles = base;
+      for (i = 0; i < bytes; i++)
+         sum = sum * 31 + ((uint8 *) buf)[i];
+   }
+   apu_destroy(p);
+   *sec = (double) t / CLOCKS_PER_SEC;
+   return sum;
+}
+
+static int failed;
+
+static void report(const char *name, const run_t *r, int seconds,
+                   double sec, uint32 sum, int ok)
+{
+   static const char *filters[] = { "none", "lowpass", "weighted" };
+
+   printf("  %-10s %2d bit  filter %-8s  x%5.0f  %08x %s\n",
+          name, r->bits, filters[r->filter], seconds / (sec > 0 ? sec : 1e-9),
+          (unsigned int) sum, ok ? "" : "DIFFERS");
+   failed |= !ok;
+}
+
+/* Power of a 50% rectangle off its harmonics over all the power (dB). */
+static double inharmonic_power(int period, int bandlimit)
+{
+   enum { N = 8192, SKIP = 15 };
+   static int16 buf[FRAME_SAMPLES];
+   static double x[N];
+   double f0 = APU_BASEFREQ / 16 / (period + 1), inharm = 0, all = 0;
+   apu_t *p;
+   int f, i, k, pos = 0;
+
+   cpu_cycles = 0;
+   p = apu_create(SAMPLE_RATE, REFRESH_RATE, 16, FALSE);
+   apu_setfilter(APU_FILTER_NONE);
+   apu_setbandlimit(bandlimit);
+   write_at(0, 0x4015, 0x01);
+   write_at(0, 0x4000, 0xB0 | 15); /* 50%, hold, fixed volume 15 */
+   write_at(0, 0x4001, 0);
+   write_at(0, 0x4002, period & 0xFF);
+   write_at(0, 0x4003, (period >> 8) & 7);
+
+   /* skip the start, then take N samples */
+   for (f = 0; pos < N; f++)
+   {
+      apu_process(buf, FRAME_SAMPLES);
+      cpu_cycles += FRAME_CYCLES;
+      for (i = 0; i < FRAME_SAMPLES && f >= SKIP && pos < N; i++)
+         x[pos++] = buf[i];
+   }
+   apu_destroy(p);
+
+   /* Hann window, DFT bins above 100Hz */
+   for (k = 20; k < N / 2; k++)
+   {
+      double re = 0, im = 0, fk = (double) k * SAMPLE_RATE / N, pw;
+      int h = (int) (fk / f0 + 0.5);
+
+      for (i = 0; i < N; i++)
+      {
+         double w = (0.5 - 0.5 * cos(2 * M_PI * i / N)) * x[i];
+         re += w * cos(2 * M_PI * k * i / N);
+         im += w * sin(2 * M_PI * k * i / N);
+      }
+      pw = re * re + im * im;
+      all += pw;
+      if (fabs(fk - h * f0) * N / SAMPLE_RATE > 3)
+         inharm += pw;
+   }
+   return 10 * log10(inharm / all);
+}
+
+int main(int argc, char *argv[])
+{
+   /* checksums of DEF_SECONDS with the previous nes_apu.c, by filter */
+   static const uint32 golden[2][3] =
+   {
+      /* 8 bit  */ { 0x8c85f50f, 0xd10d98c4, 0xb4c2e8bb },
+      /* 16 bit */ { 0xf7c69ba8, 0x74ece853, 0x25bfd9a3 },
+   };
+   static const int periods[] = { 30, 100, 200, 600 };
+   int seconds = (argc > 1) ? atoi(argv[1]) : DEF_SECONDS;
+   run_t r;
+   uint32 sum, ref_sum;
+   double sec, ref_sec;
+   int i;
+
+   if (seconds <= 0)
+   {
+      fprintf(stderr, "Usage: aputest [seconds]\n");
+      return 1;
+   }
+
+   printf("aputest : %d s per run, realtime factor, output checksum\n",
+          seconds);
+   for (r.bits = 8; r.bits <= 16; r.bits += 8)
+   {
+      for (r.filter = APU_FILTER_NONE; r.filter <= APU_FILTER_WEIGHTED;
+           r.filter++)
+      {
+         r.bandlimit = 0;
+         r.ref = 1;
+         ref_sum = render(&r, seconds, &ref_sec);
+         report("per-sample", &r, seconds, ref_sec, ref_sum,
+                seconds != DEF_SECONDS
+                || ref_sum == golden[r.bits / 16][r.filter]);
+         r.ref = 0;
+         sum = render(&r, seconds, &sec);
+         report("block", &r, seconds, sec, sum, sum == ref_sum);
+         r.bandlimit = 1;
+         sum = render(&r, seconds, &sec);
+         report("bandlimit", &r, seconds, sec, sum, TRUE);
+      }
+   }
+
+   printf("50%% rectangle, inharmonic power\n");
+   for (i = 0; i < sizeof(periods) / sizeof(periods[0]); i++)
+   {
+      double plain = inharmonic_power(periods[i], 0);
+      double bl = inharmonic_power(periods[i], 1);
+      int ok = (bl <= plain - 10);
+
+      printf("  %6.0f Hz  %6.1f dB  band-limited %6.1f dB %s\n",
+             APU_BASEFREQ / 16 / (periods[i] + 1), plain, bl,
+             ok ? "" : "NOT LOWER");
+      failed |= !ok;
+   }
+   return failed;
+}
@@ -978,6 +978,64 @@ int nsf_playtrack(nsf_t *nsf, int track, int sample_rate, int sample_bits,
   return nsf->current_song;
 }
 
+/* $$$ ben : state snapshot, taken between two frames. RAM, player page
+ * and WRAM are saved, ROM pages are just pointers in the CPU context.
+ */
+typedef struct
+{
+   nes6502_context cpu;
+   apu_state_t apu;
+   uint32 cur_frame;
+   uint8 ram[0x800];
+   uint8 wram[3][0x1000];
+} nsf_state_t;
+
+int nsf_state_size(nsf_t *nsf)
+{
+   /* external sound chips keep their state in their own modules */
+   if (!nsf || !nsf->apu || EXT_SOUND_NONE != nsf->ext_sound_type)
+      return 0;
+   return sizeof(nsf_state_t);
+}
+
+int nsf_savestate(nsf_t *nsf, void *buffer)
+{
+   nsf_state_t *state = buffer;
+   int i;
+
+   if (!nsf_state_size(nsf))
+      return -1;
+
+   nsf_setcontext(nsf);
+   if (apu_savestate(&state->apu) < 0)
+      return -1;
+   nes6502_getcontext(&state->cpu);
+   state->cur_frame = nsf->cur_frame;
+   memcpy(state->ram, state->cpu.mem_page[0], 0x800);
+   for (i = 0; i < 3; i++)
+      memcpy(state->wram[i], state->cpu.mem_page[5 + i], 0x1000);
+   return 0;
+}
+
+int nsf_loadstate(nsf_t *nsf, const void *buffer)
+{
+   const nsf_state_t *state = buffer;
+   int i;
+
+   if (!nsf_state_size(nsf))
+      return -1;
+
+   nsf_setcontext(nsf);
+   *nsf->cpu = state->cpu;
+   nes6502_setcontext(nsf->cpu);
+   memcpy(nsf->cpu->mem_page[0], state->ram, 0x800);
+   for (i = 0; i < 3; i++)
+      memcpy(nsf->cpu->mem_page[5 + i], state->wram[i], 0x1000);
+   nsf->cur_frame = state->cur_frame;
+   apu_loadstate(&state->apu);
+   return 0;
+}
+
 int nsf_setfilter(nsf_t *nsf, int filter_type)
 {
   if (!nsf) {
@@ -987,6 +1045,16 @@ int nsf_setfilter(nsf_t *nsf, int filter_type)
   return apu_setfilter(filter_type);
 }
 
+/* $$$ ben : band-limited rectangles and noise (-1 : get). */
+int nsf_setbandlimit(nsf_t *nsf, int bandlimit)
+{
+  if (!nsf) {
+    return -1;
+  }
+  nsf_setcontext(nsf);
+  return apu_setbandlimit(bandlimit);
+}
+
 /*
 ** $Log$
 ** Revision 1.3  2003/05/01 22:34:20  benjihan
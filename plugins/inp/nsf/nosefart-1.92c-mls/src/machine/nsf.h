@@ -143,6 +143,14 @@ extern int nsf_playtrack(nsf_t *nsf, int track, int sample_rate,
 extern void nsf_frame(nsf_t *nsf);
 extern int nsf_setchan(nsf_t *nsf, int chan, boolean enabled);
 extern int nsf_setfilter(nsf_t *nsf, int filter_type);
+extern int nsf_setbandlimit(nsf_t *nsf, int bandlimit);
+
+/* $$$ ben : state snapshots for seeking. nsf_state_size() returns 0 if
+ * the tune can not be saved (external sound chip).
+ */
+extern int nsf_state_size(nsf_t *nsf);
+extern int nsf_savestate(nsf_t *nsf, void *buffer);
+extern int nsf_loadstate(nsf_t *nsf, const void *buffer);
 
 #endif /* _NSF_H_ */
 
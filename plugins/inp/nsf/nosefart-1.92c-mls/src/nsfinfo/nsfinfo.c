@@ -29,6 +29,7 @@
 #include "types.h"
 #include "nsf.h"
 #include "config.h"
+#include "md5.h"
 
 static int quiet = 0;
 
@@ -69,6 +70,7 @@ static void show_help(void)
 	  " --Ts       : Display current track time (in seconds)\n"
 	  " --Tx       : Display current track time (formatted)\n"
 	  " --AT       : Launch auto time calculation.\n"
+	  " --L        : Display song length database entry (all tracks)\n"
 	  " STRING     : Display STRING.\n"
 	  "\n"
 	  "track-list  : --track[[,track]|[-track]]\n"
@@ -315,6 +317,30 @@ static unsigned int nsf_calc_time(nsf_t * src,
 }
 
 
+/* Display all tracks times as a song length database line :
+ * "md5=m:ss.mmm m:ss.mmm ...". Unknown times are 0:00.
+ */
+static void show_length_entry(nsf_t * nsf, int len,
+			      const unsigned char * digest,
+			      unsigned int * times)
+{
+  char str[MD5_SIZE*2+1];
+  unsigned int frame_rate = nsf_playback_rate(nsf);
+  int track;
+
+  printf("%s=", md5_str(str, digest));
+  for (track=1; track<=nsf->num_songs; ++track) {
+    unsigned int ms;
+
+    if (!times[track]) {
+      times[track] = nsf_calc_time(nsf, len, track, 0, 0);
+    }
+    ms = (unsigned int)((unsigned long long)times[track] * 1000u / frame_rate);
+    printf("%s%u:%02u.%03u", (track > 1) ? " " : "",
+	   ms / 60000u, ms / 1000u % 60u, ms % 1000u);
+  }
+}
+
 static char * clean_string(char *d, const char *s, int max)
 {
   int i;
@@ -435,6 +461,7 @@ int main(int na, char **a)
   char *trackList, *trackListBase;
 
   static unsigned int times[256];
+  unsigned char digest[MD5_SIZE];
 
   /* First loop search for --help, --warranty ,--quiet */
   for (i=1; i<na; ++i) {
@@ -512,6 +539,9 @@ int main(int na, char **a)
   }
   msg("Successfully loaded [%s].\n", iname);
 
+  /* Digest the file as is, before any header change. */
+  md5_sum(buffer, len, digest);
+
   nsf = (nsf_t *)buffer;
   cursong = nsf->start_song % (nsf->num_songs+1);
   clean_string(nsf->song_name, nsf->song_name, sizeof(nsf->song_name));
@@ -592,6 +622,8 @@ int main(int na, char **a)
 	times[cursong] = nf;
       }
 
+    } else if (!strcmp(arg,"--L")) {
+      show_length_entry(nsf, len, digest, times);
     } else if (!strcmp(arg,"--V")) {
       /* Print spec version. */
       printf("%d", nsf->version);
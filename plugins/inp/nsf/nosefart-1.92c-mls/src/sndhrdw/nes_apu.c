@@ -174,16 +174,18 @@ int apu_setchan(int chan, boolean enabled)
 ** for the white noise channel
 */
 #ifdef REALTIME_NOISE
-INLINE int8 shift_register15(uint8 xor_tap)
+/* $$$ ben : the register is in the channel (reset, snapshots). */
+INLINE int8 shift_register15(noise_t *chan)
 {
-   static int sreg = 0x4000;
+   int sreg = chan->sreg;
    int bit0, tap, bit14;
 
    bit0 = sreg & 1;
-   tap = (sreg & xor_tap) ? 1 : 0;
+   tap = (sreg & chan->xor_tap) ? 1 : 0;
    bit14 = (bit0 ^ tap);
    sreg >>= 1;
    sreg |= (bit14 << 14);
+   chan->sreg = sreg;
    return (bit0 ^ 1);
 }
 #else
@@ -227,19 +229,14 @@ static void shift_register15(int8 *buf, int count)
 ** reg3: 0-2=high freq, 7-4=vbl length counter
 */
 #define  APU_RECTANGLE_OUTPUT chan->output_vol
-static int32 apu_rectangle(rectangle_t *chan)
-{
-   int32 output;
-
-#ifdef APU_OVERSAMPLE
-   int num_times;
-   int32 total;
-#endif
-
-   APU_VOLUME_DECAY(chan->output_vol);
 
+/* $$$ ben : length counter, envelope and sweep for one sample.
+** Returns FALSE when the tone does not run.
+*/
+INLINE boolean apu_rectangle_clock(rectangle_t *chan)
+{
    if (FALSE == chan->enabled || 0 == chan->vbl_length)
-      return APU_RECTANGLE_OUTPUT;
+      return FALSE;
 
    /* vbl length counter */
    if (FALSE == chan->holdnote)
@@ -259,7 +256,7 @@ static int32 apu_rectangle(rectangle_t *chan)
 
    if ((FALSE == chan->sweep_inc && chan->freq > chan->freq_limit)
        || chan->freq < APU_TO_FIXED(4))
-      return APU_RECTANGLE_OUTPUT;
+      return FALSE;
 
    /* frequency sweeping at a rate of (sweep_delay + 1) / 120 secs */
    if (chan->sweep_on && chan->sweep_shifts)
@@ -274,6 +271,22 @@ static int32 apu_rectangle(rectangle_t *chan)
             chan->freq += chan->freq >> (chan->sweep_shifts);
       }
    }
+   return TRUE;
+}
+
+INLINE int32 apu_rectangle(rectangle_t *chan)
+{
+   int32 output;
+
+#ifdef APU_OVERSAMPLE
+   int num_times;
+   int32 total;
+#endif
+
+   APU_VOLUME_DECAY(chan->output_vol);
+
+   if (FALSE == apu_rectangle_clock(chan))
+      return APU_RECTANGLE_OUTPUT;
 
    chan->phaseacc -= apu->cycle_rate; /* # of cycles per sample */
    if (chan->phaseacc >= 0)
@@ -327,7 +340,7 @@ static int32 apu_rectangle(rectangle_t *chan)
 ** reg3: 7-3=length counter, 2-0=high 3 bits of frequency
 */
 #define  APU_TRIANGLE_OUTPUT  (chan->output_vol + (chan->output_vol >> 2))
-static int32 apu_triangle(triangle_t *chan)
+INLINE int32 apu_triangle(triangle_t *chan)
 {
    APU_VOLUME_DECAY(chan->output_vol);
 
@@ -382,23 +395,13 @@ static int32 apu_triangle(triangle_t *chan)
 */
 #define  APU_NOISE_OUTPUT  ((chan->output_vol + chan->output_vol + chan->output_vol) >> 2)
 
-static int32 apu_noise(noise_t *chan)
+/* $$$ ben : length counter and envelope for one sample.
+** Returns FALSE when the noise does not run.
+*/
+INLINE boolean apu_noise_clock(noise_t *chan)
 {
-   int32 outvol;
-
-#if defined(APU_OVERSAMPLE) && defined(REALTIME_NOISE)
-#else
-   int32 noise_bit;
-#endif
-#ifdef APU_OVERSAMPLE
-   int num_times;
-   int32 total;
-#endif
-
-   APU_VOLUME_DECAY(chan->output_vol);
-
    if (FALSE == chan->enabled || 0 == chan->vbl_length)
-      return APU_NOISE_OUTPUT;
+      return FALSE;
 
    /* vbl length counter */
    if (FALSE == chan->holdnote)
@@ -415,6 +418,26 @@ static int32 apu_noise(noise_t *chan)
       else if (chan->env_vol < 0x0F)
          chan->env_vol++;
    }
+   return TRUE;
+}
+
+INLINE int32 apu_noise(noise_t *chan)
+{
+   int32 outvol;
+
+#if defined(APU_OVERSAMPLE) && defined(REALTIME_NOISE)
+#else
+   int32 noise_bit;
+#endif
+#ifdef APU_OVERSAMPLE
+   int num_times;
+   int32 total;
+#endif
+
+   APU_VOLUME_DECAY(chan->output_vol);
+
+   if (FALSE == apu_noise_clock(chan))
+      return APU_NOISE_OUTPUT;
 
    chan->phaseacc -= apu->cycle_rate; /* # of cycles per sample */
    if (chan->phaseacc >= 0)
@@ -436,14 +459,14 @@ static int32 apu_noise(noise_t *chan)
 #ifdef REALTIME_NOISE
 
 #ifdef APU_OVERSAMPLE
-      if (shift_register15(chan->xor_tap))
+      if (shift_register15(chan))
          total += outvol;
       else
          total -= outvol;
 
       num_times++;
 #else
-      noise_bit = shift_register15(chan->xor_tap);
+      noise_bit = shift_register15(chan);
 #endif
 
 #else
@@ -606,6 +629,174 @@ static int32 apu_dmc(dmc_t *chan)
 }
 
 
+/* $$$ ben : band-limited edges (polyBLEP).
+** An edge of height h at d samples (0 < d <= 1) before the current
+** sample is smoothed on the previous and the current sample : the
+** previous one gets h*d^2/2 and the current one -h*(1-d)^2/2. The
+** band-limited channels are delayed by one sample (bl_prev) so the
+** previous sample can still be corrected. phaseacc is the (negative)
+** phase accumulator of the step, which is -d in cycles.
+*/
+INLINE void apu_bledge(int32 h, int32 phaseacc, int32 *before, int32 *after)
+{
+   int32 d = ((-phaseacc >> 8) * apu->bl_mul) >> 15; /* 1.15 */
+   int32 e = 32768 - d;
+
+   *before += (h * ((d * d) >> 15)) >> 16;
+   *after -= (h * ((e * e) >> 15)) >> 16;
+}
+
+/* $$$ ben : band-limited rectangle. The output switches at the duty
+** cycle edges instead of being averaged over the sample.
+*/
+INLINE int32 apu_rectangle_bl(rectangle_t *chan, int32 *before, int32 *after)
+{
+   int32 output, v;
+
+   APU_VOLUME_DECAY(chan->output_vol);
+
+   if (FALSE == apu_rectangle_clock(chan))
+      return APU_RECTANGLE_OUTPUT;
+
+   chan->phaseacc -= apu->cycle_rate; /* # of cycles per sample */
+   if (chan->phaseacc >= 0)
+      return APU_RECTANGLE_OUTPUT;
+
+   if (chan->fixed_envelope)
+      output = chan->volume << 8; /* fixed volume */
+   else
+      output = (chan->env_vol ^ 0x0F) << 8;
+
+   while (chan->phaseacc < 0)
+   {
+      chan->adder = (chan->adder + 1) & 0x0F;
+      if (0 == chan->adder || chan->adder == chan->duty_flip)
+      {
+         v = chan->adder ? -output : output;
+         apu_bledge(v - chan->output_vol, chan->phaseacc, before, after);
+         chan->output_vol = v;
+      }
+      chan->phaseacc += chan->freq;
+   }
+
+   return APU_RECTANGLE_OUTPUT;
+}
+
+#ifdef REALTIME_NOISE
+/* $$$ ben : band-limited noise. Edges are in output_vol units, they
+** are scaled as APU_NOISE_OUTPUT by the caller.
+*/
+INLINE int32 apu_noise_bl(noise_t *chan, int32 *before, int32 *after)
+{
+   int32 outvol, v;
+
+   APU_VOLUME_DECAY(chan->output_vol);
+
+   if (FALSE == apu_noise_clock(chan))
+      return APU_NOISE_OUTPUT;
+
+   chan->phaseacc -= apu->cycle_rate; /* # of cycles per sample */
+   if (chan->phaseacc >= 0)
+      return APU_NOISE_OUTPUT;
+
+   if (chan->fixed_envelope)
+      outvol = chan->volume << 8; /* fixed volume */
+   else
+      outvol = (chan->env_vol ^ 0x0F) << 8;
+
+   while (chan->phaseacc < 0)
+   {
+      v = shift_register15(chan) ? outvol : -outvol;
+      if (v != chan->output_vol)
+      {
+         apu_bledge(v - chan->output_vol, chan->phaseacc, before, after);
+         chan->output_vol = v;
+      }
+      chan->phaseacc += chan->freq;
+   }
+
+   return APU_NOISE_OUTPUT;
+}
+#endif /* REALTIME_NOISE */
+
+/* $$$ ben : block rendering.
+** apu_process() cuts the buffer at the register writes. In between,
+** each channel is rendered over the whole segment and added to the
+** mix buffer, then the mix is filtered and converted in one pass.
+*/
+#define  APU_BLOCK  256
+static int32 apu_mix[APU_BLOCK];
+
+static void apu_rectangle_block(rectangle_t *chan, int32 *mix, int n)
+{
+   int32 before, after, v, prev;
+
+   if (apu->bandlimit)
+   {
+      prev = chan->bl_prev;
+      while (n--)
+      {
+         before = after = 0;
+         v = apu_rectangle_bl(chan, &before, &after);
+         *mix++ += prev + before;
+         prev = v + after;
+      }
+      chan->bl_prev = prev;
+   }
+   else if (FALSE == chan->enabled || 0 == chan->vbl_length)
+   {
+      /* silent : only the volume decay */
+      v = chan->output_vol;
+      while (n--)
+      {
+         APU_VOLUME_DECAY(v);
+         *mix++ += v;
+      }
+      chan->output_vol = v;
+   }
+   else
+   {
+      while (n--)
+         *mix++ += apu_rectangle(chan);
+   }
+}
+
+static void apu_triangle_block(triangle_t *chan, int32 *mix, int n)
+{
+   while (n--)
+      *mix++ += apu_triangle(chan);
+}
+
+static void apu_noise_block(noise_t *chan, int32 *mix, int n)
+{
+#ifdef REALTIME_NOISE
+   int32 before, after, v, prev;
+
+   if (apu->bandlimit)
+   {
+      prev = chan->bl_prev;
+      while (n--)
+      {
+         before = after = 0;
+         v = apu_noise_bl(chan, &before, &after);
+         *mix++ += prev + ((before + before + before) >> 2);
+         prev = v + ((after + after + after) >> 2);
+      }
+      chan->bl_prev = prev;
+      return;
+   }
+#endif /* REALTIME_NOISE */
+
+   while (n--)
+      *mix++ += apu_noise(chan);
+}
+
+static void apu_dmc_block(dmc_t *chan, int32 *mix, int n)
+{
+   while (n--)
+      *mix++ += apu_dmc(chan);
+}
+
 static void apu_regwrite(uint32 address, uint8 value)
 {  
    int chan;
@@ -978,8 +1169,12 @@ void apu_process(void *buffer, int num_samples)
 {
    apudata_t *d;
    uint32 elapsed_cycles;
+   const uint32 cycles = APU_FROM_FIXED(apu->cycle_rate);
    static int32 prev_sample = 0;
    int32 next_sample, accum;
+   int16 *buf16 = (int16 *) buffer;
+   uint8 *buf8 = (uint8 *) buffer;
+   int i, n;
 
    ASSERT(apu);
 
@@ -989,7 +1184,7 @@ void apu_process(void *buffer, int num_samples)
    /* BLEH */
    apu->buffer = buffer; 
 
-   while (num_samples--)
+   while (num_samples > 0)
    {
       while ((FALSE == APU_QEMPTY()) && (apu->queue[apu->q_tail].timestamp <= elapsed_cycles))
       {
@@ -997,53 +1192,301 @@ void apu_process(void *buffer, int num_samples)
          apu_regwrite(d->address, d->value);
       }
 
-      elapsed_cycles += APU_FROM_FIXED(apu->cycle_rate);
+      /* render all channels up to the next register write */
+      n = (num_samples < APU_BLOCK) ? num_samples : APU_BLOCK;
+      if (FALSE == APU_QEMPTY())
+      {
+         uint32 k = (apu->queue[apu->q_tail].timestamp - elapsed_cycles
+                     + cycles - 1) / cycles;
+         if (k < (uint32) n)
+            n = k;
+      }
+      elapsed_cycles += n * cycles;
+      num_samples -= n;
 
-      accum = 0;
-      if (APU_MIX_ENABLE(0)) accum += apu_rectangle(&apu->rectangle[0]);
-      if (APU_MIX_ENABLE(1)) accum += apu_rectangle(&apu->rectangle[1]);
-      if (APU_MIX_ENABLE(2)) accum += apu_triangle(&apu->triangle);
-      if (APU_MIX_ENABLE(3)) accum += apu_noise(&apu->noise);
-      if (APU_MIX_ENABLE(4)) accum += apu_dmc(&apu->dmc);
+      memset(apu_mix, 0, n * sizeof(int32));
+      if (APU_MIX_ENABLE(0)) apu_rectangle_block(&apu->rectangle[0], apu_mix, n);
+      if (APU_MIX_ENABLE(1)) apu_rectangle_block(&apu->rectangle[1], apu_mix, n);
+      if (APU_MIX_ENABLE(2)) apu_triangle_block(&apu->triangle, apu_mix, n);
+      if (APU_MIX_ENABLE(3)) apu_noise_block(&apu->noise, apu_mix, n);
+      if (APU_MIX_ENABLE(4)) apu_dmc_block(&apu->dmc, apu_mix, n);
 
-      if (apu->ext && APU_MIX_ENABLE(5)) accum += apu->ext->process();
+      if (apu->ext && APU_MIX_ENABLE(5))
+         for (i = 0; i < n; i++)
+            apu_mix[i] += apu->ext->process();
 
-      /* do any filtering */
-      if (APU_FILTER_NONE != apu->filter_type)
+      for (i = 0; i < n; i++)
       {
-         next_sample = accum;
+         accum = apu_mix[i];
 
-         if (APU_FILTER_LOWPASS == apu->filter_type)
+         /* do any filtering */
+         if (APU_FILTER_NONE != apu->filter_type)
          {
-            accum += prev_sample;
-            accum >>= 1;
+            next_sample = accum;
+
+            if (APU_FILTER_LOWPASS == apu->filter_type)
+            {
+               accum += prev_sample;
+               accum >>= 1;
+            }
+            else
+               accum = (accum + accum + accum + prev_sample) >> 2;
+
+            prev_sample = next_sample;
          }
+
+         /* little extra kick for the kids */
+         accum <<= 1;
+
+         /* prevent clipping */
+         if (accum > 0x7FFF)
+            accum = 0x7FFF;
+         else if (accum < -0x8000)
+            accum = -0x8000;
+
+         /* signed 16-bit output, unsigned 8-bit */
+         if (16 == apu->sample_bits)
+            *buf16++ = (int16) accum;
          else
-            accum = (accum + accum + accum + prev_sample) >> 2;
+            *buf8++ = (accum >> 8) ^ 0x80;
+      }
+   }
+
+   /* resync cycle counter */
+   apu->elapsed_cycles = nes6502_getcycles(FALSE);
+}
+
+/* $$$ ben : fast emulation for seeking.
+** Length counters, envelopes and sweeps are clocked as in apu_process()
+** but no waveform is generated : the phase of the tones is not kept,
+** which can not be heard after a seek. The DMC and the external chip run
+** as usual since they read memory and raise IRQs.
+*/
+static void apu_rectangle_skip(rectangle_t *chan, int n)
+{
+   int k;
+
+   if (FALSE == chan->enabled || 0 == chan->vbl_length)
+      return;
+
+   /* counters stop with the vbl length counter */
+   if (FALSE == chan->holdnote)
+   {
+      if (n > chan->vbl_length)
+         n = chan->vbl_length;
+      chan->vbl_length -= n;
+   }
 
-         prev_sample = next_sample;
+   chan->env_phase -= 4 * n;
+   while (chan->env_phase < 0)
+   {
+      chan->env_phase += chan->env_delay;
+
+      if (chan->holdnote)
+         chan->env_vol = (chan->env_vol + 1) & 0x0F;
+      else if (chan->env_vol < 0x0F)
+         chan->env_vol++;
+   }
+
+   /* sweep step by step : it stops when frequency gets out of range */
+   while (n > 0 && chan->sweep_on && chan->sweep_shifts)
+   {
+      if ((FALSE == chan->sweep_inc && chan->freq > chan->freq_limit)
+          || chan->freq < APU_TO_FIXED(4))
+         break;
+
+      k = (chan->sweep_phase >> 1) + 1; /* samples to next step */
+      if (k > n)
+      {
+         chan->sweep_phase -= 2 * n;
+         break;
       }
+      chan->sweep_phase -= 2 * k;
+      n -= k;
+      while (chan->sweep_phase < 0)
+      {
+         chan->sweep_phase += chan->sweep_delay;
+         if (chan->sweep_inc) /* ramp up */
+            chan->freq -= chan->freq >> (chan->sweep_shifts);
+         else /* ramp down */
+            chan->freq += chan->freq >> (chan->sweep_shifts);
+      }
+   }
+}
 
-      /* little extra kick for the kids */
-      accum <<= 1;
+static void apu_triangle_skip(triangle_t *chan, int n)
+{
+   int k;
 
-      /* prevent clipping */
-      if (accum > 0x7FFF)
-         accum = 0x7FFF;
-      else if (accum < -0x8000)
-         accum = -0x8000;
+   if (FALSE == chan->enabled || 0 == chan->vbl_length)
+      return;
 
-      /* signed 16-bit output, unsigned 8-bit */
-      if (16 == apu->sample_bits)
-         *((int16 *) buffer)++ = (int16) accum;
-      else
-         *((uint8 *) buffer)++ = (accum >> 8) ^ 0x80;
+   if (FALSE == chan->counter_started)
+   {
+      if (chan->holdnote || 0 == chan->write_latency)
+         return;
+      k = (n < chan->write_latency) ? n : chan->write_latency;
+      chan->write_latency -= k;
+      n -= k;
+      if (chan->write_latency)
+         return;
+      chan->counter_started = TRUE;
+   }
+
+   if (FALSE == chan->holdnote && n > chan->vbl_length)
+      n = chan->vbl_length;
+   chan->linear_length = (chan->linear_length > n)
+      ? chan->linear_length - n : 0;
+   if (FALSE == chan->holdnote)
+      chan->vbl_length -= n;
+}
+
+static void apu_noise_skip(noise_t *chan, int n)
+{
+   if (FALSE == chan->enabled || 0 == chan->vbl_length)
+      return;
+
+   if (FALSE == chan->holdnote)
+   {
+      if (n > chan->vbl_length)
+         n = chan->vbl_length;
+      chan->vbl_length -= n;
+   }
+
+   chan->env_phase -= 4 * n;
+   while (chan->env_phase < 0)
+   {
+      chan->env_phase += chan->env_delay;
+
+      if (chan->holdnote)
+         chan->env_vol = (chan->env_vol + 1) & 0x0F;
+      else if (chan->env_vol < 0x0F)
+         chan->env_vol++;
+   }
+}
+
+void apu_skip(int num_samples)
+{
+   apudata_t *d;
+   uint32 elapsed_cycles;
+   const uint32 cycles = APU_FROM_FIXED(apu->cycle_rate);
+   int i, n;
+
+   ASSERT(apu);
+
+   elapsed_cycles = (uint32) apu->elapsed_cycles;
+
+   while (num_samples > 0)
+   {
+      while ((FALSE == APU_QEMPTY()) && (apu->queue[apu->q_tail].timestamp <= elapsed_cycles))
+      {
+         d = apu_dequeue();
+         apu_regwrite(d->address, d->value);
+      }
+
+      /* run all channels up to the next register write */
+      n = num_samples;
+      if (FALSE == APU_QEMPTY())
+      {
+         uint32 k = (apu->queue[apu->q_tail].timestamp - elapsed_cycles
+                     + cycles - 1) / cycles;
+         if (k < (uint32) n)
+            n = k;
+      }
+      elapsed_cycles += n * cycles;
+      num_samples -= n;
+
+      if (APU_MIX_ENABLE(0)) apu_rectangle_skip(&apu->rectangle[0], n);
+      if (APU_MIX_ENABLE(1)) apu_rectangle_skip(&apu->rectangle[1], n);
+      if (APU_MIX_ENABLE(2)) apu_triangle_skip(&apu->triangle, n);
+      if (APU_MIX_ENABLE(3)) apu_noise_skip(&apu->noise, n);
+      if (APU_MIX_ENABLE(4))
+         for (i = 0; i < n; i++)
+            apu_dmc(&apu->dmc);
+      if (apu->ext && APU_MIX_ENABLE(5))
+         for (i = 0; i < n; i++)
+            apu->ext->process();
    }
 
    /* resync cycle counter */
    apu->elapsed_cycles = nes6502_getcycles(FALSE);
 }
 
+/* $$$ ben : save channels and pending writes. Fails if too many writes
+** are pending (should not happen between two frames).
+*/
+int apu_savestate(apu_state_t *state)
+{
+   int i, n;
+
+   ASSERT(apu);
+
+   n = (apu->q_head - apu->q_tail) & APUQUEUE_MASK;
+   if (n > APUSTATE_QUEUE)
+      return -1;
+
+   state->rectangle[0] = apu->rectangle[0];
+   state->rectangle[1] = apu->rectangle[1];
+   state->triangle = apu->triangle;
+   state->noise = apu->noise;
+   state->dmc = apu->dmc;
+   state->enable_reg = apu->enable_reg;
+
+   state->num_queued = n;
+   for (i = 0; i < n; i++)
+   {
+      state->queue[i] = apu->queue[(apu->q_tail + i) & APUQUEUE_MASK];
+      state->queue[i].timestamp -= apu->elapsed_cycles;
+   }
+   return 0;
+}
+
+/* $$$ ben : restore a state saved by apu_savestate(). The CPU cycle
+** counter is not restored, pending writes are rebased on its value.
+*/
+void apu_loadstate(const apu_state_t *state)
+{
+   int i;
+
+   ASSERT(apu);
+
+   apu->rectangle[0] = state->rectangle[0];
+   apu->rectangle[1] = state->rectangle[1];
+   apu->triangle = state->triangle;
+   apu->noise = state->noise;
+   apu->dmc = state->dmc;
+   apu->enable_reg = state->enable_reg;
+
+   apu->elapsed_cycles = nes6502_getcycles(FALSE);
+   for (i = 0; i < state->num_queued; i++)
+   {
+      apu->queue[i] = state->queue[i];
+      apu->queue[i].timestamp += apu->elapsed_cycles;
+   }
+   apu->q_tail = 0;
+   apu->q_head = state->num_queued;
+}
+
+/* $$$ ben : set band-limited rectangles and noise on (1) or off (0).
+** -1 only returns the current mode.
+*/
+int apu_setbandlimit(int bandlimit)
+{
+   int old;
+
+   ASSERT(apu);
+   old = apu->bandlimit;
+   if (bandlimit != -1 && !bandlimit != !old)
+   {
+      /* band-limited channels are delayed by one sample */
+      apu->rectangle[0].bl_prev = apu->rectangle[0].output_vol;
+      apu->rectangle[1].bl_prev = apu->rectangle[1].output_vol;
+      apu->noise.bl_prev = (apu->noise.output_vol * 3) >> 2;
+      apu->bandlimit = !!bandlimit;
+   }
+   return old;
+}
+
 /* set the filter type */
 /* $$$ ben :
  * Add a get feature (filter_type == -1) and returns old filter type
@@ -1070,6 +1513,10 @@ void apu_reset(void)
    apu->q_head = 0;
    apu->q_tail = 0;
 
+#ifdef REALTIME_NOISE
+   apu->noise.sreg = 0x4000;
+#endif /* REALTIME_NOISE */
+
    /* use to avoid bugs =) */
    for (address = 0x4000; address <= 0x4013; address++)
       apu_regwrite(address, 0);
@@ -1134,6 +1581,7 @@ apu_t *apu_create(int sample_rate, int refresh_rate, int sample_bits, boolean st
    temp_apu->num_samples = sample_rate / refresh_rate;
    /* turn into fixed point! */
    temp_apu->cycle_rate = (int32) (APU_BASEFREQ * 65536.0 / (float) sample_rate);
+   temp_apu->bl_mul = (1 << 30) / (temp_apu->cycle_rate >> 8);
 
    /* build various lookup tables for apu */
    apu_build_luts(temp_apu->num_samples);
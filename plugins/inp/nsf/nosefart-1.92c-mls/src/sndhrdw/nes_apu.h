@@ -105,6 +105,8 @@ typedef struct rectangle_s
    int vbl_length;
    uint8 adder;
    int duty_flip;
+
+   int32 bl_prev; /* $$$ ben : delayed output (band-limited mode) */
 } rectangle_t;
 
 /*
@@ -162,10 +164,13 @@ typedef struct noise_s
 
 #ifdef REALTIME_NOISE
    uint8 xor_tap;
+   int sreg; /* $$$ ben : 15-bit shift register */
 #else
    boolean short_sample;
    int cur_pos;
 #endif /* REALTIME_NOISE */
+
+   int32 bl_prev; /* $$$ ben : delayed output (band-limited mode) */
 } noise_t;
 
 typedef struct dmc_s
@@ -251,6 +256,8 @@ typedef struct apu_s
 
   int mix_enable; /* $$$ben : should improve emulation */
    int filter_type;
+   int bandlimit;  /* $$$ ben : band-limited rectangles and noise */
+   int32 bl_mul;   /* $$$ ben : edge position to 1.15 fraction of sample */
 
    int32 cycle_rate;
 
@@ -267,6 +274,22 @@ typedef struct apu_s
    apuext_t *ext;
 } apu_t;
 
+/* $$$ ben : channel state snapshot (for seeking) */
+#define  APUSTATE_QUEUE  64
+
+typedef struct apu_state_s
+{
+   rectangle_t rectangle[2];
+   triangle_t triangle;
+   noise_t noise;
+   dmc_t dmc;
+   uint8 enable_reg;
+
+   /* pending register writes, timestamps relative to elapsed cycles */
+   int num_queued;
+   apudata_t queue[APUSTATE_QUEUE];
+} apu_state_t;
+
 
 #ifdef __cplusplus
 extern "C" {
@@ -277,12 +300,18 @@ extern apu_t *apu_create(int sample_rate, int refresh_rate, int sample_bits, boo
 extern void apu_destroy(apu_t *apu);
 extern int apu_setext(apu_t *apu, apuext_t *ext);
 extern int apu_setfilter(int filter_type);
+extern int apu_setbandlimit(int bandlimit);
 extern void apu_process(void *buffer, int num_samples);
 extern void apu_reset(void);
 extern int apu_setchan(int chan, boolean enabled);
 extern int32 apu_getcyclerate(void);
 extern apu_t *apu_getcontext(void);
 
+/* $$$ ben : snapshot and fast emulation (for seeking) */
+extern int apu_savestate(apu_state_t *state);
+extern void apu_loadstate(const apu_state_t *state);
+extern void apu_skip(int num_samples);
+
 extern uint8 apu_read(uint32 address);
 extern void apu_write(uint32 address, uint8 value);
 
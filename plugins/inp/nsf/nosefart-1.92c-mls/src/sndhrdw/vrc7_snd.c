@@ -32,6 +32,7 @@
 
 static int buflen;
 static int16 *buffer;
+static int sample; /* $$$ ben : next sample in buffer */
 
 #define OPL_WRITE(opl, r, d) \
 { \
@@ -130,6 +131,8 @@ static void vrc7_init(void)
    buflen = apu_getcontext()->num_samples;
    buffer = malloc(buflen * 2);
    ASSERT(buffer);
+   /* $$$ ben : render a chunk before the first sample */
+   sample = buflen;
    vrc7_reset();
 }
 
@@ -292,8 +295,6 @@ static void vrc7_write(uint32 address, uint8 data)
 
 static int32 vrc7_process(void)
 {
-   static int sample = 0;
-
    /* update a large chunk at once */
    if (sample >= buflen)
    {
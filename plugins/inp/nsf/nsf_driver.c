@@ -16,6 +16,8 @@
 #include "pcm_buffer.h"
 #include "fifo.h"
 #include "sysdebug.h"
+#include "emu_snapshot.h"
+#include "songlen.h"
 
 #include "gzip.h"
 #include "types.h"
@@ -42,6 +44,18 @@ static unsigned int zeroCnt;    // Number of successive zero sample recieved
 static unsigned int zeroGoal;   // Number of zero samples to detect end.
 static uint16 oldspl;
 
+/* Seek snapshots (time in samples) : every 10 seconds, 1Mb at most. */
+#define SNAPSHOT_PERIOD (10 * freq)
+#define SNAPSHOT_BYTES  (1 << 20)
+static emu_snapshot_t * snaps;
+
+static unsigned char nsf_md5[MD5_SIZE]; /* For song length database. */
+
+/* Band-limited rectangles and noise, changed by the nsf_bandlimit
+ * command and applied by the decoder before the next frame. */
+static volatile int bandlimit = 1;
+static volatile int bandlimit_changed;
+
 static char * make_desc(nsf_t * nsf, char *tmp)
 {
   sprintf(tmp,"Nintendo Famicom %d hz", (int)nsf->playback_rate);
@@ -92,6 +106,8 @@ static unsigned int make_time(nsf_t * nsf)
     unsigned long long ms = (unsigned long long)t << 10;
     ms /= nsf->playback_rate ? nsf->playback_rate : 60;
     t = ms;
+  } else if (t = songlen_find(nsf_md5, track), t) {
+    t = ((unsigned long long)t << 10) / 1000;
   }
 
   return t;
@@ -139,7 +155,9 @@ static nsf_t * load_nsf_file(const char * filename)
   void * buffer = 0;
   buffer = gzip_load(filename, &buffer_len);
   SDDEBUG("LOAD:%p %d\n",buffer,buffer_len);
+  memset(nsf_md5, 0, sizeof(nsf_md5));
   if (buffer) {
+    md5_sum(buffer, buffer_len, nsf_md5);
     nsf = nsf_load(0/*(char *)filename*/, buffer, buffer_len);
     free(buffer);
   } else
@@ -168,9 +186,28 @@ static int nsf_setupsong(void)
 
   nsf_setfilter(nsf, NSF_FILTER_NONE);
   nsf_playtrack(nsf, nsf->current_song, freq, bits, pcm_stereo);
+  nsf_setbandlimit(nsf, bandlimit);
+  bandlimit_changed = 0;
   return nsf->current_song;
 }
 
+/* Save emulator state at frame boundary when a snapshot is due. */
+static void save_snapshot(void)
+{
+  const unsigned int time = nsf->cur_frame * dataSize;
+  void * buffer;
+  int size;
+
+  if (!snaps || time < emu_snapshot_next(snaps)
+      || !(size = nsf_state_size(nsf))) {
+    return;
+  }
+  buffer = emu_snapshot_add(snaps, time, size);
+  if (buffer && nsf_savestate(nsf, buffer) < 0) {
+    emu_snapshot_cancel(snaps);
+  }
+}
+
 static int set_track(int track, playa_info_t * info)
 {
   char tmp[512];
@@ -226,6 +263,9 @@ static int play(int track, playa_info_t * info)
 	  "ZeroGoal :%d\n"
 	  ,track,splGoalMin,splGoal,zeroGoal);
 
+  if (snaps) {
+    emu_snapshot_clear(snaps);
+  }
   err = nsf_setupsong();
   if (err > 0) {
 /*     nsf_info(info, nsf); */
@@ -263,6 +303,8 @@ static int stop(void)
 {
   SDDEBUG("%s()\n", __FUNCTION__);
   close_nsf_file();
+  emu_snapshot_destroy(snaps);
+  snaps = 0;
   pcm_buffer_shutdown();
   pcm_count = 0;
   pcm_ptr = 0;
@@ -280,6 +322,7 @@ int start(const char *fn, int track, playa_info_t *inf)
   if (fn) {
     stop();
     nsf = load_nsf_file(fn);
+    snaps = emu_snapshot_create(SNAPSHOT_PERIOD, SNAPSHOT_BYTES);
   }
   err = nsf_info(inf, nsf);
   err = err || play(track+1, inf) < 0;
@@ -319,6 +362,11 @@ static int decoder(playa_info_t * info)
    * No more frame : it is the end
    */
   if (!pcm_count) {
+    if (bandlimit_changed) {
+      bandlimit_changed = 0;
+      nsf_setbandlimit(nsf, bandlimit);
+    }
+    save_snapshot();
     nsf_frame(nsf);
     apu_process(pcm_buffer, dataSize);
     pcm_ptr = pcm_buffer;
@@ -392,6 +440,55 @@ static int decoder(playa_info_t * info)
   return status;
 }
 
+/* Restore the nearest snapshot (or restart the track) and emulate the
+ * remaining frames without generating sound.
+ */
+static int seek(unsigned int ms, playa_info_t * info)
+{
+  const uint64 start = timer_ms_gettime64();
+  unsigned int target, at, from;
+  const void * state = 0;
+  emu_snapshot_stats_t stats;
+
+  if (!nsf || !dataSize) {
+    return -1;
+  }
+  target = (unsigned long long)ms * freq / 1000 / dataSize;
+  if (target * dataSize >= splGoal) {
+    return -1;
+  }
+
+  if (snaps) {
+    state = emu_snapshot_find(snaps, target * dataSize, &at);
+  }
+  if (state && (at > nsf->cur_frame * dataSize || target < nsf->cur_frame)) {
+    nsf_loadstate(nsf, state);
+  } else if (target < nsf->cur_frame) {
+    nsf_setupsong();
+  }
+
+  from = nsf->cur_frame;
+  while (nsf->cur_frame < target) {
+    save_snapshot();
+    nsf_frame(nsf);
+    apu_skip(dataSize);
+  }
+
+  pcm_count = 0;
+  pcm_ptr = pcm_buffer;
+  splCnt = nsf->cur_frame * dataSize;
+  zeroCnt = 0;
+
+  if (snaps) {
+    emu_snapshot_stats(snaps, &stats);
+    SDDEBUG("nsf: seek %ums : %u frames from #%u in %ums, "
+	    "%d snapshots %d bytes\n",
+	    ms, target - from, from, (int)(timer_ms_gettime64() - start),
+	    stats.count, stats.bytes);
+  }
+  return 0;
+}
+
 static int info(playa_info_t *info, const char *fname)
 {
   int err;
@@ -413,6 +510,34 @@ static driver_option_t * options(any_driver_t * d, int idx,
   return o;
 }
 
+/* LUA interface */
+
+#include "luashell.h"
+
+static int lua_bandlimit(lua_State * L)
+{
+  int old = bandlimit;
+  if (lua_gettop(L) >= 1) {
+    bandlimit = lua_tonumber(L, 1) != 0;
+    bandlimit_changed = 1;
+  }
+  lua_settop(L, 0);
+  lua_pushnumber(L, old);
+  return 1;
+}
+
+static luashell_command_description_t commands[] = {
+  {
+    "nsf_bandlimit", 0, "nsf",     /* long name, short name, topic */
+    "nsf_bandlimit([status]) : set or return band-limited synthesis"
+    " of the rectangle and noise channels",  /* usage */
+    SHELL_COMMAND_C, lua_bandlimit      /* function */
+  },
+
+  /* end of the command list */
+  {0},
+};
+
 static inp_driver_t driver =
 {
 
@@ -431,6 +556,7 @@ static inp_driver_t driver =
     init,                /**< Driver init */
     shutdown,            /**< Driver shutdown */
     options,             /**< Driver options */
+    commands,            /**< Lua shell commands */
   },
   
   /* Input driver specific */
@@ -442,6 +568,7 @@ static inp_driver_t driver =
   stop,
   decoder,
   info,
+  seek,
 };
 
 EXPORT_DRIVER(driver)
@@ -0,0 +1,355 @@
+/*	booktest.c : host test of the libvorbis codebook decode
+
+	Usage: booktest [books [codewords]]
+
+	Random codebooks are built (complete Huffman trees of 2 to 1024
+	entries, unused entries, lattice and listed values of 1 to 8
+	dimensions). A packet of random bits is a stream of codewords drawn
+	with the probabilities the code is built for (2^-length). Each book
+	decodes a packet of at least codewords codewords (default 20000) to
+	its end; books defaults to 500.
+
+	1) vorbis_book_decode() must return the same entries as the previous
+	   decoder (its first level table and tree walk are copied below),
+	   up to the end of the packet.
+	2) decodevs_add, decodev_add, decodev_set and decodevv_add (1 to 3
+	   channels, so the stereo path too) must give the same values as
+	   adding the decoded vectors one at a time.
+	3) The share of codewords not found by the first level lookup (slow
+	   path) is printed for the previous and the current table width,
+	   with the decode cost of both in ns per codeword.
+
+	Returns 0 if all checks pass.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "vorbis/codec.h"
+#include "codebook.h"
+
+#define MAXLEN	    24	/* longest codeword built */
+#define MAXDIM	    8
+
+static unsigned int seed;
+
+static unsigned int rnd(void)
+{
+  seed = seed * 1103515245u + 12345u;
+  return seed >> 8;
+}
+
+/*========== previous decoder (codebook.c, sharedbook.c) */
+
+typedef struct {
+  long *tab;
+  int *tabl;
+  int tabn;
+} prev_table;
+
+static void prev_make_table(prev_table *pt, codebook *c)
+{
+  decode_aux *t = c->decode_tree;
+  long i, j, n;
+
+  pt->tabn = _ilog(c->entries)-4; /* this is magic */
+  if (pt->tabn < 5) pt->tabn = 5;
+  n = 1 << pt->tabn;
+  pt->tab = malloc(n * sizeof(long));
+  pt->tabl = malloc(n * sizeof(int));
+  for (i = 0; i < n; i++) {
+    long p = 0;
+    for (j = 0; j < pt->tabn && (p > 0 || j == 0); j++) {
+      if (i & (1 << j))
+	p = t->ptr1[p];
+      else
+	p = t->ptr0[p];
+    }
+    /* now j == length, and p == -code */
+    pt->tab[i] = p;
+    pt->tabl[i] = j;
+  }
+}
+
+static long prev_decode(prev_table *pt, codebook *book, oggpack_buffer *b)
+{
+  long ptr = 0;
+  decode_aux *t = book->decode_tree;
+  int lok = oggpack_look(b, pt->tabn);
+
+  if (lok >= 0) {
+    ptr = pt->tab[lok];
+    oggpack_adv(b, pt->tabl[lok]);
+    if (ptr <= 0)
+      return -ptr;
+  }
+
+  do {
+    switch (oggpack_read1(b)) {
+    case 0:
+      ptr = t->ptr0[ptr];
+      break;
+    case 1:
+      ptr = t->ptr1[ptr];
+      break;
+    case -1:
+      return(-1);
+    }
+  } while (ptr > 0);
+  return(-ptr);
+}
+
+/*========== random codebooks */
+
+/* Code lengths of a complete tree of used leaves, then entries - used
+   unused ones (length 0), in random order. Leaves are split at random,
+   the shallower of two when balanced. */
+static void make_lengths(long *len, int entries, int used, int balanced)
+{
+  int n = 1, i;
+
+  len[0] = 0;
+  while (n < used) {
+    i = rnd() % n;
+    if (balanced) {
+      int k = rnd() % n;
+      if (len[k] < len[i]) i = k;
+    }
+    if (len[i] >= MAXLEN) continue;
+    len[n++] = ++len[i];
+  }
+  for (; n < entries; n++)
+    len[n] = 0;
+  for (i = n - 1; i > 0; i--) {
+    int k = rnd() % (i + 1);
+    long l = len[i];
+    len[i] = len[k];
+    len[k] = l;
+  }
+}
+
+static static_codebook *make_book(void)
+{
+  static_codebook *s = calloc(1, sizeof(*s));
+  int used = 2 + rnd() % 1023;
+  long i, q;
+
+  s->entries = used + ((rnd() & 3) ? 0 : rnd() % used);
+  s->dim = 1 + rnd() % MAXDIM;
+  s->lengthlist = malloc(s->entries * sizeof(long));
+  make_lengths(s->lengthlist, s->entries, used, rnd() & 1);
+
+  s->maptype = 1 + (rnd() & 1);
+  s->q_min = _float32_pack(-1.f - (rnd() % 100) / 64.f);
+  s->q_delta = _float32_pack((1 + rnd() % 100) / 256.f);
+  s->q_quant = 8;
+  s->q_sequencep = rnd() & 1;
+  q = (s->maptype == 1) ? _book_maptype1_quantvals(s) : s->entries * s->dim;
+  s->quantlist = malloc(q * sizeof(long));
+  for (i = 0; i < q; i++)
+    s->quantlist[i] = rnd() & 255;
+  return s;
+}
+
+static void random_packet(oggpack_buffer *b, unsigned char *buf, long bytes)
+{
+  long i;
+
+  for (i = 0; i < bytes; i++)
+    buf[i] = rnd();
+  oggpack_readinit(b, buf, bytes);
+}
+
+/*========== checks */
+
+static int failed;
+static long decoded, prev_slow, slow;
+static double prev_ns, ns;
+
+static void check(const char *name, codebook *c, int ok)
+{
+  if (!ok) {
+    printf("  %s differs : %ld entries, dim %ld, table %d bits\n",
+	   name, c->entries, c->dim, c->decode_tree->tabn);
+    failed = 1;
+  }
+}
+
+/* 1) entries and cost */
+static void test_decode(codebook *c, prev_table *pt, int codewords)
+{
+  long bytes = codewords * MAXLEN / 8 + 8;
+  unsigned char *buf = malloc(bytes);
+  long *ref = malloc((bytes * 8 + 1) * sizeof(long));
+  oggpack_buffer b;
+  long n = 0, i, e;
+  int ok = 1;
+  clock_t t0;
+
+  random_packet(&b, buf, bytes);
+  t0 = clock();
+  do {
+    ref[n] = prev_decode(pt, c, &b);
+  } while (ref[n++] >= 0);
+  prev_ns += (double)(clock() - t0) / CLOCKS_PER_SEC * 1e9;
+
+  oggpack_readinit(&b, buf, bytes);
+  t0 = clock();
+  for (i = 0; i < n; i++) {
+    e = vorbis_book_decode(c, &b);
+    ok &= (e == ref[i]);
+  }
+  ns += (double)(clock() - t0) / CLOCKS_PER_SEC * 1e9;
+  check("vorbis_book_decode", c, ok);
+
+  decoded += n - 1;
+  for (i = 0; i < n - 1; i++) {
+    prev_slow += c->c->lengthlist[ref[i]] > pt->tabn;
+    slow += c->c->lengthlist[ref[i]] > c->decode_tree->tabn;
+  }
+  free(ref);
+  free(buf);
+}
+
+static void random_floats(float *a, long n)
+{
+  long i;
+
+  for (i = 0; i < n; i++)
+    a[i] = (float)((int)(rnd() & 0xffff) - 0x8000) / 4096.f;
+}
+
+/* 2) vector decode against one vector at a time */
+static void test_vectors(codebook *c, prev_table *pt, int codewords)
+{
+  long dim = c->dim, n = codewords / dim * dim;
+  long bytes = n * MAXLEN / 8 + 8;
+  unsigned char *buf = malloc(bytes);
+  float *a = malloc(n * sizeof(float)), *r = malloc(n * sizeof(float));
+  float *av[3], *rv[3];
+  oggpack_buffer b, rb;
+  long i, j, k, step, offset;
+  int ch, chptr;
+
+  if (n <= 0) {
+    free(buf); free(a); free(r);
+    return;
+  }
+
+  /* decodevs_add : vector j scalar i at a[i * step + j] */
+  random_floats(a, n);
+  memcpy(r, a, n * sizeof(float));
+  random_packet(&b, buf, bytes);
+  oggpack_readinit(&rb, buf, bytes);
+  vorbis_book_decodevs_add(c, a, &b, n);
+  step = n / dim;
+  for (j = 0; j < step; j++) {
+    const float *t = c->valuelist + prev_decode(pt, c, &rb) * dim;
+    for (i = 0; i < dim; i++)
+      r[i * step + j] += t[i];
+  }
+  check("vorbis_book_decodevs_add", c, !memcmp(a, r, n * sizeof(float)));
+
+  /* decodev_add, decodev_set : vectors one after the other */
+  for (k = 0; k < 2; k++) {
+    random_floats(a, n);
+    memcpy(r, a, n * sizeof(float));
+    random_packet(&b, buf, bytes);
+    oggpack_readinit(&rb, buf, bytes);
+    if (k)
+      vorbis_book_decodev_set(c, a, &b, n);
+    else
+      vorbis_book_decodev_add(c, a, &b, n);
+    for (i = 0; i < n; ) {
+      const float *t = c->valuelist + prev_decode(pt, c, &rb) * dim;
+      for (j = 0; j < dim; j++, i++)
+	r[i] = k ? t[j] : r[i] + t[j];
+    }
+    check(k ? "vorbis_book_decodev_set" : "vorbis_book_decodev_add", c,
+	  !memcmp(a, r, n * sizeof(float)));
+  }
+
+  /* decodevv_add : vectors interleaved over ch channels */
+  for (ch = 1; ch <= 3; ch++) {
+    long len = n / ch + 1;
+    long m = (n / dim) * dim / ch * ch;
+
+    while (m % dim || m % ch) m--;
+    if (m <= 0) continue;
+    offset = ch * (rnd() % 4);
+    for (k = 0; k < ch; k++) {
+      av[k] = calloc(len + 4, sizeof(float));
+      rv[k] = calloc(len + 4, sizeof(float));
+      random_floats(av[k], len + 4);
+      memcpy(rv[k], av[k], (len + 4) * sizeof(float));
+    }
+    random_packet(&b, buf, bytes);
+    oggpack_readinit(&rb, buf, bytes);
+    vorbis_book_decodevv_add(c, av, offset, ch, &b, m);
+    chptr = 0;
+    for (i = offset / ch; i < (offset + m) / ch; ) {
+      const float *t = c->valuelist + prev_decode(pt, c, &rb) * dim;
+      for (j = 0; j < dim; j++) {
+	rv[chptr++][i] += t[j];
+	if (chptr == ch) {
+	  chptr = 0;
+	  i++;
+	}
+      }
+    }
+    for (k = 0, j = 1; k < ch; k++) {
+      j &= !memcmp(av[k], rv[k], (len + 4) * sizeof(float));
+      free(av[k]);
+      free(rv[k]);
+    }
+    check(ch == 2 ? "vorbis_book_decodevv_add (stereo)"
+	  : "vorbis_book_decodevv_add", c, j);
+  }
+  free(r);
+  free(a);
+  free(buf);
+}
+
+int main(int na, char **a)
+{
+  int books = (na > 1) ? atoi(a[1]) : 500;
+  int codewords = (na > 2) ? atoi(a[2]) : 20000;
+  int i;
+
+  if (books <= 0 || codewords <= 0) {
+    fprintf(stderr, "Usage: booktest [books [codewords]]\n");
+    return 1;
+  }
+
+  seed = 12345;
+  for (i = 0; i < books; i++) {
+    static_codebook *s = make_book();
+    codebook c;
+    prev_table pt;
+
+    if (vorbis_book_init_decode(&c, s)) {
+      printf("  book %d : vorbis_book_init_decode failed\n", i);
+      failed = 1;
+      continue;
+    }
+    prev_make_table(&pt, &c);
+    test_decode(&c, &pt, codewords);
+    test_vectors(&c, &pt, codewords / 8);
+    free(pt.tab);
+    free(pt.tabl);
+    vorbis_book_clear(&c);
+    free(s->quantlist);
+    free(s->lengthlist);
+    free(s);
+  }
+
+  printf("booktest : %d books, %ld codewords\n", books, decoded);
+  printf("  previous table  slow path %5.1f%%  %6.2f ns/codeword\n",
+	 100. * prev_slow / decoded, prev_ns / decoded);
+  printf("  current table   slow path %5.1f%%  %6.2f ns/codeword\n",
+	 100. * slow / decoded, ns / decoded);
+  printf("%s\n", failed ? "FAILED" : "OK");
+  return failed;
+}
@@ -0,0 +1,545 @@
+/*	syntest.c : host test of the libvorbis fused 16 bit synthesis
+
+	Usage: syntest [seconds [file.ogg ...]]
+
+	A synthetic stream is built for 1 and 2 channels : random codebooks,
+	floor 1 and residues of type 0, 1 and 2 (with channel coupling) over
+	short and long blocks, headers packed by libvorbis, then audio
+	packets of random bits after a valid mode and window sequence. The
+	floor of a channel is unused at random, so silent channels are in.
+	seconds is the length of each stream (default 30). Each file given is
+	decoded too.
+
+	1) The fused output (vorbis_synthesis_pcmout16(), read in random
+	   chunks) must be the same as the float path (vorbis_synthesis_pcmout()
+	   converted as sndvorbisfile.c does).
+	2) For the default length, the float path checksum of the synthetic
+	   streams must be the one recorded with the previous decoder.
+	3) The realtime factor of both paths is printed.
+
+	Returns 0 if all checks pass.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+
+#include "vorbis/codec.h"
+#include "codec_internal.h"
+#include "registry.h"
+#include "backends.h"
+#include "codebook.h"
+
+#define RATE		44100
+#define SHORT_BLOCK	256
+#define LONG_BLOCK	2048
+#define GOLDEN_SECONDS	30
+
+#define FLOOR_MULT	2	/* quant_q 128 */
+#define FLOOR_Q		128
+#define RES_GROUPING	16
+#define RES_PARTS	4
+
+static unsigned int seed;
+
+static unsigned int rnd(void)
+{
+  seed = seed * 1103515245u + 12345u;
+  return seed >> 8;
+}
+
+typedef struct {
+  ogg_packet *op;
+  long n, max;
+} packets_t;
+
+/* Copies op at the end of p. */
+static void add_packet(packets_t *p, const ogg_packet *op)
+{
+  ogg_packet *d;
+
+  if (p->n == p->max) {
+    p->max = 2 * p->max + 64;
+    p->op = realloc(p->op, p->max * sizeof(ogg_packet));
+  }
+  d = p->op + p->n;
+  *d = *op;
+  d->packet = malloc(op->bytes + 1);
+  memcpy(d->packet, op->packet, op->bytes);
+  d->packetno = p->n++;
+}
+
+static void free_packets(packets_t *p)
+{
+  long i;
+
+  for (i = 0; i < p->n; i++)
+    free(p->op[i].packet);
+  free(p->op);
+  memset(p, 0, sizeof(*p));
+}
+
+/*========== synthetic stream */
+
+/* Complete Huffman code lengths for used of entries, see booktest.c */
+static long *make_lengths(int entries, int used)
+{
+  long *len = malloc(entries * sizeof(long));
+  int n = 1, i;
+
+  len[0] = 0;
+  while (n < used) {
+    i = rnd() % n;
+    if (len[i] >= 20) continue;
+    len[n++] = ++len[i];
+  }
+  for (; n < entries; n++)
+    len[n] = 0;
+  for (i = n - 1; i > 0; i--) {
+    int k = rnd() % (i + 1);
+    long l = len[i];
+    len[i] = len[k];
+    len[k] = l;
+  }
+  return len;
+}
+
+/* Entropy coded only book (floor and partition books) */
+static static_codebook *make_book(int entries, int dim)
+{
+  static_codebook *s = calloc(1, sizeof(*s));
+
+  s->allocedp = 1;
+  s->dim = dim;
+  s->entries = entries;
+  s->lengthlist = make_lengths(entries, entries);
+  return s;
+}
+
+/* Residue book, lattice or listed values */
+static static_codebook *make_vq_book(int dim)
+{
+  static_codebook *s = calloc(1, sizeof(*s));
+  long i, q;
+
+  s->allocedp = 1;
+  s->dim = dim;
+  s->entries = 2 + rnd() % 255;
+  s->lengthlist = make_lengths(s->entries, s->entries - rnd() % 2);
+  s->maptype = 1 + (rnd() & 1);
+  s->q_min = _float32_pack(-.25f);
+  s->q_delta = _float32_pack(1.f / 512);
+  s->q_quant = 8;
+  s->q_sequencep = rnd() & 1;
+  q = (s->maptype == 1) ? _book_maptype1_quantvals(s) : s->entries * s->dim;
+  s->quantlist = malloc(q * sizeof(long));
+  for (i = 0; i < q; i++)
+    s->quantlist[i] = 64 + rnd() % 129;
+  return s;
+}
+
+/* Books : 0 floor class (dim 2, 1 sub bit), 1 floor values, 2 residue
+   partitions (RES_PARTS^2), 3 to 6 residue values of dim 1, 2, 4, 8. */
+#define BOOK_CLASS	0
+#define BOOK_Y		1
+#define BOOK_PART	2
+#define BOOK_VQ		3
+
+static vorbis_info_floor1 *make_floor(int n)
+{
+  vorbis_info_floor1 *f = calloc(1, sizeof(*f));
+  int used[LONG_BLOCK / 2] = { 0 };
+  int i, posts = 0;
+
+  f->partitions = 4 + rnd() % 8;
+  for (i = 0; i < f->partitions; i++)
+    f->partitionclass[i] = rnd() & 1;
+  f->class_dim[0] = 2;
+  f->class_subs[0] = 1;
+  f->class_book[0] = BOOK_CLASS;
+  f->class_subbook[0][0] = -1;
+  f->class_subbook[0][1] = BOOK_Y;
+  f->class_dim[1] = 1 + rnd() % 3;
+  f->class_subs[1] = 0;
+  f->class_subbook[1][0] = BOOK_Y;
+  f->mult = FLOOR_MULT;
+
+  /* distinct posts in (0, n) */
+  f->postlist[0] = 0;
+  f->postlist[1] = n;
+  used[0] = 1;
+  for (i = 0; i < f->partitions; i++)
+    posts += f->class_dim[f->partitionclass[i]];
+  for (i = 0; i < posts; i++) {
+    int x;
+    do {
+      x = rnd() % n;
+    } while (used[x]);
+    used[x] = 1;
+    f->postlist[i + 2] = x;
+  }
+  return f;
+}
+
+static vorbis_info_residue0 *make_residue(long end)
+{
+  vorbis_info_residue0 *r = calloc(1, sizeof(*r));
+  int i, k, books = 0;
+
+  r->begin = 0;
+  r->end = end;
+  r->grouping = RES_GROUPING;
+  r->partitions = RES_PARTS;
+  r->groupbook = BOOK_PART;
+  /* partition 0 is silent, the others have 1 or 2 stages */
+  for (i = 1; i < RES_PARTS; i++) {
+    r->secondstages[i] = 1 + rnd() % 3;
+    for (k = 0; k < 2; k++)
+      if (r->secondstages[i] & (1 << k))
+	r->booklist[books++] = BOOK_VQ + rnd() % 4;
+  }
+  return r;
+}
+
+/* Modes : 0 short residue 0, 1 long residue 2 with coupling, 2 short
+   residue 1, 3 long residue 1. floor1_inverse2() takes the block size
+   of the mode number, so modes 0 and 1 must be short and long. */
+static void make_setup(vorbis_info *vi, int channels)
+{
+  static const int restype[4] = { 0, 2, 1, 1 };
+  codec_setup_info *ci;
+  int i;
+
+  vorbis_info_init(vi);
+  ci = vi->codec_setup;
+  vi->channels = channels;
+  vi->rate = RATE;
+  ci->blocksizes[0] = SHORT_BLOCK;
+  ci->blocksizes[1] = LONG_BLOCK;
+
+  ci->books = BOOK_VQ + 4;
+  ci->book_param[BOOK_CLASS] = make_book(4, 2);
+  ci->book_param[BOOK_Y] = make_book(FLOOR_Q, 1);
+  ci->book_param[BOOK_PART] = make_book(RES_PARTS * RES_PARTS, 2);
+  for (i = 0; i < 4; i++)
+    ci->book_param[BOOK_VQ + i] = make_vq_book(1 << i);
+
+  ci->times = 1;
+  ci->floors = 2;
+  for (i = 0; i < 2; i++)
+    ci->floor_param[i] = make_floor(ci->blocksizes[i] / 2);
+  ci->floor_type[0] = ci->floor_type[1] = 1;
+
+  ci->residues = ci->maps = ci->modes = 4;
+  for (i = 0; i < 4; i++) {
+    int W = i & 1;
+    int n = ci->blocksizes[W] / 2;
+    vorbis_info_mapping0 *map = calloc(1, sizeof(*map));
+    vorbis_info_mode *mode = calloc(1, sizeof(*mode));
+
+    ci->residue_type[i] = restype[i];
+    ci->residue_param[i] = make_residue(restype[i] == 2 ? n * channels : n);
+
+    map->submaps = 1;
+    map->floorsubmap[0] = W;
+    map->residuesubmap[0] = i;
+    if (restype[i] == 2 && channels == 2) {
+      map->coupling_steps = 1;
+      map->coupling_mag[0] = 0;
+      map->coupling_ang[0] = 1;
+    }
+    ci->map_param[i] = map;
+
+    mode->blockflag = W;
+    mode->mapping = i;
+    ci->mode_param[i] = mode;
+  }
+}
+
+/* Headers and audio packets of a synthetic stream of seconds. */
+static int make_stream(packets_t *p, int channels, int seconds)
+{
+  vorbis_info vi;
+  vorbis_comment vc;
+  vorbis_dsp_state vd;
+  ogg_packet op[3];
+  oggpack_buffer opb;
+  long samples = 0, end = (long)seconds * RATE;
+  int i, lW = 0, W = 0, nW, mode;
+
+  make_setup(&vi, channels);
+  vorbis_comment_init(&vc);
+  if (vorbis_synthesis_init(&vd, &vi)
+      || vorbis_analysis_headerout(&vd, &vc, op, op + 1, op + 2)) {
+    fprintf(stderr, "syntest : header packing failed\n");
+    return -1;
+  }
+  for (i = 0; i < 3; i++)
+    add_packet(p, op + i);
+  vorbis_dsp_clear(&vd);
+  vorbis_comment_clear(&vc);
+  vorbis_info_clear(&vi);
+
+  /* runs of short and long blocks */
+  oggpack_writeinit(&opb);
+  mode = (rnd() & 1) * 2;
+  while (samples < end) {
+    ogg_packet ap;
+    long bytes;
+
+    nW = (rnd() % 8) ? W : !W;
+    oggpack_reset(&opb);
+    oggpack_write(&opb, 0, 1);
+    oggpack_write(&opb, mode, 2);
+    if (W) {
+      oggpack_write(&opb, lW, 1);
+      oggpack_write(&opb, nW, 1);
+    }
+    bytes = (W ? LONG_BLOCK : SHORT_BLOCK) / 8 * channels;
+    for (i = 0; i < bytes; i++)
+      oggpack_write(&opb, rnd() & 0xff, 8);
+
+    memset(&ap, 0, sizeof(ap));
+    ap.packet = oggpack_get_buffer(&opb);
+    ap.bytes = oggpack_bytes(&opb);
+    samples += (W ? LONG_BLOCK : SHORT_BLOCK) / 2;
+    ap.e_o_s = samples >= end;
+    add_packet(p, &ap);
+
+    lW = W;
+    W = nW;
+    mode = W + (rnd() & 1) * 2;
+  }
+  oggpack_writeclear(&opb);
+  return 0;
+}
+
+/*========== .ogg files */
+
+/* Packets of the first logical stream of fname. */
+static int load_ogg(packets_t *p, const char *fname)
+{
+  FILE *f = fopen(fname, "rb");
+  ogg_sync_state oy;
+  ogg_stream_state os;
+  ogg_page og;
+  ogg_packet op;
+  int started = 0;
+  long n;
+
+  if (!f) {
+    fprintf(stderr, "syntest : [%s] load failed\n", fname);
+    return -1;
+  }
+  ogg_sync_init(&oy);
+  do {
+    char *buf = ogg_sync_buffer(&oy, 4096);
+
+    n = fread(buf, 1, 4096, f);
+    ogg_sync_wrote(&oy, n);
+    while (ogg_sync_pageout(&oy, &og) > 0) {
+      if (!started) {
+	ogg_stream_init(&os, ogg_page_serialno(&og));
+	started = 1;
+      }
+      if (ogg_stream_pagein(&os, &og))
+	continue; /* other logical stream */
+      while (ogg_stream_packetout(&os, &op) > 0)
+	add_packet(p, &op);
+    }
+  } while (n > 0);
+  fclose(f);
+  if (started)
+    ogg_stream_clear(&os);
+  ogg_sync_clear(&oy);
+  if (p->n < 3) {
+    fprintf(stderr, "syntest : [%s] not a vorbis file\n", fname);
+    return -1;
+  }
+  return 0;
+}
+
+/*========== decode */
+
+typedef struct {
+  ogg_int16_t *pcm;	/* interleaved */
+  long samples;		/* per channel */
+  int channels;
+  long rate;
+} pcm_t;
+
+/* Float to 16 bit as conv_mono() and conv_stereo() in sndvorbisfile.c */
+static ogg_int16_t conv(float x)
+{
+  int v = (int)(x * 32767.0f);
+
+  v += 32768;               /* change sign */
+  v &= ~(v>>31);            /* Lower clip  */
+  v |= (65535 - v) >> 31;   /* Upper clip  */
+  return (v & 0xffff) ^ 0x8000;
+}
+
+static long read_float(vorbis_dsp_state *vd, ogg_int16_t *d, int channels)
+{
+  float **pcm;
+  int n = vorbis_synthesis_pcmout(vd, &pcm), i, c;
+
+  for (i = 0; i < n; i++)
+    for (c = 0; c < channels; c++)
+      *d++ = conv(pcm[c][i]);
+  vorbis_synthesis_read(vd, n);
+  return n;
+}
+
+/* Reads the pending samples in random chunks. */
+static long read_fused(vorbis_dsp_state *vd, ogg_int16_t *d, int channels)
+{
+  int n = vorbis_synthesis_pcmout(vd, NULL), k;
+  long total = 0;
+
+  while (n > 0) {
+    k = vorbis_synthesis_pcmout16(vd, d + total * channels, 1 + rnd() % n);
+    if (k <= 0)
+      break;
+    total += k;
+    n -= k;
+  }
+  return total;
+}
+
+/* Decodes the packets with the float path or fused into out. Returns
+   the decode time in seconds or -1. */
+static double decode(const packets_t *p, int fused, pcm_t *out)
+{
+  vorbis_info vi;
+  vorbis_comment vc;
+  vorbis_dsp_state vd;
+  vorbis_block vb;
+  codec_setup_info *ci;
+  clock_t t0;
+  long i;
+
+  memset(out, 0, sizeof(*out));
+  vorbis_info_init(&vi);
+  vorbis_comment_init(&vc);
+  for (i = 0; i < 3; i++)
+    if (i >= p->n || vorbis_synthesis_headerin(&vi, &vc, p->op + i)) {
+      fprintf(stderr, "syntest : bad vorbis headers\n");
+      return -1;
+    }
+  vorbis_synthesis_init(&vd, &vi);
+  vorbis_block_init(&vd, &vb);
+  if (fused && vorbis_synthesis_fused(&vd)) {
+    fprintf(stderr, "syntest : fused synthesis not available\n");
+    return -1;
+  }
+  ci = vi.codec_setup;
+  out->channels = vi.channels;
+  out->rate = vi.rate;
+  out->pcm = malloc((p->n * ci->blocksizes[1] / 2 + 1) * vi.channels
+		    * sizeof(ogg_int16_t));
+
+  t0 = clock();
+  for (i = 3; i < p->n; i++) {
+    ogg_int16_t *d = out->pcm + out->samples * vi.channels;
+
+    if (!vorbis_synthesis(&vb, p->op + i))
+      vorbis_synthesis_blockin(&vd, &vb);
+    out->samples += fused ? read_fused(&vd, d, vi.channels)
+      : read_float(&vd, d, vi.channels);
+  }
+  t0 = clock() - t0;
+
+  vorbis_block_clear(&vb);
+  vorbis_dsp_clear(&vd);
+  vorbis_comment_clear(&vc);
+  vorbis_info_clear(&vi);
+  return (double)t0 / CLOCKS_PER_SEC;
+}
+
+/*========== checks */
+
+static int failed;
+
+static void test(const char *name, const packets_t *p, int has_golden,
+		 unsigned int golden)
+{
+  pcm_t ref, out;
+  double sec, fsec, duration, se = 0;
+  long i, n, clipped = 0;
+  unsigned int sum = 0;
+  int same;
+
+  sec = decode(p, 0, &ref);
+  fsec = decode(p, 1, &out);
+  if (sec < 0 || fsec < 0) {
+    failed = 1;
+    free(ref.pcm);
+    free(out.pcm);
+    return;
+  }
+
+  n = ref.samples * ref.channels;
+  for (i = 0; i < n; i++) {
+    int v = ref.pcm[i];
+
+    sum = sum * 31 + (v & 0xffff);
+    se += (double)v * v;
+    clipped += (v == 32767 || v == -32768);
+  }
+  same = out.samples == ref.samples
+    && !memcmp(out.pcm, ref.pcm, n * sizeof(ogg_int16_t));
+  duration = (double)ref.samples / ref.rate;
+
+  printf("  %s : %d ch, %.1f s, rms %.0f, clipped %.2f%%\n", name,
+	 ref.channels, duration, n ? sqrt(se / n) : 0., n ? 100. * clipped / n : 0.);
+  printf("    float  x%7.1f  %08x %s\n", duration / (sec > 0 ? sec : 1e-9),
+	 sum, (has_golden && sum != golden) ? "DIFFERS" : "");
+  printf("    fused  x%7.1f  %s\n", duration / (fsec > 0 ? fsec : 1e-9),
+	 same ? "identical" : "DIFFERS");
+  failed |= !same || (has_golden && sum != golden);
+  free(ref.pcm);
+  free(out.pcm);
+}
+
+int main(int na, char **a)
+{
+  /* Float path checksums of the synthetic streams (mono, stereo) for
+     GOLDEN_SECONDS, recorded with the previous decoder. */
+  static const unsigned int golden[2] = { 0xe832d223, 0xa4844ddd };
+  int seconds = (na > 1) ? atoi(a[1]) : GOLDEN_SECONDS;
+  int i;
+
+  if (seconds <= 0) {
+    fprintf(stderr, "Usage: syntest [seconds [file.ogg ...]]\n");
+    return 1;
+  }
+
+  printf("syntest : realtime factor, output checksum\n");
+  for (i = 1; i <= 2; i++) {
+    packets_t p = { 0 };
+
+    seed = 12345 + i;
+    if (make_stream(&p, i, seconds)) {
+      failed = 1;
+      continue;
+    }
+    test(i == 2 ? "synthetic stereo" : "synthetic mono", &p,
+	 seconds == GOLDEN_SECONDS, golden[i - 1]);
+    free_packets(&p);
+  }
+  for (i = 2; i < na; i++) {
+    packets_t p = { 0 };
+
+    if (load_ogg(&p, a[i])) {
+      failed = 1;
+      continue;
+    }
+    test(a[i], &p, 0, 0);
+    free_packets(&p);
+  }
+  printf("%s\n", failed ? "FAILED" : "OK");
+  return failed;
+}
@@ -339,12 +339,49 @@ static int sndogg_info(playa_info_t *info, const char *fname)
   return 0;
 }
 
+static int sndogg_seek(unsigned int ms, playa_info_t *info)
+{
+  pcm_ptr = pcm_buffer;
+  pcm_count = 0;
+  return VorbisFile_seek(ms);
+}
+
 static driver_option_t * sndogg_options(any_driver_t * d, int idx,
                                         driver_option_t * o)
 {
   return o;
 }
 
+/* LUA interface */
+
+#include "luashell.h"
+
+static int lua_synthesis(lua_State * L)
+{
+  int old = VorbisFile_synthesis;
+  if (lua_gettop(L) >= 1) {
+    int t = lua_tonumber(L, 1);
+    if (t >= VorbisFile_FLOAT && t <= VorbisFile_FUSED) {
+      VorbisFile_synthesis = t;
+    }
+  }
+  lua_settop(L, 0);
+  lua_pushnumber(L, old);
+  return 1;
+}
+
+static luashell_command_description_t commands[] = {
+  {
+    "ogg_synthesis", 0, "ogg",       /* long name, short name, topic */
+    "ogg_synthesis([mode]) : set or return vorbis synthesis"
+    " for next file, 0:float 1:fused 16 bit",  /* usage */
+    SHELL_COMMAND_C, lua_synthesis      /* function */
+  },
+
+  /* end of the command list */
+  {0},
+};
+
 static inp_driver_t ogg_driver = {
   /* Any driver */
   {
@@ -360,7 +397,8 @@ static inp_driver_t ogg_driver = {
     0,                    /* Dll */
     sndogg_init,          /* Init */
     sndogg_shutdown,      /* Shutdown */
-    sndogg_options        /* Options */
+    sndogg_options,       /* Options */
+    commands,             /* Lua shell commands */
   },
 
   /* Input driver specific */
@@ -371,6 +409,7 @@ static inp_driver_t ogg_driver = {
   sndogg_stop,
   sndogg_decoder,
   sndogg_info,
+  sndogg_seek,
 };
 
 EXPORT_DRIVER(ogg_driver)
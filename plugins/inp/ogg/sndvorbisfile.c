@@ -31,6 +31,7 @@ vorbis_dsp_state vd;
 vorbis_block vb;
 
 int VorbisFile_convbufferlength = 4096;
+int VorbisFile_synthesis = VorbisFile_FUSED;
 int VorbisFile_EOS;
 static int vd_samples;
 
@@ -165,6 +166,21 @@ void VorbisFile_closeFile()
   }
 }
 
+/* Decoder init, also used when seeking. The synthesis type is chosen
+ * for the file at open.
+ */
+static int fused;
+
+static void synthesis_init(void)
+{
+  vorbis_synthesis_init(&vd, &vi);
+  if (fused && vorbis_synthesis_fused(&vd)) {
+    SDWARNING("libvorbis: fused synthesis not available\n");
+    fused = 0;
+  }
+  vorbis_block_init(&vd, &vb);
+}
+
 /* int VorbisFile_openFile(...)
  *
  * returns:
@@ -176,6 +192,7 @@ int VorbisFile_openFile(const char *filename, VorbisFile_headers_t * v_headers)
   int i;
   VorbisFile_EOS = 0;
   vd_samples = 0;
+  fused = VorbisFile_synthesis == VorbisFile_FUSED;
 
   fd = fs_open(filename, O_RDONLY);
 
@@ -269,8 +286,7 @@ int VorbisFile_openFile(const char *filename, VorbisFile_headers_t * v_headers)
   VorbisFile_sampletrack = 0;
 
   // Initialize the decoder
-  vorbis_synthesis_init(&vd, &vi);
-  vorbis_block_init(&vd, &vb);
+  synthesis_init();
 
   return (0);
 }
@@ -351,6 +367,10 @@ int VorbisFile_decodePCM(VorbisFile_headers_t vhd,
   if (n <= 0) {
     return n;
   }
+  if (vi.channels < 1 || vi.channels > 2) {
+	SDERROR("Bad number of channel : %d\n", vi.channels);
+	return -1;
+  }
 
   do {
     static float **pcm;
@@ -359,29 +379,30 @@ int VorbisFile_decodePCM(VorbisFile_headers_t vhd,
 
 	/* Finish with current dsp block. */
 	if (!vd_samples) {
-	  vd_samples = vorbis_synthesis_pcmout(&vd, &pcm);
+	  vd_samples = vorbis_synthesis_pcmout(&vd, fused ? 0 : &pcm);
 	  if (vd_samples > convsize) {
 		SDWARNING("%d > %d\n",vd_samples, convsize);
 	  }
-      vorbis_synthesis_read(&vd, vd_samples);
+	  if (!fused) {
+		vorbis_synthesis_read(&vd, vd_samples);
+	  }
 	}
 
 	bout = (vd_samples > n) ? n : vd_samples;
 
 	// pcm contains both (left and right) decoded pcm values
-	switch(vi.channels) {
-	case 1:
+	if (bout <= 0) {
+	  /* Nothing pending */
+	} else if (fused) {
+	  /* lapped and converted by libvorbis */
+	  vorbis_synthesis_pcmout16(&vd, target, bout);
+	} else if (vi.channels == 1) {
 	  conv_mono(target, pcm[0], bout);
 	  pcm[0] += bout;
-	  break;
-	case 2:
+	} else {
 	  conv_stereo((ogg_int32_t *)target , pcm[0], pcm[1], bout);
 	  pcm[0] += bout;
 	  pcm[1] += bout;
-	  break;
-	default:
-	  SDERROR("Bad number of channel : %d\n", vi.channels);
-	  return -1;
 	}
 	target += bout << (vi.channels-1);
 	n -= bout;
@@ -411,3 +432,154 @@ int VorbisFile_decodePCM(VorbisFile_headers_t vhd,
   return req_pcm - n;
 }
 
+
+/* Seeking
+ *
+ * Ogg pages are located by bisection on their granule position (the
+ * number of the last sample ending in the page), then scanned forward
+ * up to the page before the target. Decoding restarts on the next page
+ * and decoded samples are dropped up to the target. The result is
+ * accurate to the vorbis block overlap (at most half a long block).
+ */
+
+#define SEEK_CHUNK 4096
+
+static long seek_pos;  /* File offset of next page searched in oy */
+
+static int page_seek(long pos)
+{
+  if (fs_seek(fd, pos, SEEK_SET) != pos) {
+    return -1;
+  }
+  ogg_sync_reset(&oy);
+  seek_pos = pos;
+  return 0;
+}
+
+/* Get next page. Returns its file offset or -1 (end of file or page
+ * starting after end, 0 for no limit).
+ */
+static long next_page(ogg_page *page, long end)
+{
+  for (;;) {
+    long n;
+
+    if (end && seek_pos >= end) {
+      return -1;
+    }
+    n = ogg_sync_pageseek(&oy, page);
+    if (n < 0) {
+      seek_pos -= n;
+    } else if (n > 0) {
+      seek_pos += n;
+      return seek_pos - n;
+    } else {
+      VorbisFile_streambuffer = ogg_sync_buffer(&oy, SEEK_CHUNK);
+      bytes = fs_read(fd, VorbisFile_streambuffer, SEEK_CHUNK);
+      if (bytes <= 0) {
+        return -1;
+      }
+      ogg_sync_wrote(&oy, bytes);
+    }
+  }
+}
+
+/* Get next page of our stream with a granule position. */
+static long next_granule_page(ogg_page *page, long end)
+{
+  long at;
+
+  while ((at = next_page(page, end)) >= 0
+         && (ogg_page_serialno(page) != os.serialno
+             || ogg_page_granulepos(page) < 0))
+    ;
+  return at;
+}
+
+/* int VorbisFile_seek(...)
+ *
+ * Seek to ms milliseconds from the start of the stream.
+ *
+ * returns:
+ *  0 = success
+ * -1 = error or position past the end of stream
+ */
+int VorbisFile_seek(unsigned int ms)
+{
+  ogg_int64_t target, prev = 0;
+  long lo = 0, hi, start = 0, at;
+  ogg_page page;
+
+  if (fd < 0) {
+    return -1;
+  }
+  target = (ogg_int64_t)ms * vi.rate / 1000;
+
+  /* Bisection : lo is a page ending before target. */
+  hi = fs_total(fd);
+  while (hi - lo > SEEK_CHUNK) {
+    long mid = lo + ((hi - lo) >> 1);
+    if (page_seek(mid)) {
+      return -1;
+    }
+    at = next_granule_page(&page, hi);
+    if (at >= 0 && ogg_page_granulepos(&page) < target) {
+      lo = at;
+    } else {
+      hi = mid;
+    }
+  }
+
+  /* Forward scan : start decoding after the last page ending before
+   * target.
+   */
+  if (page_seek(lo)) {
+    return -1;
+  }
+  while ((at = next_granule_page(&page, 0)) >= 0
+         && ogg_page_granulepos(&page) < target) {
+    prev = ogg_page_granulepos(&page);
+    start = seek_pos;
+  }
+  if (at < 0 || page_seek(start)) {
+    VorbisFile_EOS = 1;
+    return -1;
+  }
+
+  /* Restart decoder */
+  ogg_stream_reset(&os);
+  vorbis_block_clear(&vb);
+  vorbis_dsp_clear(&vd);
+  synthesis_init();
+  vd_samples = 0;
+  VorbisFile_EOS = 0;
+
+  /* Drop samples before target */
+  while (prev < target) {
+    int n = vorbis_synthesis_pcmout(&vd, 0), r;
+
+    if (n > 0) {
+      if (n > target - prev) {
+        n = target - prev;
+      }
+      vorbis_synthesis_read(&vd, n);
+      prev += n;
+      continue;
+    }
+    r = ogg_stream_packetout(&os, &op);
+    if (r > 0) {
+      if (vorbis_synthesis(&vb, &op) == 0) {
+        vorbis_synthesis_blockin(&vd, &vb);
+      }
+    } else if (!r) {
+      if (next_page(&og, 0) < 0 || ogg_page_eos(&og)) {
+        VorbisFile_EOS = 1;
+        return -1;
+      }
+      if (ogg_page_serialno(&og) == os.serialno) {
+        ogg_stream_pagein(&os, &og);
+      }
+    }
+  }
+  return 0;
+}
@@ -87,5 +87,11 @@ void VorbisFile_closeFile();
 int VorbisFile_decodePCMint8(VorbisFile_headers_t vhd, uint8 *target, int requested);
 int VorbisFile_decodePCM(VorbisFile_headers_t vhd, ogg_int16_t * target, int requested);
 
+/* Synthesis type used by the next VorbisFile_openFile() */
+#define VorbisFile_FLOAT 0 /* float overlap/add buffer, then 16 bit */
+#define VorbisFile_FUSED 1 /* window, overlap/add and 16 bit in one pass */
+extern int VorbisFile_synthesis;
+
 int VorbisFile_isEOS();
+int VorbisFile_seek(unsigned int ms);
 
@@ -307,6 +307,13 @@ void vorbis_dsp_clear(vorbis_dsp_state *v){
 	_ogg_free(b->transform[1]);
       }
       if(b->psy_g_look)_vp_global_free(b->psy_g_look);
+
+      for(j=0;j<2;j++)
+	if(b->lap[j]){
+	  for(i=0;i<vi->channels;i++)
+	    if(b->lap[j][i])_ogg_free(b->lap[j][i]);
+	  _ogg_free(b->lap[j]);
+	}
       
     }
     
@@ -634,11 +641,22 @@ int vorbis_synthesis_init(vorbis_dsp_state *v,vorbis_info *vi){
 int vorbis_synthesis_blockin(vorbis_dsp_state *v,vorbis_block *vb){
   vorbis_info *vi=v->vi;
   codec_setup_info *ci=vi->codec_setup;
+  backend_lookup_state *b=v->backend_state;
 
   /* Shift out any PCM that we returned previously */
   /* centerW is currently the center of the last block added */
 
-  if(v->centerW>ci->blocksizes[1]/2 &&
+  if(b->lapp){
+    /* fused synthesis keeps no PCM history; just keep the indexes
+       small. Samples not read yet are lost. */
+    int shiftPCM=v->centerW-ci->blocksizes[1]/2;
+
+    v->pcm_current-=shiftPCM;
+    v->centerW-=shiftPCM;
+    if(v->pcm_returned!=-1)
+      v->pcm_returned=v->centerW;
+
+  }else if(v->centerW>ci->blocksizes[1]/2 &&
   /* Quick additional hack; to avoid *alot* of shifts, use an
      oversized buffer.  This increases memory usage, but doesn't make
      much difference wrt L1/L2 cache pressure. */
@@ -685,6 +703,25 @@ int vorbis_synthesis_blockin(vorbis_dsp_state *v,vorbis_block *vb){
     int endSl;
     int i,j;
 
+    if(b->lapp){
+      /* fused synthesis : keep the distinct IMDCT outputs of the last
+	 two blocks, windowing and overlap/add are done on output by
+	 vorbis_synthesis_pcmout16() */
+      float **swap=b->lap[0];
+      b->lap[0]=b->lap[1];
+      b->lap[1]=swap;
+      b->lapwindow[0]=b->lapwindow[1];
+      b->lapn[0]=b->lapn[1];
+
+      for(j=0;j<vi->channels;j++)
+	memcpy(b->lap[1][j],vb->pcm[j]+sizeW/2,sizeW/2*sizeof(float));
+      b->lapwindow[1]=b->window[vb->W][vb->lW][vb->nW]
+	[ci->mode_param[vb->mode]->windowtype];
+      b->lapn[1]=sizeW;
+      b->lapcenter=v->centerW;
+
+    }else{
+
     /* Do we have enough PCM/mult storage for the block? */
     if(endW>v->pcm_storage){
       /* expand the storage */
@@ -725,6 +762,7 @@ int vorbis_synthesis_blockin(vorbis_dsp_state *v,vorbis_block *vb){
       _analysis_output("buffered",seq++,v->pcm[j],sizeW+beginW,0,0);
     
     }
+    }
 
     /* deal with initial packet state; we do this using the explicit
        pcm_returned==-1 flag otherwise we're sensitive to first block
@@ -790,8 +828,10 @@ int vorbis_synthesis_blockin(vorbis_dsp_state *v,vorbis_block *vb){
 /* pcm==NULL indicates we just want the pending samples, no more */
 int vorbis_synthesis_pcmout(vorbis_dsp_state *v,float ***pcm){
   vorbis_info *vi=v->vi;
+  backend_lookup_state *b=v->backend_state;
   if(v->pcm_returned>-1 && v->pcm_returned<v->centerW){
     if(pcm){
+      if(b->lapp)return(OV_EINVAL); /* use vorbis_synthesis_pcmout16() */
       int i;
       for(i=0;i<vi->channels;i++)
 	v->pcmret[i]=v->pcm[i]+v->pcm_returned;
@@ -808,3 +848,101 @@ int vorbis_synthesis_read(vorbis_dsp_state *v,int bytes){
   return(0);
 }
 
+/* Fused synthesis ***************************************************
+
+   Switches a freshly initialized synthesis state to fused output :
+   blocks are kept as their n/2 distinct IMDCT values (see
+   mdct_backward_half()) and the window, overlap/add and float to 16
+   bit conversion are done in a single pass by
+   vorbis_synthesis_pcmout16(). This saves the unrolling and
+   windowing of whole blocks, the PCM buffer and its shifts.
+
+   Call it after vorbis_synthesis_init(), before the first block. Use
+   vorbis_synthesis_pcmout16() instead of vorbis_synthesis_pcmout()
+   (which then only tells the number of pending samples). All pending
+   samples must be read (or skipped with vorbis_synthesis_read())
+   before the next vorbis_synthesis_blockin(). */
+
+int vorbis_synthesis_fused(vorbis_dsp_state *v){
+  vorbis_info *vi=v->vi;
+  codec_setup_info *ci=vi->codec_setup;
+  backend_lookup_state *b=v->backend_state;
+  int i,j;
+
+  if(v->analysisp || b->lapp)return(OV_EINVAL);
+
+  for(j=0;j<2;j++){
+    b->lap[j]=_ogg_calloc(vi->channels,sizeof(float *));
+    for(i=0;i<vi->channels;i++)
+      b->lap[j][i]=_ogg_calloc(ci->blocksizes[1]/2,sizeof(float));
+    b->lapwindow[j]=b->window[0][0][0][0];
+    b->lapn[j]=ci->blocksizes[0];
+  }
+  b->lapp=1;
+  return(0);
+}
+
+STIN ogg_int16_t _lap_pcm16(float v){
+  int val=(int)(v*32767.f);
+  if(val>32767)val=32767;
+  else if(val<-32768)val=-32768;
+  return(val);
+}
+
+/* Lap channel ch of the two last blocks into interleaved 16 bit PCM,
+   samples [from,to) past the center of the previous block. With
+   p = previous, c = last block, the windows are 1 until the overlap
+   of the smaller one for a long p, and from it for a long c. Both
+   IMDCT outputs are mirrored at the middle of the overlap (np/4),
+   see mdct_backward_half(). */
+static void _lap_channel(backend_lookup_state *b,int ch,int from,int to,
+			 ogg_int16_t *out,int step){
+  int np2=b->lapn[0]>>1,np4=b->lapn[0]>>2;
+  int nc2=b->lapn[1]>>1,nc4=b->lapn[1]>>2;
+  int mn4=(np4<nc4?np4:nc4);
+  int lap0=np4-mn4;            /* overlap in p */
+  int lap1=np4+mn4;
+  int dc=nc4-np4;              /* index in c - index in p */
+  float *p=b->lap[0][ch];
+  float *c=b->lap[1][ch];
+  float *wp=b->lapwindow[0]+np2;
+  float *wc=b->lapwindow[1]+dc;
+  int i=from,end;
+
+  /* flat window of p */
+  for(end=(to<lap0?to:lap0);i<end;i++,out+=step)
+    *out=_lap_pcm16(p[np2-1-i]);
+
+  /* overlap, first half */
+  for(end=(to<np4?to:np4);i<end;i++,out+=step)
+    *out=_lap_pcm16(p[np2-1-i]*wp[i]+c[i+dc]*wc[i]);
+
+  /* overlap, second half */
+  for(end=(to<lap1?to:lap1);i<end;i++,out+=step)
+    *out=_lap_pcm16(p[i]*wp[i]-c[nc2-1-dc-i]*wc[i]);
+
+  /* flat window of c */
+  for(;i<to;i++,out+=step)
+    *out=_lap_pcm16(-c[nc2-1-dc-i]);
+}
+
+/* Writes up to samples interleaved 16 bit samples per channel,
+   returns the number written. */
+int vorbis_synthesis_pcmout16(vorbis_dsp_state *v,ogg_int16_t *pcm,
+			      int samples){
+  vorbis_info *vi=v->vi;
+  backend_lookup_state *b=v->backend_state;
+  int i,n,from;
+
+  if(!b->lapp)return(OV_EINVAL);
+  n=vorbis_synthesis_pcmout(v,NULL);
+  if(n>samples)n=samples;
+  if(n<=0)return(0);
+
+  from=v->pcm_returned-b->lapcenter;
+  for(i=0;i<vi->channels;i++)
+    _lap_channel(b,i,from,from+n,pcm+i,vi->channels);
+  v->pcm_returned+=n;
+  return(n);
+}
+
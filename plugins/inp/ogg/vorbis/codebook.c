@@ -313,17 +313,38 @@ int vorbis_book_encodevs(codebook *book,float *a,oggpack_buffer *b,
    addmul==1 -> additive
    addmul==2 -> multiplicitive */
 
+/* oggpack_look() for the first level lookup (bits <= 24), inlined as
+   it is the inner loop of the floor and residue decode. Away from the
+   packet end, the 4 next bytes are always there. */
+STIN long _book_look(oggpack_buffer *b,int bits){
+  if(b->endbyte+4<b->storage){
+    unsigned long ret=
+      (b->ptr[0] | (b->ptr[1]<<8) | (b->ptr[2]<<16) |
+       ((unsigned long)b->ptr[3]<<24)) >> b->endbit;
+    return(ret&((1UL<<bits)-1));
+  }
+  return(oggpack_look(b,bits));
+}
+
+STIN void _book_adv(oggpack_buffer *b,int bits){
+  bits+=b->endbit;
+  b->ptr+=bits>>3;
+  b->endbyte+=bits>>3;
+  b->endbit=bits&7;
+}
+
 /* returns the entry number or -1 on eof *************************************/
-long vorbis_book_decode(codebook *book, oggpack_buffer *b){
+STIN long _book_decode(codebook *book, oggpack_buffer *b){
   long ptr=0;
   decode_aux *t=book->decode_tree;
-  int lok = oggpack_look(b, t->tabn);
+  long lok = _book_look(b, t->tabn);
 
   if (lok >= 0) {
-    ptr = t->tab[lok];
-    oggpack_adv(b, t->tabl[lok]);
-    if (ptr <= 0)
-      return -ptr;
+    long v = t->tab[lok];
+    _book_adv(b, v & DECODE_TAB_BITS);
+    ptr = v >> DECODE_TAB_SHIFT;
+    if (v & DECODE_TAB_LEAF)
+      return ptr;
   }
 
   do{
@@ -341,6 +362,10 @@ long vorbis_book_decode(codebook *book, oggpack_buffer *b){
   return(-ptr);
 }
 
+long vorbis_book_decode(codebook *book, oggpack_buffer *b){
+  return(_book_decode(book,b));
+}
+
 /* returns 0 on OK or -1 on eof *************************************/
 long vorbis_book_decodevs_add(codebook *book,float *a,oggpack_buffer *b,int n){
   int step=n/book->dim;
@@ -349,7 +374,7 @@ long vorbis_book_decodevs_add(codebook *book,float *a,oggpack_buffer *b,int n){
   int i,j,o;
 
   for (i = 0; i < step; i++) {
-    entry[i]=vorbis_book_decode(book,b);
+    entry[i]=_book_decode(book,b);
     if(entry[i]==-1)return(-1);
     t[i] = book->valuelist+entry[i]*book->dim;
   }
@@ -365,7 +390,7 @@ long vorbis_book_decodev_add(codebook *book,float *a,oggpack_buffer *b,int n){
 
   if(book->dim>8){
     for(i=0;i<n;){
-      entry = vorbis_book_decode(book,b);
+      entry = _book_decode(book,b);
       if(entry==-1)return(-1);
       t     = book->valuelist+entry*book->dim;
       for (j=0;j<book->dim;)
@@ -373,7 +398,7 @@ long vorbis_book_decodev_add(codebook *book,float *a,oggpack_buffer *b,int n){
     }
   }else{
     for(i=0;i<n;){
-      entry = vorbis_book_decode(book,b);
+      entry = _book_decode(book,b);
       if(entry==-1)return(-1);
       t     = book->valuelist+entry*book->dim;
       j=0;
@@ -407,7 +432,7 @@ long vorbis_book_decodev_set(codebook *book,float *a,oggpack_buffer *b,int n){
   float *t;
 
   for(i=0;i<n;){
-    entry = vorbis_book_decode(book,b);
+    entry = _book_decode(book,b);
     if(entry==-1)return(-1);
     t     = book->valuelist+entry*book->dim;
     for (j=0;j<book->dim;)
@@ -421,8 +446,25 @@ long vorbis_book_decodevv_add(codebook *book,float **a,long offset,int ch,
   long i,j,k,entry;
   int chptr=0;
 
+  if(ch==2 && !(book->dim&1)){
+    /* stereo, even dim : every vector fills whole sample pairs */
+    float *a0=a[0],*a1=a[1];
+    for(i=offset/2;i<(offset+n)/2;){
+      entry = _book_decode(book,b);
+      if(entry==-1)return(-1);
+      {
+	const float *t = book->valuelist+entry*book->dim;
+	for (j=0;j<book->dim;j+=2,i++){
+	  a0[i]+=t[j];
+	  a1[i]+=t[j+1];
+	}
+      }
+    }
+    return(0);
+  }
+
   for(i=offset/ch;i<(offset+n)/ch;){
-    entry = vorbis_book_decode(book,b);
+    entry = _book_decode(book,b);
     if(entry==-1)return(-1);
     {
       const float *t = book->valuelist+entry*book->dim;
@@ -97,8 +97,8 @@ typedef struct encode_aux_pigeonhole{
 } encode_aux_pigeonhole;
 
 typedef struct decode_aux{
-  long   *tab;
-  int    *tabl;
+  long   *tab;       /* first tabn bits lookup : tree node or entry, see
+			DECODE_TAB_* */
   int    tabn;
 
   long   *ptr0;
@@ -106,6 +106,13 @@ typedef struct decode_aux{
   long   aux;        /* number of tree entries */
 } decode_aux;
 
+/* decode_aux.tab[] values : (node or entry)<<DECODE_TAB_SHIFT, leaf
+   flag and number of bits used */
+#define DECODE_TAB_BITS  31
+#define DECODE_TAB_LEAF  32
+#define DECODE_TAB_SHIFT 6
+#define DECODE_TAB_MAX   8  /* tabn limit for short codewords */
+
 typedef struct codebook{
   long dim;           /* codebook dimensions (elements per vector) */
   long entries;       /* codebook entries */
@@ -65,7 +65,15 @@ typedef struct backend_lookup_state {
   unsigned char *header;
   unsigned char *header1;
   unsigned char *header2;
-  
+
+  /* fused synthesis (vorbis_synthesis_fused()); decode side only.
+     Index 0 is the previous block, 1 the last block added. */
+  int            lapp;
+  float        **lap[2];       /* see mdct_backward_half() */
+  float         *lapwindow[2];
+  int            lapn[2];      /* block sizes */
+  int            lapcenter;    /* center of the previous block */
+
 } backend_lookup_state;
 
 /* vorbis_info contains all the setup information specific to the
@@ -673,6 +673,19 @@ static int mapping0_inverse(vorbis_block *vb,vorbis_look_mapping *l){
 
   /* transform the PCM data; takes PCM vector, vb; modifies PCM vector */
   /* only MDCT right now.... */
+  if(b->lapp){
+    /* fused synthesis : only the distinct half of the IMDCT, in
+       pcm[n/2..n); windowing is done when lapping (see block.c) */
+    for(i=0;i<vi->channels;i++){
+      float *pcm=vb->pcm[i];
+      if(nonzero[i])
+	mdct_backward_half(b->transform[vb->W][0],pcm,pcm);
+      else
+	memset(pcm+n/2,0,sizeof(float)*n/2);
+    }
+    return(0);
+  }
+
   for(i=0;i<vi->channels;i++){
     float *pcm=vb->pcm[i];
     _analysis_output("out",seq+i,pcm,n/2,1,1);
@@ -400,7 +400,9 @@ STIN void mdct_bitreverse(mdct_lookup *init,
   }while(w0<w1);
 }
 
-void mdct_backward(mdct_lookup *init, DATA_TYPE *in, DATA_TYPE *out){
+/* everything but the final unrolling; the n/2 distinct output
+   values are left in out[n/2..n) */
+STIN void mdct_backward_core(mdct_lookup *init, DATA_TYPE *in, DATA_TYPE *out){
   int n=init->n;
   int n2=n>>1;
   int n4=n>>2;
@@ -465,6 +467,22 @@ void mdct_backward(mdct_lookup *init, DATA_TYPE *in, DATA_TYPE *out){
       iX    +=   8;
       T     +=   8;
     }while(iX<oX1);
+  }
+}
+
+void mdct_backward(mdct_lookup *init, DATA_TYPE *in, DATA_TYPE *out){
+  int n=init->n;
+  int n2=n>>1;
+  int n4=n>>2;
+
+  mdct_backward_core(init,in,out);
+
+  /* unroll */
+
+  {
+    DATA_TYPE *oX1;
+    DATA_TYPE *oX2;
+    DATA_TYPE *iX;
 
     iX=out+n2+n4;
     oX1=out+n4;
@@ -496,6 +514,21 @@ void mdct_backward(mdct_lookup *init, DATA_TYPE *in, DATA_TYPE *out){
   }
 }
 
+/* Same as mdct_backward() without the final unrolling. Only the n/2
+   distinct values d[] are computed, in out[n/2..n). The full output
+   is, for 0 <= i < n/4 :
+
+     out[i]       =  d[i]
+     out[n/4+i]   = -d[n/4-1-i]
+     out[n/2+i]   =  d[n/2-1-i]
+     out[3*n/4+i] =  d[n/4+i]
+
+   which is what the fused synthesis lapping expects (see
+   codec_internal.h and block.c) */
+void mdct_backward_half(mdct_lookup *init, DATA_TYPE *in, DATA_TYPE *out){
+  mdct_backward_core(init,in,out);
+}
+
 void mdct_forward(mdct_lookup *init, DATA_TYPE *in, DATA_TYPE *out){
   int n=init->n;
   int n2=n>>1;
@@ -141,7 +141,7 @@ long *_make_words(long *l,long n){
 /* build the decode helper tree from the codewords */
 decode_aux *_make_decode_tree(codebook *c){
   const static_codebook *s=c->c;
-  long top=0,i,j,n;
+  long top=0,i,j,n,maxlen=0;
   decode_aux *t=_ogg_malloc(sizeof(decode_aux));
   long *ptr0=t->ptr0=_ogg_calloc(c->entries*2,sizeof(long));
   long *ptr1=t->ptr1=_ogg_calloc(c->entries*2,sizeof(long));
@@ -151,6 +151,7 @@ decode_aux *_make_decode_tree(codebook *c){
   t->aux=c->entries*2;
 
   for(i=0;i<c->entries;i++){
+    if(s->lengthlist[i]>maxlen)maxlen=s->lengthlist[i];
     if(s->lengthlist[i]>0){
       long ptr=0;
       for(j=0;j<s->lengthlist[i]-1;j++){
@@ -175,9 +176,12 @@ decode_aux *_make_decode_tree(codebook *c){
 
   t->tabn = _ilog(c->entries)-4; /* this is magic */
   if(t->tabn<5)t->tabn=5;
+  /* large enough for all short codewords, so that most are found in a
+     single lookup; the bit by bit walk is for the longer ones */
+  if(maxlen>DECODE_TAB_MAX)maxlen=DECODE_TAB_MAX;
+  if(t->tabn<maxlen)t->tabn=maxlen;
   n = 1<<t->tabn;
   t->tab = _ogg_malloc(n*sizeof(long));
-  t->tabl = _ogg_malloc(n*sizeof(int));
   for (i = 0; i < n; i++) {
     long p = 0;
     for (j = 0; j < t->tabn && (p > 0 || j == 0); j++) {
@@ -187,8 +191,10 @@ decode_aux *_make_decode_tree(codebook *c){
 	p = ptr0[p];
     }
     /* now j == length, and p == -code */
-    t->tab[i] = p;
-    t->tabl[i] = j;
+    if (p > 0)
+      t->tab[i] = (p << DECODE_TAB_SHIFT) | j;
+    else
+      t->tab[i] = (-p << DECODE_TAB_SHIFT) | DECODE_TAB_LEAF | j;
   }
 
   return(t);
@@ -316,7 +322,6 @@ void vorbis_book_clear(codebook *b){
      the static codebook belongs to the info struct */
   if(b->decode_tree){
     _ogg_free(b->decode_tree->tab);
-    _ogg_free(b->decode_tree->tabl);
 
     _ogg_free(b->decode_tree->ptr0);
     _ogg_free(b->decode_tree->ptr1);
@@ -9,6 +9,7 @@
 #include "dcplaya/config.h"
 
 #include <kos/fs.h>
+#include <arch/timer.h>
 #include "fs_rz.h"
 
 //#include <dc/fmath.h>
@@ -321,6 +322,54 @@ static int decoder(playa_info_t * info)
   return (n < 0) ? INP_DECODE_ERROR : status;
 }
 
+/* Seek : the 68K, MFP and chip emulators are prebuilt libraries whose
+ * internal state can not be saved, so there is no snapshot. Restart the
+ * track when seeking backward and run emulation passes up to ms. Output
+ * format conversions are skipped but chips must still be mixed since
+ * their emulation (YM envelopes, STE and Paula DMA) advances in mixing.
+ */
+static int seek(unsigned int ms, playa_info_t * info)
+{
+  const uint64 start = timer_ms_gettime64();
+  int passes = 0;
+
+  if (!app.cur_disk || !app.cur_mus) {
+    return -1;
+  }
+  if (ms < app.time.elapsed_ms) {
+    if (SC68track(&app, app.cur_track) < 0) {
+      spool_error_message();
+      return -1;
+    }
+  }
+
+  while (app.time.elapsed_ms < ms) {
+    const unsigned int cycle_this_pass = app.mix.cycleperpass;
+
+    if (app.time.elapsed > app.time.track) {
+      return -1;
+    }
+    EMU68_level_and_interrupt(cycle_this_pass);
+    app.mix.buflen = app.cur_mus->flags.ym
+      ? YM_mix(cycle_this_pass)
+      : app.mix.stdbuflen;
+    app.mix.buf = YM_get_buffer();
+    if (app.cur_mus->flags.ste) {
+      MW_mix(app.mix.buf, app.reg68.mem, app.mix.buflen);
+    } else if (app.cur_mus->flags.amiga) {
+      PL_mix(app.mix.buf, app.reg68.mem,
+	     app.reg68.mem + app.reg68.memsz, app.mix.buflen);
+    }
+    SC68app_advance_time(&app);
+    ++passes;
+  }
+  app.mix.buflen = 0;
+
+  SDDEBUG("sc68 : seek %ums : %d passes in %ums\n",
+	  ms, passes, (int)(timer_ms_gettime64() - start));
+  return 0;
+}
+
 static driver_option_t * options(any_driver_t * d, int idx,
 				 driver_option_t * o)
 {
@@ -459,6 +508,7 @@ static inp_driver_t sc68_driver =
   stop,
   decoder,
   info,
+  seek,
 };
 
 EXPORT_DRIVER(sc68_driver)
@@ -0,0 +1,4 @@
+/* Host stand-in for the KOS <arch/types.h> included by sidtune.cxx. */
+#ifndef _HOST_ARCH_TYPES_H_
+#define _HOST_ARCH_TYPES_H_
+#endif
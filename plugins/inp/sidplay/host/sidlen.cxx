@@ -0,0 +1,167 @@
+/**
+ * @file      sidlen.cxx
+ * @brief     PSID song lengths for the song length database (host tool)
+ * @version   $Id$
+ *
+ *  Usage: sidlen [-q] sid-file ... > songlengths.md5
+ *
+ *  Each subtune is emulated without rendering sound (sidEmuSkipBuffer(),
+ *  the seek fast path) by steps of one 50Hz frame. The length is the
+ *  time of the last SID register change while the master volume is on,
+ *  found the same way nsfinfo does for NSF files : emulate a 2 minutes
+ *  fragment, double it while the registers still changed in the last
+ *  one, up to one hour. Tunes still playing after that get 0:00
+ *  (unknown).
+ *
+ *  Output is in the HVSC Songlengths.md5 format, keyed by the MD5 of the
+ *  whole file like the sidplay driver does (see songlen.h).
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "player.h"
+#include "emucfg.h"
+#include "6510_.h"
+
+extern "C" {
+#include "md5.h"
+};
+
+static const int frequency = 44100;
+static const int frameRate = 50;
+static const unsigned int fragMs = 2 * 60 * 1000;
+static const unsigned int maxMs = 60 * 60 * 1000;
+
+static int quiet;
+
+static ubyte * load_file(const char * fname, int * len)
+{
+  FILE * f = fopen(fname, "rb");
+  ubyte * buf = 0;
+  long size;
+
+  if (!f) {
+    return 0;
+  }
+  if (!fseek(f, 0, SEEK_END) && (size = ftell(f)) > 0
+      && !fseek(f, 0, SEEK_SET)) {
+    buf = (ubyte *)malloc(size);
+    if (buf && fread(buf, 1, size, f) != (size_t)size) {
+      free(buf);
+      buf = 0;
+    }
+    *len = (int)size;
+  }
+  fclose(f);
+  return buf;
+}
+
+/* Returns subtune length in ms (0:unknown). */
+static unsigned int calc_time(emuEngine & engine, sidTune & tune, int track)
+{
+  const udword frameBytes = (frequency / frameRate) * 2; // 16 bit mono
+  const unsigned int frameMs = 1000 / frameRate;
+  ubyte regs[0x19];
+  unsigned int frame, last = 0, prevFrag = 0;
+  unsigned int frag = fragMs / frameMs;
+
+  if (!sidEmuInitializeSong(engine, tune, track)) {
+    fprintf(stderr, "sidlen : track #%d not initialized\n", track);
+    return 0;
+  }
+  memcpy(regs, c64mem2 + 0xd400, sizeof(regs));
+  for (frame = 1; ; ++frame) {
+    sidEmuSkipBuffer(engine, tune, frameBytes);
+    if (memcmp(regs, c64mem2 + 0xd400, sizeof(regs))) {
+      memcpy(regs, c64mem2 + 0xd400, sizeof(regs));
+      if (regs[0x18] & 15) {
+	last = frame;
+      }
+    }
+    if (frame >= frag) {
+      if (last <= prevFrag) {
+	break;
+      }
+      prevFrag = frame;
+      frag <<= 1;
+      if (frag * frameMs > maxMs) {
+	if (!quiet) {
+	  fprintf(stderr, "sidlen : track #%d still playing after %u min\n",
+		  track, maxMs / 60000);
+	}
+	last = 0;
+	break;
+      }
+    }
+  }
+  return last * frameMs;
+}
+
+static int sid_length(emuEngine & engine, const char * fname)
+{
+  char str[MD5_SIZE * 2 + 1];
+  unsigned char digest[MD5_SIZE];
+  sidTuneInfo info;
+  ubyte * buf;
+  int len = 0, track;
+
+  buf = load_file(fname, &len);
+  if (!buf) {
+    fprintf(stderr, "sidlen : [%s] load failed\n", fname);
+    return -1;
+  }
+  md5_sum(buf, len, digest);
+
+  sidTune tune(buf, len);
+  if (!tune.getStatus() || !tune.getInfo(info)) {
+    fprintf(stderr, "sidlen : [%s] not a sid tune\n", fname);
+    free(buf);
+    return -1;
+  }
+
+  printf("; %s\n%s=", fname, md5_str(str, digest));
+  for (track = 1; track <= info.songs; ++track) {
+    unsigned int ms = calc_time(engine, tune, track);
+    printf("%s%u:%02u.%03u", (track > 1) ? " " : "",
+	   ms / 60000u, ms / 1000u % 60u, ms % 1000u);
+    fflush(stdout);
+  }
+  printf("\n");
+  free(buf);
+  return 0;
+}
+
+int main(int na, char ** a)
+{
+  emuEngine engine;
+  emuConfig cfg;
+  int i, err = 0;
+
+  if (na > 1 && !strcmp(a[1], "-q")) {
+    quiet = 1;
+    --na;
+    ++a;
+  }
+  if (na < 2) {
+    fprintf(stderr, "Usage: sidlen [-q] sid-file ... > songlengths.md5\n");
+    return 1;
+  }
+
+  engine.getConfig(cfg);
+  cfg.frequency = frequency;
+  cfg.channels = SIDEMU_MONO;
+  cfg.bitsPerSample = SIDEMU_16BIT;
+  cfg.sampleFormat = SIDEMU_SIGNED_PCM;
+  if (!engine.setConfig(cfg)) {
+    fprintf(stderr, "sidlen : engine configuration failed\n");
+    return 2;
+  }
+
+  printf("[Database]\n");
+  for (i = 1; i < na; ++i) {
+    err |= sid_length(engine, a[i]) < 0;
+  }
+  return err;
+}
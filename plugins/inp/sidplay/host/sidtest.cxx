@@ -0,0 +1,249 @@
+/**
+ * @file      sidtest.cxx
+ * @brief     libsidplay mixer tests and realtime factor (host tool)
+ * @version   $Id$
+ *
+ *  Usage: sidtest [seconds]
+ *
+ *  A tune whose play routine does nothing is played while the test
+ *  writes random values to the SID registers before each buffer fill
+ *  (all waveforms, hard sync and ring modulation, filter, volume).
+ *  For each output format (8/16 bit, mono/stereo) :
+ *
+ *  - block : the output of the block voice rendering must be the same
+ *    as the per-sample loops (mixerBlockRendering cleared).
+ *  - golden : with the filter off, the output checksum must be the one
+ *    recorded with the previous mixer (waveform tables, per-sample
+ *    loops only). The filter uses floats, so it is left out there.
+ *  - os 2, os 4 : the oversampled output at 1/2 and 1/4 of the
+ *    frequency (the SID running at the frequency) must be the average of
+ *    each group of 2 or 4 samples rendered without oversampling. Then
+ *    the realtime factor at the full frequency is measured.
+ *
+ *  The realtime factor of each run is printed. Returns 0 if all checks
+ *  pass.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "player.h"
+#include "emucfg.h"
+
+extern ubyte* c64mem2;
+extern bool mixerBlockRendering;  // -> mixing.cxx
+
+static const udword frequency = 44100;
+static const udword fillBytes = 1024;   // per fill at 1x frequency
+static const int goldenSeconds = 30;
+
+static unsigned int seed;
+
+static unsigned int rnd()
+{
+  seed = seed * 1103515245u + 12345u;
+  return seed >> 8;
+}
+
+/* Silent PSID : init and play are a RTS at $1000. */
+static ubyte psid[0x100] = {
+  'P','S','I','D', 0,1, 0,0x76, 0,0, 0x10,0x00, 0x10,0x00, 0,1, 0,1
+};
+static const ubyte psidData[4] = { 0x00, 0x10, 0x60, 0x60 };
+
+/* Random SID register writes, before each fill. */
+static void write_registers()
+{
+  static const ubyte waves[] = {
+    0x10,0x20,0x40,0x80,0x30,0x50,0x60,0x70,             // plain, combined
+    0x14,0x34,0x12,0x22,0x42,0x08,0x00,0x11,0x21,0x41,0x81 // ring, sync...
+  };
+  int v;
+
+  for (v = 0; v < 3; ++v) {
+    int r = 0xd400 + v * 7;
+    unsigned int x = rnd();
+    if (!(x & 7)) {
+      c64mem2[r] = rnd();
+      c64mem2[r + 1] = rnd() & ((x & 8) ? 0x3f : 0xff);
+    }
+    if (!(x & 0x30)) {
+      c64mem2[r + 2] = rnd();
+      c64mem2[r + 3] = rnd() & 15;
+    }
+    if (!(x & 0x3c0)) {
+      c64mem2[r + 4] = waves[rnd() % sizeof(waves)] | (rnd() & 1);
+    }
+    if (!(x & 0xc00)) {
+      c64mem2[r + 5] = rnd();
+      c64mem2[r + 6] = rnd();
+    }
+  }
+  if (!(rnd() & 15)) {
+    c64mem2[0xd415] = rnd() & 7;
+    c64mem2[0xd416] = rnd();
+    c64mem2[0xd417] = rnd();
+    c64mem2[0xd418] = (rnd() & 0x70) | 15;
+  }
+}
+
+struct run {
+  int channels, bits, oversampling;
+  udword frequency;
+  bool filter, block;
+};
+
+/* Plays seconds of random writes. Fills out (if not 0) with the output,
+ * returns its checksum and the CPU time in *sec. */
+static unsigned int render(emuEngine & engine, const run & r, int seconds,
+			   ubyte * out, double * sec)
+{
+  static ubyte buf[fillBytes];
+  udword len = fillBytes * r.frequency / frequency;
+  long fills = (long)seconds * frequency * r.channels * (r.bits / 8)
+    / fillBytes;
+  unsigned int sum = 0;
+  clock_t t = 0;
+  emuConfig cfg;
+
+  engine.getConfig(cfg);
+  cfg.frequency = r.frequency;
+  cfg.channels = (r.channels == 2) ? SIDEMU_STEREO : SIDEMU_MONO;
+  cfg.bitsPerSample = (r.bits == 8) ? SIDEMU_8BIT : SIDEMU_16BIT;
+  cfg.sampleFormat = SIDEMU_SIGNED_PCM;
+  cfg.emulateFilter = r.filter;
+  cfg.oversampling = r.oversampling;
+  if (!engine.setConfig(cfg)) {
+    fprintf(stderr, "sidtest : engine configuration failed\n");
+    exit(2);
+  }
+
+  sidTune tune(psid, sizeof(psid));
+  if (!tune.getStatus() || !sidEmuInitializeSong(engine, tune, 1)) {
+    fprintf(stderr, "sidtest : tune not initialized\n");
+    exit(2);
+  }
+
+  mixerBlockRendering = r.block;
+  seed = 12345;
+  for (long f = 0; f < fills; ++f) {
+    clock_t t0;
+
+    write_registers();
+    t0 = clock();
+    sidEmuFillBuffer(engine, tune, buf, len);
+    t += clock() - t0;
+    for (udword i = 0; i < len; ++i) {
+      sum = sum * 31 + buf[i];
+    }
+    if (out) {
+      memcpy(out, buf, len);
+      out += len;
+    }
+  }
+  mixerBlockRendering = true;
+  *sec = (double)t / CLOCKS_PER_SEC;
+  return sum;
+}
+
+/* Averages groups of n samples as the oversampling mixer does. */
+template <class T>
+static void average(T * out, const T * in, long samples, int channels, int n)
+{
+  int shift = (n == 4) ? 2 : 1;
+  for (long i = 0; i < samples; ++i) {
+    for (int c = 0; c < channels; ++c) {
+      sdword acc = 0;
+      for (int k = 0; k < n; ++k) {
+	acc += in[(i * n + k) * channels + c];
+      }
+      *out++ = (T)(acc >> shift);
+    }
+  }
+}
+
+static int failed;
+
+static void report(const char * name, const run & r, int seconds, double sec,
+		   unsigned int sum, bool ok)
+{
+  printf("  %-7s %2d bit %-6s %5u Hz  os %d  %s  x%5.0f  %08x %s\n",
+	 name, r.bits, (r.channels == 2) ? "stereo" : "mono",
+	 (unsigned int)r.frequency, r.oversampling,
+	 r.filter ? "filter" : "      ", seconds / (sec > 0 ? sec : 1e-9),
+	 sum, ok ? "" : "DIFFERS");
+  failed |= !ok;
+}
+
+int main(int na, char ** a)
+{
+  /* Filter off, checksums of goldenSeconds with the previous mixer. */
+  static const unsigned int golden[2][2] = {
+    /* 8 bit mono, stereo */  { 0xc18d4209, 0xc5a82744 },
+    /* 16 bit mono, stereo */ { 0xaf6d4d73, 0x82065ba4 },
+  };
+  int seconds = (na > 1) ? atoi(a[1]) : goldenSeconds;
+  emuEngine engine;
+
+  if (seconds <= 0) {
+    fprintf(stderr, "Usage: sidtest [seconds]\n");
+    return 1;
+  }
+  memcpy(psid + 0x76, psidData, sizeof(psidData));
+  printf("sidtest : %d s per run, realtime factor, output checksum\n",
+	 seconds);
+
+  for (int bits = 8; bits <= 16; bits += 8) {
+    for (int channels = 1; channels <= 2; ++channels) {
+      long bytes = (long)seconds * frequency * channels * (bits / 8)
+	/ fillBytes * fillBytes;
+      ubyte * out = (ubyte *)malloc(bytes);
+      ubyte * ref = (ubyte *)malloc(bytes);
+      ubyte * avg = (ubyte *)malloc(bytes / 2);
+      run r = { channels, bits, 1, frequency, true, true };
+      unsigned int sum, refSum;
+      double sec, refSec;
+
+      /* block rendering against the per-sample loops */
+      sum = render(engine, r, seconds, 0, &sec);
+      r.block = false;
+      refSum = render(engine, r, seconds, 0, &refSec);
+      report("sample", r, seconds, refSec, refSum, true);
+      r.block = true;
+      report("block", r, seconds, sec, sum, sum == refSum);
+
+      /* filter off against the previous mixer */
+      r.filter = false;
+      sum = render(engine, r, seconds, 0, &sec);
+      report("golden", r, seconds, sec, sum, seconds != goldenSeconds
+	     || sum == golden[bits / 8 - 1][channels - 1]);
+      r.filter = true;
+
+      /* oversampling against averaging at the frequency */
+      render(engine, r, seconds, ref, &refSec);
+      for (int os = 2; os <= 4; os <<= 1) {
+	r.oversampling = os;
+	r.frequency = frequency / os;
+	sum = render(engine, r, seconds, out, &sec);
+	if (bits == 8) {
+	  average((sbyte *)avg, (const sbyte *)ref, bytes / os / channels,
+		  channels, os);
+	} else {
+	  average((sword *)avg, (const sword *)ref, bytes / 2 / os / channels,
+		  channels, os);
+	}
+	report("os", r, seconds, sec, sum, !memcmp(out, avg, bytes / os));
+	r.frequency = frequency;
+	sum = render(engine, r, seconds, 0, &sec);
+	report("os", r, seconds, sec, sum, true);
+	r.oversampling = 1;
+      }
+      free(avg);
+      free(ref);
+      free(out);
+    }
+  }
+  return failed;
+}
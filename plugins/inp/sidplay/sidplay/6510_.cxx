@@ -47,6 +47,7 @@
 #ifdef SID_HAVE_EXCEPTIONS
 #include <new>
 #endif
+#include <string.h>
 #include "6510_.h"
 #include "myendian.h"
 #include "emucfg.h"
@@ -1991,3 +1992,72 @@ ubyte c64memRamRom( uword address )
 		}
 	}
 }
+
+
+// ------------------------------------------------------- State snapshots
+//
+// BEN : The 6510 registers are reset at each player call, only memory
+// and SID access state have to be saved. Only the I/O area of the ROM
+// buffer can be written.
+
+struct c64memState
+{
+	bool sidKeysOff[32];
+	bool sidKeysOn[32];
+	ubyte sidLastValue;
+	ubyte optr3readWave;
+	ubyte optr3readEnve;
+	bool isBasic, isIO, isKernal;
+	udword fakeReadTimer;
+};
+
+udword c64memStateSize()
+{
+	return sizeof(c64memState) + 65536 + ((c64mem2 != c64mem1) ? 0x1000 : 0);
+}
+
+void* c64memSaveState(void* buffer)
+{
+	c64memState* state = (c64memState*)buffer;
+	ubyte* mem = (ubyte*)(state+1);
+	memcpy(state->sidKeysOff, sidKeysOff, sizeof(sidKeysOff));
+	memcpy(state->sidKeysOn, sidKeysOn, sizeof(sidKeysOn));
+	state->sidLastValue = sidLastValue;
+	state->optr3readWave = optr3readWave;
+	state->optr3readEnve = optr3readEnve;
+	state->isBasic = isBasic;
+	state->isIO = isIO;
+	state->isKernal = isKernal;
+	state->fakeReadTimer = fakeReadTimer;
+	memcpy(mem, c64mem1, 65536);
+	mem += 65536;
+	if (c64mem2 != c64mem1)
+	{
+		memcpy(mem, c64mem2+0xd000, 0x1000);
+		mem += 0x1000;
+	}
+	return mem;
+}
+
+const void* c64memLoadState(const void* buffer)
+{
+	const c64memState* state = (const c64memState*)buffer;
+	const ubyte* mem = (const ubyte*)(state+1);
+	memcpy(sidKeysOff, state->sidKeysOff, sizeof(sidKeysOff));
+	memcpy(sidKeysOn, state->sidKeysOn, sizeof(sidKeysOn));
+	sidLastValue = state->sidLastValue;
+	optr3readWave = state->optr3readWave;
+	optr3readEnve = state->optr3readEnve;
+	isBasic = state->isBasic;
+	isIO = state->isIO;
+	isKernal = state->isKernal;
+	fakeReadTimer = state->fakeReadTimer;
+	memcpy(c64mem1, mem, 65536);
+	mem += 65536;
+	if (c64mem2 != c64mem1)
+	{
+		memcpy(c64mem2+0xd000, mem, 0x1000);
+		mem += 0x1000;
+	}
+	return mem;
+}
@@ -22,6 +22,11 @@ extern void c64memClear();
 extern void c64memReset(int clockSpeed, ubyte randomSeed);
 extern ubyte c64memRamRom(uword address);
 
+// BEN : state snapshots, buffers are advanced past the saved data.
+extern udword c64memStateSize();
+extern void* c64memSaveState(void* buffer);
+extern const void* c64memLoadState(const void* buffer);
+
 extern void initInterpreter(int memoryMode);
 extern bool interpreter(uword pc, ubyte ramrom, ubyte a, ubyte x, ubyte y);
 
@@ -81,9 +81,6 @@ static ubyte filterType = 0;
 static ubyte filterCurType = 0;
 static uword filterValue;
 
-static ubyte triangleTable[4096];
-static ubyte sawtoothTable[4096];
-static ubyte squareTable[2*4096];
 static ubyte* waveform30;
 static ubyte* waveform50;
 static ubyte* waveform60;
@@ -100,6 +97,8 @@ static ubyte noiseTableLSB[1<<8];
 static const udword noiseSeed = 0x7ffff8;
 udword PCMfreq;
 static udword PCMsid, PCMsidNoise;
+// Lowest played frequency : cycleLen must fit in 16 bits.
+static udword minSIDfreq = 16;
 
 // Song clock speed (PAL or NTSC). Does not affect pitch.
 static udword sidtuneClockSpeed = 985248;
@@ -310,18 +309,38 @@ inline void noiseAdvanceHp(sidOperator* pVoice)
 }
 
 
+// BEN : The basic waveforms are computed from the 12-bit wave step
+// instead of being read from 4K tables. Only the combined waveforms,
+// which are sampled from real chips, still need a table.
+inline ubyte waveTriangle(uword step)
+{
+  // Rising half : step/8, falling half : (4095-step)/8.
+  return (ubyte)(((step ^ (0 - (step >> 11))) & 0x7ff) >> 3);
+}
+
+inline ubyte waveSawtooth(uword step)
+{
+  return (ubyte)(step >> 4);
+}
+
+inline ubyte waveSquare(uword stepPulse)
+{
+  // stepPulse = step + 4096 - pulse width, 0..8191.
+  return (ubyte)(0 - (stepPulse >> 12));
+}
+
 #if defined(DIRECT_FIXPOINT)
-#define triangle triangleTable[pVoice->waveStep.w[HI]]
-#define sawtooth sawtoothTable[pVoice->waveStep.w[HI]]
-#define square squareTable[pVoice->waveStep.w[HI] + pVoice->pulseIndex]
+#define triangle waveTriangle(pVoice->waveStep.w[HI])
+#define sawtooth waveSawtooth(pVoice->waveStep.w[HI])
+#define square waveSquare(pVoice->waveStep.w[HI] + pVoice->pulseIndex)
 #define triSaw waveform30[pVoice->waveStep.w[HI]]
 #define triSquare waveform50[pVoice->waveStep.w[HI] + pVoice->SIDpulseWidth]
 #define sawSquare waveform60[pVoice->waveStep.w[HI] + pVoice->SIDpulseWidth]
 #define triSawSquare waveform70[pVoice->waveStep.w[HI] + pVoice->SIDpulseWidth]
 #else
-#define triangle triangleTable[pVoice->waveStep]
-#define sawtooth sawtoothTable[pVoice->waveStep]
-#define square squareTable[pVoice->waveStep + pVoice->pulseIndex]
+#define triangle waveTriangle(pVoice->waveStep)
+#define sawtooth waveSawtooth(pVoice->waveStep)
+#define square waveSquare(pVoice->waveStep + pVoice->pulseIndex)
 #define triSaw waveform30[pVoice->waveStep]
 #define triSquare waveform50[pVoice->waveStep + pVoice->SIDpulseWidth]
 #define sawSquare waveform60[pVoice->waveStep + pVoice->SIDpulseWidth]
@@ -828,8 +847,9 @@ inline void sidEmuSet2(struct sidOperator* pVoice)
 {
   pVoice->outProc = &waveCalcNormal;
   pVoice->sync = false;
+  pVoice->ringMod = false;
 
-  if ( (pVoice->SIDfreq < 16)
+  if ( (pVoice->SIDfreq < minSIDfreq)
        || ((pVoice->SIDctrl & 8) != 0) )
     {
       pVoice->outProc = &waveCalcMute;
@@ -914,7 +934,10 @@ inline void sidEmuSet2(struct sidOperator* pVoice)
 	}
 		
       if ((( pVoice->SIDctrl & 0x14 ) == 0x14 ) && ( pVoice->modulator->SIDfreq != 0 ))
-	pVoice->waveProc = sidModeRingTable[pVoice->SIDctrl >> 4];
+	{
+	  pVoice->waveProc = sidModeRingTable[pVoice->SIDctrl >> 4];
+	  pVoice->ringMod = true;
+	}
       else
 	pVoice->waveProc = sidModeNormalTable[pVoice->SIDctrl >> 4];
     }
@@ -924,6 +947,7 @@ inline void sidEmuSet2(struct sidOperator* pVoice)
 
 static uword toFill;
 ubyte bufferScale;
+ubyte oversamplingShift;  // emulated samples per output sample (log2)
 ubyte playRamRom;
 
 #if defined(SIDEMU_TIME_COUNT)
@@ -974,6 +998,9 @@ void sidEmuFillBuffer( emuEngine& thisEmu,
 	  thisEmu.secondsThisSong++;
 	}
 #endif
+
+      // The fill function gets emulated samples.
+      bufferLen <<= oversamplingShift;
 		
       while ( bufferLen > 0 )
 	{
@@ -1126,27 +1153,7 @@ bool sidEmuFastForwardReplay( int percent )
 
 void initWaveformTables(bool isNewSID)
 {
-  int i,j;
-  uword k;
-	
-  k = 0;
-  for ( i = 0; i < 256; i++ )
-    for ( j = 0; j < 8; j++ )  
-      triangleTable[k++] = i;
-  for ( i = 255; i >= 0; i-- )
-    for ( j = 0; j < 8; j++ )  
-      triangleTable[k++] = i;
-	
-  k = 0;
-  for ( i = 0; i < 256; i++ )
-    for ( j = 0; j < 16; j++ )  
-      sawtoothTable[k++] = i;
-	
-  k = 0;
-  for ( i = 0; i < 4096; i++ )  
-    squareTable[k++] = 0;
-  for ( i = 0; i < 4096; i++ )  
-    squareTable[k++] = 255;
+  int i;
 
   if ( isNewSID )
     {
@@ -1236,6 +1243,10 @@ void sidEmuConfigureClock( int clockSpeed )
     
   PCMsid = (udword)(PCMfreq * (16777216.0 / C64_fClockSpeed));
   PCMsidNoise = (udword)((C64_fClockSpeed*256.0)/PCMfreq);
+  // Below 1 Hz at 44.1 kHz, a few Hz with oversampling : not audible.
+  minSIDfreq = PCMsid / 65535 + 1;
+  if (minSIDfreq < 16)
+    minSIDfreq = 16;
 
   sidEmuChangeReplayingSpeed();
   sampleEmuInit();
@@ -1309,6 +1320,7 @@ void clearSidOperator( struct sidOperator* pVoice )
   pVoice->SIDSR = 0;
 
   pVoice->sync = false;
+  pVoice->ringMod = false;
 	
   pVoice->pulseIndex = (pVoice->newPulseIndex = (pVoice->SIDpulseWidth = 0));
   pVoice->curSIDfreq = (pVoice->curNoiseFreq = 0);
@@ -1491,3 +1503,119 @@ uword sidEmuReturnVoiceVolume( int voice )
     }
   return (left&0xff00)|(right>>8);
 }
+
+
+// ------------------------------------------------------- State snapshots
+//
+// BEN : Used for seeking. A state is valid for the current song and
+// emulator configuration only. Voice operators only point to static data
+// and functions, they are copied as is.
+
+struct sidEmuState
+{
+  sidOperator optr1, optr2, optr3;
+  uword voice4_gainLeft, voice4_gainRight;
+  bool updateAutoPanning;
+  uword apCount;
+  ubyte filterType, filterCurType;
+  uword filterValue;
+  filterfloat filterDy, filterResDy;
+#if defined(DIRECT_FIXPOINT)
+  cpuLword VALUES, VALUESadd, VALUESorg;
+#else
+  uword VALUES, VALUESorg;
+  udword VALUESadd, VALUEScomma;
+#endif
+  uword timer, calls, toFill;
+  ubyte masterVolume;
+  uword masterVolumeAmplIndex;
+  ubyte playRamRom;
+};
+
+udword sidEmuStateSize()
+{
+  return sizeof(sidEmuState) + c64memStateSize() + sampleEmuStateSize();
+}
+
+void sidEmuSaveState(void* buffer)
+{
+  sidEmuState* state = (sidEmuState*)buffer;
+  state->optr1 = optr1;
+  state->optr2 = optr2;
+  state->optr3 = optr3;
+  state->voice4_gainLeft = voice4_gainLeft;
+  state->voice4_gainRight = voice4_gainRight;
+  state->updateAutoPanning = updateAutoPanning;
+  state->apCount = apCount;
+  state->filterType = filterType;
+  state->filterCurType = filterCurType;
+  state->filterValue = filterValue;
+  state->filterDy = filterDy;
+  state->filterResDy = filterResDy;
+  state->VALUES = VALUES;
+  state->VALUESadd = VALUESadd;
+  state->VALUESorg = VALUESorg;
+#if !defined(DIRECT_FIXPOINT)
+  state->VALUEScomma = VALUEScomma;
+#endif
+  state->timer = timer;
+  state->calls = calls;
+  state->toFill = toFill;
+  state->masterVolume = masterVolume;
+  state->masterVolumeAmplIndex = masterVolumeAmplIndex;
+  state->playRamRom = playRamRom;
+  sampleEmuSaveState(c64memSaveState(state+1));
+}
+
+void sidEmuLoadState(const void* buffer)
+{
+  const sidEmuState* state = (const sidEmuState*)buffer;
+  optr1 = state->optr1;
+  optr2 = state->optr2;
+  optr3 = state->optr3;
+  voice4_gainLeft = state->voice4_gainLeft;
+  voice4_gainRight = state->voice4_gainRight;
+  updateAutoPanning = state->updateAutoPanning;
+  apCount = state->apCount;
+  filterType = state->filterType;
+  filterCurType = state->filterCurType;
+  filterValue = state->filterValue;
+  filterDy = state->filterDy;
+  filterResDy = state->filterResDy;
+  VALUES = state->VALUES;
+  VALUESadd = state->VALUESadd;
+  VALUESorg = state->VALUESorg;
+#if !defined(DIRECT_FIXPOINT)
+  VALUEScomma = state->VALUEScomma;
+#endif
+  timer = state->timer;
+  calls = state->calls;
+  toFill = state->toFill;
+  masterVolume = state->masterVolume;
+  masterVolumeAmplIndex = state->masterVolumeAmplIndex;
+  playRamRom = state->playRamRom;
+  sampleEmuLoadState(c64memLoadState(state+1));
+}
+
+// BEN : Fast emulation for seeking. Player calls are run as usual but
+// only envelopes and samples are processed between them. Waveforms and
+// filter are not, so voice 3 oscillator reads ($D41B) are approximate.
+static void* skipFill(void* buffer, udword numberOfSamples)
+{
+  for ( ; numberOfSamples > 0; numberOfSamples-- )
+    {
+      (*optr1.ADSRproc)(&optr1);
+      (*optr2.ADSRproc)(&optr2);
+      (*optr3.ADSRproc)(&optr3);
+      (*sampleEmuRout)();
+    }
+  return buffer;
+}
+
+void sidEmuSkipBuffer(emuEngine& thisEmu, sidTune& thisTune, udword bufferLen)
+{
+  void* (*fillFunc)(void*, udword) = sidEmuFillFunc;
+  sidEmuFillFunc = &skipFill;
+  sidEmuFillBuffer(thisEmu, thisTune, 0, bufferLen);
+  sidEmuFillFunc = fillFunc;
+}
@@ -25,6 +25,7 @@ emuEngine::emuEngine()
   config.memoryMode = MPU_BANK_SWITCHING;
   config.clockSpeed = SIDTUNE_CLOCK_PAL;
   config.forceSongSpeed = false;
+  config.oversampling = 1;
 	
 #if defined(SIDEMU_TIME_COUNT)
   // Reset data counter.
@@ -281,6 +282,35 @@ bool emuEngine::setConfig( struct emuConfig& inCfg )
       newSIDconfig = true;
     }
 
+  // The SID runs at frequency * oversampling.
+  int oversampling = config.oversampling;
+#if defined(DIRECT_FIXPOINT)
+  // cycleLen calculation would overflow.
+  if ( inCfg.oversampling == 1 )
+#else
+  if (( inCfg.oversampling == 1 ) || ( inCfg.oversampling == 2 )
+      || ( inCfg.oversampling == 4 ))
+#endif
+    {
+      oversampling = inCfg.oversampling;
+    }
+  else
+    {
+      gotInvalidConfig = true;  // invalid settings
+    }
+  if ((oversampling != 1) && (config.volumeControl == SIDEMU_HWMIXING))
+    {
+      oversampling = 1;
+      gotInvalidConfig = true;  // invalid settings
+    }
+  if (oversampling != config.oversampling)
+    {
+      config.oversampling = oversampling;
+      newSIDconfig = true;
+      newFilterInit = true;
+      newMixerSettings = true;
+    }
+
   // Here re-initialize the SID, if required.
   if (newSIDconfig)
     {
@@ -458,7 +488,8 @@ void emuEngine::configureSID()
 {
   extern void sidEmuConfigure(udword PCMfrequency, bool measuredEnveValues, 
 			      bool isNewSID, bool emulateFilter, int clockSpeed);
-  sidEmuConfigure(config.frequency,config.measuredVolume,config.mos8580,
+  sidEmuConfigure(config.frequency*config.oversampling,
+		  config.measuredVolume,config.mos8580,
 		  config.emulateFilter,config.clockSpeed);
 }
 
@@ -700,6 +731,18 @@ void emuEngine::initMixerEngine()
   // Call a function which inits more local tables.
   extern void MixerInit(bool threeVoiceAmplify, ubyte zero8, uword zero16);
   MixerInit(isThreeVoiceAmplified,zero8bit,zero16bit);
+
+  // Oversampling : the fill function is wrapped to average the
+  // emulated samples down.
+  extern ubyte oversamplingShift;
+  oversamplingShift = 0;
+  while ((1 << oversamplingShift) < config.oversampling)
+    oversamplingShift++;
+  extern void MixerInitOversampling(void* (**fillFunc)(void*, udword),
+				    int bits, bool isSigned, int channels);
+  MixerInitOversampling(&sidEmuFillFunc,config.bitsPerSample,
+			config.sampleFormat == SIDEMU_SIGNED_PCM,
+			(config.channels == SIDEMU_STEREO) ? 2 : 1);
 	
   // ----------------------------------------------------------------------
 	
@@ -769,7 +812,7 @@ void emuEngine::filterTableInit()
   for ( float rk = 0; rk < 0x800; rk++ )
     {
       filterTable[uk] = (((exp(rk/0x800*log(config.filterFs))/config.filterFm)+config.filterFt)
-			 *filterRefFreq) / config.frequency;
+			 *filterRefFreq) / (config.frequency*config.oversampling);
       if ( filterTable[uk] < yMin )
 	filterTable[uk] = yMin;
       if ( filterTable[uk] > yMax )
@@ -786,7 +829,7 @@ void emuEngine::filterTableInit()
   // Some C++ compilers still have non-local scope!
   for ( float rk2 = 0; rk2 < 0x800; rk2++ )
     {
-      bandPassParam[uk] = (yTmp*filterRefFreq) / config.frequency;
+      bandPassParam[uk] = (yTmp*filterRefFreq) / (config.frequency*config.oversampling);
       yTmp += yAdd;
       uk++;
     }
@@ -52,6 +52,9 @@ struct emuConfig
   // scan it for PlaySID Extended SID Register usage.
 
   int autoPanning;       // see below, ``Auto-panning''
+
+  int oversampling;      // 1, 2, 4 : emulated samples per output sample,
+  // averaged down. Not with SIDEMU_HWMIXING.
 };
 
 
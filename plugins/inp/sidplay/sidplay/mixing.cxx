@@ -135,6 +135,50 @@ inline void syncEm()
 }
 
 
+// BEN : Block rendering. Unless a voice depends on another one (hard
+// sync, ring modulation) each voice is rendered for a whole block, which
+// keeps its waveform, envelope and filter code in cache instead of going
+// through the three voices for every sample. Registers only change
+// between two fill calls, so the test is done once per call.
+
+static const udword blockLen = 256;
+static sbyte block1[blockLen], block2[blockLen];
+static sbyte block3[blockLen], block4[blockLen];
+
+// Cleared by the host tests to get the per-sample reference output.
+bool mixerBlockRendering = true;
+
+inline bool voicesDecoupled()
+{
+	return mixerBlockRendering
+		&& !(optr1.sync || optr2.sync || optr3.sync
+			 || optr1.ringMod || optr2.ringMod || optr3.ringMod);
+}
+
+static void renderVoice( sidOperator* pVoice, sbyte* out, udword numberOfSamples )
+{
+	for ( ; numberOfSamples > 0; numberOfSamples-- )
+	{
+		*out++ = (*pVoice->outProc)(pVoice);
+		pVoice->cycleLenCount--;  // see syncEm()
+	}
+}
+
+// Returns number of samples rendered in the blocks.
+static udword renderBlock( udword numberOfSamples )
+{
+	udword n = (numberOfSamples < blockLen) ? numberOfSamples : blockLen;
+	renderVoice(&optr1,block1,n);
+	renderVoice(&optr2,block2,n);
+	renderVoice(&optr3,block3,n);
+	for ( udword i = 0; i < n; i++ )
+	{
+		block4[i] = (*sampleEmuRout)();
+	}
+	return n;
+}
+
+
 //
 // -------------------------------------------------------------------- 8-bit
 //
@@ -142,6 +186,20 @@ inline void syncEm()
 void* fill8bitMono( void* buffer, udword numberOfSamples )
 {
 	ubyte* buffer8bit = (ubyte*)buffer;
+	if ( voicesDecoupled() )
+	{
+		while ( numberOfSamples > 0 )
+		{
+			udword n = renderBlock(numberOfSamples);
+			numberOfSamples -= n;
+			for ( udword i = 0; i < n; i++ )
+			{
+				*buffer8bit++ = mix8mono[(unsigned)(mix8monoMiddleIndex
+													+block1[i]+block2[i]
+													+block3[i]+block4[i])];
+			}
+		}
+	}
 	for ( ; numberOfSamples > 0; numberOfSamples-- )
 	{
 	    *buffer8bit++ = mix8mono[(unsigned)(mix8monoMiddleIndex
@@ -172,6 +230,21 @@ void* fill8bitMonoControl( void* buffer, udword numberOfSamples )
 void* fill8bitStereo( void* buffer, udword numberOfSamples )
 {
 	ubyte* buffer8bit = (ubyte*)buffer;
+	if ( voicesDecoupled() )
+	{
+		while ( numberOfSamples > 0 )
+		{
+			udword n = renderBlock(numberOfSamples);
+			numberOfSamples -= n;
+			for ( udword i = 0; i < n; i++ )
+			{
+				*buffer8bit++ = mix8stereo[(unsigned)(mix8stereoMiddleIndex
+													  +block1[i]+block3[i])];
+				*buffer8bit++ = mix8stereo[(unsigned)(mix8stereoMiddleIndex
+													  +block2[i]+block4[i])];
+			}
+		}
+	}
   	for ( ; numberOfSamples > 0; numberOfSamples-- )
 	{
 		// left
@@ -265,6 +338,20 @@ void* fill8bitSplit( void* buffer, udword numberOfSamples )
 void* fill16bitMono( void* buffer, udword numberOfSamples )
 {
 	sword* buffer16bit = (sword*)buffer;
+	if ( voicesDecoupled() )
+	{
+		while ( numberOfSamples > 0 )
+		{
+			udword n = renderBlock(numberOfSamples);
+			numberOfSamples -= n;
+			for ( udword i = 0; i < n; i++ )
+			{
+				*buffer16bit++ = mix16mono[(unsigned)(mix16monoMiddleIndex
+													  +block1[i]+block2[i]
+													  +block3[i]+block4[i])];
+			}
+		}
+	}
 	for ( ; numberOfSamples > 0; numberOfSamples-- )
 	{
 	    *buffer16bit++ = mix16mono[(unsigned)(mix16monoMiddleIndex
@@ -295,6 +382,21 @@ void* fill16bitMonoControl( void* buffer, udword numberOfSamples )
 void* fill16bitStereo( void* buffer, udword numberOfSamples )
 {
 	sword* buffer16bit = (sword*)buffer;
+	if ( voicesDecoupled() )
+	{
+		while ( numberOfSamples > 0 )
+		{
+			udword n = renderBlock(numberOfSamples);
+			numberOfSamples -= n;
+			for ( udword i = 0; i < n; i++ )
+			{
+				*buffer16bit++ = mix16stereo[(unsigned)(mix16stereoMiddleIndex
+														+block1[i]+block3[i])];
+				*buffer16bit++ = mix16stereo[(unsigned)(mix16stereoMiddleIndex
+														+block2[i]+block4[i])];
+			}
+		}
+	}
 	for ( ; numberOfSamples > 0; numberOfSamples-- )
 	{
 		// left
@@ -380,3 +482,86 @@ void* fill16bitSplit( void* buffer, udword numberOfSamples )
 	}
 	return v1buffer16bit;
 }
+
+
+//
+// ------------------------------------------------------------- Oversampling
+//
+
+// BEN : With oversampling the emulator runs at 2^oversamplingShift times
+// the output frequency. The selected fill function renders to a small
+// buffer and groups of samples are averaged down to one output sample,
+// which removes most of the aliasing of the sharp SID waveforms.
+
+extern ubyte oversamplingShift;  // -> 6581_.cpp
+
+static void* (*oversampledFillFunc)(void*, udword);
+static int oversampledBits;      // negative for signed samples
+static int oversampledChannels;
+static sdword oversampledSum[2];
+static udword oversampledCount;
+static sword oversampledBuffer[blockLen*2];
+
+template <class T>
+inline T* oversampledMix( T* out, const T* in, udword numberOfSamples )
+{
+	for ( ; numberOfSamples > 0; numberOfSamples-- )
+	{
+		int c;
+		for ( c = 0; c < oversampledChannels; c++ )
+		{
+			oversampledSum[c] += *in++;
+		}
+		if ( (++oversampledCount >> oversamplingShift) != 0 )
+		{
+			for ( c = 0; c < oversampledChannels; c++ )
+			{
+				*out++ = (T)(oversampledSum[c] >> oversamplingShift);
+				oversampledSum[c] = 0;
+			}
+			oversampledCount = 0;
+		}
+	}
+	return out;
+}
+
+void* fillOversampled( void* buffer, udword numberOfSamples )
+{
+	while ( numberOfSamples > 0 )
+	{
+		udword n = (numberOfSamples < blockLen) ? numberOfSamples : blockLen;
+		(*oversampledFillFunc)(oversampledBuffer,n);
+		numberOfSamples -= n;
+		switch ( oversampledBits )
+		{
+		 case -8:
+			buffer = oversampledMix((sbyte*)buffer,(const sbyte*)oversampledBuffer,n);
+			break;
+		 case 8:
+			buffer = oversampledMix((ubyte*)buffer,(const ubyte*)oversampledBuffer,n);
+			break;
+		 case -16:
+			buffer = oversampledMix((sword*)buffer,(const sword*)oversampledBuffer,n);
+			break;
+		 default:
+			buffer = oversampledMix((uword*)buffer,(const uword*)oversampledBuffer,n);
+			break;
+		}
+	}
+	return buffer;
+}
+
+// Wraps the fill function if oversampling is on. Not for HWMIXING.
+void MixerInitOversampling( void* (**fillFunc)(void*, udword),
+						    int bits, bool isSigned, int channels )
+{
+	oversampledSum[0] = (oversampledSum[1] = 0);
+	oversampledCount = 0;
+	if ( oversamplingShift != 0 )
+	{
+		oversampledFillFunc = *fillFunc;
+		oversampledBits = isSigned ? -bits : bits;
+		oversampledChannels = channels;
+		*fillFunc = &fillOversampled;
+	}
+}
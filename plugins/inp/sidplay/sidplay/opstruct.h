@@ -35,6 +35,7 @@ struct sidOperator
 	sidOperator* carrier;
 	sidOperator* modulator;
 	bool sync;
+	bool ringMod;  // waveform reads modulator->waveStep
 	
 	uword pulseIndex, newPulseIndex;
 	uword curSIDfreq;
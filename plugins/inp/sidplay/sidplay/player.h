@@ -12,5 +12,11 @@
 #include "sidtune.h"
 #include "version.h"
 
+// BEN : state snapshots and fast emulation for seeking (see 6581_.cxx).
+extern udword sidEmuStateSize();
+extern void sidEmuSaveState(void* buffer);
+extern void sidEmuLoadState(const void* buffer);
+extern void sidEmuSkipBuffer(emuEngine&, sidTune&, udword bufferLen);
+
 
 #endif  /* SIDPLAY1_PLAYER_H */
@@ -2,6 +2,8 @@
 // /home/ms/files/source/libsidplay/RCS/samples.cpp,v
 //
 
+#include <string.h>
+
 #include "samples.h"
 
 extern ubyte* c64mem1;
@@ -499,3 +501,44 @@ sbyte GalwayReturnSample()
 	}
 	return tempSample;
 }
+
+
+// ------------------------------------------------------- State snapshots
+
+struct sampleEmuState
+{
+	sampleChannel ch4, ch5;
+	udword sampleClock;
+	sbyte (*rout)();
+	ubyte galwayNoiseVolTab[16];
+	sbyte galwayNoiseSamTab[16];
+};
+
+udword sampleEmuStateSize()
+{
+	return sizeof(sampleEmuState);
+}
+
+void* sampleEmuSaveState(void* buffer)
+{
+	sampleEmuState* state = (sampleEmuState*)buffer;
+	state->ch4 = ch4;
+	state->ch5 = ch5;
+	state->sampleClock = sampleClock;
+	state->rout = sampleEmuRout;
+	memcpy(state->galwayNoiseVolTab, galwayNoiseVolTab, 16);
+	memcpy(state->galwayNoiseSamTab, galwayNoiseSamTab, 16);
+	return state+1;
+}
+
+const void* sampleEmuLoadState(const void* buffer)
+{
+	const sampleEmuState* state = (const sampleEmuState*)buffer;
+	ch4 = state->ch4;
+	ch5 = state->ch5;
+	sampleClock = state->sampleClock;
+	sampleEmuRout = state->rout;
+	memcpy(galwayNoiseVolTab, state->galwayNoiseVolTab, 16);
+	memcpy(galwayNoiseSamTab, state->galwayNoiseSamTab, 16);
+	return state+1;
+}
@@ -16,5 +16,10 @@ extern void sampleEmuReset();         // reset some important variables
 
 extern sbyte (*sampleEmuRout)();
 
+// BEN : state snapshots, buffers are advanced past the saved data.
+extern udword sampleEmuStateSize();
+extern void* sampleEmuSaveState(void* buffer);
+extern const void* sampleEmuLoadState(const void* buffer);
+
 
 #endif  /* SIDPLAY1_SAMPLES_H */
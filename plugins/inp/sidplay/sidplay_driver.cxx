@@ -20,6 +20,7 @@ extern "C" {
 #include <stdlib.h>
 #include <string.h>
 #include <kos/fs.h>
+#include <arch/timer.h>
 };
 
 #include "player.h"
@@ -32,6 +33,8 @@ extern "C" {
 #include "gzip.h"
 #include "dcplaya/config.h"
 #include "sysdebug.h"
+#include "emu_snapshot.h"
+#include "songlen.h"
 };
 
 static int disk_info(playa_info_t *info, sidTune * sidtune);
@@ -46,6 +49,7 @@ static void DisplayConfig(emuConfig * c)
   dbglog(DBG_DEBUG,"chn: %d\n", c->channels);
   dbglog(DBG_DEBUG,"fmt: %d\n", c->sampleFormat);
   dbglog(DBG_DEBUG,"vol: %x\n", c->volumeControl);
+  dbglog(DBG_DEBUG,"ovs: %d\n", c->oversampling);
   dbglog(DBG_DEBUG,"--------------------------------------------------\n");
 }
 
@@ -68,6 +72,9 @@ static unsigned int splGoal;    // Sample goal (end of track)
 static unsigned int zeroCnt;    // Number of successive zero sample recieved
 static unsigned int zeroGoal;   // Number of zero samples to detect end.
 
+static emu_snapshot_t * snaps;  // Seek snapshots (time in samples)
+static unsigned char sid_md5[MD5_SIZE]; // For song length database
+
 static int init(any_driver_t *d)
 {
   int err = 0;
@@ -116,8 +123,24 @@ static int init(any_driver_t *d)
   return err;
 }
 
+/* Save emulator state when a snapshot is due. */
+static void save_snapshot(void)
+{
+  void * state;
+
+  if (!snaps || (splCnt && splCnt < emu_snapshot_next(snaps))) {
+    return;
+  }
+  state = emu_snapshot_add(snaps, splCnt, sidEmuStateSize());
+  if (state) {
+    sidEmuSaveState(state);
+  }
+}
+
 static int stop(void)
 {
+  emu_snapshot_destroy(snaps);
+  snaps = 0;
   if (tune) {
     delete tune;
     tune = 0;
@@ -154,6 +177,7 @@ static int load_sid(const char *fn)
   if (!sidbuffer) {
     goto error;
   }
+  md5_sum(sidbuffer, sidbuffer_len, sid_md5);
 
   return 0;
 
@@ -190,11 +214,17 @@ static int start_track(int track, playa_info_t *info)
   if (!sidEmuInitializeSong(*engine, *tune, track)) {
 	return -1;
   }
+  if (snaps) {
+	emu_snapshot_clear(snaps);
+  }
 
   if (!info) {
 	info = &infotmp;
   }
   disk_info(info, tune);
+  if (ms = songlen_find(sid_md5, track), ms) {
+	playa_info_time(info, ((unsigned long long)ms << 10) / 1000);
+  }
 	  
   ms = info->info[PLAYA_INFO_TIME].v;
   zeroGoal = zeroCnt = splCnt = 0;
@@ -230,6 +260,10 @@ static int start(const char *fn, int track, playa_info_t *info)
   if (!tune) {
     err = __LINE__;
     goto error;
+  }
+  if (!snaps) {
+    /* Every 10 seconds, 2Mb at most. */
+    snaps = emu_snapshot_create(10 * config.frequency, 2 << 20);
   }
    if (load_sid(fn) < 0) {
     err = __LINE__;
@@ -276,6 +310,7 @@ static int decoder(playa_info_t *info)
   }
 
   /* Run emulator, fill buffer */
+  save_snapshot();
   sidEmuFillBuffer(*engine, *tune, buffer, n);
   if (!engine->getStatus()) {
     SDERROR("sidplay: status error\n");
@@ -328,6 +363,59 @@ static int decoder(playa_info_t *info)
   return status;
 }
 
+/* Seek : restore the latest snapshot before ms (or restart the song) and
+   run the fast emulation up to ms. */
+static int seek(unsigned int ms, playa_info_t *info)
+{
+  const uint64 start = timer_ms_gettime64();
+  unsigned int target, at, from;
+  const void * state = 0;
+  sidTuneInfo sidinfo;
+  emu_snapshot_stats_t stats;
+
+  if (!engine || !tune || !tune->getInfo(sidinfo)) {
+    return -1;
+  }
+  target = (unsigned long long)ms * config.frequency / 1000;
+  if (target >= splGoal) {
+    return -1;
+  }
+
+  if (snaps) {
+    state = emu_snapshot_find(snaps, target, &at);
+  }
+  if (state && (at > splCnt || target < splCnt)) {
+    sidEmuLoadState(state);
+    splCnt = at;
+  } else if (target < splCnt) {
+    if (!sidEmuInitializeSong(*engine, *tune, sidinfo.currentSong)) {
+      return -1;
+    }
+    splCnt = 0;
+  }
+
+  from = splCnt;
+  while (splCnt < target) {
+    unsigned int n = target - splCnt;
+    if (n > 4096) {
+      n = 4096;
+    }
+    save_snapshot();
+    sidEmuSkipBuffer(*engine, *tune, n << 1);
+    splCnt += n;
+  }
+  zeroCnt = 0;
+
+  if (snaps) {
+    emu_snapshot_stats(snaps, &stats);
+    SDDEBUG("sidplay: seek %ums : %u samples from %u in %ums, "
+	    "%d snapshots %d bytes\n",
+	    ms, target - from, from, (int)(timer_ms_gettime64() - start),
+	    stats.count, stats.bytes);
+  }
+  return 0;
+}
+
 static driver_option_t * options(any_driver_t * d, int idx,
 				 driver_option_t * o)
 {
@@ -439,6 +527,7 @@ inp_driver_t sidplay_driver =
   stop,
   decoder,
   info,
+  seek,
 };
 
 extern "C" {
@@ -0,0 +1,18 @@
+/* Host stand-in for the KOS <arch/types.h> included by port.h. */
+#ifndef _HOST_ARCH_TYPES_H_
+#define _HOST_ARCH_TYPES_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <sys/types.h>
+
+typedef uint8_t  uint8;
+typedef uint16_t uint16;
+typedef uint32_t uint32;
+typedef uint64_t uint64;
+typedef int8_t   int8;
+typedef int16_t  int16;
+typedef int32_t  int32;
+typedef int64_t  int64;
+
+#endif
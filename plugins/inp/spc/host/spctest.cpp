@@ -0,0 +1,217 @@
+/**
+ * @file      spctest.cpp
+ * @brief     libspc DSP output tests and realtime factor (host tool)
+ * @version   $Id$
+ *
+ *  Usage: spctest [seconds]
+ *
+ *  A synthetic SPC is played : the SPC700 loops on itself and the test
+ *  drives the DSP registers with a seeded random pattern between
+ *  updates (key on/off, pitch, ADSR, echo feedback, FIR taps, echo
+ *  delay and enable, noise). 8 voices play random BRR samples.
+ *
+ *  For each of the 16 combinations of stereo, resolution (8/16 bit),
+ *  interpolation and echo, the output checksum must be the one recorded
+ *  with the previous DSP mixer (per sample echo ring and output loops),
+ *  and the realtime factor is printed.
+ *
+ *  Returns 0 if all checks pass.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "port.h"
+#include "snes9x.h"
+#include "apu.h"
+#include "soundux.h"
+#include "libspc.h"
+
+static const char spcFile[] = "obj/spctest.spc";
+static const int goldenSeconds = 10;
+static const int updatesPerSecond = 400;  // RATE in libspc.cpp
+
+static unsigned int seed;
+
+static unsigned int rnd()
+{
+  seed = seed * 1103515245u + 12345u;
+  return seed >> 8;
+}
+
+static void dsp(int reg, int val)
+{
+  IAPU.RAM[0xf2] = reg;
+  S9xSetAPUDSP(val);
+}
+
+/* SPC whose program is "bra *", with 8 random BRR samples. */
+static int make_spc(const char * fname)
+{
+  static unsigned char spc[0x10200];
+  unsigned char * ram = spc + 0x100, * regs = spc + 0x10100;
+  FILE * f;
+  int ok;
+
+  memset(spc, 0, sizeof(spc));
+  memcpy(spc, "SNES-SPC700 Sound File Data v0.30", 33);
+  spc[0x21] = spc[0x22] = 26;
+  spc[0x25] = 0x00; spc[0x26] = 0x02;   // PC = 0x200
+  spc[0x2b] = 0xef;                     // SP
+  ram[0x200] = 0x2f; ram[0x201] = 0xfe; // bra *
+
+  /* 8 samples of 32 BRR blocks at 0x1000 + k * 0x200, directory at
+   * 0x300. */
+  seed = 4321;
+  for (int k = 0; k < 8; ++k) {
+    int a = 0x1000 + k * 0x200;
+    ram[0x300 + k * 4] = a & 255; ram[0x301 + k * 4] = a >> 8;
+    ram[0x302 + k * 4] = a & 255; ram[0x303 + k * 4] = a >> 8;
+    for (int b = 0; b < 32; ++b) {
+      unsigned char * p = ram + a + b * 9;
+      p[0] = ((rnd() % 12) << 4) | ((rnd() & 3) << 2) | (b == 31 ? 3 : 0);
+      for (int i = 1; i < 9; ++i) {
+	p[i] = rnd();
+      }
+    }
+  }
+  regs[0x5d] = 0x03;                    // DIR
+  regs[0x6c] = 0x00;                    // FLG
+  regs[0x0c] = regs[0x1c] = 0x60;       // main volume
+
+  f = fopen(fname, "wb");
+  if (!f) {
+    return 0;
+  }
+  ok = fwrite(spc, 1, sizeof(spc), f) == sizeof(spc);
+  return !fclose(f) && ok;
+}
+
+/* Random DSP register writes, every 16 updates. */
+static void write_registers()
+{
+  unsigned int x = rnd();
+  int v = x & 7;
+
+  if ((x & 0x18) == 0) {
+    dsp(v * 16 + 0, rnd()); dsp(v * 16 + 1, rnd());
+    dsp(v * 16 + 2, rnd()); dsp(v * 16 + 3, rnd() & 0x3f);
+    dsp(v * 16 + 4, rnd() & 7);
+    dsp(v * 16 + 5, 0x80 | (rnd() & 0x7f)); dsp(v * 16 + 6, rnd());
+    dsp(0x4c, 1 << v);
+  } else if ((x & 0x18) == 8) {
+    dsp(0x5c, 1 << v);
+  } else if ((x & 0x3f8) == 0x10) {
+    dsp(0x2d, rnd() & 0xfe);
+  } else if ((x & 0x3f8) == 0x18) {
+    for (int i = 0; i < 8; ++i) {
+      dsp(0x0f + i * 0x10, (signed char)(rnd() & 0xff) / 4);
+    }
+    dsp(0x0d, rnd() & 0x7f); dsp(0x4d, rnd());
+  } else if ((x & 0xff8) == 0x20) {
+    dsp(0x7d, rnd() & 3);
+  } else if ((x & 0xff8) == 0x28) {
+    dsp(0x3d, rnd() & 1 ? 1 << v : 0); dsp(0x6c, rnd() & 0x1f);
+  }
+}
+
+/* Play seconds of the synthetic SPC. Returns output checksum, SPC_update()
+ * time in *sec. */
+static unsigned int render(int stereo, int bits, int interp, int echo,
+			   int seconds, double * sec, int * err)
+{
+  static const int fir[8] = { 0x7f, 0, 0, 0, 0, 0, 0, 0 };
+  SPC_Config cfg = { 32000, bits, stereo ? 2 : 1, interp, echo };
+  unsigned int sum = 0;
+  clock_t total = 0;
+  unsigned char * buf;
+  int size;
+
+  seed = 4321;
+  *sec = 0;
+  size = SPC_init(&cfg);
+  if (size <= 0 || !SPC_load(spcFile, 0)) {
+    *err = 1;
+    return 0;
+  }
+  dsp(0x6d, 0xd0); dsp(0x7d, 2); dsp(0x0d, 0x40);
+  dsp(0x2c, 0x30); dsp(0x3c, 0xd0);
+  for (int i = 0; i < 8; ++i) {
+    dsp(0x0f + i * 0x10, fir[i]);
+  }
+  dsp(0x4d, 0xff); dsp(0x6c, 0x00);
+
+  buf = (unsigned char *)malloc(size);
+  for (long u = 0; u < (long)seconds * updatesPerSecond; ++u) {
+    if (!(u & 15)) {
+      write_registers();
+    }
+    clock_t t0 = clock();
+    SPC_update(buf);
+    total += clock() - t0;
+    for (int i = 0; i < size; ++i) {
+      sum = sum * 31 + buf[i];
+    }
+  }
+  free(buf);
+  SPC_close();
+  *sec = (double)total / CLOCKS_PER_SEC;
+  *err = 0;
+  return sum;
+}
+
+int main(int na, char ** a)
+{
+  /* Checksums of goldenSeconds with the previous DSP mixer, indexed by
+   * [stereo][bits/8-1][interpolation][echo]. */
+  static const unsigned int golden[2][2][2][2] = {
+    /* mono   8 bit */ {{{ 0x86e749de, 0x4c5d5c39 },
+			 { 0x1e213431, 0xf78bb8ce }},
+    /* mono  16 bit */  {{ 0xf04d6810, 0xe00a4f2b },
+			 { 0xb397af71, 0xa25c1066 }}},
+    /* stereo 8 bit */ {{{ 0x07fd67b5, 0x51306ff0 },
+			 { 0xa5238f3d, 0xa22aa870 }},
+    /* stereo 16 bit */ {{ 0x6c515e3c, 0xbfdaf6c1 },
+			 { 0xb0b4c3b8, 0x8810ff73 }}},
+  };
+  int seconds = (na > 1) ? atoi(a[1]) : goldenSeconds;
+  int failed = 0;
+
+  if (seconds <= 0) {
+    fprintf(stderr, "Usage: spctest [seconds]\n");
+    return 1;
+  }
+  if (!make_spc(spcFile)) {
+    fprintf(stderr, "spctest : could not write %s\n", spcFile);
+    return 1;
+  }
+  printf("spctest : %d s per run, realtime factor, output checksum\n",
+	 seconds);
+
+  for (int stereo = 0; stereo <= 1; ++stereo) {
+    for (int bits = 8; bits <= 16; bits += 8) {
+      for (int interp = 0; interp <= 1; ++interp) {
+	for (int echo = 0; echo <= 1; ++echo) {
+	  double sec;
+	  int err;
+	  unsigned int sum = render(stereo, bits, interp, echo, seconds,
+				    &sec, &err);
+	  bool ok = !err && (seconds != goldenSeconds
+			     || sum == golden[stereo][bits/8-1][interp][echo]);
+
+	  printf(" %-6s %2d bit %-6s %-4s : x%5.0f %08x %s\n",
+		 stereo ? "stereo" : "mono", bits,
+		 interp ? "interp" : "", echo ? "echo" : "",
+		 seconds / (sec > 0 ? sec : 1e-9), sum,
+		 err ? "FAILED" : ok ? "" : "DIFFERS");
+	  failed |= !ok;
+	}
+      }
+    }
+  }
+
+  printf("spctest : %s\n", failed ? "FAILED" : "OK");
+  return failed;
+}
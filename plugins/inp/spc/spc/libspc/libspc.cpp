@@ -16,6 +16,11 @@ unsigned char BackupDSPRAM[128];
 
 int samples_per_mix;
 
+extern int Echo [24000];
+extern int FilterTaps [8];
+extern unsigned long Z;
+extern int Loop [16];
+
 
 // The callback
 
@@ -129,6 +134,13 @@ int SPC_set_state(SPC_Config *cfg)
     return so.buffer_size;
 }
 
+void SPC_set_options(int is_interpolation, int is_echo)
+{
+    Settings.InterpolatedSound = (is_interpolation) ? TRUE : FALSE;
+    Settings.DisableSoundEcho = (is_echo) ? FALSE : TRUE;
+    S9xSetEchoEnable(APU.DSP [APU_EON]);
+}
+
 
 
 /*
@@ -158,15 +170,13 @@ inline void BCOLOR(int r, int g, int b)
 #endif
 }
 
-/* get samples
+/* run the SPC700 for one update period
    ---------------------------------------------------------------- */
-void SPC_update(unsigned char *buf)
+static void RunAPU(void)
 {
   // APU_LOOP
   int c, ic, oc;
 
-  BCOLOR(255, 0, 0);
-
   /* VP : rewrote this loop, it was completely wrong in original
      spcxmms-0.2.1 */
   for (c = 0; c < 2048000 / RATE; ) {
@@ -195,6 +205,14 @@ void SPC_update(unsigned char *buf)
     }
 
   }
+}
+
+/* get samples
+   ---------------------------------------------------------------- */
+void SPC_update(unsigned char *buf)
+{
+  BCOLOR(255, 0, 0);
+  RunAPU();
 
   BCOLOR(255, 255, 0);
   S9xMixSamples ((unsigned char *)buf, samples_per_mix);
@@ -202,6 +220,108 @@ void SPC_update(unsigned char *buf)
 
 }
 
+/* skip samples : same as SPC_update() without output
+   ---------------------------------------------------------------- */
+void SPC_skip(void)
+{
+  BCOLOR(0, 0, 255);
+  RunAPU();
+  S9xMixSamplesSkip (samples_per_mix);
+  BCOLOR(0, 0, 0);
+}
+
+/* State snapshots
+   ---------------------------------------------------------------- */
+
+/* Pointers in IAPU are saved as offsets in the APU RAM, so a state can
+   be loaded after the APU memory has been reallocated. */
+typedef struct SPC_State
+{
+  SAPURegisters regs;
+  struct SIAPU iapu;
+  struct SAPU apu;
+  SSoundData sound;
+  SoundStatus so;
+  int loop[16];
+  unsigned long z;
+  int filter_taps[8];
+  int pc, direct_page, wait1, wait2;
+  uint8 ram[0x10000];
+  int echo[1]; /* echo_buffer_size entries */
+} SPC_State;
+
+static int RamOffset(uint8 *ptr)
+{
+  return ptr ? ptr - IAPU.RAM : -1;
+}
+
+static uint8 * RamPointer(int offset)
+{
+  return offset >= 0 ? IAPU.RAM + offset : 0;
+}
+
+int SPC_state_size(void)
+{
+  return sizeof(SPC_State)
+    + (SoundData.echo_buffer_size - 1) * sizeof(int);
+}
+
+void SPC_state_save(void *buffer)
+{
+  SPC_State *state = (SPC_State *)buffer;
+  int i;
+
+  APURegisters.PC = IAPU.PC - IAPU.RAM;
+  state->regs = APURegisters;
+  state->iapu = IAPU;
+  state->apu = APU;
+  state->sound = SoundData;
+  memcpy(&state->so, (const void *)&so, sizeof(so));
+  memcpy(state->loop, Loop, sizeof(Loop));
+  state->z = Z;
+  memcpy(state->filter_taps, FilterTaps, sizeof(FilterTaps));
+  state->pc = RamOffset(IAPU.PC);
+  state->direct_page = RamOffset(IAPU.DirectPage);
+  state->wait1 = RamOffset(IAPU.WaitAddress1);
+  state->wait2 = RamOffset(IAPU.WaitAddress2);
+  memcpy(state->ram, IAPU.RAM, 0x10000);
+  memcpy(state->echo, Echo, SoundData.echo_buffer_size * sizeof(int));
+
+  /* Current block may be in the sample cache : keep a copy. */
+  for (i = 0; i < NUM_CHANNELS; i++) {
+    Channel *ch = &state->sound.channels[i];
+    if (ch->block) {
+      memmove(ch->decoded, SoundData.channels[i].block, sizeof(ch->decoded));
+      ch->block = SoundData.channels[i].decoded;
+    }
+  }
+}
+
+void SPC_state_load(const void *buffer)
+{
+  const SPC_State *state = (const SPC_State *)buffer;
+  uint8 *ram = IAPU.RAM, *shadow = IAPU.ShadowRAM;
+  uint8 *cache = IAPU.CachedSamples;
+
+  APURegisters = state->regs;
+  IAPU = state->iapu;
+  IAPU.RAM = ram;
+  IAPU.ShadowRAM = shadow;
+  IAPU.CachedSamples = cache;
+  IAPU.PC = RamPointer(state->pc);
+  IAPU.DirectPage = RamPointer(state->direct_page);
+  IAPU.WaitAddress1 = RamPointer(state->wait1);
+  IAPU.WaitAddress2 = RamPointer(state->wait2);
+  APU = state->apu;
+  SoundData = state->sound;
+  memcpy((void *)&so, &state->so, sizeof(so));
+  memcpy(Loop, state->loop, sizeof(Loop));
+  Z = state->z;
+  memcpy(FilterTaps, state->filter_taps, sizeof(FilterTaps));
+  memcpy(IAPU.RAM, state->ram, 0x10000);
+  memcpy(Echo, state->echo, SoundData.echo_buffer_size * sizeof(int));
+}
+
 /* Restore SPC state
    ---------------------------------------------------------------- */
 static void RestoreSPC()
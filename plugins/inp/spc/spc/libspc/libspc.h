@@ -59,11 +59,25 @@ extern "C" {
 int SPC_init(SPC_Config *cfg);
 void SPC_close(void);
 int SPC_set_state(SPC_Config *cfg);
+/* BEN : change interpolation and echo while playing. Other fields of
+ * SPC_Config need a SPC_set_state() which changes the buffer size. */
+void SPC_set_options(int is_interpolation, int is_echo);
 int SPC_load(const char *fname, SPC_ID666 * id);
 void SPC_update(unsigned char *buf);
+void SPC_skip(void);
 int SPC_get_id666 (const char *filename, SPC_ID666 * id);
 int SPC_write_id666(SPC_ID666 *id, const char *filename);
 
+/*
+ * BEN : state snapshots for seeking. SPC_skip() runs the SPC and the
+ * DSP voices for one update like SPC_update() but produces no sound
+ * (echo buffer is not updated). A state is valid for the loaded song
+ * only, its size depends on the echo delay.
+ */
+int SPC_state_size(void);
+void SPC_state_save(void *buffer);
+void SPC_state_load(const void *buffer);
+
 
 /*
  * VP : each time a timer is read, the SPC is slowdowned for 
@@ -571,6 +571,8 @@ void MixStereo (int sample_count)
     {
 	int32 VL, VR;
 	Channel *ch = &SoundData.channels[J];
+	// BEN : nothing reads the dummy echo buffer, do not write it.
+	int *echo = ch->echo_buf_ptr == DummyEchoBuffer ? 0 : ch->echo_buf_ptr;
 	unsigned long freq0 = ch->frequency;
 
 	if (ch->state == SOUND_SILENT || !(so.sound_switch & (1 << J)))
@@ -861,8 +863,11 @@ void MixStereo (int sample_count)
 
 	    MixBuffer [I  ] += VL;
 	    MixBuffer [I+1] += VR;
-	    ch->echo_buf_ptr [I  ] += VL;
-	    ch->echo_buf_ptr [I+1] += VR;
+	    if (echo)
+	    {
+		echo [I  ] += VL;
+		echo [I+1] += VR;
+	    }
         }
 stereo_exit: ;
     }
@@ -879,6 +884,7 @@ void MixMono (int sample_count)
     for (uint32 J = 0; J < NUM_CHANNELS; J++) 
     {
 	Channel *ch = &SoundData.channels[J];
+	int *echo = ch->echo_buf_ptr == DummyEchoBuffer ? 0 : ch->echo_buf_ptr;
 	unsigned long freq0 = ch->frequency;
 
 	if (ch->state == SOUND_SILENT || !(so.sound_switch & (1 << J)))
@@ -1155,7 +1161,8 @@ void MixMono (int sample_count)
 	    }
 
 	    MixBuffer [I] += V;
-	    ch->echo_buf_ptr [I] += V;
+	    if (echo)
+		echo [I] += V;
 
 	    if (pitch_mod & (1 << (J + 1)))
 		wave [I] = ch->sample * ch->envx;
@@ -1171,6 +1178,92 @@ END_OF_FUNCTION(MixMono);
 extern uint8 int2ulaw (int);
 #endif
 
+/* BEN : Echo of a whole buffer. The echo input is read block by block,
+   the FIR runs on a linear copy of its history (no ring indexing per
+   tap) and the block is written back. A block is never longer than
+   the echo buffer, so it does not read what it writes and the result is
+   the same as the sample by sample loop. EchoOut [] gets the filtered
+   echo, Loop [] and Z are kept up to date for the next buffer. */
+static int EchoOut [SOUND_BUFFER_SIZE];
+static int EchoHistory [16 + SOUND_BUFFER_SIZE];
+
+static void MixEcho (int sample_count)
+{
+    int *h = EchoHistory + 16;
+    int mask = so.stereo ? 15 : 7;
+    int size = SoundData.echo_buffer_size;
+    int J, k, n;
+
+    for (J = 0; J < sample_count; J += n)
+    {
+	int ptr = SoundData.echo_ptr;
+	int *E = EchoOut + J;
+
+	n = sample_count - J;
+	if (n > size)
+	    n = size;
+
+	for (k = 0; k < n; k++)
+	{
+	    h [k] = Echo [ptr];
+	    if (++ptr >= size)
+		ptr = 0;
+	}
+
+	if (SoundData.no_filter)
+	{
+	    for (k = 0; k < n; k++)
+		E [k] = h [k];
+	}
+	else
+	{
+	    int32 t0 = FilterTaps [0], t1 = FilterTaps [1];
+	    int32 t2 = FilterTaps [2], t3 = FilterTaps [3];
+	    int32 t4 = FilterTaps [4], t5 = FilterTaps [5];
+	    int32 t6 = FilterTaps [6], t7 = FilterTaps [7];
+
+	    for (k = -1 - mask; k < 0; k++)
+		h [k] = Loop [(Z + k) & mask];
+
+	    if (so.stereo)
+	    {
+		// Taps are on the same channel : every other sample.
+		for (k = 0; k < n; k++)
+		{
+		    const int *x = h + k;
+		    E [k] = (x [  0] * t0 + x [ -2] * t1 + x [ -4] * t2 +
+			     x [ -6] * t3 + x [ -8] * t4 + x [-10] * t5 +
+			     x [-12] * t6 + x [-14] * t7) / 128;
+		}
+	    }
+	    else
+	    {
+		for (k = 0; k < n; k++)
+		{
+		    const int *x = h + k;
+		    E [k] = (x [ 0] * t0 + x [-1] * t1 + x [-2] * t2 +
+			     x [-3] * t3 + x [-4] * t4 + x [-5] * t5 +
+			     x [-6] * t6 + x [-7] * t7) / 128;
+		}
+	    }
+
+	    Z += n;
+	    for (k = -1 - mask; k < 0; k++)
+		Loop [(Z + k) & mask] = h [n + k];
+	}
+
+	ptr = SoundData.echo_ptr;
+	for (k = 0; k < n; k++)
+	{
+	    Echo [ptr] = (E [k] * SoundData.echo_feedback) / 128 +
+		EchoBuffer [J + k];
+	    if (++ptr >= size)
+		ptr = 0;
+	}
+	SoundData.echo_ptr = ptr;
+    }
+}
+
 // For backwards compatibility with older port specific code
 void S9xMixSamples (uint8 *buffer, int sample_count)
 {
@@ -1198,6 +1291,13 @@ void S9xMixSamplesO (uint8 *buffer, int sample_count, int byte_offset)
     }
 
     BCOLOR(255, 0, 255);
+    bool8 echo = !so.mute_sound && SoundData.echo_enable &&
+	SoundData.echo_buffer_size;
+    int C = so.stereo ? 1 : 0;
+
+    if (echo)
+	MixEcho (sample_count);
+
     /* Mix and convert waveforms */
     if (so.sixteen_bit)
     {
@@ -1211,120 +1311,17 @@ void S9xMixSamplesO (uint8 *buffer, int sample_count, int byte_offset)
 	else
 	{
 	    int O = byte_offset >> 1;
-	    if (SoundData.echo_enable && SoundData.echo_buffer_size)
+	    if (echo)
 	    {
-		if (so.stereo)
-		{
-		    // 16-bit stereo sound with echo enabled ...
-		    if (SoundData.no_filter)
-		    {
-			// ... but no filter defined.
-			for (J = 0; J < sample_count; J++)
-			{
-			    int E = Echo [SoundData.echo_ptr];
-
-			    Echo [SoundData.echo_ptr] = (E * SoundData.echo_feedback) / 128 +
-							EchoBuffer [J];
-
-			    if ((SoundData.echo_ptr += 1) >= SoundData.echo_buffer_size)
-				SoundData.echo_ptr = 0;
-
-			    I = (MixBuffer [J] * 
-				 SoundData.master_volume [J & 1] +
-				 E * SoundData.echo_volume [J & 1]) / VOL_DIV16;
-
-			    CLIP16(I);
-			    ((signed short *) buffer)[J + O] = I;
-			}
-		    }
-		    else
-		    {
-			// ... with filter defined.
-			for (J = 0; J < sample_count; J++)
-			{
-			    int E = Echo [SoundData.echo_ptr];
-
-			    Loop [(Z - 0) & 15] = E;
-			    E =  E                    * FilterTaps [0];
-			    E += Loop [(Z -  2) & 15] * FilterTaps [1];
-			    E += Loop [(Z -  4) & 15] * FilterTaps [2];
-			    E += Loop [(Z -  6) & 15] * FilterTaps [3];
-			    E += Loop [(Z -  8) & 15] * FilterTaps [4];
-			    E += Loop [(Z - 10) & 15] * FilterTaps [5];
-			    E += Loop [(Z - 12) & 15] * FilterTaps [6];
-			    E += Loop [(Z - 14) & 15] * FilterTaps [7];
-			    E /= 128;
-			    Z++;
-
-			    Echo [SoundData.echo_ptr] = (E * SoundData.echo_feedback) / 128 +
-							EchoBuffer [J];
-
-			    if ((SoundData.echo_ptr += 1) >= SoundData.echo_buffer_size)
-				SoundData.echo_ptr = 0;
-
-			    I = (MixBuffer [J] * 
-				 SoundData.master_volume [J & 1] +
-				 E * SoundData.echo_volume [J & 1]) / VOL_DIV16;
-
-			    CLIP16(I);
-			    ((signed short *) buffer)[J + O] = I;
-			}
-		    }
-		}
-		else
+		// 16-bit mono or stereo sound with echo enabled
+		for (J = 0; J < sample_count; J++)
 		{
-		    // 16-bit mono sound with echo enabled...
-		    if (SoundData.no_filter)
-		    {
-			// ... no filter defined
-			for (J = 0; J < sample_count; J++)
-			{
-			    int E = Echo [SoundData.echo_ptr];
-
-			    Echo [SoundData.echo_ptr] = (E * SoundData.echo_feedback) / 128 +
-							 EchoBuffer [J];
-
-			    if ((SoundData.echo_ptr += 1) >= SoundData.echo_buffer_size)
-				SoundData.echo_ptr = 0;
+		    I = (MixBuffer [J] * 
+			 SoundData.master_volume [J & C] +
+			 EchoOut [J] * SoundData.echo_volume [J & C]) / VOL_DIV16;
 
-			    I = (MixBuffer [J] *
-				 SoundData.master_volume [0] +
-				 E * SoundData.echo_volume [0]) / VOL_DIV16;
-			    CLIP16(I);
-			    ((signed short *) buffer)[J + O] = I;
-			}
-		    }
-		    else
-		    {
-			// ... with filter defined
-			for (J = 0; J < sample_count; J++)
-			{
-			    int E = Echo [SoundData.echo_ptr];
-
-			    Loop [(Z - 0) & 7] = E;
-			    E =  E                  * FilterTaps [0];
-			    E += Loop [(Z - 1) & 7] * FilterTaps [1];
-			    E += Loop [(Z - 2) & 7] * FilterTaps [2];
-			    E += Loop [(Z - 3) & 7] * FilterTaps [3];
-			    E += Loop [(Z - 4) & 7] * FilterTaps [4];
-			    E += Loop [(Z - 5) & 7] * FilterTaps [5];
-			    E += Loop [(Z - 6) & 7] * FilterTaps [6];
-			    E += Loop [(Z - 7) & 7] * FilterTaps [7];
-			    E /= 128;
-			    Z++;
-
-			    Echo [SoundData.echo_ptr] = (E * SoundData.echo_feedback) / 128 +
-							 EchoBuffer [J];
-
-			    if ((SoundData.echo_ptr += 1) >= SoundData.echo_buffer_size)
-				SoundData.echo_ptr = 0;
-
-			    I = (MixBuffer [J] * SoundData.master_volume [0] +
-				 E * SoundData.echo_volume [0]) / VOL_DIV16;
-			    CLIP16(I);
-			    ((signed short *) buffer)[J + O] = I;
-			}
-		    }
+		    CLIP16(I);
+		    ((signed short *) buffer)[J + O] = I;
 		}
 	    }
 	    else
@@ -1364,117 +1361,16 @@ void S9xMixSamplesO (uint8 *buffer, int sample_count, int byte_offset)
 	else
 #endif
 	{
-	    if (SoundData.echo_enable && SoundData.echo_buffer_size)
+	    if (echo)
 	    {
-		if (so.stereo)
-		{
-		    // 8-bit stereo sound with echo enabled...
-		    if (SoundData.no_filter)
-		    {
-			// ... but no filter
-			for (J = 0; J < sample_count; J++)
-			{
-			    int E = Echo [SoundData.echo_ptr];
-
-			    Echo [SoundData.echo_ptr] = (E * SoundData.echo_feedback) / 128 + 
-							EchoBuffer [J];
-
-			    if ((SoundData.echo_ptr += 1) >= SoundData.echo_buffer_size)
-				SoundData.echo_ptr = 0;
-
-			    I = (MixBuffer [J] * 
-				 SoundData.master_volume [J & 1] +
-				 E * SoundData.echo_volume [J & 1]) / VOL_DIV8;
-			    CLIP8(I);
-			    buffer [J + O] = I + 128;
-			}
-		    }
-		    else
-		    {
-			// ... with filter
-			for (J = 0; J < sample_count; J++)
-			{
-			    int E = Echo [SoundData.echo_ptr];
-
-			    Loop [(Z - 0) & 15] = E;
-			    E =  E                    * FilterTaps [0];
-			    E += Loop [(Z -  2) & 15] * FilterTaps [1];
-			    E += Loop [(Z -  4) & 15] * FilterTaps [2];
-			    E += Loop [(Z -  6) & 15] * FilterTaps [3];
-			    E += Loop [(Z -  8) & 15] * FilterTaps [4];
-			    E += Loop [(Z - 10) & 15] * FilterTaps [5];
-			    E += Loop [(Z - 12) & 15] * FilterTaps [6];
-			    E += Loop [(Z - 14) & 15] * FilterTaps [7];
-			    E /= 128;
-			    Z++;
-
-			    Echo [SoundData.echo_ptr] = (E * SoundData.echo_feedback) / 128 + 
-							EchoBuffer [J];
-
-			    if ((SoundData.echo_ptr += 1) >= SoundData.echo_buffer_size)
-				SoundData.echo_ptr = 0;
-
-			    I = (MixBuffer [J] * 
-				 SoundData.master_volume [J & 1] +
-				 E * SoundData.echo_volume [J & 1]) / VOL_DIV8;
-			    CLIP8(I);
-			    buffer [J + O] = I + 128;
-			}
-		    }
-		}
-		else
+		// 8-bit mono or stereo sound with echo enabled
+		for (J = 0; J < sample_count; J++)
 		{
-		    // 8-bit mono sound with echo enabled...
-		    if (SoundData.no_filter)
-		    {
-			// ... but no filter.
-			for (J = 0; J < sample_count; J++)
-			{
-			    int E = Echo [SoundData.echo_ptr];
-
-			    Echo [SoundData.echo_ptr] = (E * SoundData.echo_feedback) / 128 + 
-							EchoBuffer [J];
-
-			    if ((SoundData.echo_ptr += 1) >= SoundData.echo_buffer_size)
-				SoundData.echo_ptr = 0;
-
-			    I = (MixBuffer [J] * SoundData.master_volume [0] +
-				 E * SoundData.echo_volume [0]) / VOL_DIV8;
-			    CLIP8(I);
-			    buffer [J + O] = I + 128;
-			}
-		    }
-		    else
-		    {
-			// ... with filter.
-			for (J = 0; J < sample_count; J++)
-			{
-			    int E = Echo [SoundData.echo_ptr];
-
-			    Loop [(Z - 0) & 7] = E;
-			    E =  E                  * FilterTaps [0];
-			    E += Loop [(Z - 1) & 7] * FilterTaps [1];
-			    E += Loop [(Z - 2) & 7] * FilterTaps [2];
-			    E += Loop [(Z - 3) & 7] * FilterTaps [3];
-			    E += Loop [(Z - 4) & 7] * FilterTaps [4];
-			    E += Loop [(Z - 5) & 7] * FilterTaps [5];
-			    E += Loop [(Z - 6) & 7] * FilterTaps [6];
-			    E += Loop [(Z - 7) & 7] * FilterTaps [7];
-			    E /= 128;
-			    Z++;
-
-			    Echo [SoundData.echo_ptr] = (E * SoundData.echo_feedback) / 128 + 
-							EchoBuffer [J];
-
-			    if ((SoundData.echo_ptr += 1) >= SoundData.echo_buffer_size)
-				SoundData.echo_ptr = 0;
-
-			    I = (MixBuffer [J] * SoundData.master_volume [0] +
-				 E * SoundData.echo_volume [0]) / VOL_DIV8;
-			    CLIP8(I);
-			    buffer [J + O] = I + 128;
-			}
-		    }
+		    I = (MixBuffer [J] * 
+			 SoundData.master_volume [J & C] +
+			 EchoOut [J] * SoundData.echo_volume [J & C]) / VOL_DIV8;
+		    CLIP8(I);
+		    buffer [J + O] = I + 128;
 		}
 	    }
 	    else
@@ -1497,6 +1393,21 @@ void S9xMixSamplesO (uint8 *buffer, int sample_count, int byte_offset)
 END_OF_FUNCTION(S9xMixSamplesO);
 #endif
 
+/* BEN : Run voices (envelopes, sample positions, ENDX) without any
+   output : echo is not fed and the sound buffers are not converted.
+   Voices advance by output frame, the mono mixer is enough. */
+void S9xMixSamplesSkip (int sample_count)
+{
+    if (so.mute_sound)
+	return;
+    if (so.stereo)
+	sample_count >>= 1;
+    memset (MixBuffer, 0, sample_count * sizeof (MixBuffer [0]));
+    if (SoundData.echo_enable)
+	memset (EchoBuffer, 0, sample_count * sizeof (EchoBuffer [0]));
+    MixMono (sample_count);
+}
+
 void S9xResetSound (bool8 full)
 {
     for (int i = 0; i < 8; i++)
@@ -190,6 +190,7 @@ void S9xStartSample (int channel);
 
 EXTERN_C void S9xMixSamples (uint8 *buffer, int sample_count);
 EXTERN_C void S9xMixSamplesO (uint8 *buffer, int sample_count, int byte_offset);
+EXTERN_C void S9xMixSamplesSkip (int sample_count);
 bool8 S9xOpenSoundDevice (int, bool8, int);
 void S9xSetPlaybackRate (uint32 rate);
 #endif
@@ -9,6 +9,7 @@ DCPLAYA_EXTERN_C_START
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <arch/timer.h>
 DCPLAYA_EXTERN_C_END
 
 #include "libspc.h"
@@ -16,6 +17,7 @@ DCPLAYA_EXTERN_C_END
 #include "playa.h"
 #include "fifo.h"
 #include "inp_driver.h"
+#include "emu_snapshot.h"
 
 #include "exceptions.h"
 
@@ -41,6 +43,13 @@ static int32 *buf;
 static int buf_size;
 static int buf_cnt;
 
+/** Seek snapshots (time in updates) : every 10 seconds, 2Mb at most. */
+static emu_snapshot_t * snaps;
+static unsigned int updates; /**< Number of SPC_update() since start */
+
+/** Set by shell commands : echo or interpolation changed while playing. */
+static volatile int options_changed;
+
 static void clean_spc_info(void)
 {
   memset(&spcinfo, 0, sizeof(spcinfo));
@@ -64,11 +73,28 @@ static int init(any_driver_t *d)
   return 0;
 }
 
+/** Save SPC state when a snapshot is due. */
+static void save_snapshot(void)
+{
+  void * state;
+
+  if (!snaps || (updates && updates < emu_snapshot_next(snaps))) {
+    return;
+  }
+  state = emu_snapshot_add(snaps, updates, SPC_state_size());
+  if (state) {
+    SPC_state_save(state);
+  }
+}
+
 static int stop(void)
 {
   if (ready) {
     SPC_close();
   }
+  emu_snapshot_destroy(snaps);
+  snaps = 0;
+  updates = 0;
   if (buf) {
     free(buf);
   }
@@ -124,6 +150,9 @@ static int start(const char *fn, int track, playa_info_t *info)
   //  spc_config.is_interpolation = 1;
 
   buf_cnt = buf_size;
+  updates = 0;
+  snaps = emu_snapshot_create(10 * spc_config.sampling_rate / buf_size,
+			      2 << 20);
   ready = 1;
 
   EXPT_GUARD_RETURN 0;
@@ -148,7 +177,13 @@ static int decoder(playa_info_t *info)
   }
         
   if (buf_cnt >= buf_size) {
+    if (options_changed) {
+      options_changed = 0;
+      SPC_set_options(spc_config.is_interpolation, spc_config.is_echo);
+    }
+    save_snapshot();
     SPC_update((char *)buf);
+    ++updates;
     buf_cnt = 0;
   }
 
@@ -166,6 +201,50 @@ static int decoder(playa_info_t *info)
   return -(n>0) & INP_DECODE_CONT;
 }
 
+/* Seek : restore the latest snapshot before ms and run the SPC without
+   sound up to ms. There is always a snapshot at the start of the song. */
+static int seek(unsigned int ms, playa_info_t *info)
+{
+  const uint64 start = timer_ms_gettime64();
+  unsigned int target, at, from;
+  const void * state;
+  emu_snapshot_stats_t stats;
+
+  EXPT_GUARD_BEGIN;
+
+  if (!ready || !snaps) {
+    EXPT_GUARD_RETURN -1;
+  }
+  target = (unsigned long long)ms * spc_config.sampling_rate
+    / 1000 / buf_size;
+  state = emu_snapshot_find(snaps, target, &at);
+  if (state && (at > updates || target < updates)) {
+    SPC_state_load(state);
+    updates = at;
+  } else if (target < updates) {
+    EXPT_GUARD_RETURN -1;
+  }
+
+  from = updates;
+  while (updates < target) {
+    save_snapshot();
+    SPC_skip();
+    ++updates;
+  }
+  buf_cnt = buf_size;
+
+  emu_snapshot_stats(snaps, &stats);
+  dbglog(DBG_DEBUG, "spc : seek %ums : %u updates from #%u in %ums, "
+	 "%d snapshots %d bytes\n",
+	 ms, target - from, from, (int)(timer_ms_gettime64() - start),
+	 stats.count, stats.bytes);
+
+  EXPT_GUARD_CATCH;
+
+  EXPT_GUARD_END;
+  return 0;
+}
+
 static driver_option_t * options(any_driver_t * d, int idx,
 				 driver_option_t * o)
 {
@@ -268,7 +347,10 @@ static int lua_profile(lua_State * L)
 static int lua_echo(lua_State * L)
 {
   int old = spc_config.is_echo;
-  spc_config.is_echo = lua_tonumber(L, 1);
+  if (lua_gettop(L) >= 1) {
+    spc_config.is_echo = lua_tonumber(L, 1);
+    options_changed = 1;
+  }
   lua_settop(L, 0);
   lua_pushnumber(L, old);
   vid_border_color(0, 0, 0);
@@ -278,7 +360,10 @@ static int lua_echo(lua_State * L)
 static int lua_interpolation(lua_State * L)
 {
   int old = spc_config.is_interpolation;
-  spc_config.is_interpolation = lua_tonumber(L, 1);
+  if (lua_gettop(L) >= 1) {
+    spc_config.is_interpolation = lua_tonumber(L, 1);
+    options_changed = 1;
+  }
   lua_settop(L, 0);
   lua_pushnumber(L, old);
   vid_border_color(0, 0, 0);
@@ -343,7 +428,7 @@ static luashell_command_description_t commands[] = {
   {
     "spc_interpolation", 0, "spc",     /* long name, short name, topic */
     "spc_interpolation(status) : set or return interpolation status",  /* usage */
-    SHELL_COMMAND_C, lua_echo      /* function */
+    SHELL_COMMAND_C, lua_interpolation /* function */
   },
 
   /* end of the command list */
@@ -381,6 +466,7 @@ static inp_driver_t spc_driver =
   stop,
   decoder,
   info,
+  seek,
 };
 
 EXPORT_DRIVER(spc_driver)
@@ -0,0 +1,271 @@
+/*	mp3gen.c : synthetic MPEG-1 Layer III stream for the xing host tests
+
+	Usage: mp3gen [-m] [-b kbps] [-n frames] [-s seed] out.mp3
+
+	Writes a valid 44100 Hz Layer III stream, stereo or mono (-m), at a
+	constant bitrate (default 128 kbps, 2000 frames, about 52 s). No
+	encoder is involved : the main data of each granule is built
+	directly, so the stream exercises the decoder paths, not the sound.
+
+	- huffman table 1 only (|x|,|y| <= 1), with a density and bandwidth
+	  that follow the bitrate.
+	- scalefactors rising with the band, global gain following a slow
+	  envelope.
+	- block switching : long, start, short (one or more), stop.
+
+	The same seed gives the same stream. Returns 0 if the file was
+	written.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#define SAMPRATE	44100
+#define MAX_FRAME	2048
+
+typedef struct {
+  int part23;		/* main data bits */
+  int big_values;
+  int global_gain;
+  int block_type;	/* 0 long, 1 start, 2 short, 3 stop */
+  unsigned char code[MAX_FRAME];
+} granule_t;
+
+static const int bitrates[15] = {
+  0, 32, 40, 48, 56, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320
+};
+
+static unsigned int seed = 1;
+
+static unsigned int rnd(void)
+{
+  seed = seed * 1103515245u + 12345u;
+  return seed >> 8;
+}
+
+static double frnd(void)
+{
+  return (rnd() & 0xffffff) / 16777216.0;
+}
+
+/* MSB first bit writer. */
+static void put(unsigned char *buf, int *pos, unsigned int v, int n)
+{
+  while (n--) {
+    if ((v >> n) & 1) {
+      buf[*pos >> 3] |= 0x80 >> (*pos & 7);
+    }
+    ++*pos;
+  }
+}
+
+/* Main data of one granule/channel within budget bits : scalefactors
+ * (scalefac_compress 15, slen 4/3) then big values with table 1. */
+static void make_granule(granule_t *g, int budget, int block_type,
+			 double level, double density, int bandwidth)
+{
+  int pos = 0, sfb, k, pairs, npairs = bandwidth / 2;
+
+  memset(g->code, 0, sizeof(g->code));
+  g->block_type = block_type;
+  g->global_gain = 210 + (int)(4 * level);
+  if (g->global_gain < 0) {
+    g->global_gain = 0;
+  } else if (g->global_gain > 255) {
+    g->global_gain = 255;
+  }
+
+  if (block_type == 2) {
+    for (sfb = 0; sfb < 12; ++sfb) {
+      for (k = 0; k < 3; ++k) {
+	int sf = (int)(sfb * 1.3) + rnd() % 3, max = sfb < 6 ? 15 : 7;
+
+	put(g->code, &pos, sf > max ? max : sf, sfb < 6 ? 4 : 3);
+      }
+    }
+  } else {
+    for (sfb = 0; sfb < 21; ++sfb) {
+      int sf = (int)(sfb * 0.7) + rnd() % 3, max = sfb < 11 ? 15 : 7;
+
+      put(g->code, &pos, sf > max ? max : sf, sfb < 11 ? 4 : 3);
+    }
+  }
+
+  for (pairs = 0; pairs < npairs && pairs < 288; ++pairs) {
+    double p = density * (1.0 - (double)pairs / npairs);
+    int x = frnd() < p, y = frnd() < p;
+
+    if (pos + 1 + 2 * (x || y) + x + y > budget) {
+      break;
+    }
+    /* table 1 codes : 00 -> 1, 01 -> 001, 10 -> 01, 11 -> 000 */
+    if (!x && !y) {
+      put(g->code, &pos, 1, 1);
+    } else if (!x) {
+      put(g->code, &pos, 1, 3);
+    } else if (!y) {
+      put(g->code, &pos, 1, 2);
+    } else {
+      put(g->code, &pos, 0, 3);
+    }
+    if (x) {
+      put(g->code, &pos, rnd() & 1, 1);
+    }
+    if (y) {
+      put(g->code, &pos, rnd() & 1, 1);
+    }
+  }
+  g->big_values = pairs;
+  g->part23 = pos;
+}
+
+/* Next block type of a channel : 0 -> 1 -> 2... -> 3 -> 0. */
+static int next_block_type(int prev)
+{
+  switch (prev) {
+  case 0:
+    return rnd() % 24 ? 0 : 1;
+  case 1:
+    return 2;
+  case 2:
+    return rnd() % 3 ? 3 : 2;
+  default:
+    return 0;
+  }
+}
+
+/* Writes one frame. Returns 0 on success. */
+static int write_frame(FILE *f, int frame, int index, int nch,
+		       int *block_types, double *rem)
+{
+  static granule_t g[2][2];
+  static unsigned char buf[MAX_FRAME];
+  int kbps = bitrates[index], side = nch == 2 ? 32 : 17;
+  int size, pad, budget, gr, ch, i, pos = 0;
+
+  *rem += 144.0 * kbps * 1000 / SAMPRATE;
+  size = (int)*rem;
+  *rem -= size;
+  pad = size > 144 * kbps * 1000 / SAMPRATE;
+  budget = (size - 4 - side) * 8 / (2 * nch);
+
+  for (gr = 0; gr < 2; ++gr) {
+    for (ch = 0; ch < nch; ++ch) {
+      double level = -4.5 - 6 * frnd() + 3 * sin(frame * 0.01);
+
+      block_types[ch] = next_block_type(block_types[ch]);
+      make_granule(&g[gr][ch], budget, block_types[ch], level,
+		   0.25 + 0.5 * kbps / 320.0, 120 + kbps * 456 / 320);
+    }
+  }
+
+  /* header : MPEG-1 layer III, no CRC, 44100 Hz, stereo or mono. */
+  memset(buf, 0, sizeof(buf));
+  put(buf, &pos, 0xfff, 12);
+  put(buf, &pos, 1, 1);
+  put(buf, &pos, 1, 2);
+  put(buf, &pos, 1, 1);
+  put(buf, &pos, index, 4);
+  put(buf, &pos, 0, 2);
+  put(buf, &pos, pad, 1);
+  put(buf, &pos, 0, 1);
+  put(buf, &pos, nch == 2 ? 0 : 3, 2);
+  put(buf, &pos, 0, 2);
+  put(buf, &pos, 0, 1);
+  put(buf, &pos, 1, 1);
+  put(buf, &pos, 0, 2);
+
+  /* side info : main_data_begin 0, no scfsi. */
+  put(buf, &pos, 0, 9);
+  put(buf, &pos, 0, nch == 2 ? 3 : 5);
+  put(buf, &pos, 0, 4 * nch);
+  for (gr = 0; gr < 2; ++gr) {
+    for (ch = 0; ch < nch; ++ch) {
+      granule_t *p = &g[gr][ch];
+
+      put(buf, &pos, p->part23, 12);
+      put(buf, &pos, p->big_values, 9);
+      put(buf, &pos, p->global_gain, 8);
+      put(buf, &pos, 15, 4);
+      put(buf, &pos, p->block_type != 0, 1);
+      if (p->block_type) {
+	put(buf, &pos, p->block_type, 2);
+	put(buf, &pos, 0, 1);
+	put(buf, &pos, 1, 5);
+	put(buf, &pos, 1, 5);
+	put(buf, &pos, 0, 9);
+      } else {
+	put(buf, &pos, 1, 5);
+	put(buf, &pos, 1, 5);
+	put(buf, &pos, 1, 5);
+	put(buf, &pos, 7, 4);
+	put(buf, &pos, 7, 3);
+      }
+      put(buf, &pos, 0, 3);
+    }
+  }
+
+  for (gr = 0; gr < 2; ++gr) {
+    for (ch = 0; ch < nch; ++ch) {
+      granule_t *p = &g[gr][ch];
+
+      for (i = 0; i < p->part23; ++i) {
+	put(buf, &pos, (p->code[i >> 3] >> (7 - (i & 7))) & 1, 1);
+      }
+    }
+  }
+  if (pos > size * 8) {
+    fprintf(stderr, "mp3gen : frame %d overflow\n", frame);
+    return -1;
+  }
+  return fwrite(buf, 1, size, f) != (size_t)size;
+}
+
+int main(int na, char **a)
+{
+  int nch = 2, kbps = 128, frames = 2000, index, frame, err = 0;
+  int block_types[2] = { 0, 0 };
+  double rem = 0;
+  FILE *f;
+
+  for (; na > 1 && a[1][0] == '-'; --na, ++a) {
+    if (!strcmp(a[1], "-m")) {
+      nch = 1;
+    } else if (na > 2 && !strcmp(a[1], "-b")) {
+      kbps = atoi(a[2]);
+      --na, ++a;
+    } else if (na > 2 && !strcmp(a[1], "-n")) {
+      frames = atoi(a[2]);
+      --na, ++a;
+    } else if (na > 2 && !strcmp(a[1], "-s")) {
+      seed = strtoul(a[2], 0, 0);
+      --na, ++a;
+    } else {
+      break;
+    }
+  }
+  for (index = 1; index < 15 && bitrates[index] != kbps; ++index)
+    ;
+  if (na != 2 || index == 15 || frames <= 0) {
+    fprintf(stderr,
+	    "Usage: mp3gen [-m] [-b kbps] [-n frames] [-s seed] out.mp3\n");
+    return 1;
+  }
+
+  f = fopen(a[1], "wb");
+  if (!f) {
+    fprintf(stderr, "mp3gen : [%s] open failed\n", a[1]);
+    return 2;
+  }
+  for (frame = 0; frame < frames && !err; ++frame) {
+    err = write_frame(f, frame, index, nch, block_types, &rem);
+  }
+  err |= fclose(f);
+  if (err) {
+    fprintf(stderr, "mp3gen : [%s] write failed\n", a[1]);
+    return 2;
+  }
+  return 0;
+}
@@ -0,0 +1,303 @@
+/*	xingdec.c : host decode tool for the xing Layer III synthesis paths
+
+	Usage: xingdec [-r reps] [-s skip] [-t psnr] file.mp3 [ref.wav]
+
+	The file is decoded with each transform_code (TRANSFORM_FLOAT,
+	TRANSFORM_FIXED and TRANSFORM_VECTOR, see mhead.h), set up the way
+	the xing driver does it. The output of each path is compared with the
+	16 bit PCM of ref.wav if given, else with the TRANSFORM_FLOAT output.
+	The PSNR, the RMS and the max of the error are printed in 16 bit
+	steps. skip is the number of decoded samples per channel dropped
+	before the comparison with ref.wav (decoder delay, default 0).
+
+	Each path decodes the file reps times (default 1). The realtime
+	factor is the stream duration over the mean decode time.
+
+	With -t, a path whose PSNR is below psnr dB is an error.
+
+	Returns 0 if the file was decoded (and every path passed -t).
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+
+#include "mhead.h"
+
+/* From xing_driver.c */
+#define CONV_NORMAL	    0
+#define REDUCT_NORMAL	    0
+
+/* Zero bytes after the stream, audio_decode() may read a whole frame. */
+#define PAD_BYTES	    4096
+
+typedef struct {
+  short *pcm;		/* interleaved 16 bit */
+  long samples;		/* per channel */
+  int channels;
+  long samprate;
+} pcm_t;
+
+static const char *path_names[] = { "float", "fixed", "vector" };
+
+static MPEG mpeg;
+
+static unsigned char *load_file(const char *fname, long *len)
+{
+  FILE *f = fopen(fname, "rb");
+  unsigned char *buf = 0;
+  long size;
+
+  if (!f) {
+    return 0;
+  }
+  if (!fseek(f, 0, SEEK_END) && (size = ftell(f)) > 0
+      && !fseek(f, 0, SEEK_SET)) {
+    buf = calloc(1, size + PAD_BYTES);
+    if (buf && fread(buf, 1, size, f) != (size_t)size) {
+      free(buf);
+      buf = 0;
+    }
+    *len = size;
+  }
+  fclose(f);
+  return buf;
+}
+
+static unsigned int le16(const unsigned char *p)
+{
+  return p[0] | (p[1] << 8);
+}
+
+static unsigned long le32(const unsigned char *p)
+{
+  return le16(p) | ((unsigned long)le16(p + 2) << 16);
+}
+
+/* Reads a 16 bit PCM WAV. Returns 0 on success. */
+static int load_wav(const char *fname, pcm_t *wav)
+{
+  unsigned char *buf;
+  long len, pos;
+  int bits = 0;
+
+  buf = load_file(fname, &len);
+  if (!buf) {
+    fprintf(stderr, "xingdec : [%s] load failed\n", fname);
+    return -1;
+  }
+  memset(wav, 0, sizeof(*wav));
+  if (len < 12 || memcmp(buf, "RIFF", 4) || memcmp(buf + 8, "WAVE", 4)) {
+    fprintf(stderr, "xingdec : [%s] not a WAV file\n", fname);
+    free(buf);
+    return -1;
+  }
+  for (pos = 12; pos + 8 <= len; ) {
+    unsigned long size = le32(buf + pos + 4);
+    const unsigned char *p = buf + pos + 8;
+
+    if (size > (unsigned long)(len - pos - 8)) {
+      size = len - pos - 8;
+    }
+    if (!memcmp(buf + pos, "fmt ", 4) && size >= 16) {
+      if (le16(p) != 1) {
+	break;
+      }
+      wav->channels = le16(p + 2);
+      wav->samprate = le32(p + 4);
+      bits = le16(p + 14);
+    } else if (!memcmp(buf + pos, "data", 4) && bits == 16
+	       && wav->channels > 0) {
+      long i, n = size / 2;
+
+      wav->pcm = malloc(n * sizeof(short) + 1);
+      for (i = 0; wav->pcm && i < n; ++i) {
+	wav->pcm[i] = (short)le16(p + i * 2);
+      }
+      wav->samples = n / wav->channels;
+      break;
+    }
+    pos += 8 + size + (size & 1);
+  }
+  free(buf);
+  if (!wav->pcm) {
+    fprintf(stderr, "xingdec : [%s] no 16 bit PCM data\n", fname);
+    return -1;
+  }
+  return 0;
+}
+
+/* Decodes the stream reps times with transform_code tc. The output of the
+ * first run is in out. Returns the mean decode time in seconds or -1. */
+static double decode(unsigned char *bs, long n, int tc, int reps, pcm_t *out)
+{
+  static short pcm[2304 * 2];
+  long max = 0;
+  clock_t t = 0;
+  int r;
+
+  memset(out, 0, sizeof(*out));
+  for (r = 0; r < reps; ++r) {
+    MPEG_HEAD head;
+    DEC_INFO info;
+    unsigned int forward;
+    int bitrate, frame_bytes;
+    long pos;
+    clock_t t0;
+
+    mpeg_init(&mpeg);
+    mpeg_eq_init(&mpeg);
+    frame_bytes = head_info3(bs, n, &head, &bitrate, &forward);
+    if (!frame_bytes
+	|| !audio_decode_init(&mpeg, &head, frame_bytes,
+			      REDUCT_NORMAL, tc, CONV_NORMAL, 40000)) {
+      fprintf(stderr, "xingdec : bad or unsupported MPEG file\n");
+      return -1;
+    }
+    audio_decode_info(&mpeg, &info);
+    if (info.channels < 1 || info.channels > 2 || info.bits != 16) {
+      fprintf(stderr, "xingdec : unsupported audio output format\n");
+      return -1;
+    }
+    out->channels = info.channels;
+    out->samprate = info.samprate;
+
+    t0 = clock();
+    for (pos = forward; pos + 4 <= n; ) {
+      IN_OUT x = audio_decode(&mpeg, bs + pos, pcm);
+
+      if (x.in_bytes <= 0 || pos + x.in_bytes > n) {
+	break;
+      }
+      pos += x.in_bytes;
+      if (r > 0) {
+	continue;
+      }
+      if (out->samples * out->channels + x.out_bytes / 2 > max) {
+	max = 2 * max + x.out_bytes / 2;
+	out->pcm = realloc(out->pcm, max * sizeof(short));
+	if (!out->pcm) {
+	  fprintf(stderr, "xingdec : out of memory\n");
+	  exit(2);
+	}
+      }
+      memcpy(out->pcm + out->samples * out->channels, pcm, x.out_bytes);
+      out->samples += x.out_bytes / 2 / out->channels;
+    }
+    t += clock() - t0;
+  }
+  return (double)t / CLOCKS_PER_SEC / reps;
+}
+
+/* Prints the error of test against ref, skip samples of test dropped.
+ * Returns the PSNR in dB (HUGE_VAL if identical) or -1. */
+static double compare(const pcm_t *ref, const pcm_t *test, long skip)
+{
+  long i, n, maxd = 0;
+  double se = 0;
+  const short *a = ref->pcm, *b;
+
+  if (ref->channels != test->channels || ref->samprate != test->samprate) {
+    printf("  format differs (%d ch %ld Hz)\n",
+	   ref->channels, ref->samprate);
+    return -1;
+  }
+  if (skip > test->samples) {
+    skip = test->samples;
+  }
+  b = test->pcm + skip * test->channels;
+  n = test->samples - skip;
+  if (n > ref->samples) {
+    n = ref->samples;
+  }
+  n *= ref->channels;
+  for (i = 0; i < n; ++i) {
+    long d = labs((long)a[i] - b[i]);
+
+    se += (double)d * d;
+    if (d > maxd) {
+      maxd = d;
+    }
+  }
+  if (!n) {
+    printf("  no samples\n");
+    return -1;
+  }
+  if (!maxd) {
+    printf("  identical\n");
+    return HUGE_VAL;
+  }
+  printf("  PSNR %5.1f dB  rms %7.3f  max %5ld\n",
+	 10 * log10(32767.0 * 32767.0 * n / se), sqrt(se / n), maxd);
+  return 10 * log10(32767.0 * 32767.0 * n / se);
+}
+
+int main(int na, char **a)
+{
+  unsigned char *bs;
+  long len;
+  int reps = 1, tc;
+  long skip = 0;
+  double min_psnr = 0;
+  pcm_t ref, out[3];
+  int has_wav = 0, failed = 0;
+
+  for (; na > 2 && a[1][0] == '-'; na -= 2, a += 2) {
+    if (!strcmp(a[1], "-r")) {
+      reps = atoi(a[2]);
+    } else if (!strcmp(a[1], "-s")) {
+      skip = atol(a[2]);
+    } else if (!strcmp(a[1], "-t")) {
+      min_psnr = atof(a[2]);
+    } else {
+      break;
+    }
+  }
+  if (na < 2 || na > 3 || reps <= 0 || skip < 0 || min_psnr < 0) {
+    fprintf(stderr,
+	    "Usage: xingdec [-r reps] [-s skip] [-t psnr] file.mp3 [ref.wav]\n");
+    return 1;
+  }
+
+  bs = load_file(a[1], &len);
+  if (!bs) {
+    fprintf(stderr, "xingdec : [%s] load failed\n", a[1]);
+    return 2;
+  }
+  if (na > 2) {
+    if (load_wav(a[2], &ref)) {
+      return 2;
+    }
+    has_wav = 1;
+  }
+
+  for (tc = TRANSFORM_FLOAT; tc <= TRANSFORM_VECTOR; ++tc) {
+    double psnr, sec = decode(bs, len, tc, reps, &out[tc]);
+
+    if (sec < 0) {
+      return 2;
+    }
+    if (tc == TRANSFORM_FLOAT) {
+      printf("xingdec : [%s] %d ch %ld Hz, %.1f s\n", a[1],
+	     out[tc].channels, out[tc].samprate,
+	     (double)out[tc].samples / out[tc].samprate);
+    }
+    printf("  %-6s  x%7.1f", path_names[tc],
+	   (double)out[tc].samples / out[tc].samprate / (sec > 0 ? sec : 1e-9));
+    if (has_wav) {
+      psnr = compare(&ref, &out[tc], skip);
+    } else if (tc == TRANSFORM_FLOAT) {
+      printf("  reference\n");
+      continue;
+    } else {
+      psnr = compare(&out[TRANSFORM_FLOAT], &out[tc], 0);
+    }
+    if (min_psnr > 0 && psnr < min_psnr) {
+      printf("  %-6s  below %.1f dB\n", path_names[tc], min_psnr);
+      failed = 1;
+    }
+  }
+  return failed ? 3 : 0;
+}
@@ -114,5 +114,31 @@ typedef int WINCOEF;
 
 #define WINBITS 10
 #define WINMULT(x,coef)  ((x)*(coef))
+
+/*-------------- Layer III fixed point ihwin.c isbtL3.c ----------------
+hybrid (imdct + overlap) and sbt (dct + full window) for Layer III,
+selected with transform_code TRANSFORM_FIXED (see mhead.h).
+
+L3INT:    samples, L3FRAC fractional bits below one 16 bit pcm step.
+          Input spectral values are clamped to L3MAXIN pcm steps, so
+          the transforms have about 3 bits of headroom and do not
+          saturate.
+L3COEF:   coefs, L3CBITS fractional bits. Largest coef is the 10.2 of
+          the 32 pt dct.
+L3MULT:   32x32 multiply keeping the 32 bits of interest of the 64 bit
+          product (dmuls.l on SH-4). All sums are 32 bit.
+------------------------------------------------------------------*/
+typedef int L3INT;
+typedef int L3COEF;
+#ifdef _MSC_VER
+typedef __int64 L3PROD;
+#else
+typedef long long L3PROD;
+#endif
+
+#define L3FRAC   8
+#define L3CBITS  27
+#define L3MAXIN  (1 << 19)
+#define L3MULT(x,coef)  ((L3INT) (((L3PROD) (x) * (coef) + (1 << (L3CBITS - 1))) >> L3CBITS))
 #endif
 
@@ -196,6 +196,14 @@ struct _mpeg
   struct {
     float coef32[31];	/* 32 pt dct coefs */
   } cdct;
+  struct {
+    /* ihwin.c isbtL3.c : fixed point Layer III, see itype.h */
+    int yout[576];		/* hybrid out, sbt in */
+    signed int vb_ptr;
+    signed int vb2_ptr;
+    int vbuf[512];
+    int vbuf2[512];
+  } il3;
 
   // This needs to be last in this struct!
   eq_info eq;
@@ -287,6 +295,12 @@ extern "C"
   /* audio_decode_init returns 1 for success, 0 for fail */
   /* audio_decode returns in_bytes = 0 on sync loss */
 
+  /* Layer III transform_code, TRANSFORM_FIXED and TRANSFORM_VECTOR
+     are full rate 16 bit only, others fall back to TRANSFORM_FLOAT */
+#define TRANSFORM_FLOAT   0	/* float hybrid and sbt */
+#define TRANSFORM_FIXED   1	/* fixed point hybrid and sbt */
+#define TRANSFORM_VECTOR  2	/* float, window in vectorizable loops */
+
   int audio_decode_init(MPEG *m, MPEG_HEAD * h, int framebytes_arg,
 			int reduction_code, int transform_code,
 			int convert_code, int freq_limit);
@@ -5,6 +5,15 @@ int hybrid_sum(MPEG *m, void *xin, void *xin_left, float *y,
 	       int btype, int nlong, int ntot);
 void sum_f_bands(void *a, void *b, int n);
 void FreqInvert(float *y, int n);
+
+/*---------- fixed point hybrid and sbt (ihwin.c isbtL3.c) -------*/
+void ihwin_init(MPEG *m);
+void isbtL3_init(MPEG *m);
+int i_hybrid(MPEG *m, SAMPLE xin[], SAMPLE xprev[], L3INT *y,
+	     int btype, int nlong, int ntot, int nprev);
+void i_FreqInvert(L3INT *y, int n);
+void i_sbt_mono_L3(MPEG *m, L3INT *sample, short *pcm, int ch);
+void i_sbt_dual_L3(MPEG *m, L3INT *sample, short *pcm, int ch);
 void antialias(MPEG *m, void *x, int n);
 void ms_process(void *x, int n);	/* sum-difference stereo */
 void is_process_MPEG1(MPEG *m, void *x,	/* intensity stereo */
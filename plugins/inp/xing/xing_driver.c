@@ -24,6 +24,7 @@
 
 #include <kos.h>
 #include <string.h>
+#include <malloc.h>
 
 //#include "sndstream.h"
 //#include "sndmp3.h"
@@ -66,6 +67,47 @@ static MPEG	  mpeg;
 static MPEG_HEAD  head;
 static int        bitrate;
 static DEC_INFO   decinfo;
+static unsigned int read_pos;    /* File offset of bitstream buffer end */
+
+/* Frame index : file offset of one frame every INDEX_STEP. It is filled
+   while decoding and while seeking forward, so that seeking back to an
+   already reached position does not read the file again. */
+#define INDEX_STEP    16
+#define SEEK_PREROLL  3          /* Frames decoded before seek position */
+static unsigned int * frame_index;
+static int index_count, index_max;
+static int frame_no;             /* Number of next frame */
+static int frame_samples;        /* PCM per frame */
+static int cbr;                  /* Constant bitrate : offsets computable */
+
+/* Layer III hybrid and sbt (TRANSFORM_* in mhead.h), changed by the
+   xing_transform lua command, used when next file starts. */
+static int transform = TRANSFORM_FLOAT;
+
+static void index_add(int frame, unsigned int pos)
+{
+  if (frame % INDEX_STEP || frame / INDEX_STEP != index_count) {
+    return;
+  }
+  if (index_count == index_max) {
+    int max = index_max ? index_max * 2 : 256;
+    unsigned int * idx = realloc(frame_index, max * sizeof(*idx));
+    if (!idx) {
+      return;
+    }
+    frame_index = idx;
+    index_max = max;
+  }
+  frame_index[index_count++] = pos;
+}
+
+static void index_free(void)
+{
+  free(frame_index);
+  frame_index = 0;
+  index_count = index_max = 0;
+  frame_no = 0;
+}
 
 /* Checks to make sure we have some data available in the bitstream
    buffer; if there's less than a certain "water level", shift the
@@ -94,6 +136,7 @@ static int bs_fill(int min_bytes)
     }
 
     bs_count += n;
+    read_pos += n;
   }
   return (bs_count < min_bytes) ? INP_DECODE_END : 0;
 }
@@ -153,6 +196,7 @@ static int decode_frame(void)
       resync = 0;
     }
 
+    index_add(frame_no++, read_pos - bs_count);
     bs_ptr      += x.in_bytes;
     bs_count    -= x.in_bytes;
 
@@ -189,6 +233,8 @@ static int xing_init(const char *fn, playa_info_t * info)
 	
   /* Allocate buffers */
   bs_ptr = bs_buffer; bs_count = 0;
+  read_pos = 0;
+  index_free();
   pcm_ptr = pcm_buffer; pcm_count = 0;
 	
   /* Fill bitstream buffer */
@@ -270,12 +316,22 @@ static int xing_init(const char *fn, playa_info_t * info)
     SDERROR("xing: Bad or unsupported MPEG file.\n");
     goto errorout;
   }
+  index_add(0, read_pos - bs_count);
+
+  /* A Xing or VBRI header in first frame tags variable bitrate files. */
+  cbr = bitrate > 0;
+  {
+    int i;
+    for (i=0; cbr && i+4 <= frame_bytes && i+4 <= bs_count; ++i) {
+      cbr = memcmp(bs_ptr+i, "Xing", 4) && memcmp(bs_ptr+i, "VBRI", 4);
+    }
+  }
 
   /* Initialize audio decoder */
   /* $$$ Last parameters looks like cut frequency :
      Dim said to me 40000 is a good value */ 
   if (!audio_decode_init(&mpeg, &head, frame_bytes,
-			 REDUCT_NORMAL, 0, CONV_NORMAL, 40000)) {
+			 REDUCT_NORMAL, transform, CONV_NORMAL, 40000)) {
     SDERROR("xing : failed to initialize decoder\n");
     goto errorout;
   }
@@ -313,6 +369,11 @@ static int xing_init(const char *fn, playa_info_t * info)
   pcm_count  = 0;
   pcm_stereo = decinfo.channels-1;
 
+  /* PCM per frame : 384 for layer I, 1152 for layer II and 1152 or 576
+     (mpeg 2 and 2.5) for layer III. */
+  frame_samples = head.option == 3 ? 384
+    : (head.option == 2 || head.id) ? 1152 : 576;
+
   SDDEBUG("<< %s('%s') := [0]\n",  __FUNCTION__, fn);
   return 0;
 
@@ -331,6 +392,125 @@ static void xing_shutdown()
     fs_close(mp3_fd);
     mp3_fd = -1;
   }
+  index_free();
+}
+
+/* Restart reading bitstream at file offset pos. */
+static int stream_seek(unsigned int pos)
+{
+  if (fs_seek(mp3_fd, pos, SEEK_SET) != pos) {
+    SDERROR("xing : seek to %u failed.\n", pos);
+    return INP_DECODE_ERROR;
+  }
+  read_pos = pos;
+  bs_ptr = bs_buffer;
+  bs_count = 0;
+  return 0;
+}
+
+/* Skip a frame reading its header only. Fails on bad sync. */
+static int skip_frame(void)
+{
+  MPEG_HEAD h;
+  int bytes, code;
+
+  code = bs_fill(4);
+  if (code) {
+    return code;
+  }
+  bytes = head_info((unsigned char *)bs_ptr, bs_count, &h);
+  if (bytes <= 0) {
+    return INP_DECODE_ERROR;
+  }
+  bytes += h.pad << (h.option == 3 ? 2 : 0);
+  code = bs_fill(bytes);
+  if (code) {
+    return code;
+  }
+  index_add(frame_no++, read_pos - bs_count);
+  bs_ptr   += bytes;
+  bs_count -= bytes;
+  return 0;
+}
+
+/* Jump to frame computing its offset from the constant bitrate, then sync
+   on a frame header followed by another one. Frame numbers are estimated
+   from there, so no index is built. */
+static int cbr_seek(int frame)
+{
+  const int max_scan = 1<<14;
+  unsigned int pos;
+  int scan, code;
+
+  pos = frame_index[0] + (long long)frame * frame_samples * (bitrate >> 3)
+    / decinfo.samprate;
+  code = stream_seek(pos);
+  for (scan = 0; !code && scan < max_scan; ++scan, ++bs_ptr, --bs_count) {
+    MPEG_HEAD h;
+    int bytes, br;
+
+    code = bs_fill(4);
+    if (code || (uint8)bs_ptr[0] != 0xff) {
+      continue;
+    }
+    br = (uint8)bs_ptr[2] >> 4;
+    if (!br || br == 15) {
+      continue;
+    }
+    bytes = head_info((unsigned char *)bs_ptr, 4, &h);
+    if (bytes <= 0) {
+      continue;
+    }
+    bytes += h.pad << (h.option == 3 ? 2 : 0);
+    code = bs_fill(bytes + 2);
+    if (!code && (uint8)bs_ptr[bytes] == 0xff
+	&& (bs_ptr[bytes+1] & 0xfe) == (bs_ptr[1] & 0xfe)) {
+      frame_no = frame;
+      return 0;
+    }
+  }
+  return code ? code : INP_DECODE_ERROR;
+}
+
+/* Seek : restart from the nearest indexed frame before the target, skip
+   frames by their header up to a few frames before the target, then
+   decode these frames so that layer III bit reservoir is filled. */
+static int xing_seek(unsigned int ms)
+{
+  int target, frame, i, code = 0;
+
+  if (mp3_fd < 0 || !frame_samples || !index_count) {
+    return -1;
+  }
+  target = (long long)ms * decinfo.samprate / (1000 * frame_samples);
+  frame = target > SEEK_PREROLL ? target - SEEK_PREROLL : 0;
+  i = frame / INDEX_STEP;
+  if (i >= index_count) {
+    i = index_count - 1;
+  }
+  if (cbr && frame >= (index_count + 4) * INDEX_STEP
+      && (frame_no > frame || frame - frame_no >= 4 * INDEX_STEP)) {
+    /* Far beyond index : do not read the file up to there. */
+    code = cbr_seek(frame);
+  } else if (i * INDEX_STEP > frame_no || frame_no > frame) {
+    code = stream_seek(frame_index[i]);
+    frame_no = i * INDEX_STEP;
+  }
+  while (!code && frame_no < frame) {
+    code = skip_frame();
+  }
+  if (code == INP_DECODE_ERROR) {
+    /* Lost sync : let the decoder resync. */
+    code = 0;
+  }
+  while (!(code & INP_DECODE_END) && frame_no < target) {
+    code = decode_frame();
+  }
+  pcm_ptr = pcm_buffer;
+  pcm_count = 0;
+  SDDEBUG("xing : seek %ums -> frame %d/%d (%d indexed)\n",
+	  ms, frame_no, target, index_count);
+  return (code & INP_DECODE_END) ? -1 : 0;
 }
 
 
@@ -416,6 +596,11 @@ static int sndmp3_decoder(playa_info_t * info)
   return -(n > 0) & INP_DECODE_CONT;
 }
 
+static int sndmp3_seek(unsigned int ms, playa_info_t *info)
+{
+  return xing_seek(ms);
+}
+
 static int sndmp3_info(playa_info_t *info, const char *fname)
 {
   return id3_info(info, fname);
@@ -427,6 +612,36 @@ static driver_option_t * sndmp3_options(any_driver_t * d, int idx,
   return o;
 }
 
+/* LUA interface */
+
+#include "luashell.h"
+
+static int lua_transform(lua_State * L)
+{
+  int old = transform;
+  if (lua_gettop(L) >= 1) {
+    int t = lua_tonumber(L, 1);
+    if (t >= TRANSFORM_FLOAT && t <= TRANSFORM_VECTOR) {
+      transform = t;
+    }
+  }
+  lua_settop(L, 0);
+  lua_pushnumber(L, old);
+  return 1;
+}
+
+static luashell_command_description_t commands[] = {
+  {
+    "xing_transform", 0, "xing",     /* long name, short name, topic */
+    "xing_transform([mode]) : set or return layer III synthesis"
+    " for next file, 0:float 1:fixed point 2:vectorized float",  /* usage */
+    SHELL_COMMAND_C, lua_transform      /* function */
+  },
+
+  /* end of the command list */
+  {0},
+};
+
 static inp_driver_t xing_driver =
 {
 
@@ -445,6 +660,7 @@ static inp_driver_t xing_driver =
     sndmp3_init,         /**< Driver init */
     sndmp3_shutdown,     /**< Driver shutdown */
     sndmp3_options,      /**< Driver options */
+    commands,            /**< Lua shell commands */
   },
   
   /* Input driver specific */
@@ -456,6 +672,7 @@ static inp_driver_t xing_driver =
   sndmp3_stop,
   sndmp3_decoder,
   sndmp3_info,
+  sndmp3_seek,
 };
 
 EXPORT_DRIVER(xing_driver)
@@ -54,6 +54,8 @@ void window16(MPEG *m, float *, int , short *pcm);
 void window16_dual(MPEG *m, float *, int , short *pcm);
 void window8(MPEG *m, float *, int , short *pcm);
 void window8_dual(MPEG *m, float *, int , short *pcm);
+void window_v(MPEG *m, float *, int , short *pcm);
+void window_dual_v(MPEG *m, float *, int , short *pcm);
 float *dct_coef_addr(MPEG *m);
 
 /*-------------------------------------------------------------------------*/
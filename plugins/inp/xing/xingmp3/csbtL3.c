@@ -74,6 +74,49 @@ void sbt_dual_L3(MPEG *m, float *sample, short *pcm, int ch)
       }
 
 
+}
+/*------------------------------------------------------------*/
+/*---------------- vectorizable window (cwinv.c) -------------*/
+void sbt_mono_L3v(MPEG *m, float *sample, short *pcm, int ch)
+{
+   int i;
+
+   ch = 0;
+   for (i = 0; i < 18; i++)
+   {
+      fdct32(m,sample, m->csbt.vbuf + m->csbt.vb_ptr);
+      window_v(m,m->csbt.vbuf, m->csbt.vb_ptr, pcm);
+      sample += 32;
+      m->csbt.vb_ptr = (m->csbt.vb_ptr - 32) & 511;
+      pcm += 32;
+   }
+
+}
+/*------------------------------------------------------------*/
+void sbt_dual_L3v(MPEG *m, float *sample, short *pcm, int ch)
+{
+   int i;
+
+   if (ch == 0)
+      for (i = 0; i < 18; i++)
+      {
+	 fdct32(m,sample, m->csbt.vbuf + m->csbt.vb_ptr);
+	 window_dual_v(m,m->csbt.vbuf, m->csbt.vb_ptr, pcm);
+	 sample += 32;
+	 m->csbt.vb_ptr = (m->csbt.vb_ptr - 32) & 511;
+	 pcm += 64;
+      }
+   else
+      for (i = 0; i < 18; i++)
+      {
+	 fdct32(m,sample, m->csbt.vbuf2 + m->csbt.vb2_ptr);
+	 window_dual_v(m, m->csbt.vbuf2, m->csbt.vb2_ptr, pcm + 1);
+	 sample += 32;
+	 m->csbt.vb2_ptr = (m->csbt.vb2_ptr - 32) & 511;
+	 pcm += 64;
+      }
+
+
 }
 /*------------------------------------------------------------*/
 /*------------------------------------------------------------*/
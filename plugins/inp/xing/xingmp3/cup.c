@@ -59,7 +59,12 @@ reduction_code  input, sample rate reduction code
                     1 = half rate
                     2 = quarter rate
 
-transform_code  input, ignored
+transform_code  input, Layer III synthesis, ignored by Layer I/II
+                    0 = float (TRANSFORM_FLOAT)
+                    1 = fixed point (TRANSFORM_FIXED)
+                    2 = vectorized float window (TRANSFORM_VECTOR)
+                  1 and 2 need full rate 16 bit output and
+                  convert_code 0, else float is used
 convert_code    input, channel conversion
                   convert_code:  0 = two chan output
                                  1 = convert two chan to mono
@@ -261,6 +261,62 @@ static void Xform_dual_mono(void *mv, void *pcm, int igr)
    FreqInvert(m->cupl.yout, n3);
    m->cupl.sbt_L3(m,m->cupl.yout, pcm, 0);
 
+}
+/*--------------------------------------------------------------------*/
+/*-- fixed point hybrid + sbt (transform_code TRANSFORM_FIXED) --*/
+static void Xform_mono_i(void *mv, void *pcm, int igr)
+{
+   MPEG *m = mv;
+   int igr_prev, n1, n2;
+
+/*--- hybrid + sbt ---*/
+   n1 = n2 = m->cupl.nsamp[igr][0];	/* total number bands */
+   if (m->cupl.side_info.gr[igr][0].block_type == 2)
+   {				/* long bands */
+      n1 = 0;
+      if (m->cupl.side_info.gr[igr][0].mixed_block_flag)
+	 n1 = m->cupl.sfBandIndex[0][m->cupl.ncbl_mixed - 1];
+   }
+   if (n1 > m->cupl.band_limit)
+      n1 = m->cupl.band_limit;
+   if (n2 > m->cupl.band_limit)
+      n2 = m->cupl.band_limit;
+   igr_prev = igr ^ 1;
+
+   m->cupl.nsamp[igr][0] = i_hybrid(m,m->cupl.sample[0][igr], m->cupl.sample[0][igr_prev],
+	 m->il3.yout, m->cupl.side_info.gr[igr][0].block_type, n1, n2, m->cupl.nsamp[igr_prev][0]);
+   i_FreqInvert(m->il3.yout, m->cupl.nsamp[igr][0]);
+   i_sbt_mono_L3(m,m->il3.yout, pcm, 0);
+
+}
+/*--------------------------------------------------------------------*/
+static void Xform_dual_i(void *mv, void *pcm, int igr)
+{
+   MPEG *m = mv;
+   int ch;
+   int igr_prev, n1, n2;
+
+/*--- hybrid + sbt ---*/
+   igr_prev = igr ^ 1;
+   for (ch = 0; ch < m->cupl.nchan; ch++)
+   {
+      n1 = n2 = m->cupl.nsamp[igr][ch];	/* total number bands */
+      if (m->cupl.side_info.gr[igr][ch].block_type == 2)
+      {				/* long bands */
+	 n1 = 0;
+	 if (m->cupl.side_info.gr[igr][ch].mixed_block_flag)
+	    n1 = m->cupl.sfBandIndex[0][m->cupl.ncbl_mixed - 1];
+      }
+      if (n1 > m->cupl.band_limit)
+	 n1 = m->cupl.band_limit;
+      if (n2 > m->cupl.band_limit)
+	 n2 = m->cupl.band_limit;
+      m->cupl.nsamp[igr][ch] = i_hybrid(m,m->cupl.sample[ch][igr], m->cupl.sample[ch][igr_prev],
+       m->il3.yout, m->cupl.side_info.gr[igr][ch].block_type, n1, n2, m->cupl.nsamp[igr_prev][ch]);
+      i_FreqInvert(m->il3.yout, m->cupl.nsamp[igr][ch]);
+      i_sbt_dual_L3(m,m->il3.yout, pcm, ch);
+   }
+
 }
 /*--------------------------------------------------------------------*/
 /*====================================================================*/
@@ -940,6 +996,9 @@ void sbt16_mono_L3(MPEG *m, float *sample, signed short *pcm, int ch);
 void sbt16_dual_L3(MPEG *m, float *sample, signed short *pcm, int ch);
 void sbt8_mono_L3(MPEG *m, float *sample, signed short *pcm, int ch);
 void sbt8_dual_L3(MPEG *m, float *sample, signed short *pcm, int ch);
+void sbt_mono_L3v(MPEG *m, float *sample, signed short *pcm, int ch);
+void sbt_dual_L3v(MPEG *m, float *sample, signed short *pcm, int ch);
+void winv_init(void);
 
 void sbtB_mono_L3(MPEG *m, float *sample, unsigned char *pcm, int ch);
 void sbtB_dual_L3(MPEG *m, float *sample, unsigned char *pcm, int ch);
@@ -1018,7 +1077,6 @@ int L3audio_decode_init(void *mv, MPEG_HEAD * h, int framebytes_arg,
 
    m->cupl.framebytes = framebytes_arg;
 
-   transform_code = transform_code;	/* not used, asm compatability */
    bit_code = 0;
    if (convert_code & 8)
       bit_code = 1;
@@ -1090,6 +1148,15 @@ int L3audio_decode_init(void *mv, MPEG_HEAD * h, int framebytes_arg,
       k = 0;
    m->cupl.Xform = xform_table[k];
 
+/*-- fixed point or vector transform, full rate 16 bit no conversion only --*/
+   if (bit_code == 0 && reduction_code == 0 && convert_code == 0)
+   {
+      if (transform_code == TRANSFORM_FIXED)
+	 m->cupl.Xform = (h->mode == 3) ? Xform_mono_i : Xform_dual_i;
+      else if (transform_code == TRANSFORM_VECTOR)
+	 m->cupl.sbt_L3 = (h->mode == 3) ? sbt_mono_L3v : sbt_dual_L3v;
+   }
+
 
    m->cupl.outvalues *= out_chans;
 
@@ -1145,6 +1212,10 @@ int L3audio_decode_init(void *mv, MPEG_HEAD * h, int framebytes_arg,
 
 /*----- init sbt ---*/
    sbt_init(m);
+/* fixed point and vector window coefs from the float tables */
+   ihwin_init(m);
+   isbtL3_init(m);
+   winv_init();
 
 
 
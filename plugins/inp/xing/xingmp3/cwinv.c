@@ -0,0 +1,147 @@
+/*____________________________________________________________________________
+
+	FreeAmp - The Free MP3 Player
+
+	This program is free software; you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation; either version 2 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program; if not, write to the Free Software
+	Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+
+	$Id$
+____________________________________________________________________________*/
+
+/****  cwinv.c  ***************************************************
+
+MPEG audio decoder, float window in vectorizable loops
+portable C, full rate only (transform_code TRANSFORM_VECTOR)
+
+Same sums as window() in cwin.c. For one output block, the 16
+taps of every output read the rows
+
+   s[j] = vbuf[vb_ptr + 64*j + 16 ... 31]
+   b[j] = vbuf[vb_ptr + 64*j + 32 ... 48]     j = 0...7
+
+which never wrap since vb_ptr is a multiple of 32. The window is
+computed row by row with transposed coefs, so that each inner loop
+is a 16 wide multiply-add on consecutive values that a compiler
+turns into SIMD code. The sums are added in a different order than
+cwin.c, output may differ by one pcm step.
+
+******************************************************************/
+
+#include <float.h>
+#include <math.h>
+#include "L3.h"
+#include "mhead.h"
+
+extern float wincoef[264];
+
+/* out[i]    = p[i] + r[15 - i]       i = 0...15
+   out[16]   = special
+   out[17+k] = q[15 - k] + t[k]       k = 0...14 */
+static float coef_p[8][16];	/* s rows, first 16 */
+static float coef_q[8][16];	/* s rows, last 15 */
+static float coef_r[8][16];	/* b rows + 1, first 16 */
+static float coef_t[8][16];	/* b rows + 1, last 15 */
+static float coef_special[8];	/* b rows + 0 */
+
+/*------------------------------------------------------------*/
+void winv_init(void)
+{
+   int i, j, k;
+
+   for (j = 0; j < 8; j++)
+   {
+      for (i = 0; i < 16; i++)
+      {
+	 coef_p[j][i] = wincoef[16 * i + 2 * j];
+	 coef_r[j][15 - i] = -wincoef[16 * i + 2 * j + 1];
+      }
+      coef_special[j] = wincoef[256 + j];
+      coef_q[j][0] = 0.0F;
+      coef_t[j][15] = 0.0F;
+      for (k = 0; k < 15; k++)
+      {
+	 coef_q[j][15 - k] = wincoef[255 - 16 * k - 2 * j];
+	 coef_t[j][k] = wincoef[254 - 16 * k - 2 * j];
+      }
+   }
+}
+/*------------------------------------------------------------*/
+#define V_PCM(sum, tmp) \
+   tmp = (long) (sum); \
+   if (tmp > 32767) \
+      tmp = 32767; \
+   else if (tmp < -32768) \
+      tmp = -32768
+
+/* step is 1 for mono, 2 for dual (interleaved output) */
+static void window_step(float *vbuf, int vb_ptr, short *pcm, int step)
+{
+   float p[16], q[16], r[16], t[16];
+   float special;
+   float *s, *b;
+   int i, j;
+   long tmp;
+
+   for (i = 0; i < 16; i++)
+      p[i] = q[i] = r[i] = t[i] = 0.0F;
+   special = 0.0F;
+
+   for (j = 0; j < 8; j++)
+   {
+      s = vbuf + ((vb_ptr + 64 * j + 16) & 511);
+      b = vbuf + ((vb_ptr + 64 * j + 32) & 511);
+      for (i = 0; i < 16; i++)
+      {
+	 p[i] += coef_p[j][i] * s[i];
+	 q[i] += coef_q[j][i] * s[i];
+      }
+      special += coef_special[j] * b[0];
+      b++;
+      for (i = 0; i < 16; i++)
+      {
+	 r[i] += coef_r[j][i] * b[i];
+	 t[i] += coef_t[j][i] * b[i];
+      }
+   }
+
+/*-- first 16 --*/
+   for (i = 0; i < 16; i++)
+   {
+      V_PCM(p[i] + r[15 - i], tmp);
+      *pcm = tmp;
+      pcm += step;
+   }
+/*--  special case --*/
+   V_PCM(special, tmp);
+   *pcm = tmp;
+   pcm += step;
+/*-- last 15 --*/
+   for (i = 0; i < 15; i++)
+   {
+      V_PCM(q[15 - i] + t[i], tmp);
+      *pcm = tmp;
+      pcm += step;
+   }
+}
+/*------------------------------------------------------------*/
+void window_v(MPEG *m, float *vbuf, int vb_ptr, short *pcm)
+{
+   window_step(vbuf, vb_ptr, pcm, 1);
+}
+/*------------------------------------------------------------*/
+void window_dual_v(MPEG *m, float *vbuf, int vb_ptr, short *pcm)
+{
+   window_step(vbuf, vb_ptr, pcm, 2);
+}
+/*------------------------------------------------------------*/
@@ -0,0 +1,384 @@
+/*____________________________________________________________________________
+
+	FreeAmp - The Free MP3 Player
+
+	This program is free software; you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation; either version 2 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program; if not, write to the Free Software
+	Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+
+	$Id$
+____________________________________________________________________________*/
+
+/****  ihwin.c  ***************************************************
+
+Layer III
+
+fixed point hybrid window/filter, integer version of hwin.c
+and mdct.c (see itype.h for the number format)
+
+input is the float dequantized sample, converted block by block.
+The overlap for the next granule is kept as L3INT in the .s
+member of the same SAMPLE buffer, where the float version keeps
+it in .x
+
+coefs are made from the float tables built by imdct_init and
+hwin_init, call ihwin_init after L3table_init.
+
+******************************************************************/
+#include <float.h>
+#include <math.h>
+#include "L3.h"
+#include "mhead.h"
+
+typedef struct
+{
+   float *w;
+   float *w2;
+   void *coef;
+}
+IMDCT_INIT_BLOCK;
+
+IMDCT_INIT_BLOCK *imdct_init_addr_18();
+IMDCT_INIT_BLOCK *imdct_init_addr_6();
+
+/*------ 18 point xform -------*/
+static L3COEF mdct18w[18];
+static L3COEF mdct18w2[9];
+static L3COEF coef[9][4];
+
+static L3COEF mdct6_3v[6];
+static L3COEF mdct6_3v2[3];
+static L3COEF coef87;
+
+/*-- windows by block type --*/
+static L3COEF win[4][36];
+
+/*====================================================================*/
+static L3COEF fix_coef(float x)
+{
+   double t = x * (double) (1 << L3CBITS);
+
+   return (L3COEF) (t > 0.0 ? t + 0.5 : t - 0.5);
+}
+/*--------------------------------------------------------------------*/
+void ihwin_init(MPEG *m)
+{
+   int i, j;
+   IMDCT_INIT_BLOCK *addr;
+   float (*c)[4];
+
+   addr = imdct_init_addr_18();
+   c = addr->coef;
+   for (i = 0; i < 18; i++)
+      mdct18w[i] = fix_coef(addr->w[i]);
+   for (i = 0; i < 9; i++)
+   {
+      mdct18w2[i] = fix_coef(addr->w2[i]);
+      for (j = 0; j < 4; j++)
+	 coef[i][j] = fix_coef(c[i][j]);
+   }
+
+   addr = imdct_init_addr_6();
+   for (i = 0; i < 6; i++)
+      mdct6_3v[i] = fix_coef(addr->w[i]);
+   for (i = 0; i < 3; i++)
+      mdct6_3v2[i] = fix_coef(addr->w2[i]);
+   coef87 = fix_coef(*(float *) addr->coef);
+
+   for (j = 0; j < 4; j++)
+      for (i = 0; i < 36; i++)
+	 win[j][i] = fix_coef(m->cupl.win[j][i]);
+}
+/*--------------------------------------------------------------------*/
+/* float dequantized input to L3INT, in place */
+static void fix_input(SAMPLE x[], int n)
+{
+   int i;
+   float t;
+
+   for (i = 0; i < n; i++)
+   {
+      t = x[i].x * (float) (1 << L3FRAC);
+      if (t > (float) L3MAXIN * (1 << L3FRAC))
+	 t = (float) L3MAXIN * (1 << L3FRAC);
+      else if (t < -(float) L3MAXIN * (1 << L3FRAC))
+	 t = -(float) L3MAXIN * (1 << L3FRAC);
+      x[i].s = (L3INT) (t > 0.0F ? t + 0.5F : t - 0.5F);
+   }
+}
+/*--------------------------------------------------------------------*/
+static void i_imdct18(L3INT f[18])	/* 18 point */
+{
+   int p;
+   L3INT a[9], b[9];
+   L3INT ap, bp, a8p, b8p;
+   L3INT g1, g2;
+
+
+   for (p = 0; p < 4; p++)
+   {
+      g1 = L3MULT(f[p], mdct18w[p]);
+      g2 = L3MULT(f[17 - p], mdct18w[17 - p]);
+      ap = g1 + g2;		// a[p]
+
+      bp = L3MULT(g1 - g2, mdct18w2[p]);	// b[p]
+
+      g1 = L3MULT(f[8 - p], mdct18w[8 - p]);
+      g2 = L3MULT(f[9 + p], mdct18w[9 + p]);
+      a8p = g1 + g2;		// a[8-p]
+
+      b8p = L3MULT(g1 - g2, mdct18w2[8 - p]);	// b[8-p]
+
+      a[p] = ap + a8p;
+      a[5 + p] = ap - a8p;
+      b[p] = bp + b8p;
+      b[5 + p] = bp - b8p;
+   }
+   g1 = L3MULT(f[p], mdct18w[p]);
+   g2 = L3MULT(f[17 - p], mdct18w[17 - p]);
+   a[p] = g1 + g2;
+   b[p] = L3MULT(g1 - g2, mdct18w2[p]);
+
+
+   f[0] = (a[0] + a[1] + a[2] + a[3] + a[4]) >> 1;
+   f[1] = (b[0] + b[1] + b[2] + b[3] + b[4]) >> 1;
+
+   f[2] = L3MULT(a[5], coef[1][0]) + L3MULT(a[6], coef[1][1])
+      + L3MULT(a[7], coef[1][2]) + L3MULT(a[8], coef[1][3]);
+   f[3] = L3MULT(b[5], coef[1][0]) + L3MULT(b[6], coef[1][1])
+      + L3MULT(b[7], coef[1][2]) + L3MULT(b[8], coef[1][3]) - f[1];
+   f[1] = f[1] - f[0];
+   f[2] = f[2] - f[1];
+
+   f[4] = L3MULT(a[0], coef[2][0]) + L3MULT(a[1], coef[2][1])
+      + L3MULT(a[2], coef[2][2]) + L3MULT(a[3], coef[2][3]) - a[4];
+   f[5] = L3MULT(b[0], coef[2][0]) + L3MULT(b[1], coef[2][1])
+      + L3MULT(b[2], coef[2][2]) + L3MULT(b[3], coef[2][3]) - b[4] - f[3];
+   f[3] = f[3] - f[2];
+   f[4] = f[4] - f[3];
+
+   f[6] = L3MULT(a[5] - a[7] - a[8], coef[3][0]);
+   f[7] = L3MULT(b[5] - b[7] - b[8], coef[3][0]) - f[5];
+   f[5] = f[5] - f[4];
+   f[6] = f[6] - f[5];
+
+   f[8] = L3MULT(a[0], coef[4][0]) + L3MULT(a[1], coef[4][1])
+      + L3MULT(a[2], coef[4][2]) + L3MULT(a[3], coef[4][3]) + a[4];
+   f[9] = L3MULT(b[0], coef[4][0]) + L3MULT(b[1], coef[4][1])
+      + L3MULT(b[2], coef[4][2]) + L3MULT(b[3], coef[4][3]) + b[4] - f[7];
+   f[7] = f[7] - f[6];
+   f[8] = f[8] - f[7];
+
+   f[10] = L3MULT(a[5], coef[5][0]) + L3MULT(a[6], coef[5][1])
+      + L3MULT(a[7], coef[5][2]) + L3MULT(a[8], coef[5][3]);
+   f[11] = L3MULT(b[5], coef[5][0]) + L3MULT(b[6], coef[5][1])
+      + L3MULT(b[7], coef[5][2]) + L3MULT(b[8], coef[5][3]) - f[9];
+   f[9] = f[9] - f[8];
+   f[10] = f[10] - f[9];
+
+   f[12] = ((a[0] + a[2] + a[3]) >> 1) - a[1] - a[4];
+   f[13] = ((b[0] + b[2] + b[3]) >> 1) - b[1] - b[4] - f[11];
+   f[11] = f[11] - f[10];
+   f[12] = f[12] - f[11];
+
+   f[14] = L3MULT(a[5], coef[7][0]) + L3MULT(a[6], coef[7][1])
+      + L3MULT(a[7], coef[7][2]) + L3MULT(a[8], coef[7][3]);
+   f[15] = L3MULT(b[5], coef[7][0]) + L3MULT(b[6], coef[7][1])
+      + L3MULT(b[7], coef[7][2]) + L3MULT(b[8], coef[7][3]) - f[13];
+   f[13] = f[13] - f[12];
+   f[14] = f[14] - f[13];
+
+   f[16] = L3MULT(a[0], coef[8][0]) + L3MULT(a[1], coef[8][1])
+      + L3MULT(a[2], coef[8][2]) + L3MULT(a[3], coef[8][3]) + a[4];
+   f[17] = L3MULT(b[0], coef[8][0]) + L3MULT(b[1], coef[8][1])
+      + L3MULT(b[2], coef[8][2]) + L3MULT(b[3], coef[8][3]) + b[4] - f[15];
+   f[15] = f[15] - f[14];
+   f[16] = f[16] - f[15];
+   f[17] = f[17] - f[16];
+}
+/*--------------------------------------------------------------------*/
+/* does 3, 6 pt dct.  changes order from f[i][window] c[window][i] */
+static void i_imdct6_3(L3INT f[])	/* 6 point */
+{
+   int w;
+   L3INT buf[18];
+   L3INT *a, *c;		// b[i] = a[3+i]
+
+   L3INT g1, g2;
+   L3INT a02, b02;
+
+   c = f;
+   a = buf;
+   for (w = 0; w < 3; w++)
+   {
+      g1 = L3MULT(f[3 * 0], mdct6_3v[0]);
+      g2 = L3MULT(f[3 * 5], mdct6_3v[5]);
+      a[0] = g1 + g2;
+      a[3 + 0] = L3MULT(g1 - g2, mdct6_3v2[0]);
+
+      g1 = L3MULT(f[3 * 1], mdct6_3v[1]);
+      g2 = L3MULT(f[3 * 4], mdct6_3v[4]);
+      a[1] = g1 + g2;
+      a[3 + 1] = L3MULT(g1 - g2, mdct6_3v2[1]);
+
+      g1 = L3MULT(f[3 * 2], mdct6_3v[2]);
+      g2 = L3MULT(f[3 * 3], mdct6_3v[3]);
+      a[2] = g1 + g2;
+      a[3 + 2] = L3MULT(g1 - g2, mdct6_3v2[2]);
+
+      a += 6;
+      f++;
+   }
+
+   a = buf;
+   for (w = 0; w < 3; w++)
+   {
+      a02 = (a[0] + a[2]);
+      b02 = (a[3 + 0] + a[3 + 2]);
+      c[0] = a02 + a[1];
+      c[1] = b02 + a[3 + 1];
+      c[2] = L3MULT(a[0] - a[2], coef87);
+      c[3] = L3MULT(a[3 + 0] - a[3 + 2], coef87) - c[1];
+      c[1] = c[1] - c[0];
+      c[2] = c[2] - c[1];
+      c[4] = a02 - a[1] - a[1];
+      c[5] = b02 - a[3 + 1] - a[3 + 1] - c[3];
+      c[3] = c[3] - c[2];
+      c[4] = c[4] - c[3];
+      c[5] = c[5] - c[4];
+      a += 6;
+      c += 6;
+   }
+}
+/*====================================================================*/
+int i_hybrid(MPEG *m, SAMPLE xin[], SAMPLE xprev[], L3INT y[18][32],
+	     int btype, int nlong, int ntot, int nprev)
+{
+   int i, j;
+   L3INT *x, *x0;
+   L3INT xa, xb;
+   int n;
+   int nout;
+
+   if (btype == 2)
+      btype = 0;
+   x = &xin->s;
+   x0 = &xprev->s;
+
+/*-- do long blocks (if any) --*/
+   n = (nlong + 17) / 18;	/* number of dct's to do */
+   for (i = 0; i < n; i++)
+   {
+      fix_input((SAMPLE *) x, 18);
+      i_imdct18(x);
+      for (j = 0; j < 9; j++)
+      {
+	 y[j][i] = x0[j] + L3MULT(x[9 + j], win[btype][j]);
+	 y[9 + j][i] = x0[9 + j] + L3MULT(x[17 - j], win[btype][9 + j]);
+      }
+    /* window x for next time x0 */
+      for (j = 0; j < 4; j++)
+      {
+	 xa = x[j];
+	 xb = x[8 - j];
+	 x[j] = L3MULT(xb, win[btype][18 + j]);
+	 x[8 - j] = L3MULT(xa, win[btype][(18 + 8) - j]);
+	 x[9 + j] = L3MULT(xa, win[btype][(18 + 9) + j]);
+	 x[17 - j] = L3MULT(xb, win[btype][(18 + 17) - j]);
+      }
+      xa = x[j];
+      x[j] = L3MULT(xa, win[btype][18 + j]);
+      x[9 + j] = L3MULT(xa, win[btype][(18 + 9) + j]);
+
+      x += 18;
+      x0 += 18;
+   }
+
+/*-- do short blocks (if any) --*/
+   n = (ntot + 17) / 18;	/* number of 6 pt dct's triples to do */
+   for (; i < n; i++)
+   {
+      fix_input((SAMPLE *) x, 18);
+      i_imdct6_3(x);
+      for (j = 0; j < 3; j++)
+      {
+	 y[j][i] = x0[j];
+	 y[3 + j][i] = x0[3 + j];
+
+	 y[6 + j][i] = x0[6 + j] + L3MULT(x[3 + j], win[2][j]);
+	 y[9 + j][i] = x0[9 + j] + L3MULT(x[5 - j], win[2][3 + j]);
+
+	 y[12 + j][i] = x0[12 + j] + L3MULT(x[2 - j], win[2][6 + j])
+	    + L3MULT(x[(6 + 3) + j], win[2][j]);
+	 y[15 + j][i] = x0[15 + j] + L3MULT(x[j], win[2][9 + j])
+	    + L3MULT(x[(6 + 5) - j], win[2][3 + j]);
+      }
+    /* window x for next time x0 */
+      for (j = 0; j < 3; j++)
+      {
+	 x[j] = L3MULT(x[(6 + 2) - j], win[2][6 + j])
+	    + L3MULT(x[(12 + 3) + j], win[2][j]);
+	 x[3 + j] = L3MULT(x[6 + j], win[2][9 + j])
+	    + L3MULT(x[(12 + 5) - j], win[2][3 + j]);
+      }
+      for (j = 0; j < 3; j++)
+      {
+	 x[6 + j] = L3MULT(x[(12 + 2) - j], win[2][6 + j]);
+	 x[9 + j] = L3MULT(x[12 + j], win[2][9 + j]);
+      }
+      for (j = 0; j < 3; j++)
+      {
+	 x[12 + j] = 0;
+	 x[15 + j] = 0;
+      }
+      x += 18;
+      x0 += 18;
+   }
+
+/*--- overlap prev if prev longer that current --*/
+/*--- what is left in x is next time overlap, as in hybrid() */
+   n = (nprev + 17) / 18;
+   for (; i < n; i++)
+   {
+      fix_input((SAMPLE *) x, 18);
+      for (j = 0; j < 18; j++)
+	 y[j][i] = x0[j];
+      x += 18;
+      x0 += 18;
+   }
+   nout = 18 * i;
+
+/*--- clear remaining only to band limit --*/
+   for (; i < m->cupl.band_limit_nsb; i++)
+   {
+      for (j = 0; j < 18; j++)
+	 y[j][i] = 0;
+   }
+
+   return nout;
+}
+/*--------------------------------------------------------------------*/
+void i_FreqInvert(L3INT y[18][32], int n)
+{
+   int i, j;
+
+   n = (n + 17) / 18;
+   for (j = 0; j < 18; j += 2)
+   {
+      for (i = 0; i < n; i += 2)
+      {
+	 y[1 + j][1 + i] = -y[1 + j][1 + i];
+      }
+   }
+}
+/*--------------------------------------------------------------------*/
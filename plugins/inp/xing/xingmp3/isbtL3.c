@@ -0,0 +1,254 @@
+/*____________________________________________________________________________
+
+	FreeAmp - The Free MP3 Player
+
+	This program is free software; you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation; either version 2 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program; if not, write to the Free Software
+	Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+
+	$Id$
+____________________________________________________________________________*/
+
+/****  isbtL3.c  ***************************************************
+
+Layer III
+
+fixed point dct and window, integer version of the full rate
+cdct.c cwin.c csbtL3.c (see itype.h for the number format)
+
+Unlike the Layer II integer window (iwinQ.c) all 16 taps are
+used, and the dct keeps L3FRAC bits below the pcm step, so the
+output stays within one pcm step of the float sbt.
+
+coefs are made from the float tables, call isbtL3_init after
+sbt_init.
+
+******************************************************************/
+
+#include <float.h>
+#include <math.h>
+#include "L3.h"
+#include "mhead.h"
+
+extern float wincoef[264];
+float *dct_coef_addr(MPEG *m);
+
+static L3COEF coef32[31];	/* 32 pt dct coefs */
+static L3COEF iwincoef[264];	/* window coefs */
+
+/*====================================================================*/
+static L3COEF fix_coef(float x)
+{
+   double t = x * (double) (1 << L3CBITS);
+
+   return (L3COEF) (t > 0.0 ? t + 0.5 : t - 0.5);
+}
+/*--------------------------------------------------------------------*/
+void isbtL3_init(MPEG *m)
+{
+   int i;
+   float *c = dct_coef_addr(m);
+
+   for (i = 0; i < 31; i++)
+      coef32[i] = fix_coef(c[i]);
+   for (i = 0; i < 264; i++)
+      iwincoef[i] = fix_coef(wincoef[i]);
+
+/* clear window m->il3.vbuf */
+   for (i = 0; i < 512; i++)
+   {
+      m->il3.vbuf[i] = 0;
+      m->il3.vbuf2[i] = 0;
+   }
+   m->il3.vb2_ptr = m->il3.vb_ptr = 0;
+}
+/*------------------------------------------------------------*/
+static void forward_bf(int m, int n, L3INT x[], L3INT f[], L3COEF coef[])
+{
+   int i, j, n2;
+   int p, q, p0, k;
+
+   p0 = 0;
+   n2 = n >> 1;
+   for (i = 0; i < m; i++, p0 += n)
+   {
+      k = 0;
+      p = p0;
+      q = p + n - 1;
+      for (j = 0; j < n2; j++, p++, q--, k++)
+      {
+	 f[p] = x[p] + x[q];
+	 f[n2 + p] = L3MULT(x[p] - x[q], coef[k]);
+      }
+   }
+}
+/*------------------------------------------------------------*/
+static void back_bf(int m, int n, L3INT x[], L3INT f[])
+{
+   int i, j, n2, n21;
+   int p, q, p0;
+
+   p0 = 0;
+   n2 = n >> 1;
+   n21 = n2 - 1;
+   for (i = 0; i < m; i++, p0 += n)
+   {
+      p = p0;
+      q = p0;
+      for (j = 0; j < n2; j++, p += 2, q++)
+	 f[p] = x[q];
+      p = p0 + 1;
+      for (j = 0; j < n21; j++, p += 2, q++)
+	 f[p] = x[q] + x[q + 1];
+      f[p] = x[q];
+   }
+}
+/*------------------------------------------------------------*/
+static void i_fdct32_L3(MPEG *m, L3INT x[], L3INT c[])
+{
+   L3INT a[32];			/* ping pong buffers */
+   L3INT b[32];
+   int p, q;
+
+   L3INT *src = x;
+
+   int i;
+   if (m->eq.enableEQ) {
+       for(i=0; i<32; i++)
+	   b[i] = L3MULT(x[i], fix_coef(m->eq.equalizer[i]));
+       src = b;
+   }
+
+/* special first stage */
+   for (p = 0, q = 31; p < 16; p++, q--)
+   {
+      a[p] = src[p] + src[q];
+      a[16 + p] = L3MULT(src[p] - src[q], coef32[p]);
+   }
+   forward_bf(2, 16, a, b, coef32 + 16);
+   forward_bf(4, 8, b, a, coef32 + 16 + 8);
+   forward_bf(8, 4, a, b, coef32 + 16 + 8 + 4);
+   forward_bf(16, 2, b, a, coef32 + 16 + 8 + 4 + 2);
+   back_bf(8, 4, a, b);
+   back_bf(4, 8, b, a);
+   back_bf(2, 16, a, b);
+   back_bf(1, 32, b, c);
+}
+/*------------------------------------------------------------*/
+/* L3INT sum to pcm, truncated toward zero as the float (long) cast */
+#define I_PCM(sum, tmp) \
+   tmp = (sum + ((sum >> 31) & ((1 << L3FRAC) - 1))) >> L3FRAC; \
+   if (tmp > 32767) \
+      tmp = 32767; \
+   else if (tmp < -32768) \
+      tmp = -32768
+
+/* step is 1 for mono, 2 for dual (interleaved output) */
+static void i_window_L3(L3INT * vbuf, int vb_ptr, short *pcm, int step)
+{
+   int i, j;
+   int si, bx;
+   L3COEF *coef;
+   L3INT sum;
+   L3INT tmp;
+
+   si = vb_ptr + 16;
+   bx = (si + 32) & 511;
+   coef = iwincoef;
+
+/*-- first 16 --*/
+   for (i = 0; i < 16; i++)
+   {
+      sum = 0;
+      for (j = 0; j < 8; j++)
+      {
+	 sum += L3MULT(vbuf[si], *coef++);
+	 si = (si + 64) & 511;
+	 sum -= L3MULT(vbuf[bx], *coef++);
+	 bx = (bx + 64) & 511;
+      }
+      si++;
+      bx--;
+      I_PCM(sum, tmp);
+      *pcm = tmp;
+      pcm += step;
+   }
+/*--  special case --*/
+   sum = 0;
+   for (j = 0; j < 8; j++)
+   {
+      sum += L3MULT(vbuf[bx], *coef++);
+      bx = (bx + 64) & 511;
+   }
+   I_PCM(sum, tmp);
+   *pcm = tmp;
+   pcm += step;
+/*-- last 15 --*/
+   coef = iwincoef + 255;	/* back pass through coefs */
+   for (i = 0; i < 15; i++)
+   {
+      si--;
+      bx++;
+      sum = 0;
+      for (j = 0; j < 8; j++)
+      {
+	 sum += L3MULT(vbuf[si], *coef--);
+	 si = (si + 64) & 511;
+	 sum += L3MULT(vbuf[bx], *coef--);
+	 bx = (bx + 64) & 511;
+      }
+      I_PCM(sum, tmp);
+      *pcm = tmp;
+      pcm += step;
+   }
+}
+/*============================================================*/
+void i_sbt_mono_L3(MPEG *m, L3INT *sample, short *pcm, int ch)
+{
+   int i;
+
+   ch = 0;
+   for (i = 0; i < 18; i++)
+   {
+      i_fdct32_L3(m, sample, m->il3.vbuf + m->il3.vb_ptr);
+      i_window_L3(m->il3.vbuf, m->il3.vb_ptr, pcm, 1);
+      sample += 32;
+      m->il3.vb_ptr = (m->il3.vb_ptr - 32) & 511;
+      pcm += 32;
+   }
+}
+/*------------------------------------------------------------*/
+void i_sbt_dual_L3(MPEG *m, L3INT *sample, short *pcm, int ch)
+{
+   int i;
+
+   if (ch == 0)
+      for (i = 0; i < 18; i++)
+      {
+	 i_fdct32_L3(m, sample, m->il3.vbuf + m->il3.vb_ptr);
+	 i_window_L3(m->il3.vbuf, m->il3.vb_ptr, pcm, 2);
+	 sample += 32;
+	 m->il3.vb_ptr = (m->il3.vb_ptr - 32) & 511;
+	 pcm += 64;
+      }
+   else
+      for (i = 0; i < 18; i++)
+      {
+	 i_fdct32_L3(m, sample, m->il3.vbuf2 + m->il3.vb2_ptr);
+	 i_window_L3(m->il3.vbuf2, m->il3.vb2_ptr, pcm + 1, 2);
+	 sample += 32;
+	 m->il3.vb2_ptr = (m->il3.vb2_ptr - 32) & 511;
+	 pcm += 64;
+      }
+}
+/*------------------------------------------------------------*/
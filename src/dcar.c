@@ -10,6 +10,9 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <kos/thread.h>
+#include <kos/sem.h>
+#include <arch/spinlock.h>
 
 #include "dcplaya/config.h"
 #include "sysdebug.h"
@@ -17,6 +20,7 @@
 #include "filetype.h"
 #include "file_utils.h"
 #include "zlib.h"
+#include "shell.h"
 
 const int dcar_align = 4;
 
@@ -184,7 +188,330 @@ static int make_dir_index(aentry_t * aentry, int base)
   return base;
 }
 
-static int r_gzwrite_aentries(gzFile zf, aentry_t * aentry)
+/*
+ * Parallel gzip writer.
+ *
+ * The archive stream is cut into chunks of DCAR_CHUNK bytes. Each chunk is
+ * deflated independently as raw deflate data ended by a sync flush (the
+ * last one by a finish), primed with the tail of the previous chunk as
+ * dictionary. Concatenated in order, the chunks make a single regular gzip
+ * member, so that dcar_extract() (and any gzip reader) is left unchanged.
+ * Chunks are compressed by a pool of worker threads and written in order
+ * by the caller thread, which also computes the CRC.
+ */
+
+#define DCAR_CHUNK     (64<<10) /* Uncompressed chunk size.          */
+#define DCAR_DICT      (32<<10) /* Dictionary size (deflate window). */
+#define DCAR_MAX_THD   8        /* Maximum number of worker threads. */
+
+typedef struct {
+  char * buf;            /* DCAR_DICT bytes of dictionary + chunk data.  */
+  int ilen;              /* Chunk uncompressed size.                     */
+  int dlen;              /* Dictionary size.                             */
+  int last;              /* Last chunk: finish the deflate stream.       */
+  char * out;            /* Compressed chunk.                            */
+  int omax;              /* Compressed buffer size.                      */
+  int ooff;              /* Offset of raw deflate data in out.           */
+  int olen;              /* Raw deflate data size (<0 on error).         */
+  semaphore_t * done;    /* Signaled when the chunk is compressed.       */
+} dcar_zjob_t;
+
+typedef struct dcar_zwriter_s {
+  int fd;                /* Output file.                                 */
+  int level;             /* Compression level.                           */
+  int nthd;              /* Number of worker threads (0: no thread).     */
+  int njob;              /* Number of jobs in the ring.                  */
+  dcar_zjob_t job[2*DCAR_MAX_THD+1];
+  unsigned int seq;      /* Sequence number of the chunk being filled.   */
+  unsigned int wseq;     /* Sequence number of the next chunk to write.  */
+  z_stream zs;           /* Deflate stream for the no thread mode.       */
+
+  /* Worker pool. */
+  semaphore_t * todo;    /* Count chunks waiting for a worker.           */
+  spinlock_t lock;       /* Protect next.                                */
+  unsigned int next;     /* Sequence number of next chunk to compress.   */
+  volatile int quit;     /* Ask workers to quit.                         */
+  volatile int alive;    /* Number of running workers.                   */
+
+  uLong crc;             /* CRC of uncompressed data.                    */
+  int ubytes;            /* Uncompressed bytes.                          */
+  int cbytes;            /* Compressed bytes (including gzip header).    */
+  const char * errstr;   /* Error string.                                */
+} dcar_zwriter_t;
+
+/* Deflate a chunk. zlib 1.1.4 does not allow a dictionary with raw
+ * deflate streams, so chunks are deflated as zlib streams and the zlib
+ * header (with dictionary id) and adler32 trailer are stripped.
+ */
+static int zjob_deflate(z_stream * zs, dcar_zjob_t * job)
+{
+  int err, len;
+
+  if (deflateReset(zs) != Z_OK) {
+    return -1;
+  }
+  if (job->dlen &&
+      deflateSetDictionary(zs, (Bytef *)job->buf + DCAR_DICT - job->dlen,
+			   job->dlen) != Z_OK) {
+    return -1;
+  }
+  zs->next_in   = (Bytef *)job->buf + DCAR_DICT;
+  zs->avail_in  = job->ilen;
+  zs->next_out  = (Bytef *)job->out;
+  zs->avail_out = job->omax;
+  err = deflate(zs, job->last ? Z_FINISH : Z_SYNC_FLUSH);
+  if (zs->avail_in || (job->last ? err != Z_STREAM_END : err != Z_OK)) {
+    return -1;
+  }
+  job->ooff = 2 + (job->dlen ? 4 : 0);
+  len = job->omax - zs->avail_out - job->ooff - (job->last ? 4 : 0);
+  return len < 0 ? -1 : len;
+}
+
+static int zstream_init(z_stream * zs, int level)
+{
+  memset(zs, 0, sizeof(*zs));
+  return deflateInit2(zs, level, Z_DEFLATED, MAX_WBITS, 8,
+		      Z_DEFAULT_STRATEGY) == Z_OK ? 0 : -1;
+}
+
+static void zworker_thread(void * cookie)
+{
+  dcar_zwriter_t * zw = (dcar_zwriter_t *)cookie;
+  z_stream zs;
+  int err = zstream_init(&zs, zw->level);
+
+  for (;;) {
+    dcar_zjob_t * job;
+
+    sem_wait(zw->todo);
+    if (zw->quit) {
+      break;
+    }
+    spinlock_lock(&zw->lock);
+    job = zw->job + (zw->next++ % zw->njob);
+    spinlock_unlock(&zw->lock);
+
+    job->olen = err ? -1 : zjob_deflate(&zs, job);
+    sem_signal(job->done);
+  }
+
+  if (!err) {
+    deflateEnd(&zs);
+  }
+  spinlock_lock(&zw->lock);
+  --zw->alive;
+  spinlock_unlock(&zw->lock);
+}
+
+static int zw_write(dcar_zwriter_t * zw, const void * buf, int n)
+{
+  if (fs_write(zw->fd, buf, n) != n) {
+    zw->errstr = "gzip write error";
+    return -1;
+  }
+  zw->cbytes += n;
+  return n;
+}
+
+static int zw_putlong(dcar_zwriter_t * zw, uLong x)
+{
+  unsigned char b[4];
+  int i;
+
+  for (i=0; i<4; ++i, x >>= 8) {
+    b[i] = x;
+  }
+  return zw_write(zw, b, 4);
+}
+
+/* Write chunk `seq' once it is compressed. */
+static int zw_flushjob(dcar_zwriter_t * zw)
+{
+  dcar_zjob_t * job = zw->job + (zw->wseq++ % zw->njob);
+
+  if (zw->nthd) {
+    sem_wait(job->done);
+  } else {
+    job->olen = zjob_deflate(&zw->zs, job);
+  }
+  if (job->olen < 0) {
+    zw->errstr = "gzip deflate error";
+    return -1;
+  }
+  zw->crc = crc32(zw->crc, (Bytef *)job->buf + DCAR_DICT, job->ilen);
+  return zw_write(zw, job->out + job->ooff, job->olen);
+}
+
+/* Submit the chunk being filled and prepare the next one. */
+static int zw_submit(dcar_zwriter_t * zw, int last)
+{
+  dcar_zjob_t * job = zw->job + (zw->seq % zw->njob), * nxt;
+
+  job->last = last;
+  ++zw->seq;
+  if (zw->nthd) {
+    sem_signal(zw->todo);
+  }
+  if (last) {
+    return 0;
+  }
+
+  /* Next chunk slot must have been written before it can be reused. */
+  nxt = zw->job + (zw->seq % zw->njob);
+  if (zw->seq - zw->wseq >= zw->njob && zw_flushjob(zw) < 0) {
+    return -1;
+  }
+  nxt->dlen = job->ilen < DCAR_DICT ? job->ilen : DCAR_DICT;
+  memcpy(nxt->buf + DCAR_DICT - nxt->dlen,
+	 job->buf + DCAR_DICT + job->ilen - nxt->dlen, nxt->dlen);
+  nxt->ilen = 0;
+  return 0;
+}
+
+static int zwrite(dcar_zwriter_t * zw, const void * buf, int n)
+{
+  const char * src = (const char *)buf;
+  int rem = n;
+
+  while (rem > 0) {
+    dcar_zjob_t * job = zw->job + (zw->seq % zw->njob);
+    int len = DCAR_CHUNK - job->ilen;
+
+    if (len > rem) {
+      len = rem;
+    }
+    memcpy(job->buf + DCAR_DICT + job->ilen, src, len);
+    job->ilen += len;
+    src += len;
+    rem -= len;
+    zw->ubytes += len;
+    if (job->ilen == DCAR_CHUNK && zw_submit(zw, 0) < 0) {
+      return -1;
+    }
+  }
+  return n;
+}
+
+static void zw_close(dcar_zwriter_t * zw)
+{
+  int i;
+
+  if (zw->todo) {
+    /* Wake up workers so that they see the quit flag. Pending jobs are
+     * dropped. */
+    zw->quit = 1;
+    for (i=0; i<zw->nthd; ++i) {
+      sem_signal(zw->todo);
+    }
+    while (zw->alive) {
+      thd_pass();
+    }
+    sem_destroy(zw->todo);
+    zw->todo = 0;
+  } else if (!zw->nthd) {
+    deflateEnd(&zw->zs);
+  }
+  for (i=0; i<zw->njob; ++i) {
+    if (zw->job[i].done) {
+      sem_destroy(zw->job[i].done);
+    }
+    free(zw->job[i].buf);
+  }
+}
+
+static int zw_open(dcar_zwriter_t * zw, int fd, int level, int nthd)
+{
+  /* gzip header as written by gzio. */
+  static const unsigned char gzhdr[10] = {
+    0x1f, 0x8b, Z_DEFLATED, 0, 0,0,0,0, 0, 0x03
+  };
+  int i;
+
+  memset(zw, 0, sizeof(*zw));
+  zw->fd    = fd;
+  zw->level = (level >= 0 && level <= 9) ? level : Z_DEFAULT_COMPRESSION;
+  zw->nthd  = nthd < 0 ? 0 : (nthd > DCAR_MAX_THD ? DCAR_MAX_THD : nthd);
+  zw->njob  = zw->nthd ? 2 * zw->nthd : 1;
+  zw->crc   = crc32(0L, Z_NULL, 0);
+  spinlock_init(&zw->lock);
+
+  for (i=0; i<zw->njob; ++i) {
+    dcar_zjob_t * job = zw->job + i;
+
+    /* Worst case of deflate is stored blocks : 5 bytes per 16K block,
+     * plus the sync flush marker and zlib header and trailer. */
+    job->omax = DCAR_CHUNK + (DCAR_CHUNK >> 8) + 64;
+    job->buf  = malloc(DCAR_DICT + DCAR_CHUNK + job->omax);
+    if (!job->buf) {
+      zw->errstr = "gzip buffer alloc error";
+      goto error;
+    }
+    job->out = job->buf + DCAR_DICT + DCAR_CHUNK;
+    if (zw->nthd && (job->done = sem_create(0), !job->done)) {
+      zw->errstr = "gzip semaphore error";
+      goto error;
+    }
+  }
+
+  if (!zw->nthd) {
+    if (zstream_init(&zw->zs, zw->level) < 0) {
+      zw->errstr = "gzip init error";
+      goto error;
+    }
+  } else {
+    zw->todo = sem_create(0);
+    if (!zw->todo) {
+      zw->errstr = "gzip semaphore error";
+      goto error;
+    }
+    for (i=0; i<zw->nthd; ++i) {
+      kthread_t * thd;
+
+      spinlock_lock(&zw->lock);
+      ++zw->alive;
+      spinlock_unlock(&zw->lock);
+      thd = thd_create(zworker_thread, zw);
+      if (!thd) {
+	spinlock_lock(&zw->lock);
+	--zw->alive;
+	spinlock_unlock(&zw->lock);
+	zw->nthd = i;
+	break;
+      }
+      thd_set_label(thd, "Dcar-thd");
+    }
+    if (!zw->nthd) {
+      zw->errstr = "gzip thread error";
+      goto error;
+    }
+  }
+
+  return zw_write(zw, gzhdr, sizeof(gzhdr)) < 0 ? -1 : 0;
+
+ error:
+  zw_close(zw);
+  return -1;
+}
+
+/* Submit last chunk, write all pending chunks and the gzip trailer. */
+static int zw_finish(dcar_zwriter_t * zw)
+{
+  if (zw_submit(zw, 1) < 0) {
+    return -1;
+  }
+  while (zw->wseq != zw->seq) {
+    if (zw_flushjob(zw) < 0) {
+      return -1;
+    }
+  }
+  if (zw_putlong(zw, zw->crc) < 0 || zw_putlong(zw, zw->ubytes) < 0) {
+    return -1;
+  }
+  return 0;
+}
+
+static int r_gzwrite_aentries(dcar_zwriter_t * zf, aentry_t * aentry)
 {
   aentry_t *e;
 
@@ -194,7 +521,7 @@ static int r_gzwrite_aentries(gzFile zf, aentry_t * aentry)
 
   /* 1st : This level */
   for (e=aentry; e; e=e->nxt) {
-    if (gzwrite(zf, &e->te, sizeof(e->te)) <= 0) {
+    if (zwrite(zf, &e->te, sizeof(e->te)) <= 0) {
       /*       SDERROR("Writing directory entry [%s]\n", e->te.name); */
       return -1;
     }
@@ -230,7 +557,7 @@ static int r_gzwrite_aentries(gzFile zf, aentry_t * aentry)
  * @retval -3     Write error
  * @retval other  Internal unexecpected errors
  */
-static int gzcopy(gzFile zf, dcar_option_t * opt)
+static int gzcopy(dcar_zwriter_t * zf, dcar_option_t * opt)
 {
   int fd, n, r, w, len, z;
 
@@ -255,7 +582,7 @@ static int gzcopy(gzFile zf, dcar_option_t * opt)
       goto error;
     } else if (n > 0) {
       r += n;
-      if (gzwrite(zf, opt->internal.tmp, n) != n) {
+      if (zwrite(zf, opt->internal.tmp, n) != n) {
 	opt->errstr = "gzip write error";
 	n = -3;
 	goto error;
@@ -263,6 +590,7 @@ static int gzcopy(gzFile zf, dcar_option_t * opt)
       w += n;
       opt->out.bytes += n;
     }
+    shell_yield();
   } while (n>0);
 
   /* Check ... */
@@ -285,7 +613,7 @@ static int gzcopy(gzFile zf, dcar_option_t * opt)
 
   if (z) {
     memset(opt->internal.tmp, 0, z);
-    if (gzwrite(zf, opt->internal.tmp, z) != z) {
+    if (zwrite(zf, opt->internal.tmp, z) != z) {
       opt->errstr = "gzip padding write error";
       n = -3;
       goto error;
@@ -301,7 +629,8 @@ static int gzcopy(gzFile zf, dcar_option_t * opt)
   return n;
 }
 
-static int r_gzwrite_data(gzFile zf, aentry_t * aentry, dcar_option_t * opt)
+static int r_gzwrite_data(dcar_zwriter_t * zf, aentry_t * aentry,
+			  dcar_option_t * opt)
 {
   aentry_t *e;
   char * pathend;
@@ -522,13 +851,12 @@ static dcar_option_t * setup_option(dcar_option_t *opt, dcar_option_t *opt2)
 int dcar_archive(const char *name, const char *path, dcar_option_t *opt)
 {
   aentry_t root;
-  char mode [8];
   char cpath[512];
   char tmp[512];
   int count;
   dcar_tree_t dt;
-  int fd = -1, fd2;
-  gzFile zf=0;
+  int fd = -1;
+  dcar_zwriter_t * zf = 0;
   dcar_option_t option;
   volatile int save_verbose;
 
@@ -543,15 +871,6 @@ int dcar_archive(const char *name, const char *path, dcar_option_t *opt)
     return -1;
   }
 
-  /* Make gzip open mode. */
-  count = 0;
-  mode [count++] = 'w';
-  mode [count++] = 'b';
-  if (opt->in.compress >= 0 && opt->in.compress <= 9) {
-    mode [count++] = '0' + opt->in.compress;
-  }
-  mode [count] = 0;
-
   /* Build tree */
   strncpy(cpath, path, sizeof(cpath)-1);
   cpath[sizeof(cpath)-1] = 0;
@@ -577,26 +896,31 @@ int dcar_archive(const char *name, const char *path, dcar_option_t *opt)
     opt->in.skip = fs_tell(fd);
     /* 	SDDEBUG("[%s] : skipping %d bytes\n",__FUNCTION__, opt->in.skip); */
   }
-  fd2 = fd;
   if (fd<0) {
     opt->errstr = "create error";
     count = -1;
     goto error;
   }
 
-  zf = gzdopen(fd, mode);
+  zf = (dcar_zwriter_t *)malloc(sizeof(*zf));
   if (!zf) {
-    opt->errstr = "gzip reopen error";
+    opt->errstr = "gzip writer alloc error";
+    count = -1;
+    goto error;
+  }
+  if (zw_open(zf, fd, opt->in.compress, opt->in.threads) < 0) {
+    opt->errstr = zf->errstr;
+    free(zf);
+    zf = 0;
     count = -1;
     goto error;
   }
-  fd = -1;
 
   memcpy(&dt.magic, "DCAR",4);
   dt.n = count;
 
   /* Write archive headers */
-  if (gzwrite(zf, &dt, 8) <= 0) {
+  if (zwrite(zf, &dt, 8) <= 0) {
     opt->errstr = "gzip write archive header error";
     count = -1;
     goto error;
@@ -611,20 +935,30 @@ int dcar_archive(const char *name, const char *path, dcar_option_t *opt)
 
   /* Write file data */
   if (r_gzwrite_data(zf, root.son, opt) < 0) {
+    if (!opt->errstr) {
+      opt->errstr = zf->errstr;
+    }
     count = -1;
     goto error;
   }
-  gzflush(zf, Z_SYNC_FLUSH);
-  opt->out.ubytes = gztell(zf);
-  /* add checksum + filesize - skip at start */
-  opt->out.cbytes = fs_tell(fd2) - opt->in.skip + 8;
+
+  /* Write pending chunks and gzip trailer. */
+  if (zw_finish(zf) < 0) {
+    opt->errstr = zf->errstr;
+    count = -1;
+    goto error;
+  }
+  opt->out.ubytes = zf->ubytes;
+  opt->out.cbytes = zf->cbytes;
 
  error:
   free_aentries(root.son);
+  if (zf) {
+    zw_close(zf);
+    free(zf);
+  }
   if (fd>=0) {
     fs_close(fd);
-  } else if (zf) {
-    gzclose(zf);
     if (count < 0) {
       fs_unlink(name);
     }
@@ -714,6 +1048,7 @@ static int gzextract(int fd, gzFile zf, dcar_option_t * opt, int len)
     //    crc = CRC(crc,  opt->internal.tmp, n);
 
     opt->out.bytes += n;
+    shell_yield();
   }
 
   if (rem != 0 || r != w || w != len) {
@@ -69,6 +69,7 @@
 //#include "viewport.h"
 
 #include "fs_ramdisk.h"
+#include "fs_cache.h"
 #include "screen_shot.h"
 
 #include "sysdebug.h"
@@ -1138,6 +1139,8 @@ int dreammp3_main(int argc, char **argv)
     fs_ramdisk_modified();
   }
 
+  /* read-ahead cache for slow media ("/cache/cd/...") */
+  dcpfs_cache_init(0);
 
   /* Initialize the vmu file module as soon as possible... */
 
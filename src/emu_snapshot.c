@@ -0,0 +1,158 @@
+/**
+ * @file    emu_snapshot.c
+ * @brief   Emulator state snapshots for seeking.
+ *
+ * $Id$
+ */
+
+#include <malloc.h>
+#include <string.h>
+
+#include "dcplaya/config.h"
+#include "sysdebug.h"
+#include "emu_snapshot.h"
+
+typedef struct {
+  unsigned int time;  /**< Snapshot time.    */
+  int size;           /**< State size.       */
+  void * data;        /**< Saved state.      */
+} snapshot_t;
+
+struct emu_snapshot_s {
+  unsigned int period0;  /**< Initial period.      */
+  unsigned int period;   /**< Current period.      */
+  int max_bytes;         /**< Memory budget.       */
+  int bytes;             /**< Memory used.         */
+  int count;             /**< Number of snapshots. */
+  int max;               /**< Allocated entries.   */
+  snapshot_t * snap;     /**< Snapshots by time.   */
+};
+
+emu_snapshot_t * emu_snapshot_create(unsigned int period, int max_bytes)
+{
+  emu_snapshot_t * s;
+
+  s = calloc(1, sizeof(*s));
+  if (!s) {
+    SDERROR("[emu_snapshot] : no memory\n");
+    return 0;
+  }
+  s->period0 = s->period = period ? period : 1;
+  s->max_bytes = max_bytes;
+  return s;
+}
+
+void emu_snapshot_clear(emu_snapshot_t * s)
+{
+  int i;
+
+  for (i=0; i<s->count; ++i) {
+    free(s->snap[i].data);
+  }
+  s->count = s->bytes = 0;
+  s->period = s->period0;
+}
+
+void emu_snapshot_destroy(emu_snapshot_t * s)
+{
+  if (s) {
+    emu_snapshot_clear(s);
+    free(s->snap);
+    free(s);
+  }
+}
+
+unsigned int emu_snapshot_next(const emu_snapshot_t * s)
+{
+  return (s->count ? s->snap[s->count-1].time : 0) + s->period;
+}
+
+/* Free one snapshot out of two (the first one is kept). */
+static void thin(emu_snapshot_t * s)
+{
+  int i, n;
+
+  for (i=n=0; i<s->count; ++i) {
+    if (i & 1) {
+      s->bytes -= s->snap[i].size;
+      free(s->snap[i].data);
+    } else {
+      s->snap[n++] = s->snap[i];
+    }
+  }
+  s->count = n;
+  s->period <<= 1;
+}
+
+void * emu_snapshot_add(emu_snapshot_t * s, unsigned int time, int size)
+{
+  snapshot_t * e;
+
+  if (s->count && time <= s->snap[s->count-1].time) {
+    return 0;
+  }
+  while (s->count > 1 && s->bytes + size > s->max_bytes) {
+    thin(s);
+  }
+  if (s->bytes + size > s->max_bytes) {
+    return 0;
+  }
+  if (s->count == s->max) {
+    int max = s->max ? s->max * 2 : 16;
+    snapshot_t * snap = realloc(s->snap, max * sizeof(*snap));
+    if (!snap) {
+      return 0;
+    }
+    s->snap = snap;
+    s->max = max;
+  }
+  e = s->snap + s->count;
+  e->data = malloc(size);
+  if (!e->data) {
+    SDERROR("[emu_snapshot] : no memory for %d bytes\n", size);
+    return 0;
+  }
+  e->time = time;
+  e->size = size;
+  s->bytes += size;
+  ++s->count;
+  return e->data;
+}
+
+void emu_snapshot_cancel(emu_snapshot_t * s)
+{
+  if (s->count) {
+    snapshot_t * e = s->snap + --s->count;
+    s->bytes -= e->size;
+    free(e->data);
+  }
+}
+
+const void * emu_snapshot_find(const emu_snapshot_t * s,
+			       unsigned int time, unsigned int * at)
+{
+  int lo = 0, hi = s->count;
+
+  /* First snapshot after time. */
+  while (lo < hi) {
+    int mid = (lo + hi) >> 1;
+    if (s->snap[mid].time <= time) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+  if (!lo) {
+    return 0;
+  }
+  *at = s->snap[lo-1].time;
+  return s->snap[lo-1].data;
+}
+
+void emu_snapshot_stats(const emu_snapshot_t * s, emu_snapshot_stats_t * st)
+{
+  st->count = s->count;
+  st->bytes = s->bytes;
+  st->period = s->period;
+  st->last = s->count ? s->snap[s->count-1].time : 0;
+}
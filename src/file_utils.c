@@ -13,6 +13,8 @@
 */
 
 #include "file_utils.h"
+#include "fs_ramdisk.h"
+#include "shell.h"
 #include <kos/fs.h>
 #include <string.h>
 #include <stdlib.h>
@@ -123,6 +125,12 @@ static int filecopy(const char * dstname, const char * srcname,
     }
   }
 
+  /* Ramdisk to ramdisk copy shares data. */
+  if (cnt = fs_ramdisk_copy(dstname, srcname), cnt >= 0) {
+    goto error;
+  }
+  cnt = 0;
+
   /* Open source. */
   fds = fs_open(srcname, O_RDONLY);
   if (fds<0) {
@@ -148,6 +156,7 @@ static int filecopy(const char * dstname, const char * srcname,
       }
       cnt += n;
     }
+    shell_yield();
   } while (n > 0);
 
  error:
@@ -0,0 +1,693 @@
+/**
+ * @file    fs_cache.c
+ * @brief   Read-ahead block cache for KOS file system
+ *
+ * $Id$
+ */
+
+#include <arch/types.h>
+#include <arch/timer.h>
+#include <kos/thread.h>
+#include <kos/sem.h>
+#include <arch/spinlock.h>
+#include <malloc.h>
+#include <string.h>
+#include <stdio.h>
+
+#include "dcplaya/config.h"
+#include "sysdebug.h"
+#include "fs_cache.h"
+
+/* Default parameters. */
+#define DEFAULT_BLOCK_SIZE  (32<<10)
+#define DEFAULT_MAX_BYTES   (512<<10)
+#define DEFAULT_READAHEAD   4
+
+#define MAX_CACHE_FILES     8
+#define MAX_CACHE_BLOCKS    256
+#define INVALID_FH          MAX_CACHE_FILES
+
+/* Cache mount point. */
+#define CACHE_PREFIX        "/cache"
+
+/** Block state. */
+typedef enum {
+  BLOCK_FREE = 0,     /**< Not used.                   */
+  BLOCK_LOADING,      /**< Being read from media.      */
+  BLOCK_READY         /**< Data valid.                 */
+} block_state_e;
+
+/** Cache block. */
+typedef struct _block_s {
+  struct _block_s  * prev;       /**< LRU list, previous (more recent). */
+  struct _block_s  * next;       /**< LRU list, next (less recent).     */
+  int                file;       /**< Owner file handle.                */
+  int                index;      /**< Block index in file.              */
+  int                size;       /**< Valid bytes (<0 : read error).    */
+  int                pin;        /**< Number of readers copying data.   */
+  int                ahead;      /**< Read ahead and not used yet.      */
+  volatile int       state;      /**< Block state (block_state_e).      */
+  uint8            * data;       /**< Block data.                       */
+} block_t;
+
+/** Cached open file. */
+typedef struct {
+  file_t             fd;         /**< Underlying file (0:free handle).  */
+  int                dir;        /**< Directory handle (not cached).    */
+  int                pos;        /**< Current position.                 */
+  int                total;      /**< File size.                        */
+  int                last;       /**< Last block read.                  */
+  int                seq;        /**< Sequential reads count.           */
+  semaphore_t      * io;         /**< Underlying seek/read lock.        */
+} cfile_t;
+
+static int block_size;
+static int block_shift;
+static int readahead;
+static int n_blocks;
+static uint8 * block_data;
+static block_t blocks[MAX_CACHE_BLOCKS];
+static block_t * lru_head, * lru_tail;
+
+static cfile_t files[MAX_CACHE_FILES];
+
+static fs_cache_stats_t stats;
+
+/* Protect blocks, LRU list, file handles and stats. */
+static spinlock_t cache_mutex;
+
+/* Read ahead thread. */
+static semaphore_t * ra_sem;
+static kthread_t * ra_thd;
+static volatile int ra_quit;
+static volatile int ra_alive;
+
+static int initialized;
+
+/* Media routed through the cache by fs_cache_path(). */
+static int cache_media = 1;
+static const char * const media_prefix[] = { "/cd/", "/pc/", 0 };
+
+static struct vfs_handler vh;
+
+static int valid_fh(uint32 fd)
+{
+  if (--fd >= MAX_CACHE_FILES || !files[fd].fd) {
+    SDERROR("[cache] : [%d] invalid file handle.\n", fd+1);
+    return INVALID_FH;
+  }
+  return fd;
+}
+
+static void lru_remove(block_t * b)
+{
+  if (b->prev) {
+    b->prev->next = b->next;
+  } else {
+    lru_head = b->next;
+  }
+  if (b->next) {
+    b->next->prev = b->prev;
+  } else {
+    lru_tail = b->prev;
+  }
+  b->prev = b->next = 0;
+}
+
+/* Move block at the head of the LRU list (most recently used). */
+static void lru_touch(block_t * b)
+{
+  if (b == lru_head) {
+    return;
+  }
+  lru_remove(b);
+  b->next = lru_head;
+  if (lru_head) {
+    lru_head->prev = b;
+  } else {
+    lru_tail = b;
+  }
+  lru_head = b;
+}
+
+static block_t * find_block(int file, int index)
+{
+  block_t * b;
+
+  for (b = lru_head; b; b = b->next) {
+    if (b->state != BLOCK_FREE && b->file == file && b->index == index) {
+      return b;
+    }
+  }
+  return 0;
+}
+
+/* Get the least recently used block that could be recycled. Must be
+ * called with cache_mutex locked. */
+static block_t * alloc_block(int file, int index)
+{
+  block_t * b;
+
+  for (b = lru_tail; b; b = b->prev) {
+    if (b->state != BLOCK_LOADING && !b->pin) {
+      break;
+    }
+  }
+  if (b) {
+    if (b->state == BLOCK_READY && b->ahead) {
+      ++stats.unused;
+    }
+    b->state = BLOCK_LOADING;
+    b->file  = file;
+    b->index = index;
+    b->size  = 0;
+    b->ahead = 0;
+    b->pin   = 1;
+    lru_touch(b);
+  }
+  return b;
+}
+
+/* Read a block from the underlying file. Block must be LOADING. */
+static void load_block(cfile_t * f, block_t * b)
+{
+  int n;
+
+  sem_wait(f->io);
+  n = fs_seek(f->fd, b->index << block_shift, SEEK_SET);
+  if (n == (b->index << block_shift)) {
+    n = fs_read(f->fd, b->data, block_size);
+  } else {
+    n = -1;
+  }
+  sem_signal(f->io);
+  b->size = n;
+}
+
+static void readahead_thread(void * cookie)
+{
+  while (!ra_quit) {
+    int i, j;
+
+    sem_wait(ra_sem);
+
+    for (i = 0; i < MAX_CACHE_FILES && !ra_quit; ++i) {
+      cfile_t * f = files + i;
+
+      for (j = 1; j <= readahead && !ra_quit; ++j) {
+	block_t * b;
+	int index;
+
+	spinlock_lock(&cache_mutex);
+	index = f->last + j;
+	if (!f->fd || f->dir || f->seq < 1 ||
+	    (index << block_shift) >= f->total ||
+	    find_block(i, index) || !(b = alloc_block(i, index))) {
+	  spinlock_unlock(&cache_mutex);
+	  continue;
+	}
+	spinlock_unlock(&cache_mutex);
+
+	load_block(f, b);
+
+	spinlock_lock(&cache_mutex);
+	b->state = b->size < 0 ? BLOCK_FREE : BLOCK_READY;
+	b->ahead = b->size >= 0;
+	--b->pin;
+	++stats.readahead;
+	spinlock_unlock(&cache_mutex);
+      }
+    }
+  }
+
+  spinlock_lock(&cache_mutex);
+  --ra_alive;
+  spinlock_unlock(&cache_mutex);
+}
+
+/* Open a file. fn is the underlying filesystem path. */
+static file_t open(vfs_handler_t * vfs, const char *fn, int mode)
+{
+  file_t ufd;
+  semaphore_t * io;
+  int fd, total, dir = !!(mode & O_DIR);
+
+  if (!fn || !fn[0] || !strncmp(fn, CACHE_PREFIX, sizeof(CACHE_PREFIX)-1)) {
+    SDERROR("[cache] : [%s] invalid path.\n", fn ? fn : "<null>");
+    return 0;
+  }
+  if ((mode & O_MODE_MASK) != O_RDONLY) {
+    SDERROR("[cache] : [%s] read only filesystem.\n", fn);
+    return 0;
+  }
+
+  ufd = fs_open(fn, mode);
+  if (ufd < 0) {
+    return 0;
+  }
+  /* Media calls may block : not under cache_mutex. */
+  total = dir ? -1 : fs_total(ufd);
+  io = sem_create(1);
+  if (!io) {
+    SDERROR("[cache] : [%s] semaphore creation failed.\n", fn);
+    fs_close(ufd);
+    return 0;
+  }
+
+  spinlock_lock(&cache_mutex);
+  for (fd = 0; fd < MAX_CACHE_FILES && files[fd].fd; ++fd)
+    ;
+  if (fd == MAX_CACHE_FILES) {
+    spinlock_unlock(&cache_mutex);
+    SDERROR("[cache] : no free file handle.\n");
+    sem_destroy(io);
+    fs_close(ufd);
+    return 0;
+  }
+  memset(files + fd, 0, sizeof(files[fd]));
+  files[fd].io    = io;
+  files[fd].dir   = dir;
+  files[fd].total = total;
+  files[fd].last  = -2;
+  files[fd].fd    = ufd;
+  spinlock_unlock(&cache_mutex);
+
+  return fd + 1;
+}
+
+static void close(uint32 fd)
+{
+  cfile_t * f;
+  file_t ufd;
+  semaphore_t * io;
+  int i, loading;
+
+  if (fd = valid_fh(fd), fd == INVALID_FH) {
+    return;
+  }
+  f = files + fd;
+
+  /* Wait for blocks being read, then release all file blocks. */
+  do {
+    spinlock_lock(&cache_mutex);
+    f->seq = 0;
+    for (i = loading = 0; i < n_blocks; ++i) {
+      block_t * b = blocks + i;
+      if (b->state != BLOCK_FREE && b->file == fd) {
+	if (b->state == BLOCK_LOADING || b->pin) {
+	  loading = 1;
+	} else {
+	  if (b->ahead) {
+	    ++stats.unused;
+	  }
+	  b->state = BLOCK_FREE;
+	}
+      }
+    }
+    if (!loading) {
+      ufd = f->fd;
+      io = f->io;
+      f->fd = 0;
+    }
+    spinlock_unlock(&cache_mutex);
+    if (loading) {
+      thd_pass();
+    }
+  } while (loading);
+
+  fs_close(ufd);
+  sem_destroy(io);
+}
+
+static ssize_t read(file_t fd, void * buffer, size_t size)
+{
+  uint8 * d = buffer;
+  cfile_t * f;
+  int n = 0, sequential = 0, moved = 0;
+
+  if (fd = valid_fh(fd), fd == INVALID_FH || files[fd].dir) {
+    return -1;
+  }
+  f = files + fd;
+
+  while (size > 0 && f->pos < f->total) {
+    block_t * b;
+    int index = f->pos >> block_shift;
+    int off = f->pos & (block_size - 1);
+    int len;
+
+    spinlock_lock(&cache_mutex);
+    b = find_block(fd, index);
+    if (b) {
+      ++b->pin;
+      lru_touch(b);
+      if (b->ahead) {
+	b->ahead = 0;
+      }
+      if (b->state == BLOCK_LOADING) {
+	/* Being read ahead : wait for it. */
+	uint64 start = timer_ms_gettime64();
+
+	++stats.waits;
+	while (b->state == BLOCK_LOADING) {
+	  spinlock_unlock(&cache_mutex);
+	  while (b->state == BLOCK_LOADING) {
+	    thd_pass();
+	  }
+	  spinlock_lock(&cache_mutex);
+	  if (b->state == BLOCK_FREE) {
+	    /* Read ahead failed : the block is still pinned by us, read it
+	     * again now instead of failing this read. */
+	    ++stats.misses;
+	    b->state = BLOCK_LOADING;
+	    spinlock_unlock(&cache_mutex);
+	    load_block(f, b);
+	    spinlock_lock(&cache_mutex);
+	    b->state = b->size < 0 ? BLOCK_FREE : BLOCK_READY;
+	    break;
+	  }
+	}
+	stats.stall_ms += (int)(timer_ms_gettime64() - start);
+      } else {
+	++stats.hits;
+      }
+    } else if (b = alloc_block(fd, index), b) {
+      /* Miss : read it now. */
+      uint64 start = timer_ms_gettime64();
+
+      ++stats.misses;
+      spinlock_unlock(&cache_mutex);
+      load_block(f, b);
+      spinlock_lock(&cache_mutex);
+      b->state = b->size < 0 ? BLOCK_FREE : BLOCK_READY;
+      stats.stall_ms += (int)(timer_ms_gettime64() - start);
+    }
+    spinlock_unlock(&cache_mutex);
+
+    if (!b) {
+      /* No block available (all pinned) : read directly. */
+      sem_wait(f->io);
+      len = fs_seek(f->fd, f->pos, SEEK_SET) == f->pos
+	? fs_read(f->fd, d, size) : -1;
+      sem_signal(f->io);
+    } else {
+      len = b->size - off;
+      if (len > (int)size) {
+	len = size;
+      }
+      if (len > 0) {
+	memcpy(d, b->data + off, len);
+      }
+      spinlock_lock(&cache_mutex);
+      --b->pin;
+      spinlock_unlock(&cache_mutex);
+    }
+
+    if (len <= 0) {
+      if (!n && len < 0) {
+	n = -1;
+      }
+      break;
+    }
+
+    /* Sequential access detection. */
+    sequential = (index == f->last || index == f->last + 1);
+    f->seq = sequential ? f->seq + (index != f->last) : 0;
+    moved |= index != f->last;
+    f->last = index;
+
+    d += len;
+    f->pos += len;
+    size -= len;
+    n += len;
+  }
+
+  if (n > 0) {
+    spinlock_lock(&cache_mutex);
+    stats.bytes += n;
+    spinlock_unlock(&cache_mutex);
+  }
+  /* Wake the read ahead thread only when reading a new block : small reads
+   * within a block have nothing new to read ahead. */
+  if (moved && f->seq > 0 && readahead > 0 && ra_sem) {
+    sem_signal(ra_sem);
+  }
+
+  return n;
+}
+
+static ssize_t write(file_t fd, const void * buffer, size_t size)
+{
+  SDERROR("[cache] : read only filesystem.\n");
+  return -1;
+}
+
+static off_t seek(uint32 fd, off_t offset, int whence)
+{
+  cfile_t * f;
+
+  if (fd = valid_fh(fd), fd == INVALID_FH || files[fd].dir) {
+    return -1;
+  }
+  f = files + fd;
+
+  switch (whence) {
+  case SEEK_SET:
+    f->pos = offset;
+    break;
+  case SEEK_CUR:
+    f->pos += offset;
+    break;
+  case SEEK_END:
+    f->pos = f->total + offset;
+    break;
+  default:
+    return -1;
+  }
+  if (f->pos < 0) {
+    f->pos = 0;
+  }
+  return f->pos;
+}
+
+static off_t tell(uint32 fd)
+{
+  if (fd = valid_fh(fd), fd == INVALID_FH || files[fd].dir) {
+    return -1;
+  }
+  return files[fd].pos;
+}
+
+static size_t total(uint32 fd)
+{
+  if (fd = valid_fh(fd), fd == INVALID_FH) {
+    return -1;
+  }
+  return files[fd].total;
+}
+
+static dirent_t * readdir(file_t fd)
+{
+  if (fd = valid_fh(fd), fd == INVALID_FH || !files[fd].dir) {
+    return 0;
+  }
+  return fs_readdir(files[fd].fd);
+}
+
+/* Put everything together */
+static struct vfs_handler vh = {
+  {
+    { CACHE_PREFIX },      /* name */
+    0,
+    0x00010000,		/* Version 1.0 */
+    0,			/* flags */
+    NMMGR_TYPE_VFS,	/* VFS handler */
+    NMMGR_LIST_INIT	/* list */
+  },
+  0, NULL,		/* In-kernel, no cacheing, next */
+  open,
+  close,
+  read,
+  write,
+  seek,
+  tell,
+  total,
+  readdir,
+  NULL,                 /* ioctl */
+  NULL,                 /* rename */
+  NULL,                 /* unlink */
+  NULL                  /* mmap */
+};
+
+int dcpfs_cache_init(const fs_cache_param_t * param)
+{
+  fs_cache_param_t p;
+  int i;
+
+  if (initialized) {
+    SDERROR("[%s] : already initialized.\n", __FUNCTION__);
+    return -1;
+  }
+
+  memset(&p, 0, sizeof(p));
+  if (param) {
+    p = *param;
+  }
+  if (p.block_size <= 0) {
+    p.block_size = DEFAULT_BLOCK_SIZE;
+  }
+  if (p.max_bytes <= 0) {
+    p.max_bytes = DEFAULT_MAX_BYTES;
+  }
+  if (!p.readahead) {
+    p.readahead = DEFAULT_READAHEAD;
+  }
+
+  /* Round block size to a power of 2 (at least 512). */
+  for (block_shift = 9; (1 << block_shift) < p.block_size; ++block_shift)
+    ;
+  block_size = 1 << block_shift;
+  n_blocks = p.max_bytes >> block_shift;
+  if (n_blocks > MAX_CACHE_BLOCKS) {
+    n_blocks = MAX_CACHE_BLOCKS;
+  }
+  /* Readers need a block each, plus read ahead ones. */
+  readahead = p.readahead < 0 ? 0 : p.readahead;
+  if (n_blocks < 2) {
+    n_blocks = 2;
+  }
+  if (readahead >= n_blocks) {
+    readahead = n_blocks - 1;
+  }
+
+  block_data = (uint8 *)malloc(n_blocks << block_shift);
+  if (!block_data) {
+    SDERROR("[%s] : block allocation failure (%d bytes).\n", __FUNCTION__,
+	    n_blocks << block_shift);
+    return -1;
+  }
+
+  memset(blocks, 0, sizeof(blocks));
+  memset(files, 0, sizeof(files));
+  memset(&stats, 0, sizeof(stats));
+  for (i = 0; i < n_blocks; ++i) {
+    blocks[i].data = block_data + (i << block_shift);
+    blocks[i].prev = i ? blocks + i - 1 : 0;
+    blocks[i].next = i < n_blocks - 1 ? blocks + i + 1 : 0;
+  }
+  lru_head = blocks;
+  lru_tail = blocks + n_blocks - 1;
+  spinlock_init(&cache_mutex);
+
+  ra_quit = 0;
+  ra_alive = 0;
+  ra_sem = 0;
+  ra_thd = 0;
+  if (readahead) {
+    ra_sem = sem_create(0);
+    if (ra_sem) {
+      ra_alive = 1;
+      ra_thd = thd_create(readahead_thread, 0);
+      if (!ra_thd) {
+	ra_alive = 0;
+	sem_destroy(ra_sem);
+	ra_sem = 0;
+      } else {
+	thd_set_label(ra_thd, "Cache-thd");
+      }
+    }
+    if (!ra_thd) {
+      SDWARNING("[%s] : no read ahead thread.\n", __FUNCTION__);
+    }
+  }
+
+  if (nmmgr_handler_add(&vh)) {
+    SDERROR("[%s] : fs_handler_add failed\n", __FUNCTION__);
+    dcpfs_cache_shutdown();
+    return -1;
+  }
+  initialized = 1;
+
+  SDDEBUG("[%s] : %d blocks of %d bytes, read ahead %d\n", __FUNCTION__,
+	  n_blocks, block_size, readahead);
+  return 0;
+}
+
+int dcpfs_cache_shutdown(void)
+{
+  int i, err = 0;
+
+  if (initialized) {
+    err = nmmgr_handler_remove(&vh);
+    initialized = 0;
+  }
+  if (ra_thd) {
+    ra_quit = 1;
+    sem_signal(ra_sem);
+    while (ra_alive) {
+      thd_pass();
+    }
+    ra_thd = 0;
+  }
+  if (ra_sem) {
+    sem_destroy(ra_sem);
+    ra_sem = 0;
+  }
+  for (i = 0; i < MAX_CACHE_FILES; ++i) {
+    if (files[i].fd) {
+      close(i + 1);
+    }
+  }
+  if (block_data) {
+    free(block_data);
+    block_data = 0;
+  }
+  n_blocks = 0;
+  lru_head = lru_tail = 0;
+
+  return err;
+}
+
+int fs_cache_stats(fs_cache_stats_t * s, int reset)
+{
+  if (!initialized) {
+    return -1;
+  }
+  spinlock_lock(&cache_mutex);
+  if (s) {
+    *s = stats;
+  }
+  if (reset) {
+    memset(&stats, 0, sizeof(stats));
+  }
+  spinlock_unlock(&cache_mutex);
+  return 0;
+}
+
+int fs_cache_media(int enable)
+{
+  int old = cache_media;
+  if (enable >= 0) {
+    cache_media = !!enable;
+  }
+  return old;
+}
+
+const char * fs_cache_path(char * tmp, int max, const char * fn)
+{
+  int i;
+
+  if (!initialized || !cache_media || !fn) {
+    return fn;
+  }
+  for (i = 0; media_prefix[i]; ++i) {
+    if (!strncmp(fn, media_prefix[i], strlen(media_prefix[i]))) {
+      break;
+    }
+  }
+  if (!media_prefix[i] ||
+      snprintf(tmp, max, CACHE_PREFIX "%s", fn) >= max) {
+    return fn;
+  }
+  return tmp;
+}
@@ -9,6 +9,19 @@
 /** @TODO add lock to file-handle. It is not thread-safe right now !!! */
 /** I'll try to use the node-mutex as a fix. It should be ok. */
 
+/* Locking :
+ *  - node_mutex (LOCK_NODE) protects the tree structure, open counts,
+ *    node flags, directory hash tables and the path cache.
+ *  - Each node has a reader/writer lock protecting its data (extents
+ *    and size). read() takes it shared, write() exclusive. They do not
+ *    take node_mutex, so reading a file does not wait for a write to
+ *    another file.
+ *  - ext_mutex protects extent reference counts and memory accounting,
+ *    which are shared between nodes.
+ *  When both are needed node_mutex is taken first. Nodes data locks are
+ *  taken by increasing address.
+ */
+
 #ifdef VPSPECIAL
 /* VP : added this to remove debug messages and test :) */
 # undef DEBUG
@@ -26,11 +39,19 @@
 #include "sysdebug.h"
 #include "fs_ramdisk.h"
 
-/* #define RAMDISK_TEST */
-
 /* Allocation block size */
 #define ALLOC_BLOCK_SIZE 1024
 
+/* Maximum size of a single extent allocated for file growth. */
+#define MAX_EXTENT_SIZE  (256<<10)
+
+/* Directory hash table initial size (power of 2). */
+#define DIR_HASH_SIZE    8
+
+/* Path to node cache size (power of 2) and maximum cached path length. */
+#define PATH_CACHE_SIZE  32
+#define PATH_CACHE_MAX   128
+
 /* Opening mode bit. */
 #define READ_MODE       1
 #define WRITE_MODE 	2
@@ -39,16 +60,45 @@
 #define MAX_RD_FILES 	32            /**< Must not excess 32 */
 #define INVALID_FH  	MAX_RD_FILES
 
+/** RAM disk data extent.
+ *
+ *    File data is stored in a list of extents. Extents are reference
+ *    counted so that copies of a file share them until one of the copies
+ *    writes to it (copy on write).
+ */
+typedef struct {
+  int                refcount;       /**< Number of nodes using it.  */
+  int                size;           /**< Extent data size.          */
+  uint8              data[1];        /**< Extent data.               */
+} extent_t;
+
+/** Node data reader/writer lock. */
+typedef struct {
+  spinlock_t         lock;           /**< Protects counters.         */
+  volatile int       readers;        /**< Number of readers.         */
+  volatile int       writer;         /**< Write locked.              */
+  volatile int       wwait;          /**< Number of waiting writers. */
+} node_lock_t;
+
 /** RAM disk i-node */
 typedef struct _node_s {
   struct _node_s   * big_bros;       /**< Previous node same level   */
   struct _node_s   * little_bros;    /**< Next node same level       */
   struct _node_s   * father;         /**< Previous level node        */
   struct _node_s   * son;            /**< Next level node (dir only) */
+  struct _node_s   * last_son;       /**< Youngest son (dir only)    */
+  struct _node_s   * hash_nxt;       /**< Next node in father htab   */
+  struct _node_s  ** htab;           /**< Sons hash table (dir only) */
+  unsigned int       hash;           /**< Name hash value.           */
+  int                hsize;          /**< Size of htab.              */
+  int                hcount;         /**< Number of nodes in htab.   */
 
   dirent_t           entry;          /**< Kos directory entry.       */
+  node_lock_t        rw;             /**< Data lock.                 */
   int                max;            /**< Data allocated size.       */
-  uint8            * data;           /**< File data                  */
+  int                n_ext;          /**< Number of extents.         */
+  int                max_ext;        /**< Size of extent table.      */
+  extent_t        ** ext;            /**< Extent table.              */
   struct {
     unsigned int open:29;            /**< Open count                 */
     unsigned int unlinked:1;         /**< Node requested for unlink  */
@@ -82,6 +132,21 @@ static struct vfs_handler vh;
 /* Set when ramdisk is modified a notification not read. */
 static int modify; 
 
+/* Memory budget (0:unlimited) and usage. */
+static int max_bytes;
+static int used_bytes;
+static int ext_bytes;
+static int ext_count;
+
+/* Path to node cache. Only successful lookups are cached. It is flushed
+ * each time a node is removed from the tree or scheduled for unlink.
+ */
+static struct {
+  node_t * node;
+  unsigned int hash;
+  char path[PATH_CACHE_MAX];
+} path_cache[PATH_CACHE_SIZE];
+
 /* File data alignment */
 const int align = 16;
 
@@ -91,6 +156,9 @@ static spinlock_t fh_mutex;
 /* Mutex for node modification (modify notify) */
 static spinlock_t node_mutex;
 
+/* Mutex for extent reference count and memory accounting. */
+static spinlock_t ext_mutex;
+
 #ifdef DEBUG
 #define LOCK_NODE() \
 if (node_mutex) {\
@@ -113,12 +181,177 @@ if (!node_mutex) {\
 
 static void dump_node(node_t * node, const char * label);
 
+static void rw_init(node_lock_t * rw)
+{
+  spinlock_init(&rw->lock);
+  rw->readers = rw->writer = rw->wwait = 0;
+}
+
+/* Shared lock. Readers give way to waiting writers. */
+static void rw_rdlock(node_lock_t * rw)
+{
+  for (;;) {
+    spinlock_lock(&rw->lock);
+    if (!rw->writer && !rw->wwait) {
+      ++rw->readers;
+      spinlock_unlock(&rw->lock);
+      return;
+    }
+    spinlock_unlock(&rw->lock);
+    thd_pass();
+  }
+}
+
+static void rw_rdunlock(node_lock_t * rw)
+{
+  spinlock_lock(&rw->lock);
+  --rw->readers;
+  spinlock_unlock(&rw->lock);
+}
+
+/* Exclusive lock. */
+static void rw_wrlock(node_lock_t * rw)
+{
+  int waiting = 0;
+
+  for (;;) {
+    spinlock_lock(&rw->lock);
+    if (!rw->writer && !rw->readers) {
+      rw->writer = 1;
+      rw->wwait -= waiting;
+      spinlock_unlock(&rw->lock);
+      return;
+    }
+    if (!waiting) {
+      waiting = 1;
+      ++rw->wwait;
+    }
+    spinlock_unlock(&rw->lock);
+    thd_pass();
+  }
+}
+
+static void rw_wrunlock(node_lock_t * rw)
+{
+  spinlock_lock(&rw->lock);
+  rw->writer = 0;
+  spinlock_unlock(&rw->lock);
+}
+
+/* Add bytes to memory usage, check memory budget for allocation. */
+static int account(int bytes)
+{
+  int err = 0;
+
+  spinlock_lock(&ext_mutex);
+  if (bytes > 0 && max_bytes && used_bytes + bytes > max_bytes) {
+    err = -1;
+  } else {
+    used_bytes += bytes;
+  }
+  spinlock_unlock(&ext_mutex);
+  return err;
+}
+
 /* Used to compare 2 names. We could easily change case sensitivity */
 static int namecmp(const char *n1, const char *n2)
 {
   return strcmp(n1,n2);
 }
 
+/* Hash a name (must be coherent with namecmp()). FNV-1a. */
+static unsigned int namehash(const char *n, int len)
+{
+  unsigned int h = 2166136261u;
+
+  while (len-- && *n) {
+    h = (h ^ (*n++ & 255)) * 16777619u;
+  }
+  return h;
+}
+
+static void path_cache_flush(void)
+{
+  memset(path_cache, 0, sizeof(path_cache));
+}
+
+static node_t * path_cache_get(const char * path, unsigned int h)
+{
+  int i = h & (PATH_CACHE_SIZE-1);
+  node_t * node = path_cache[i].node;
+
+  if (node && path_cache[i].hash == h && !strcmp(path_cache[i].path, path)) {
+    return node;
+  }
+  return 0;
+}
+
+static void path_cache_set(const char * path, unsigned int h, node_t * node)
+{
+  int i = h & (PATH_CACHE_SIZE-1);
+
+  if (strlen(path) < PATH_CACHE_MAX) {
+    path_cache[i].node = node;
+    path_cache[i].hash = h;
+    strcpy(path_cache[i].path, path);
+  }
+}
+
+/* Insert node in its father hash table, grow the table if needed. If the
+ * table could not be allocated, lookup will scan the sons list.
+ */
+static void hash_insert(node_t * father, node_t * node)
+{
+  int i;
+
+  if (father->hcount >= 2 * father->hsize) {
+    int size = father->hsize ? father->hsize * 4 : DIR_HASH_SIZE;
+    node_t ** htab, * n;
+
+    htab = (node_t **)calloc(size, sizeof(*htab));
+    if (htab) {
+      for (n = father->son; n; n = n->little_bros) {
+	if (n != node) {
+	  i = n->hash & (size-1);
+	  n->hash_nxt = htab[i];
+	  htab[i] = n;
+	}
+      }
+      if (father->htab) {
+	account(-father->hsize * (int)sizeof(*htab));
+	free(father->htab);
+      }
+      account(size * sizeof(*htab));
+      father->htab = htab;
+      father->hsize = size;
+    }
+  }
+  ++father->hcount;
+  if (father->htab) {
+    i = node->hash & (father->hsize-1);
+    node->hash_nxt = father->htab[i];
+    father->htab[i] = node;
+  }
+}
+
+static void hash_remove(node_t * father, node_t * node)
+{
+  node_t ** pn;
+
+  --father->hcount;
+  if (!father->htab) {
+    return;
+  }
+  for (pn = father->htab + (node->hash & (father->hsize-1));
+       *pn; pn = &(*pn)->hash_nxt) {
+    if (*pn == node) {
+      *pn = node->hash_nxt;
+      break;
+    }
+  }
+  node->hash_nxt = 0;
+}
+
 static const char * modestr(int mode)
 {
   const char * str[12] =
@@ -204,16 +437,6 @@ static int valid_name(const char * name, int accept_root) {
   return valid;
 }
 
-static node_t * youngest_bros(node_t * node)
-{
-  if (!node) {
-    return 0;
-  }
-  for(;node->little_bros; node = node->little_bros)
-    ;
-  return node;
-}
-
 static void attach_node(node_t * father, node_t * node)
 {
   /*
@@ -223,11 +446,13 @@ static void attach_node(node_t * father, node_t * node)
   */
   node->father = father;
   node->little_bros = 0;
-  if ((node->big_bros = youngest_bros(father->son)) != 0) {
+  if ((node->big_bros = father->last_son) != 0) {
     node->big_bros->little_bros = node;
   } else {
     father->son = node;
   }
+  father->last_son = node;
+  hash_insert(father, node);
 /*   father->flags.modified = 1; /\* Attach modify father ! *\/ */
   node->flags.notify = father->flags.notify;
 }
@@ -248,6 +473,11 @@ static void detach_node(node_t * node)
   }
 #endif
 
+  path_cache_flush();
+  if (node->father) {
+    hash_remove(node->father, node);
+  }
+
   /* Remove this node from directory reading. */
   for (i=0; i<MAX_RD_FILES; ++i) {
     if (fh[i].readdir == node) {
@@ -267,6 +497,9 @@ static void detach_node(node_t * node)
       }
 #endif
   }
+  if (node->father && node->father->last_son == node) {
+    node->father->last_son = node->big_bros;
+  }
   /* Correct little/big brother hierarchy */
   if (node->big_bros) {
     node->big_bros->little_bros = node->little_bros;
@@ -276,14 +509,20 @@ static void detach_node(node_t * node)
   }
 }
 
+static void release_extents(node_t * node);
+
 static void release_node(node_t * node)
 {
   //  SDDEBUG( "%s [%s]\n", __FUNCTION__, node ? node->entry.name : "<null>"); 
   if (node) {
-    if (node->data) {
-      free(node->data);
+    release_extents(node);
+    if (node->htab) {
+      account(-node->hsize * (int)sizeof(*node->htab));
+      free(node->htab);
+      node->htab = 0;
     }
     if (node != &root_node) {
+      account(-(int)sizeof(*node));
       free(node);
     }
   }
@@ -313,6 +552,7 @@ static void dump_node(node_t * node, const char * label)
     SDDEBUG("Name:   '%s'\n", node->entry.name);
     SDDEBUG("size:   %d\n", node->entry.size);
     SDDEBUG("alloc:  %d\n", node->max);
+    SDDEBUG("extent: %d\n", node->n_ext);
     SDDEBUG("open:   %d\n", node->flags.open);
     SDDEBUG("notify: %d\n", node->flags.notify);
     SDDEBUG("modify: %d\n", node->flags.modified);
@@ -360,11 +600,100 @@ static void remap_node(node_t * n0, node_t *n1)
 }
 */
 
-// $$$ Ben: Could have smarter alloc policy depending of the current file size
+/* Allocate an extent, checking the memory budget. */
+static extent_t * alloc_extent(int size)
+{
+  extent_t * e;
+  int bytes = sizeof(*e) - sizeof(e->data) + size;
+
+  if (account(bytes) < 0) {
+    SDWARNING("[%s] : ramdisk is full [used:%d] [max:%d] [req:%d]\n",
+	      __FUNCTION__, used_bytes, max_bytes, size);
+    return 0;
+  }
+  e = (extent_t *)malloc(bytes);
+  if (!e) {
+    account(-bytes);
+    SDERROR("Extent allocation failure\n");
+    return 0;
+  }
+  e->refcount = 1;
+  e->size = size;
+  spinlock_lock(&ext_mutex);
+  ext_bytes += size;
+  ++ext_count;
+  spinlock_unlock(&ext_mutex);
+  return e;
+}
+
+static void release_extent(extent_t * e)
+{
+  int last;
+
+  if (!e) {
+    return;
+  }
+  spinlock_lock(&ext_mutex);
+  last = !--e->refcount;
+  if (last) {
+    used_bytes -= sizeof(*e) - sizeof(e->data) + e->size;
+    ext_bytes -= e->size;
+    --ext_count;
+  }
+  spinlock_unlock(&ext_mutex);
+  if (last) {
+    free(e);
+  }
+}
+
+static void release_extents(node_t * node)
+{
+  int i;
+
+  for (i=0; i<node->n_ext; ++i) {
+    release_extent(node->ext[i]);
+  }
+  if (node->ext) {
+    account(-node->max_ext * (int)sizeof(*node->ext));
+    free(node->ext);
+  }
+  node->ext = 0;
+  node->n_ext = node->max_ext = node->max = 0;
+}
+
+/* Append an extent to the node extent table. */
+static int add_extent(node_t * node, extent_t * e)
+{
+  if (node->n_ext == node->max_ext) {
+    int max = node->max_ext ? node->max_ext * 2 : 4;
+    extent_t ** ext;
+
+    if (account((max - node->max_ext) * sizeof(*ext)) < 0) {
+      return -1;
+    }
+    ext = (extent_t **)realloc(node->ext, max * sizeof(*ext));
+    if (!ext) {
+      account(-(max - node->max_ext) * (int)sizeof(*ext));
+      SDERROR("Extent table allocation failure\n");
+      return -1;
+    }
+    node->ext = ext;
+    node->max_ext = max;
+  }
+  node->ext[node->n_ext++] = e;
+  node->max += e->size;
+  return 0;
+}
+
+/* Grow node so that it can hold req_size bytes. Growth is geometric :
+ * the new extent is as large as the current allocated size (bounded),
+ * so that appending never moves existing data.
+ */
 static int realloc_node(node_t * node, int req_size)
 {
-  void * data;
+  extent_t * e;
   int missing = req_size - node->max;
+  int grow;
 
 /*   SDDEBUG("%s [%s] to %d, missing %d\n", __FUNCTION__, */
 /* 	  node->entry.name, req_size, missing); */
@@ -374,17 +703,89 @@ static int realloc_node(node_t * node, int req_size)
   }
 
   missing = (missing + ALLOC_BLOCK_SIZE-1) & -ALLOC_BLOCK_SIZE;
-  missing += node->max;
+  grow = node->max > MAX_EXTENT_SIZE ? MAX_EXTENT_SIZE : node->max;
+  grow = (grow + ALLOC_BLOCK_SIZE-1) & -ALLOC_BLOCK_SIZE;
+  if (grow < missing) {
+    grow = missing;
+  }
 
-  data = realloc(node->data, missing);
-  if (data) {
-    node->data = data;
-    node->max = missing;
-    return 0;
-  } else {
+  e = alloc_extent(grow);
+  if (!e && grow > missing) {
+    /* Geometric growth failed, try exact size. */
+    e = alloc_extent(grow = missing);
+  }
+  if (!e || add_extent(node, e) < 0) {
+    release_extent(e);
     SDERROR("Node data allocation failure\n");
     return -1;
   }
+  return 0;
+}
+
+/* Get extent index containing file position pos. Returns the position
+ * of the extent start in *start.
+ */
+static int find_extent(node_t * node, int pos, int * start)
+{
+  int i, p;
+
+  for (i=p=0; i<node->n_ext && pos >= p + node->ext[i]->size; ++i) {
+    p += node->ext[i]->size;
+  }
+  *start = p;
+  return i;
+}
+
+/* Make extent private to the node before writing to it. Node must be
+ * write locked : refcount could not grow as sharing an extent needs the
+ * node read lock.
+ */
+static int unshare_extent(node_t * node, int i)
+{
+  extent_t * e = node->ext[i], * c;
+  int refcount;
+
+  spinlock_lock(&ext_mutex);
+  refcount = e->refcount;
+  spinlock_unlock(&ext_mutex);
+  if (refcount == 1) {
+    return 0;
+  }
+  c = alloc_extent(e->size);
+  if (!c) {
+    return -1;
+  }
+  memcpy(c->data, e->data, e->size);
+  release_extent(e);
+  node->ext[i] = c;
+  return 0;
+}
+
+/* Merge all extents into a single private one (needed by mmap). */
+static uint8 * flatten_node(node_t * node)
+{
+  extent_t * e;
+  int i, p;
+
+  if (!node->n_ext) {
+    return 0;
+  }
+  if (node->n_ext == 1 && !unshare_extent(node, 0)) {
+    return node->ext[0]->data;
+  }
+
+  e = alloc_extent(node->max);
+  if (!e) {
+    return 0;
+  }
+  for (i=p=0; i<node->n_ext; ++i) {
+    memcpy(e->data + p, node->ext[i]->data, node->ext[i]->size);
+    p += node->ext[i]->size;
+    release_extent(node->ext[i]);
+  }
+  node->ext[0] = e;
+  node->n_ext = 1;
+  return e->data;
 }
 
 static void clean_openfile(openfile_t *f)
@@ -419,11 +820,17 @@ static node_t * create_node(const char *name, int datasize)
   }
 
   /* Create the  node itself. */
+  if (account(sizeof(*node)) < 0) {
+    SDWARNING("[%s] : ramdisk is full\n", __FUNCTION__);
+    goto error;
+  }
   node = (node_t *)malloc(sizeof (*node));
   if (!node) {
+    account(-(int)sizeof(*node));
     goto error;
   }
   clean_node(node);
+  rw_init(&node->rw);
   /* created node is always modified ;) becauze it modify the directory 
    * structure.  
    */
@@ -431,20 +838,17 @@ static node_t * create_node(const char *name, int datasize)
 
   /* Copy filename. */
   strcpy(node->entry.name, name);
+  node->hash = namehash(name, -1);
 
   if (!node->entry.name) {
     goto error;
   }
 
   /* Create data area */
-  if (datasize > 0) {
-    node->data = (uint8 *)malloc(datasize);
-    if (!node->data) {
-      SDERROR("Data allocation failure.\n");
-      goto error;
-    }
+  if (datasize > 0 && realloc_node(node, datasize) < 0) {
+    SDERROR("Data allocation failure.\n");
+    goto error;
   }
-  node->max = datasize;
 
   //  SDDEBUG("-->%s success\n", __FUNCTION__);
   return node;
@@ -456,59 +860,40 @@ static node_t * create_node(const char *name, int datasize)
 } 
 
 
-static node_t * find_node_same_level(node_t *node, const char *fn, int what)
+/* Find a node named fn in the sons of dir. Scan the hash table (or the
+ * sons list if there is no table). Nodes scheduled for unlink are
+ * skipped.
+ */
+static node_t * find_son(node_t *dir, const char *fn, int len, int what)
 {
-  /*
-  SDDEBUG("%s [%s] [%s] in [%s]\n", __FUNCTION__,
-	  whatstr(what),
-	  fn ? fn : "<null>",
-	  node ? node->entry.name : "<null>");
-  */
-  SDINDENT;
-  if (!node || !fn) {
-    SDERROR("Invalid parms [%p] [%p]\n", node, fn);
-    goto error;
-  }
+  node_t * node;
+  unsigned int h = namehash(fn, len);
 
-  /* Get first born */
-  while (node->big_bros) {
-    node = node->big_bros;
+  if (dir->htab) {
+    node = dir->htab[h & (dir->hsize-1)];
+  } else {
+    node = dir->son;
   }
 
-  /* Search ... */
-  for (; node; node = node->little_bros) {
-    //    SDDEBUG("SCAN [%s]%s\n", node->entry.name, is_dir(node)?"*":"");
-    if (node->flags.unlinked) {
-      SDDEBUG("Skipping [%s] (scheduled for unlink)\n", node->entry.name);
+  for (; node; node = dir->htab ? node->hash_nxt : node->little_bros) {
+    if (node->hash != h || node->flags.unlinked ||
+	strncmp(fn, node->entry.name, len) || node->entry.name[len]) {
       continue;
     }
-
-    if (!namecmp(fn, node->entry.name)) {
-      /* Found it, is it a kind we want to ? 1:regular 2Ldir 3:both */
-      if ( (is_dir(node) + 1) & what) {
-	break;
-      } else {
-	//	SDDEBUG("BAD TYPE !!\n");
-	node = 0;
-	break;
-      }
-    }
+    /* Found it, is it a kind we want to ? 1:regular 2Ldir 3:both */
+    return ((is_dir(node) + 1) & what) ? node : 0;
   }
- error:
-  if (node) {
-    //    SDDEBUG("-->[%s]\n",node->entry.name);
-  } else {
-    //    SDDEBUG("NOT FOUND OR BAD TYPE\n");
-  }
-  SDUNINDENT;
-  return node;
+  return 0;
 }
 
+/* Find a node from its path. Path must start with a '/' (root node has
+ * an empty name).
+ */
 static node_t * find_node(node_t * node, char *fn, int what)
 {
   char *fe;
-  node_t * n = 0;
-  int len, save_char;
+  node_t * n = node;
+  unsigned int h;
 
 /*   SDDEBUG("%s [%s] [%s] in [%s]\n", __FUNCTION__, */
 /* 	  whatstr(what), */
@@ -520,34 +905,44 @@ static node_t * find_node(node_t * node, char *fn, int what)
     return 0;
   }
 
-  /* Scan for end of level name */
+  /* Scan for end of root name */
   for (fe=fn; *fe && *fe != '/'; ++fe)
     ;
+  if (fe != fn || node != root) {
+    SDERROR("Find node [%s] : not an absolute path\n", fn);
+    return 0;
+  }
+
+  h = namehash(fn, -1);
+  if (n = path_cache_get(fn, h), n) {
+    return ((is_dir(n) + 1) & what) ? n : 0;
+  }
+
+  for (n = node; *fe; ) {
+    char * fs = fe + 1;
+    int last;
 
-  len = fe - fn;
-  save_char = *fe;
+    /* Scan for end of level name */
+    for (fe=fs; *fe && *fe != '/'; ++fe)
+      ;
+    last = !*fe;
 
-  if (!save_char) {
-    node_t *n;
-    //    SDDEBUG("REACH LEAF LEVEL:\n");
-    /* Reach end of path : search target (dir/file) */
-    n = find_node_same_level(node, fn, what);
+    if (!is_dir(n)) {
+      return 0;
+    }
+    n = find_son(n, fs, fe - fs, last ? 3 : 2);
     if (!n) {
-      SDERROR("NOT FOUND [%s] [%s]\n", fn, whatstr(what));
+      if (last) {
+	SDERROR("NOT FOUND [%s] [%s]\n", fn, whatstr(what));
+      } else {
+	SDERROR("SUBDIR [%s] Not found\n", fn);
+      }
+      return 0;
     }
-    //    SDDEBUG("FOUND [%s] [%s]\n", fn, whatstr(what));
-    return n;
   }
 
-  /* Search a dir */
-  *fe = 0;
-  n = find_node_same_level(node, fn, 2);
-  *fe = save_char;
-  if (!n) {
-    SDERROR("SUBDIR [%s] Not found\n", fn);
-    return 0;
-  }
-  return find_node(n->son, fe+1, what);
+  path_cache_set(fn, h, n);
+  return ((is_dir(n) + 1) & what) ? n : 0;
 }
 
 
@@ -571,7 +966,8 @@ static ssize_t read(file_t fd, void * buffer, size_t size)
 {
   uint8 * d = buffer;
   openfile_t * of;
-  int end_pos, n;
+  node_t * node;
+  int end_pos, n, i, start, pos;
 
   //  SDDEBUG("%s (%d, %p, %d)\n", __FUNCTION__, fd, buffer, size);
   
@@ -589,15 +985,32 @@ static ssize_t read(file_t fd, void * buffer, size_t size)
     return 0;
   }
 		
-  LOCK_NODE();
+  node = of->node;
+  rw_rdlock(&node->rw);
   end_pos = of->pos + size;
-  if (end_pos > of->node->entry.size) {
-    end_pos = of->node->entry.size;
+  if (end_pos > node->entry.size) {
+    end_pos = node->entry.size;
   }
   n = end_pos - of->pos;
-  memcpy(d, of->node->data + of->pos, n);
-  of->pos = end_pos;
-  UNLOCK_NODE();
+  if (n < 0) {
+    /* Reading after end of file. */
+    n = 0;
+  }
+  for (pos = of->pos, i = find_extent(node, pos, &start);
+       pos < end_pos; ++i) {
+    extent_t * e = node->ext[i];
+    int len = start + e->size - pos;
+
+    if (len > end_pos - pos) {
+      len = end_pos - pos;
+    }
+    memcpy(d, e->data + pos - start, len);
+    d += len;
+    pos += len;
+    start += e->size;
+  }
+  of->pos += n;
+  rw_rdunlock(&node->rw);
 	
   return n;
 }
@@ -607,7 +1020,8 @@ static ssize_t write(file_t fd, const void * buffer, size_t size)
 {
   const uint8 * d = buffer;
   openfile_t * of;
-  int end_pos, n;
+  node_t * node;
+  int end_pos, n, i, start, pos;
 
   //  SDDEBUG("%s (%d, %p, %d)\n", __FUNCTION__, fd, buffer, size);
 
@@ -624,14 +1038,15 @@ static ssize_t write(file_t fd, const void * buffer, size_t size)
   }
 	
   of = fh + fd;
-  LOCK_NODE();
+  node = of->node;
+  rw_wrlock(&node->rw);
   end_pos = of->pos + size;
-  if (end_pos > of->node->max) {
-    realloc_node(of->node, end_pos);
-    if (end_pos > of->node->max) {
+  if (end_pos > node->max) {
+    realloc_node(node, end_pos);
+    if (end_pos > node->max) {
       SDWARNING("[%s] : Realloc failed [end:%d] [max:%d]\n",
-		__FUNCTION__, end_pos, of->node->max);
-      end_pos = of->node->max;
+		__FUNCTION__, end_pos, node->max);
+      end_pos = node->max;
     }
   }
 
@@ -643,20 +1058,40 @@ static ssize_t write(file_t fd, const void * buffer, size_t size)
   }
 #endif
   
-  memcpy(of->node->data + of->pos, d, n);
-  //  SDDEBUG("%s copied [%p+%d %p %d]\n", __FUNCTION__,
-  //	  of->node->data, of->pos, d, n);
+  for (pos = of->pos, i = find_extent(node, pos, &start);
+       pos < end_pos; ++i) {
+    extent_t * e;
+    int len;
+
+    if (unshare_extent(node, i) < 0) {
+      SDWARNING("[%s] : copy on write failed\n", __FUNCTION__);
+      n = pos - of->pos;
+      break;
+    }
+    e = node->ext[i];
+    len = start + e->size - pos;
+    if (len > end_pos - pos) {
+      len = end_pos - pos;
+    }
+    memcpy(e->data + pos - start, d, len);
+    d += len;
+    pos += len;
+    start += e->size;
+  }
+  //  SDDEBUG("%s copied [%d %p %d]\n", __FUNCTION__, of->pos, d, n);
   of->pos += n;
-  if (of->pos > of->node->entry.size) {
-    of->node->entry.size = of->pos;
+  if (of->pos > node->entry.size) {
+    node->entry.size = of->pos;
   }
+  rw_wrunlock(&node->rw);
 
-  if (n>0) {
-    /* Writing some data modify node */
-    of->node->flags.modified = 1;
+  if (n>0 && !node->flags.modified) {
+    /* Writing some data modify node. Flags share a word with the open
+     * count : they are only changed under the node mutex. */
+    LOCK_NODE();
+    node->flags.modified = 1;
+    UNLOCK_NODE();
   }
-
-  UNLOCK_NODE();
 	
   //SDDEBUG("--> %d bytes\n", n);
   return n;
@@ -1036,14 +1471,12 @@ static int rename(const char *fn1, const char *fn2)
   }
 
   /* Find the files */
+  LOCK_NODE();
   node1 = find_node(root, fname1, 3);
-  if (!node1) {
-    return -1;
-  }
-
   /* Check if a file already exist with new name */
-  node2 =  find_node(root, fname2, 3);
-  if (node2) {
+  node2 = node1 ? find_node(root, fname2, 3) : 0;
+  UNLOCK_NODE();
+  if (!node1 || node2) {
     return -1;
   }
 
@@ -1092,24 +1525,27 @@ static int unlink(vfs_handler_t * vfs, const char *fn)
     return -1;
   }
 
+  LOCK_NODE();
+
   /* Find a regular file or a directory */
   node = find_node(root, fname, 3 - slash_end);
   if (!node) {
+    UNLOCK_NODE();
     return -1;
   }
 
   if (is_dir(node) && node->son) {
     /* Can't unlink non empty dir. */
     SDERROR("Directory not empty.\n");
+    UNLOCK_NODE();
     return -1;
   }
 
-  LOCK_NODE();
-
   if (node->flags.open) {
     /* Node is open... Just flag it for unlinking. */
     SDDEBUG("-->Scheduled for unlink\n");
     node->flags.unlinked = 1;
+    path_cache_flush();
   } else {
     /* Node is closed... */
     really_unlink(vfs, node);
@@ -1122,14 +1558,19 @@ static int unlink(vfs_handler_t * vfs, const char *fn)
 /* Assume node will be modified ! */
 static void * mmap(file_t fd)
 {
+  void * data;
+
   if (fd = valid_regular(fd,-1), fd == INVALID_FH) {
     return 0;
   }
   LOCK_NODE();
   fh[fd].node->flags.modified = 1;
   UNLOCK_NODE();
+  rw_wrlock(&fh[fd].node->rw);
+  data = flatten_node(fh[fd].node);
+  rw_wrunlock(&fh[fd].node->rw);
 
-  return fh[fd].node->data;
+  return data;
 }
 
 /* Put everything together */
@@ -1172,19 +1613,17 @@ int dcpfs_ramdisk_init(int max_size)
   root_node.entry.size = -1;
   root_node.flags.notify = 1;
   
-  if (max_size) {
-    SDNOTICE("[%s] : max_size [%d] ignored (not implemented\n",
-	     __FUNCTION__, max_size);
-  }
-
-  /* Set max size to max if 0 is requested. $$$ BEN: Not used  */ 
-  max_size -= !max_size;
+  /* 0 is unlimited. */
+  max_bytes = max_size > 0 ? max_size : 0;
+  used_bytes = ext_bytes = ext_count = 0;
 
   clean_openfiles();
 	
   /* Init thread mutexes */
   spinlock_init(&fh_mutex);
   spinlock_init(&node_mutex);
+  spinlock_init(&ext_mutex);
+  rw_init(&root_node.rw);
 
   /* Register with VFS */
   if (nmmgr_handler_add(&vh)) {
@@ -1194,6 +1633,7 @@ int dcpfs_ramdisk_init(int max_size)
   fh_mask = 0;
   root = &root_node;
   modify = 0;
+  path_cache_flush();
 
   return 0;
 }
@@ -1284,3 +1724,133 @@ int fs_ramdisk_notify_path(const char *path)
   UNLOCK_NODE();
   return 0;
 }
+
+/* Strip "/ram" from a full path, returns 0 if not a ramdisk path. */
+static const char * ramdisk_path(const char * path)
+{
+  if (!path || strstr(path, "/ram/") != path) {
+    return 0;
+  }
+  return path + 4;
+}
+
+int fs_ramdisk_copy(const char * dstname, const char * srcname)
+{
+  const char * src = ramdisk_path(srcname), * dst = ramdisk_path(dstname);
+  node_t * snode, * dnode;
+  file_t fds = 0, fdd = 0;
+  int i, err = -1;
+
+  if (!root || !src || !dst) {
+    return -1;
+  }
+
+  fds = open(&vh, src, O_RDONLY);
+  if (!fds) {
+    goto error;
+  }
+  fdd = open(&vh, dst, O_WRONLY);
+  if (!fdd) {
+    goto error;
+  }
+
+  snode = fh[fds-1].node;
+  dnode = fh[fdd-1].node;
+  if (snode == dnode) {
+    /* Same file : do not unlink it on the error path. */
+    SDERROR("[fs_ramdisk_copy] : [%s] copy to itself\n", srcname);
+    close(fdd);
+    close(fds);
+    return -1;
+  }
+  {
+    /* Lock nodes by address order. */
+    if (snode < dnode) {
+      rw_rdlock(&snode->rw);
+      rw_wrlock(&dnode->rw);
+    } else {
+      rw_wrlock(&dnode->rw);
+      rw_rdlock(&snode->rw);
+    }
+    /* Share source extents with the destination. */
+    release_extents(dnode);
+    for (i=0; i<snode->n_ext; ++i) {
+      spinlock_lock(&ext_mutex);
+      ++snode->ext[i]->refcount;
+      spinlock_unlock(&ext_mutex);
+      if (add_extent(dnode, snode->ext[i]) < 0) {
+	release_extent(snode->ext[i]);
+	break;
+      }
+    }
+    if (i == snode->n_ext) {
+      dnode->entry.size = snode->entry.size;
+      err = snode->entry.size;
+    } else {
+      release_extents(dnode);
+      dnode->entry.size = 0;
+    }
+    rw_wrunlock(&dnode->rw);
+    rw_rdunlock(&snode->rw);
+
+    LOCK_NODE();
+    dnode->flags.modified = 1;
+    UNLOCK_NODE();
+  }
+
+ error:
+  if (fds) {
+    close(fds);
+  }
+  if (fdd) {
+    close(fdd);
+    if (err < 0) {
+      unlink(&vh, dst);
+    }
+  }
+  return err;
+}
+
+int fs_ramdisk_usage(fs_ramdisk_usage_t * usage)
+{
+  node_t * node;
+
+  if (!usage) {
+    return -1;
+  }
+  memset(usage, 0, sizeof(*usage));
+  if (!root) {
+    return -1;
+  }
+
+  LOCK_NODE();
+  spinlock_lock(&ext_mutex);
+  usage->max = max_bytes;
+  usage->used = used_bytes;
+  usage->extents = ext_count;
+  usage->shared = -ext_bytes;
+  spinlock_unlock(&ext_mutex);
+
+  /* Walk the tree without recursion. */
+  for (node = root->son; node; ) {
+    if (is_dir(node)) {
+      ++usage->dirs;
+    } else {
+      ++usage->files;
+      usage->bytes += node->entry.size;
+      usage->shared += node->max;
+    }
+    if (node->son) {
+      node = node->son;
+    } else {
+      while (node && !node->little_bros && node != root) {
+	node = node->father;
+      }
+      node = (node && node != root) ? node->little_bros : 0;
+    }
+  }
+  /* Allocated by files minus really allocated. */
+  UNLOCK_NODE();
+
+  return 0;
+}
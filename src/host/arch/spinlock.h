@@ -0,0 +1,20 @@
+/* Host stand-in for the KOS <arch/spinlock.h>. Spins with a yield like
+ * the KOS one does with thd_pass().
+ */
+#ifndef _HOST_ARCH_SPINLOCK_H_
+#define _HOST_ARCH_SPINLOCK_H_
+
+#include <sched.h>
+
+typedef volatile int spinlock_t;
+
+#define SPINLOCK_INITIALIZER 0
+
+#define spinlock_init(l)    (*(l) = 0)
+#define spinlock_lock(l) \
+  do { while (__sync_lock_test_and_set((l), 1)) sched_yield(); } while (0)
+#define spinlock_unlock(l)  __sync_lock_release(l)
+#define spinlock_trylock(l) (!__sync_lock_test_and_set((l), 1))
+#define spinlock_is_locked(l) (*(l) != 0)
+
+#endif
@@ -0,0 +1,10 @@
+/* Host stand-in for the KOS <arch/timer.h>. */
+#ifndef _HOST_ARCH_TIMER_H_
+#define _HOST_ARCH_TIMER_H_
+
+#include <arch/types.h>
+
+/* Milliseconds since the first call. */
+uint64 timer_ms_gettime64(void);
+
+#endif
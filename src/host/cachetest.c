@@ -0,0 +1,273 @@
+/*	cachetest.c : cache filesystem test and benchmark on host.
+ *
+ *	Usage: cachetest [file]
+ *
+ *	A "/slow" filesystem forwards to "/pc" adding a fixed latency to
+ *	each read, as a CD seek would. Without file argument a 256KB file
+ *	is generated in obj/.
+ *
+ *	1. decoder : a fake decoder reads the file by small chunks,
+ *	   spending some time between reads, directly and through the
+ *	   cache. Same data, cached faster than direct.
+ *	2. seeks : random seeks and reads through the cache match the file.
+ *	3. threads : two readers of the same file through the cache read
+ *	   the right data.
+ *
+ *	Returns 0 if all checks pass.
+ *
+ * $Id$
+ */
+
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <arch/types.h>
+#include <arch/timer.h>
+#include <kos/thread.h>
+#include <kos/fs.h>
+
+#include "fs_cache.h"
+
+#define SLOW_LATENCY_MS  20
+#define TEST_CHUNK       4096
+#define TEST_DECODE_MS   2
+#define TEST_SIZE        (256<<10)
+
+static uint8 * data;
+static int data_size;
+
+static unsigned int seed = 0x5eed;
+
+static unsigned int rnd(void)
+{
+  seed = seed * 1103515245u + 12345u;
+  return seed >> 8;
+}
+
+static file_t slow_open(vfs_handler_t * vfs, const char *fn, int mode)
+{
+  char tmp[256];
+  file_t fd;
+
+  snprintf(tmp, sizeof(tmp), "/pc%s", fn);
+  fd = fs_open(tmp, mode);
+  return fd < 0 ? 0 : fd;
+}
+
+static void slow_close(uint32 fd)
+{
+  fs_close(fd);
+}
+
+static ssize_t slow_read(file_t fd, void * buffer, size_t size)
+{
+  thd_sleep(SLOW_LATENCY_MS);
+  return fs_read(fd, buffer, size);
+}
+
+static off_t slow_seek(uint32 fd, off_t offset, int whence)
+{
+  return fs_seek(fd, offset, whence);
+}
+
+static off_t slow_tell(uint32 fd)
+{
+  return fs_tell(fd);
+}
+
+static size_t slow_total(uint32 fd)
+{
+  return fs_total(fd);
+}
+
+static struct vfs_handler slow_vh = {
+  {
+    { "/slow" },           /* name */
+    0,
+    0x00010000,		/* Version 1.0 */
+    0,			/* flags */
+    NMMGR_TYPE_VFS,	/* VFS handler */
+    NMMGR_LIST_INIT	/* list */
+  },
+  0, NULL,		/* In-kernel, no cacheing, next */
+  slow_open,
+  slow_close,
+  slow_read,
+  NULL,
+  slow_seek,
+  slow_tell,
+  slow_total,
+  NULL, NULL, NULL, NULL, NULL
+};
+
+/* Read whole file like a decoder would and compare with the file data.
+ * Returns elapsed ms or -1. */
+static int test_decode(const char * path)
+{
+  static uint8 buffer[TEST_CHUNK];
+  uint64 start = timer_ms_gettime64();
+  file_t fd;
+  int n, pos = 0, err = 0;
+
+  fd = fs_open(path, O_RDONLY);
+  if (fd < 0) {
+    printf("  [%s] open failed\n", path);
+    return -1;
+  }
+  while (n = fs_read(fd, buffer, sizeof(buffer)), n > 0) {
+    err |= pos + n > data_size || memcmp(buffer, data + pos, n);
+    pos += n;
+    thd_sleep(TEST_DECODE_MS);
+  }
+  fs_close(fd);
+  if (n < 0 || err || pos != data_size) {
+    printf("  [%s] read %d/%d bytes%s\n", path, pos, data_size,
+	   err ? ", bad data" : "");
+    return -1;
+  }
+  return (int)(timer_ms_gettime64() - start);
+}
+
+static int test_seeks(const char * path, int count)
+{
+  static uint8 buffer[3 * TEST_CHUNK];
+  file_t fd;
+  int i, err = 0;
+
+  fd = fs_open(path, O_RDONLY);
+  if (fd < 0) {
+    return -1;
+  }
+  for (i=0; i<count && !err; ++i) {
+    int pos = rnd() % data_size;
+    int len = rnd() % sizeof(buffer);
+    int exp = data_size - pos < len ? data_size - pos : len;
+
+    err = fs_seek(fd, pos, SEEK_SET) != pos
+      || fs_read(fd, buffer, len) != exp
+      || memcmp(buffer, data + pos, exp)
+      || fs_tell(fd) != pos + exp;
+  }
+  fs_close(fd);
+  return -err;
+}
+
+static const char * thread_path;
+static volatile int thread_alive;
+static volatile int thread_err;
+
+static void test_thread(void * cookie)
+{
+  int err = test_decode(thread_path) < 0;
+
+  __sync_fetch_and_or(&thread_err, err);
+  __sync_fetch_and_sub(&thread_alive, 1);
+}
+
+static int load_file(const char * fname)
+{
+  FILE * f = fopen(fname, "rb");
+
+  if (!f) {
+    return -1;
+  }
+  fseek(f, 0, SEEK_END);
+  data_size = ftell(f);
+  fseek(f, 0, SEEK_SET);
+  data = malloc(data_size ? data_size : 1);
+  if (!data || fread(data, 1, data_size, f) != data_size) {
+    data_size = -1;
+  }
+  fclose(f);
+  return -(data_size < 0);
+}
+
+static int make_file(const char * fname)
+{
+  FILE * f = fopen(fname, "wb");
+  int i, err;
+
+  if (!f) {
+    return -1;
+  }
+  data_size = TEST_SIZE;
+  data = malloc(data_size);
+  for (i=0; i<data_size; ++i) {
+    data[i] = rnd();
+  }
+  err = fwrite(data, 1, data_size, f) != data_size;
+  err |= fclose(f);
+  return -err;
+}
+
+int main(int argc, char ** argv)
+{
+  char name[1024], path[PATH_MAX], tmp[PATH_MAX + 16];
+  fs_cache_stats_t s;
+  int direct, cached, i, err = 0;
+
+  if (argc > 1) {
+    snprintf(name, sizeof(name), "%s", argv[1]);
+    err = load_file(name);
+  } else {
+    strcpy(name, "obj/cachetest.bin");
+    err = make_file(name);
+  }
+  if (err || !realpath(name, path)) {
+    printf("cachetest : [%s] read error\n", name);
+    return 1;
+  }
+  if (dcpfs_cache_init(0) || nmmgr_handler_add(&slow_vh)) {
+    printf("cachetest : init failed\n");
+    return 1;
+  }
+
+  printf("cache test [%s] : %d bytes\n", path, data_size);
+
+  /* 1. decoder, direct then cached. */
+  snprintf(tmp, sizeof(tmp), "/slow%s", path);
+  direct = test_decode(tmp);
+  snprintf(tmp, sizeof(tmp), "/cache/slow%s", path);
+  fs_cache_stats(0, 1);
+  cached = test_decode(tmp);
+  fs_cache_stats(&s, 1);
+  printf(" direct : %6d ms\n", direct);
+  printf(" cached : %6d ms, stall %d ms\n", cached, s.stall_ms);
+  printf(" hits:%d misses:%d waits:%d readahead:%d unused:%d\n",
+	 s.hits, s.misses, s.waits, s.readahead, s.unused);
+  if (direct < 0 || cached < 0 || cached >= direct) {
+    printf(" decoder : FAILED\n");
+    err = 1;
+  }
+
+  /* 2. random seeks. */
+  if (test_seeks(tmp, 200)) {
+    printf(" seeks : FAILED\n");
+    err = 1;
+  }
+
+  /* 3. two readers of the same file. */
+  thread_path = tmp;
+  thread_err = 0;
+  thread_alive = 2;
+  for (i=0; i<2; ++i) {
+    if (!thd_create(test_thread, 0)) {
+      __sync_fetch_and_sub(&thread_alive, 1);
+      thread_err = 1;
+    }
+  }
+  while (thread_alive) {
+    thd_sleep(1);
+  }
+  if (thread_err) {
+    printf(" threads : FAILED\n");
+    err = 1;
+  }
+
+  nmmgr_handler_remove(&slow_vh);
+  dcpfs_cache_shutdown();
+  printf("cache test : %s\n", err ? "FAILED" : "OK");
+  return err;
+}
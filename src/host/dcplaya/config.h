@@ -0,0 +1,5 @@
+/* Host stand-in for the configure generated dcplaya/config.h. */
+#ifndef _DCPLAYA_CONFIG_H_
+#define _DCPLAYA_CONFIG_H_
+
+#endif
@@ -0,0 +1,12 @@
+/* Forced include for the dcplaya sources built on host. The VFS
+ * handlers define a static rename() which the host <stdio.h> already
+ * declares : declare it first and rename the handler one.
+ */
+#ifndef _HOST_H_
+#define _HOST_H_
+
+#include <stdio.h>
+
+#define rename vfs_rename
+
+#endif
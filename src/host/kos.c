@@ -0,0 +1,438 @@
+/**
+ * @file    kos.c
+ * @brief   Host stand-in for the KOS services used by the dcplaya file
+ *          systems : threads, semaphores, timer and VFS.
+ *
+ * $Id$
+ */
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <arch/types.h>
+#include <arch/spinlock.h>
+#include <arch/timer.h>
+#include <kos/thread.h>
+#include <kos/sem.h>
+#include <kos/fs.h>
+
+/* Timer. */
+
+uint64 timer_ms_gettime64(void)
+{
+  static uint64 origin;
+  struct timespec ts;
+  uint64 ms;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  ms = (uint64)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+  if (!origin) {
+    origin = ms - 1;
+  }
+  return ms - origin;
+}
+
+/* Threads. Thread structures are never freed : callers may keep the
+ * pointer returned by thd_create() after the thread has exited. */
+
+struct kthread {
+  pthread_t    thd;
+  void      (* routine)(void *);
+  void       * param;
+  char         label[32];
+};
+
+static void * thd_start(void * cookie)
+{
+  kthread_t * t = cookie;
+
+  t->routine(t->param);
+  return 0;
+}
+
+kthread_t * thd_create(void (*routine)(void *param), void *param)
+{
+  kthread_t * t = calloc(1, sizeof(*t));
+
+  if (!t) {
+    return 0;
+  }
+  t->routine = routine;
+  t->param = param;
+  if (pthread_create(&t->thd, 0, thd_start, t)) {
+    free(t);
+    return 0;
+  }
+  pthread_detach(t->thd);
+  return t;
+}
+
+int thd_set_label(kthread_t *thd, const char *label)
+{
+  strncpy(thd->label, label, sizeof(thd->label) - 1);
+  return 0;
+}
+
+void thd_pass(void)
+{
+  sched_yield();
+}
+
+void thd_sleep(int ms)
+{
+  usleep(ms * 1000);
+}
+
+/* Semaphores. */
+
+struct semaphore {
+  pthread_mutex_t mutex;
+  pthread_cond_t  cond;
+  int             count;
+};
+
+semaphore_t * sem_create(int value)
+{
+  semaphore_t * sem = malloc(sizeof(*sem));
+
+  if (sem) {
+    pthread_mutex_init(&sem->mutex, 0);
+    pthread_cond_init(&sem->cond, 0);
+    sem->count = value;
+  }
+  return sem;
+}
+
+void sem_destroy(semaphore_t *sem)
+{
+  pthread_cond_destroy(&sem->cond);
+  pthread_mutex_destroy(&sem->mutex);
+  free(sem);
+}
+
+void sem_wait(semaphore_t *sem)
+{
+  pthread_mutex_lock(&sem->mutex);
+  while (sem->count <= 0) {
+    pthread_cond_wait(&sem->cond, &sem->mutex);
+  }
+  --sem->count;
+  pthread_mutex_unlock(&sem->mutex);
+}
+
+void sem_signal(semaphore_t *sem)
+{
+  pthread_mutex_lock(&sem->mutex);
+  ++sem->count;
+  pthread_cond_signal(&sem->cond);
+  pthread_mutex_unlock(&sem->mutex);
+}
+
+/* VFS. */
+
+#define MAX_HANDLERS 8
+#define MAX_FILES    64
+
+static vfs_handler_t * handlers[MAX_HANDLERS];
+
+/* Global file handles, 0 is never used. */
+static struct {
+  vfs_handler_t * vfs;
+  uint32          hnd;
+} files[MAX_FILES];
+
+static spinlock_t vfs_mutex;
+
+int nmmgr_handler_add(void *hnd)
+{
+  int i, err = -1;
+
+  spinlock_lock(&vfs_mutex);
+  for (i=0; i<MAX_HANDLERS; ++i) {
+    if (!handlers[i]) {
+      handlers[i] = hnd;
+      err = 0;
+      break;
+    }
+  }
+  spinlock_unlock(&vfs_mutex);
+  return err;
+}
+
+int nmmgr_handler_remove(void *hnd)
+{
+  int i, err = -1;
+
+  spinlock_lock(&vfs_mutex);
+  for (i=0; i<MAX_HANDLERS; ++i) {
+    if (handlers[i] == hnd) {
+      handlers[i] = 0;
+      err = 0;
+    }
+  }
+  spinlock_unlock(&vfs_mutex);
+  return err;
+}
+
+/* Find the handler with the longest mount point prefixing fn. *path is
+ * set to the path in the handler, leading '/' included. */
+static vfs_handler_t * find_handler(const char * fn, const char ** path)
+{
+  vfs_handler_t * vfs = 0;
+  int i, len, best = 0;
+
+  spinlock_lock(&vfs_mutex);
+  for (i=0; i<MAX_HANDLERS; ++i) {
+    if (!handlers[i]) {
+      continue;
+    }
+    len = strlen(handlers[i]->nmmgr.pathname);
+    if (len > best && !strncmp(fn, handlers[i]->nmmgr.pathname, len)
+	&& (fn[len] == '/' || !fn[len])) {
+      vfs = handlers[i];
+      best = len;
+    }
+  }
+  spinlock_unlock(&vfs_mutex);
+  *path = fn + best;
+  return vfs;
+}
+
+static int valid_file(file_t fd)
+{
+  return fd > 0 && fd < MAX_FILES && files[fd].vfs;
+}
+
+file_t fs_open(const char *fn, int mode)
+{
+  const char * path;
+  vfs_handler_t * vfs = find_handler(fn, &path);
+  uint32 hnd;
+  int fd;
+
+  if (!vfs || !vfs->open) {
+    return -1;
+  }
+  hnd = vfs->open(vfs, path, mode);
+  if (!hnd) {
+    return -1;
+  }
+  spinlock_lock(&vfs_mutex);
+  for (fd=1; fd<MAX_FILES && files[fd].vfs; ++fd)
+    ;
+  if (fd < MAX_FILES) {
+    files[fd].vfs = vfs;
+    files[fd].hnd = hnd;
+  }
+  spinlock_unlock(&vfs_mutex);
+  if (fd == MAX_FILES) {
+    vfs->close(hnd);
+    return -1;
+  }
+  return fd;
+}
+
+void fs_close(file_t fd)
+{
+  vfs_handler_t * vfs;
+  uint32 hnd;
+
+  if (!valid_file(fd)) {
+    return;
+  }
+  vfs = files[fd].vfs;
+  hnd = files[fd].hnd;
+  spinlock_lock(&vfs_mutex);
+  files[fd].vfs = 0;
+  spinlock_unlock(&vfs_mutex);
+  if (vfs->close) {
+    vfs->close(hnd);
+  }
+}
+
+ssize_t fs_read(file_t fd, void *buffer, size_t cnt)
+{
+  return valid_file(fd) && files[fd].vfs->read
+    ? files[fd].vfs->read(files[fd].hnd, buffer, cnt) : -1;
+}
+
+ssize_t fs_write(file_t fd, const void *buffer, size_t cnt)
+{
+  return valid_file(fd) && files[fd].vfs->write
+    ? files[fd].vfs->write(files[fd].hnd, buffer, cnt) : -1;
+}
+
+off_t fs_seek(file_t fd, off_t offset, int whence)
+{
+  return valid_file(fd) && files[fd].vfs->seek
+    ? files[fd].vfs->seek(files[fd].hnd, offset, whence) : -1;
+}
+
+off_t fs_tell(file_t fd)
+{
+  return valid_file(fd) && files[fd].vfs->tell
+    ? files[fd].vfs->tell(files[fd].hnd) : -1;
+}
+
+size_t fs_total(file_t fd)
+{
+  return valid_file(fd) && files[fd].vfs->total
+    ? files[fd].vfs->total(files[fd].hnd) : (size_t)-1;
+}
+
+dirent_t * fs_readdir(file_t fd)
+{
+  return valid_file(fd) && files[fd].vfs->readdir
+    ? files[fd].vfs->readdir(files[fd].hnd) : 0;
+}
+
+int fs_unlink(const char *fn)
+{
+  const char * path;
+  vfs_handler_t * vfs = find_handler(fn, &path);
+
+  return vfs && vfs->unlink ? vfs->unlink(vfs, path) : -1;
+}
+
+/* "/pc" : host files, "/pc/tmp/foo" is "/tmp/foo". Directories are not
+ * supported. */
+
+#define MAX_PC_FILES 32
+
+static FILE * pc_files[MAX_PC_FILES];
+
+static FILE * pc_file(uint32 hnd)
+{
+  return hnd > 0 && hnd <= MAX_PC_FILES ? pc_files[hnd-1] : 0;
+}
+
+static file_t pc_open(vfs_handler_t * vfs, const char *fn, int mode)
+{
+  const char * fmode;
+  FILE * f;
+  int i;
+
+  switch (mode & (O_MODE_MASK | O_DIR)) {
+  case O_RDONLY:
+    fmode = "rb";
+    break;
+  case O_RDWR:
+    fmode = "r+b";
+    break;
+  case O_APPEND:
+    fmode = "ab";
+    break;
+  case O_WRONLY:
+    fmode = "wb";
+    break;
+  default:
+    return 0;
+  }
+  if (f = fopen(fn, fmode), !f) {
+    return 0;
+  }
+  spinlock_lock(&vfs_mutex);
+  for (i=0; i<MAX_PC_FILES && pc_files[i]; ++i)
+    ;
+  if (i < MAX_PC_FILES) {
+    pc_files[i] = f;
+  }
+  spinlock_unlock(&vfs_mutex);
+  if (i == MAX_PC_FILES) {
+    fclose(f);
+    return 0;
+  }
+  return i + 1;
+}
+
+static void pc_close(uint32 hnd)
+{
+  FILE * f = pc_file(hnd);
+
+  if (f) {
+    pc_files[hnd-1] = 0;
+    fclose(f);
+  }
+}
+
+static ssize_t pc_read(file_t hnd, void *buffer, size_t cnt)
+{
+  FILE * f = pc_file(hnd);
+
+  return f ? (ssize_t)fread(buffer, 1, cnt, f) : -1;
+}
+
+static ssize_t pc_write(file_t hnd, const void *buffer, size_t cnt)
+{
+  FILE * f = pc_file(hnd);
+
+  return f ? (ssize_t)fwrite(buffer, 1, cnt, f) : -1;
+}
+
+static off_t pc_seek(uint32 hnd, off_t offset, int whence)
+{
+  FILE * f = pc_file(hnd);
+
+  return f && !fseek(f, offset, whence) ? ftell(f) : -1;
+}
+
+static off_t pc_tell(uint32 hnd)
+{
+  FILE * f = pc_file(hnd);
+
+  return f ? ftell(f) : -1;
+}
+
+static size_t pc_total(uint32 hnd)
+{
+  FILE * f = pc_file(hnd);
+  long pos, end;
+
+  if (!f) {
+    return (size_t)-1;
+  }
+  pos = ftell(f);
+  fseek(f, 0, SEEK_END);
+  end = ftell(f);
+  fseek(f, pos, SEEK_SET);
+  return end;
+}
+
+static int pc_unlink(vfs_handler_t * vfs, const char *fn)
+{
+  return remove(fn) ? -1 : 0;
+}
+
+static vfs_handler_t pc_vh = {
+  {
+    { "/pc" },
+    0,
+    0x00010000,
+    0,
+    NMMGR_TYPE_VFS,
+    NMMGR_LIST_INIT
+  },
+  0, NULL,
+  pc_open,
+  pc_close,
+  pc_read,
+  pc_write,
+  pc_seek,
+  pc_tell,
+  pc_total,
+  NULL,
+  NULL,
+  NULL,
+  pc_unlink,
+  NULL
+};
+
+/* Registered before main() as KOS does for its built-in file systems. */
+static void __attribute__((constructor)) pc_init(void)
+{
+  nmmgr_handler_add(&pc_vh);
+}
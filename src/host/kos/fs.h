@@ -0,0 +1,72 @@
+/* Host stand-in for the KOS <kos/fs.h> : VFS handler and the fs_*()
+ * calls used by the dcplaya file systems. Implemented in kos.c.
+ */
+#ifndef _HOST_KOS_FS_H_
+#define _HOST_KOS_FS_H_
+
+#include <stdio.h>
+#include <arch/types.h>
+
+typedef int file_t;
+
+typedef struct {
+  int   size;        /* -1 for a directory. */
+  char  name[256];
+  int   time;
+  int   attr;
+} dirent_t;
+
+#define O_RDONLY     1
+#define O_RDWR       2
+#define O_APPEND     3
+#define O_WRONLY     4
+#define O_MODE_MASK  7
+#define O_TRUNC      0x0100
+#define O_DIR        0x1000
+
+typedef struct nmmgr_handler {
+  char    pathname[64];
+  int     pid;
+  uint32  version;
+  uint32  flags;
+  uint32  type;
+  struct { struct nmmgr_handler * next; } list_ent;
+} nmmgr_handler_t;
+
+#define NMMGR_TYPE_VFS   0x0001
+#define NMMGR_LIST_INIT  { 0 }
+
+typedef struct vfs_handler {
+  nmmgr_handler_t nmmgr;
+  int    cache;
+  void * privdata;
+  file_t (*open)(struct vfs_handler * vfs, const char *fn, int mode);
+  void (*close)(uint32 hnd);
+  ssize_t (*read)(file_t hnd, void *buffer, size_t cnt);
+  ssize_t (*write)(file_t hnd, const void *buffer, size_t cnt);
+  off_t (*seek)(uint32 hnd, off_t offset, int whence);
+  off_t (*tell)(uint32 hnd);
+  size_t (*total)(uint32 hnd);
+  dirent_t * (*readdir)(file_t hnd);
+  int (*ioctl)(file_t hnd, void *data, size_t size);
+  int (*rename)(const char *fn1, const char *fn2);
+  int (*unlink)(struct vfs_handler * vfs, const char *fn);
+  void * (*mmap)(file_t hnd);
+} vfs_handler_t;
+
+/* Handlers are matched on the longest mount point prefix. A "/pc"
+ * handler maps to host files. */
+int nmmgr_handler_add(void *hnd);
+int nmmgr_handler_remove(void *hnd);
+
+file_t fs_open(const char *fn, int mode);
+void fs_close(file_t hnd);
+ssize_t fs_read(file_t hnd, void *buffer, size_t cnt);
+ssize_t fs_write(file_t hnd, const void *buffer, size_t cnt);
+off_t fs_seek(file_t hnd, off_t offset, int whence);
+off_t fs_tell(file_t hnd);
+size_t fs_total(file_t hnd);
+dirent_t * fs_readdir(file_t hnd);
+int fs_unlink(const char *fn);
+
+#endif
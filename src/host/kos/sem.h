@@ -0,0 +1,12 @@
+/* Host stand-in for the KOS <kos/sem.h> (counting semaphore). */
+#ifndef _HOST_KOS_SEM_H_
+#define _HOST_KOS_SEM_H_
+
+typedef struct semaphore semaphore_t;
+
+semaphore_t * sem_create(int value);
+void sem_destroy(semaphore_t *sem);
+void sem_wait(semaphore_t *sem);
+void sem_signal(semaphore_t *sem);
+
+#endif
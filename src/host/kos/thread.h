@@ -0,0 +1,12 @@
+/* Host stand-in for the KOS <kos/thread.h> (pthreads). */
+#ifndef _HOST_KOS_THREAD_H_
+#define _HOST_KOS_THREAD_H_
+
+typedef struct kthread kthread_t;
+
+kthread_t * thd_create(void (*routine)(void *param), void *param);
+int thd_set_label(kthread_t *thd, const char *label);
+void thd_pass(void);
+void thd_sleep(int ms);
+
+#endif
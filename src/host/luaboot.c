@@ -0,0 +1,203 @@
+/*	luaboot.c : lua bytecode cache on the boot scripts, on host.
+ *
+ *	Usage: luaboot script.lua...
+ *
+ *	Scripts are given as host paths and loaded as "/pc" files, the
+ *	dcplaya development setup. Cache files are written next to them.
+ *
+ *	1. first boot : every script is parsed, no cache hit, every cache
+ *	   file written.
+ *	2. next boot : every script is loaded from its cache file.
+ *	3. parse vs load : time to parse all sources against time to load
+ *	   all cache files (lua_loadbuffer() only, scripts are not run).
+ *	4. /ram script : loaded without cache file.
+ *
+ *	Scripts run with none of the dcplaya functions : they stop quietly
+ *	at the first missing one, which does not matter here.
+ *
+ *	Returns 0 if all checks pass.
+ *
+ * $Id$
+ */
+
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <arch/types.h>
+#include <kos/fs.h>
+
+#include "lua.h"
+#include "luacache.h"
+#include "fs_ramdisk.h"
+#include "file_utils.h"
+
+/* Cache file header size (see luacache.c). */
+#define HEADER_SIZE 16
+
+/* Host stand-ins for the file_utils functions used with a cache
+ * directory, not with the default next to sources setting. */
+int fu_is_dir(const char * fname)
+{
+  return 0;
+}
+
+int fu_create_dir(const char * dirname)
+{
+  return -1;
+}
+
+static long usec(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1000000L + ts.tv_nsec / 1000;
+}
+
+static char * read_file(const char * fname, int * psize)
+{
+  FILE * f = fopen(fname, "rb");
+  char * buf = 0;
+  int size;
+
+  if (!f) {
+    return 0;
+  }
+  fseek(f, 0, SEEK_END);
+  size = ftell(f);
+  fseek(f, 0, SEEK_SET);
+  if (size >= 0 && (buf = malloc(size + 1)) != 0
+      && fread(buf, 1, size, f) != size) {
+    free(buf);
+    buf = 0;
+  }
+  fclose(f);
+  *psize = size;
+  return buf;
+}
+
+/* Time lua_loadbuffer() on buf, function dropped. Returns us or -1. */
+static long load_time(lua_State * L, const char * buf, int size,
+		      const char * name)
+{
+  long t = usec();
+  int status = lua_loadbuffer(L, buf, size, name);
+
+  t = usec() - t;
+  lua_settop(L, 0);
+  return status ? -1 : t;
+}
+
+static int run_boot(lua_State * L, char ** names, int n,
+		    luacache_stats_t * st)
+{
+  int i;
+  long t = usec();
+
+  luacache_stats(0, 1);
+  for (i=0; i<n; ++i) {
+    luacache_dofile(L, names[i]);
+    lua_settop(L, 0);
+  }
+  luacache_stats(st, 1);
+  return (int)((usec() - t) / 1000);
+}
+
+int main(int argc, char ** argv)
+{
+  static const char ramscript[] = "x = 1\n";
+  char ** names;
+  lua_State * L;
+  luacache_stats_t st;
+  long parse_us = 0, load_us = 0;
+  int i, n = argc - 1, ms, fd, err = 0;
+
+  if (n < 1) {
+    printf("Usage: luaboot script.lua...\n");
+    return 1;
+  }
+  if (dcpfs_ramdisk_init(0) || !(L = lua_open(0))) {
+    printf("luaboot : init failed\n");
+    return 1;
+  }
+  luacache_report(0);
+  /* Quiet run time errors. */
+  lua_dostring(L, "function _ERRORMESSAGE(msg) end");
+
+  names = malloc(n * sizeof(*names));
+  for (i=0; i<n; ++i) {
+    char path[PATH_MAX], cname[PATH_MAX + 8];
+
+    if (!realpath(argv[i+1], path)) {
+      printf("luaboot : [%s] not found\n", argv[i+1]);
+      return 1;
+    }
+    names[i] = malloc(strlen(path) + 4);
+    sprintf(names[i], "/pc%s", path);
+    /* Start without cache file. */
+    snprintf(cname, sizeof(cname), "%sc", names[i]);
+    fs_unlink(cname);
+  }
+
+  printf("lua boot : %d scripts, cache dir [%s]\n", n, luacache_get_dir());
+
+  /* 1. first boot. */
+  ms = run_boot(L, names, n, &st);
+  printf(" first boot : %5d ms, files:%d hits:%d parse:%d ms errors:%d\n",
+	 ms, st.files, st.hits, st.parse_ms, st.errors);
+  err |= st.files != n || st.hits || st.errors;
+
+  /* 2. next boot. */
+  ms = run_boot(L, names, n, &st);
+  printf(" next boot  : %5d ms, files:%d hits:%d load:%d ms errors:%d\n",
+	 ms, st.files, st.hits, st.load_ms, st.errors);
+  err |= st.files != n || st.hits != n;
+
+  /* 3. parse vs load. */
+  for (i=0; i<n; ++i) {
+    char cname[PATH_MAX];
+    char * src, * dump;
+    int srcsize, dumpsize;
+    long p = -1, l = -1;
+
+    snprintf(cname, sizeof(cname), "%sc", argv[i+1]);
+    src = read_file(argv[i+1], &srcsize);
+    dump = read_file(cname, &dumpsize);
+    if (src && dump && dumpsize > HEADER_SIZE) {
+      p = load_time(L, src, srcsize, names[i]);
+      l = load_time(L, dump + HEADER_SIZE, dumpsize - HEADER_SIZE, names[i]);
+    }
+    if (p < 0 || l < 0) {
+      printf("  [%s] : parse or load failed\n", argv[i+1]);
+      err = 1;
+    }
+    parse_us += p;
+    load_us += l;
+    free(src);
+    free(dump);
+  }
+  printf(" parse : %6ld us\n", parse_us);
+  printf(" load  : %6ld us (x%.1f)\n", load_us,
+	 load_us > 0 ? (double)parse_us / load_us : 0.0);
+  err |= load_us >= parse_us;
+
+  /* 4. /ram script. */
+  fd = fs_open("/ram/boot.lua", O_WRONLY);
+  err |= fd < 0 || fs_write(fd, ramscript, sizeof(ramscript) - 1) < 0;
+  fs_close(fd);
+  err |= luacache_dofile(L, "/ram/boot.lua") != 0;
+  fd = fs_open("/ram/boot.luac", O_RDONLY);
+  if (fd >= 0) {
+    printf(" /ram script cached : FAILED\n");
+    fs_close(fd);
+    err = 1;
+  }
+
+  lua_close(L);
+  dcpfs_ramdisk_shutdown();
+  printf("lua boot : %s\n", err ? "FAILED" : "OK");
+  return err;
+}
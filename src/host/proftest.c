@@ -0,0 +1,116 @@
+/*	proftest.c : lua sampling profiler on deep stacks, on host.
+ *
+ *	Usage: proftest
+ *
+ *	1. deep stack : 60 levels of a function with a 200 chars name,
+ *	   more than the profiler keeps (48 frames, 2048 chars).
+ *	2. long names : 12 levels of a function with a 400 chars name,
+ *	   longer than a folded stack with less than 48 frames.
+ *	Each is sampled every ms while it calls a small function in a
+ *	loop. Samples are recorded and every dumped stack fits in 2048
+ *	chars.
+ *
+ *	Returns 0 if all checks pass.
+ *
+ * $Id$
+ */
+
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <arch/types.h>
+#include <kos/fs.h>
+
+#include "lua.h"
+#include "luaprof.h"
+
+/* Folded stack limit (see luaprof.c). */
+#define MAX_STACK_LEN 2048
+
+/* Run a recursion of depth levels of a function with a namelen chars
+ * name, each call at the bottom looping on a small function. */
+static int run(lua_State * L, int depth, int namelen)
+{
+  static const char fmt[] =
+    "function tick() end\n"
+    "function %s(n)\n"
+    "  if n > 0 then %s(n - 1) return end\n"
+    "  local i = 0\n"
+    "  while i < 3000000 do i = i + 1 tick() end\n"
+    "end\n"
+    "%s(%d)\n";
+  char * name = malloc(namelen + 1), * script;
+  int status;
+
+  memset(name, 'f', namelen);
+  name[namelen] = 0;
+  script = malloc(sizeof(fmt) + 3 * namelen + 16);
+  sprintf(script, fmt, name, name, name, depth);
+  status = lua_dostring(L, script);
+  free(script);
+  free(name);
+  return status;
+}
+
+/* Check every stack of a luaprof_dump() file. Returns number of stacks
+ * or -1. */
+static int check_dump(const char * fname)
+{
+  static char line[16 << 10];
+  FILE * f = fopen(fname, "r");
+  int n = 0, err = 0;
+
+  if (!f) {
+    return -1;
+  }
+  while (fgets(line, sizeof(line), f)) {
+    char * count = strrchr(line, ' ');
+    int len = count ? count - line : -1;
+
+    if (len < 0 || len >= MAX_STACK_LEN) {
+      printf("  bad stack (%d chars) : %.60s...\n", len, line);
+      err = 1;
+    }
+    ++n;
+  }
+  fclose(f);
+  return err ? -1 : n;
+}
+
+static int test(const char * label, int depth, int namelen)
+{
+  char path[PATH_MAX], fname[PATH_MAX + 8];
+  lua_State * L = lua_open(0);
+  luaprof_stats_t st;
+  int n, err;
+
+  if (!L || !realpath("obj", path)) {
+    return -1;
+  }
+  strcat(path, "/prof.txt");
+  snprintf(fname, sizeof(fname), "/pc%s", path);
+
+  err = luaprof_start(L, 1) || run(L, depth, namelen);
+  luaprof_stop();
+  luaprof_stats(&st);
+  n = err ? -1 : luaprof_dump(fname);
+  err |= n <= 0 || check_dump(path) != n || st.samples <= 0;
+  printf(" %-11s : depth:%2d name:%3d samples:%5d stacks:%3d %s\n",
+	 label, depth, namelen, st.samples, st.stacks, err ? "FAILED" : "OK");
+  remove(path);
+  lua_close(L);
+  return -err;
+}
+
+int main(void)
+{
+  int err = 0;
+
+  printf("luaprof test :\n");
+  err |= test("deep stack", 60, 200);
+  err |= test("long names", 12, 400);
+  printf("luaprof test : %s\n", err ? "FAILED" : "OK");
+  return !!err;
+}
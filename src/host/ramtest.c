@@ -0,0 +1,289 @@
+/*	ramtest.c : ramdisk self test and benchmark on host.
+ *
+ *	Usage: ramtest
+ *
+ *	1. playlist saves : small appends, file read back.
+ *	2. screenshot writes : large files by 4K blocks.
+ *	3. vmu backups : fs_ramdisk_copy() copies then copy on write of
+ *	   some of them, source unchanged. A copy onto itself fails and
+ *	   keeps the file.
+ *	4. big directory : create, open and unlink 5000 files.
+ *	5. threads : readers of the same file, of different files, and
+ *	   readers with a writer.
+ *	6. cleanup : no file left.
+ *
+ *	Returns 0 if all checks pass.
+ *
+ * $Id$
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include <arch/types.h>
+#include <arch/spinlock.h>
+#include <arch/timer.h>
+#include <kos/thread.h>
+#include <kos/fs.h>
+
+#include "fs_ramdisk.h"
+
+static int test_ms(uint64 start)
+{
+  return (int)(timer_ms_gettime64() - start);
+}
+
+static int test_usage(const char * label)
+{
+  fs_ramdisk_usage_t u;
+
+  fs_ramdisk_usage(&u);
+  printf("  %-12s used:%8d bytes:%8d shared:%8d files:%5d extents:%5d\n",
+	 label, u.used, u.bytes, u.shared, u.files, u.extents);
+  return u.files;
+}
+
+/* Write size bytes by blocks of len bytes. */
+static int test_write(const char * name, int size, int len, int mode)
+{
+  static uint8 buf[4096];
+  file_t fd;
+  int i, n;
+
+  for (i=0; i<sizeof(buf); ++i) {
+    buf[i] = i * 7 + size;
+  }
+  fd = fs_open(name, mode);
+  if (fd < 0) {
+    return -1;
+  }
+  for (i=0; i<size; i+=n) {
+    n = size - i > len ? len : size - i;
+    if (fs_write(fd, buf, n) != n) {
+      break;
+    }
+  }
+  fs_close(fd);
+  return i == size ? 0 : -1;
+}
+
+/* Read and check a file written by test_write(). */
+static int test_check(const char * name, int size, int len)
+{
+  static uint8 buf[4096];
+  file_t fd;
+  int i, j, n, err = 0;
+
+  fd = fs_open(name, O_RDONLY);
+  if (fd < 0) {
+    return -1;
+  }
+  for (i=0; i<size && !err; i+=n) {
+    n = size - i > len ? len : size - i;
+    err = fs_read(fd, buf, n) != n;
+    for (j=0; j<n && !err; ++j) {
+      err = buf[j] != (uint8)(j * 7 + size);
+    }
+  }
+  err |= fs_total(fd) != size;
+  fs_close(fd);
+  return -err;
+}
+
+/* Threaded throughput test. */
+static spinlock_t test_mutex;
+static volatile int test_alive;
+static volatile int test_bytes;
+
+typedef struct {
+  const char * name;  /* File to read or write.       */
+  int loop;           /* Number of read/write passes. */
+  int write;          /* Append instead of reading.   */
+} test_thread_t;
+
+static void test_thread(void * cookie)
+{
+  test_thread_t * t = (test_thread_t *)cookie;
+  static uint8 wbuf[4096];
+  uint8 buf[4096];
+  int i, n, bytes = 0;
+
+  for (i=0; i<t->loop; ++i) {
+    file_t fd = fs_open(t->name, t->write ? O_APPEND : O_RDONLY);
+
+    if (fd < 0) {
+      break;
+    }
+    if (t->write) {
+      for (n=0; n<64; ++n) {
+	bytes += fs_write(fd, wbuf, sizeof(wbuf));
+      }
+    } else {
+      while (n = fs_read(fd, buf, sizeof(buf)), n > 0) {
+	bytes += n;
+      }
+    }
+    fs_close(fd);
+  }
+
+  spinlock_lock(&test_mutex);
+  test_bytes += bytes;
+  --test_alive;
+  spinlock_unlock(&test_mutex);
+}
+
+static int test_threads(const char * label, test_thread_t * t, int n)
+{
+  uint64 start;
+  int i, ms;
+
+  test_bytes = 0;
+  test_alive = n;
+  start = timer_ms_gettime64();
+  for (i=0; i<n; ++i) {
+    if (!thd_create(test_thread, t+i)) {
+      spinlock_lock(&test_mutex);
+      --test_alive;
+      spinlock_unlock(&test_mutex);
+    }
+  }
+  while (test_alive) {
+    thd_pass();
+  }
+  ms = test_ms(start);
+  printf(" %-17s : %5d ms %6d KB/s\n", label, ms,
+	 (int)((uint64)test_bytes * 1000 / 1024 / (ms ? ms : 1)));
+  return 0;
+}
+
+static int mkdir_test(const char * name)
+{
+  file_t fd = fs_open(name, O_WRONLY | O_DIR);
+
+  if (fd >= 0) {
+    fs_close(fd);
+  }
+  return -(fd < 0);
+}
+
+int main(void)
+{
+  uint64 start;
+  char name[64];
+  int i, err = 0;
+
+  if (dcpfs_ramdisk_init(0)) {
+    printf("ramtest : init failed\n");
+    return 1;
+  }
+  printf("ramdisk test :\n");
+
+  /* Append-heavy : playlist saves, small writes appended. */
+  start = timer_ms_gettime64();
+  for (i=0; i<50; ++i) {
+    fs_unlink("/ram/playlist.m3u");
+    err |= test_write("/ram/playlist.m3u", 2000 * 64, 64, O_APPEND);
+  }
+  err |= test_check("/ram/playlist.m3u", 2000 * 64, 64);
+  printf(" playlist saves    : %5d ms\n", test_ms(start));
+  test_usage("playlist");
+
+  /* Append-heavy : screenshot writes, large file by 4K blocks. */
+  start = timer_ms_gettime64();
+  for (i=0; i<10; ++i) {
+    sprintf(name, "/ram/shot%02d.tga", i);
+    err |= test_write(name, 640 * 480 * 3, 4096, O_WRONLY);
+  }
+  err |= test_check("/ram/shot09.tga", 640 * 480 * 3, 4096);
+  printf(" screenshot writes : %5d ms\n", test_ms(start));
+  test_usage("screenshot");
+
+  /* Copy-heavy : vmu backups, copy then touch some copies. */
+  err |= test_write("/ram/vmu.dcar", 128 << 10, 4096, O_WRONLY);
+  start = timer_ms_gettime64();
+  for (i=0; i<100; ++i) {
+    sprintf(name, "/ram/vmu%03d.dcar", i);
+    err |= fs_ramdisk_copy(name, "/ram/vmu.dcar") != (128 << 10);
+  }
+  printf(" vmu backups       : %5d ms\n", test_ms(start));
+  test_usage("vmu copy");
+  for (i=0; i<100; i+=10) {
+    file_t fd;
+
+    sprintf(name, "/ram/vmu%03d.dcar", i);
+    fd = fs_open(name, O_RDWR);
+    err |= fd < 0 || fs_write(fd, "x", 1) != 1;
+    fs_close(fd);
+  }
+  err |= test_check("/ram/vmu.dcar", 128 << 10, 4096);
+  test_usage("vmu touch");
+  if (fs_ramdisk_copy("/ram/vmu.dcar", "/ram/vmu.dcar") != -1
+      || test_check("/ram/vmu.dcar", 128 << 10, 4096)) {
+    printf(" copy onto itself  : FAILED\n");
+    err = 1;
+  }
+
+  /* Big directory : unpacking a large module collection. */
+  start = timer_ms_gettime64();
+  err |= mkdir_test("/ram/mods");
+  for (i=0; i<5000; ++i) {
+    sprintf(name, "/ram/mods/module-%04d.mod", i);
+    err |= test_write(name, 64, 64, O_WRONLY);
+  }
+  printf(" create 5000 files : %5d ms\n", test_ms(start));
+  start = timer_ms_gettime64();
+  for (i=0; i<5000*4; ++i) {
+    sprintf(name, "/ram/mods/module-%04d.mod", (i * 7919) % 5000);
+    err |= test_check(name, 64, 64);
+  }
+  printf(" open 20000 files  : %5d ms\n", test_ms(start));
+  test_usage("mods");
+  start = timer_ms_gettime64();
+  for (i=0; i<5000; ++i) {
+    sprintf(name, "/ram/mods/module-%04d.mod", i);
+    err |= fs_unlink(name);
+  }
+  err |= fs_unlink("/ram/mods");
+  printf(" unlink 5000 files : %5d ms\n", test_ms(start));
+
+  /* Threads : readers of different files, of the same file, and readers
+   * with a writer appending to another file. */
+  spinlock_init(&test_mutex);
+  {
+    test_thread_t t[4];
+
+    for (i=0; i<4; ++i) {
+      t[i].name = "/ram/shot00.tga";
+      t[i].loop = 20;
+      t[i].write = 0;
+    }
+    test_threads("1 reader", t, 1);
+    test_threads("4 readers same", t, 4);
+    t[1].name = "/ram/shot01.tga";
+    t[2].name = "/ram/shot02.tga";
+    t[3].name = "/ram/shot03.tga";
+    test_threads("4 readers diff", t, 4);
+    t[3].name = "/ram/stream.raw";
+    t[3].write = 1;
+    test_threads("3 readers+writer", t, 4);
+    err |= test_check("/ram/shot00.tga", 640 * 480 * 3, 4096);
+    err |= fs_unlink("/ram/stream.raw");
+  }
+
+  /* Cleanup. */
+  for (i=0; i<100; ++i) {
+    sprintf(name, "/ram/vmu%03d.dcar", i);
+    err |= fs_unlink(name);
+  }
+  for (i=0; i<10; ++i) {
+    sprintf(name, "/ram/shot%02d.tga", i);
+    err |= fs_unlink(name);
+  }
+  err |= fs_unlink("/ram/vmu.dcar");
+  err |= fs_unlink("/ram/playlist.m3u");
+  err |= test_usage("cleanup") != 0;
+
+  dcpfs_ramdisk_shutdown();
+  printf("ramdisk test : %s\n", err ? "FAILED" : "OK");
+  return !!err;
+}
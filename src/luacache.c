@@ -0,0 +1,335 @@
+/**
+ * @file    luacache.c
+ * @brief   Precompiled lua script cache
+ *
+ * $Id$
+ */
+
+#include <arch/types.h>
+#include <arch/timer.h>
+#include <kos/fs.h>
+#include <malloc.h>
+#include <string.h>
+#include <stdio.h>
+
+#include "dcplaya/config.h"
+#include "sysdebug.h"
+#include "luacache.h"
+#include "file_utils.h"
+#include "zlib.h"
+
+/* Default cache directory : next to the sources, so that the cache
+ * survives reboots where scripts are on writable media (/pc). */
+#define DEFAULT_CACHE_DIR ""
+
+/* Cache file magic : "LUAC" + format revision. Bump it with the lua
+ * bytecode format (VERSION in lundump.h). */
+#define LUACACHE_MAGIC    0x4C554302
+
+/* First byte of a binary lua chunk (see lundump.h). */
+#define ID_CHUNK          27
+
+/** Cache file header, followed by the dumped chunk. */
+typedef struct {
+  uint32 magic;     /**< LUACACHE_MAGIC.          */
+  uint32 srcsize;   /**< Source size in bytes.    */
+  uint32 srccrc;    /**< Source CRC32.            */
+  uint32 dumpsize;  /**< Dumped chunk size.       */
+} luacache_header_t;
+
+/** Growing buffer for lua_dump(). */
+typedef struct {
+  char * buf;
+  int size;
+  int max;
+} dumpbuf_t;
+
+static char cachedir[128] = DEFAULT_CACHE_DIR;
+static int cache_enabled = 1;
+static int cachedir_ok;
+static int report = 1;
+static luacache_stats_t stats;
+
+/* Media where bytecode is not saved next to the sources : read only,
+ * erased at boot, or too small. */
+static const char * const nocache_prefix[] = { "/cd/", "/ram/", "/vmu/", 0 };
+
+/* Can the script have a cache file ? */
+static int cacheable(const char * fname)
+{
+  int i;
+
+  if (!cache_enabled) {
+    return 0;
+  }
+  if (cachedir[0]) {
+    return 1;
+  }
+  for (i=0; nocache_prefix[i]; ++i) {
+    if (!strncmp(fname, nocache_prefix[i], strlen(nocache_prefix[i]))) {
+      return 0;
+    }
+  }
+  return 1;
+}
+
+static char * read_file(const char * fname, int * psize)
+{
+  int fd, size;
+  char * buf = 0;
+
+  fd = fs_open(fname, O_RDONLY);
+  if (fd < 0) {
+    return 0;
+  }
+  size = fs_total(fd);
+  if (size >= 0) {
+    buf = malloc(size + 1);
+    if (buf && fs_read(fd, buf, size) != size) {
+      free(buf);
+      buf = 0;
+    }
+  }
+  fs_close(fd);
+  *psize = size;
+  return buf;
+}
+
+/* Build cache filename for a script. */
+static void cache_name(char * dst, int max, const char * fname)
+{
+  const char * base, * ext;
+  int len;
+  uint32 key;
+
+  if (!cachedir[0]) {
+    /* Next to the source : "foo.lua" -> "foo.luac". */
+    snprintf(dst, max, "%sc", fname);
+    return;
+  }
+
+  /* In cache directory : basename + path hash, so that same name
+   * scripts in different directories do not collide. */
+  base = strrchr(fname, '/');
+  base = base ? base + 1 : fname;
+  ext = strrchr(base, '.');
+  len = ext ? ext - base : strlen(base);
+  if (len > 32) {
+    len = 32;
+  }
+  key = crc32(0, (const Bytef *)fname, strlen(fname));
+  snprintf(dst, max, "%s/%.*s_%08x.luac", cachedir, len, base, (int)key);
+}
+
+/* Load a valid cache file. Returns the dumped chunk or 0. */
+static char * cache_read(const char * cname, uint32 srcsize, uint32 srccrc,
+			 int * pdumpsize)
+{
+  luacache_header_t hd;
+  char * dump;
+  int fd;
+
+  fd = fs_open(cname, O_RDONLY);
+  if (fd < 0) {
+    return 0;
+  }
+  dump = 0;
+  if (fs_read(fd, &hd, sizeof(hd)) == sizeof(hd)
+      && hd.magic == LUACACHE_MAGIC
+      && hd.srcsize == srcsize
+      && hd.srccrc == srccrc
+      && fs_total(fd) == sizeof(hd) + hd.dumpsize
+      && (dump = malloc(hd.dumpsize)) != 0) {
+    if (fs_read(fd, dump, hd.dumpsize) != hd.dumpsize || dump[0] != ID_CHUNK) {
+      free(dump);
+      dump = 0;
+    } else {
+      *pdumpsize = hd.dumpsize;
+    }
+  }
+  fs_close(fd);
+  return dump;
+}
+
+static int dump_writer(const void * p, size_t size, void * ud)
+{
+  dumpbuf_t * d = ud;
+
+  if (d->size + (int)size > d->max) {
+    int max = d->max * 2 + size;
+    char * buf = realloc(d->buf, max);
+    if (!buf) {
+      return -1;
+    }
+    d->buf = buf;
+    d->max = max;
+  }
+  memcpy(d->buf + d->size, p, size);
+  d->size += size;
+  return 0;
+}
+
+/* Dump function on top of the stack to cache file. */
+static int cache_write(lua_State * L, const char * cname,
+		       uint32 srcsize, uint32 srccrc)
+{
+  luacache_header_t hd;
+  dumpbuf_t d;
+  int fd, err = -1;
+
+  if (cachedir[0] && !cachedir_ok) {
+    fu_create_dir(cachedir);
+    cachedir_ok = fu_is_dir(cachedir);
+    if (!cachedir_ok) {
+      return -1;
+    }
+  }
+
+  d.size = 0;
+  d.max = 4096;
+  d.buf = malloc(d.max);
+  if (!d.buf || lua_dump(L, dump_writer, &d)) {
+    goto error;
+  }
+
+  fd = fs_open(cname, O_WRONLY);
+  if (fd < 0) {
+    goto error;
+  }
+  hd.magic = LUACACHE_MAGIC;
+  hd.srcsize = srcsize;
+  hd.srccrc = srccrc;
+  hd.dumpsize = d.size;
+  err = -(fs_write(fd, &hd, sizeof(hd)) != sizeof(hd)
+	  || fs_write(fd, d.buf, d.size) != d.size);
+  fs_close(fd);
+  if (err) {
+    /* Do not leave a corrupt cache file. */
+    fs_unlink(cname);
+  }
+
+ error:
+  if (d.buf) {
+    free(d.buf);
+  }
+  return err;
+}
+
+int luacache_dofile(lua_State * L, const char * fname)
+{
+  char cname[256];
+  char chunkname[256];
+  char * src, * dump = 0;
+  int srcsize, dumpsize, status;
+  uint32 crc;
+  uint64 start;
+  int ms, cached;
+
+  if (!fname || !(src = read_file(fname, &srcsize))) {
+    /* stdin or unreadable file : let lua report it. */
+    return lua_dofile(L, fname);
+  }
+
+  ++stats.files;
+  snprintf(chunkname, sizeof(chunkname), "@%s", fname);
+
+  if (srcsize > 0 && src[0] == ID_CHUNK) {
+    /* Already precompiled. */
+    status = lua_dobuffer(L, src, srcsize, chunkname);
+    free(src);
+    return status;
+  }
+
+  crc = crc32(0, (const Bytef *)src, srcsize);
+  cached = cacheable(fname);
+  if (cached) {
+    cache_name(cname, sizeof(cname), fname);
+    dump = cache_read(cname, srcsize, crc, &dumpsize);
+  }
+
+  start = timer_ms_gettime64();
+  if (dump) {
+    status = lua_loadbuffer(L, dump, dumpsize, chunkname);
+    free(dump);
+    ms = (int)(timer_ms_gettime64() - start);
+    if (!status) {
+      ++stats.hits;
+      stats.load_ms += ms;
+      if (report) {
+	printf("luacache: [%s] load %d ms\n", fname, ms);
+      }
+    }
+  } else {
+    status = -1;
+  }
+
+  if (status) {
+    /* No valid cache : parse the source. */
+    start = timer_ms_gettime64();
+    status = lua_loadbuffer(L, src, srcsize, chunkname);
+    ms = (int)(timer_ms_gettime64() - start);
+    stats.parse_ms += ms;
+    if (report) {
+      printf("luacache: [%s] parse %d ms\n", fname, ms);
+    }
+    if (!status && cached && cache_write(L, cname, srcsize, crc)) {
+      ++stats.errors;
+      SDDEBUG("[luacache] : could not write [%s]\n", cname);
+    }
+  }
+  free(src);
+
+  if (!status) {
+    status = lua_call(L, 0, LUA_MULTRET);
+  }
+  return status;
+}
+
+int luacache_set_dir(const char * dir)
+{
+  cache_enabled = dir != 0;
+  cachedir_ok = 0;
+  if (!dir) {
+    return 0;
+  }
+  strncpy(cachedir, dir, sizeof(cachedir) - 1);
+  cachedir[sizeof(cachedir) - 1] = 0;
+  if (cachedir[0]) {
+    int len = strlen(cachedir);
+    if (cachedir[len - 1] == '/') {
+      cachedir[len - 1] = 0;
+    }
+    fu_create_dir(cachedir);
+    cachedir_ok = fu_is_dir(cachedir);
+    if (!cachedir_ok) {
+      SDERROR("[luacache] : bad cache directory [%s]\n", cachedir);
+      cache_enabled = 0;
+      return -1;
+    }
+  }
+  return 0;
+}
+
+const char * luacache_get_dir(void)
+{
+  return cache_enabled ? cachedir : 0;
+}
+
+int luacache_report(int new_report)
+{
+  int old = report;
+  if (new_report >= 0) {
+    report = new_report;
+  }
+  return old;
+}
+
+void luacache_stats(luacache_stats_t * st, int reset)
+{
+  if (st) {
+    *st = stats;
+  }
+  if (reset) {
+    memset(&stats, 0, sizeof(stats));
+  }
+}
@@ -0,0 +1,252 @@
+/**
+ * @file    luaprof.c
+ * @brief   Lua sampling profiler
+ *
+ * $Id$
+ */
+
+#include <arch/types.h>
+#include <kos/thread.h>
+#include <kos/fs.h>
+#include <malloc.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdarg.h>
+
+#include "dcplaya/config.h"
+#include "sysdebug.h"
+#include "luaprof.h"
+#include "luadebug.h"
+
+/* Default sampling period (ms). */
+#define DEFAULT_PERIOD_MS 5
+
+/* Folded stack limits. Deeper stacks keep their innermost frames. */
+#define MAX_DEPTH         48
+#define MAX_STACK_LEN     2048
+
+/* Aggregation table. */
+#define HASH_SIZE         1024
+#define MAX_STACKS        8192
+
+/** One distinct call stack. */
+typedef struct luaprof_stack_s {
+  struct luaprof_stack_s * next;  /**< Next in hash bucket.     */
+  uint32 hash;                    /**< Hash of str.             */
+  int count;                      /**< Number of samples.       */
+  int len;                        /**< Length of str.           */
+  char str[1];                    /**< Folded stack.            */
+} luaprof_stack_t;
+
+enum {
+  STOPPED, RUNNING, QUIT, ZOMBIE
+};
+
+static volatile int status = STOPPED;
+static lua_State * prof_L;
+static int period = DEFAULT_PERIOD_MS;
+static luaprof_stack_t * stacks[HASH_SIZE];
+static int nstacks;
+static int samples;
+static int lost;
+
+static uint32 hash_str(const char * s, int len)
+{
+  uint32 h = 2166136261u;
+  while (len--) {
+    h = (h ^ (uint8)*s++) * 16777619u;
+  }
+  return h;
+}
+
+static void clear(void)
+{
+  int i;
+
+  for (i=0; i<HASH_SIZE; ++i) {
+    luaprof_stack_t * s, * next;
+    for (s = stacks[i]; s; s = next) {
+      next = s->next;
+      free(s);
+    }
+    stacks[i] = 0;
+  }
+  nstacks = samples = lost = 0;
+}
+
+static void record(const char * str, int len, int ticks)
+{
+  uint32 h = hash_str(str, len);
+  luaprof_stack_t ** head = stacks + (h & (HASH_SIZE - 1));
+  luaprof_stack_t * s;
+
+  samples += ticks;
+  for (s = *head; s; s = s->next) {
+    if (s->hash == h && s->len == len && !memcmp(s->str, str, len)) {
+      s->count += ticks;
+      return;
+    }
+  }
+  if (nstacks >= MAX_STACKS
+      || !(s = malloc(sizeof(*s) + len))) {
+    lost += ticks;
+    return;
+  }
+  s->hash = h;
+  s->count = ticks;
+  s->len = len;
+  memcpy(s->str, str, len);
+  s->str[len] = 0;
+  s->next = *head;
+  *head = s;
+  ++nstacks;
+}
+
+/* Append to folded stack buffer, returns new length. */
+static int append(char * buf, int len, const char * fmt, ...)
+{
+  va_list list;
+  int n;
+
+  if (len >= MAX_STACK_LEN - 1) {
+    return len;
+  }
+  va_start(list, fmt);
+  n = vsnprintf(buf + len, MAX_STACK_LEN - len, fmt, list);
+  va_end(list);
+  len += n < 0 ? 0 : n;
+  return len < MAX_STACK_LEN - 1 ? len : MAX_STACK_LEN - 1;
+}
+
+/* Frame name : "name@file:line", "main@file" or "name[C]", after sep. */
+static int append_frame(char * buf, int len, const char * sep,
+			lua_Debug * ar)
+{
+  const char * name = ar->name ? ar->name : "?";
+  const char * src = "?";
+
+  if (ar->what[0] == 'C') {
+    return append(buf, len, "%s%s[C]", sep, name);
+  }
+  if (ar->source && ar->source[0] == '@') {
+    src = strrchr(ar->source, '/');
+    src = src ? src + 1 : ar->source + 1;
+  } else if (ar->source) {
+    src = "(string)";
+  }
+  if (ar->what[0] == 'm') {
+    return append(buf, len, "%smain@%s", sep, src);
+  }
+  return append(buf, len, "%s%s@%s:%d", sep, name, src, ar->linedefined);
+}
+
+/* Lua sample hook, runs in the profiled lua thread. */
+static void sample_hook(lua_State * L, int ticks, const char * leaf)
+{
+  char buf[MAX_STACK_LEN];
+  lua_Debug ar;
+  int depth, level, len = 0;
+
+  for (depth = 0; lua_getstack(L, depth, &ar); ++depth)
+    ;
+  level = depth;
+  if (level > MAX_DEPTH) {
+    level = MAX_DEPTH;
+    len = append(buf, len, "...");
+  }
+  /* Stop when the buffer is full : the stack is cut at the inner end. */
+  while (level-- > 0 && len < MAX_STACK_LEN - 1) {
+    lua_getstack(L, level, &ar);
+    lua_getinfo(L, "Sn", &ar);
+    len = append_frame(buf, len, len ? ";" : "", &ar);
+  }
+  if (leaf) {
+    len = append(buf, len, len ? ";%s" : "%s", leaf);
+  } else if (!len) {
+    len = append(buf, len, "[lua]");
+  }
+  record(buf, len, ticks);
+}
+
+static void sampler_thread(void * cookie)
+{
+  while (status == RUNNING) {
+    thd_sleep(period);
+    lua_sampletick(prof_L);
+  }
+  status = ZOMBIE;
+}
+
+int luaprof_start(lua_State * L, int period_ms)
+{
+  kthread_t * thd;
+
+  luaprof_stop();
+  clear();
+  prof_L = L;
+  period = period_ms > 0 ? period_ms : DEFAULT_PERIOD_MS;
+  lua_setsamplehook(L, sample_hook);
+
+  status = RUNNING;
+  thd = thd_create(sampler_thread, 0);
+  if (!thd) {
+    status = STOPPED;
+    lua_setsamplehook(L, 0);
+    SDERROR("[luaprof] : could not create sampling thread\n");
+    return -1;
+  }
+  thd_set_label(thd, "Luaprof-thd");
+  return 0;
+}
+
+int luaprof_stop(void)
+{
+  if (status != STOPPED) {
+    status = QUIT;
+    while (status != ZOMBIE) {
+      thd_pass();
+    }
+    status = STOPPED;
+    lua_setsamplehook(prof_L, 0);
+  }
+  return samples;
+}
+
+int luaprof_dump(const char * fname)
+{
+  char line[MAX_STACK_LEN + 16];
+  int fd, i, n = 0, err = 0;
+
+  fd = fs_open(fname, O_WRONLY);
+  if (fd < 0) {
+    SDERROR("[luaprof] : could not open [%s]\n", fname);
+    return -1;
+  }
+  for (i=0; i<HASH_SIZE && !err; ++i) {
+    luaprof_stack_t * s;
+    for (s = stacks[i]; s && !err; s = s->next) {
+      int len = sprintf(line, "%s %d\n", s->str, s->count);
+      err = fs_write(fd, line, len) != len;
+      ++n;
+    }
+  }
+  if (!err && lost) {
+    int len = sprintf(line, "[lost] %d\n", lost);
+    err = fs_write(fd, line, len) != len;
+  }
+  fs_close(fd);
+  if (err) {
+    SDERROR("[luaprof] : write error [%s]\n", fname);
+    return -1;
+  }
+  return n;
+}
+
+void luaprof_stats(luaprof_stats_t * st)
+{
+  st->running = status == RUNNING;
+  st->period_ms = period;
+  st->samples = samples;
+  st->stacks = nstacks;
+  st->lost = lost;
+}
@@ -0,0 +1,295 @@
+/**
+ * @file    luasrc.c
+ * @brief   Lua source tokenizer for viewers
+ *
+ * $Id$
+ */
+
+#include <arch/types.h>
+#include <kos/fs.h>
+#include <malloc.h>
+#include <string.h>
+#include <stdio.h>
+
+#include "dcplaya/config.h"
+#include "sysdebug.h"
+#include "luasrc.h"
+
+struct luasrc_s {
+  char * text;   /**< File contents.                            */
+  int nlines;    /**< Number of lines.                          */
+  int maxlen;    /**< Longest line.                             */
+  int * line;    /**< Line offsets (nlines+1 entries).          */
+  int * state;   /**< Scanner state at line start.              */
+  int nstates;   /**< Number of known states.                   */
+};
+
+/** Growing zml buffer. */
+typedef struct {
+  char * buf;
+  int size;
+  int max;
+  int err;
+} zmlbuf_t;
+
+/* zml macro for each span kind (0 : joins current macro). */
+static const char kindtag[LUA_LEXKINDS] = {
+  0, 'c', 'k', 'r', 's', 'n', 't', 'f', 'd'
+};
+
+static char * read_file(const char * fname, int * psize)
+{
+  int fd, size;
+  char * buf = 0;
+
+  fd = fs_open(fname, O_RDONLY);
+  if (fd < 0) {
+    return 0;
+  }
+  size = fs_total(fd);
+  if (size >= 0) {
+    buf = malloc(size + 1);
+    if (buf && fs_read(fd, buf, size) != size) {
+      free(buf);
+      buf = 0;
+    }
+  }
+  fs_close(fd);
+  *psize = size;
+  return buf;
+}
+
+luasrc_t * luasrc_load(const char * fname)
+{
+  luasrc_t * src;
+  int size, i, n;
+
+  src = calloc(1, sizeof(*src));
+  if (!src) {
+    return 0;
+  }
+  src->text = read_file(fname, &size);
+  if (!src->text) {
+    goto error;
+  }
+  src->text[size] = 0;
+
+  for (i=n=0; i<size; ++i) {
+    n += src->text[i] == '\n';
+  }
+  n += size > 0 && src->text[size-1] != '\n';
+  src->line = malloc((n + 1) * sizeof(*src->line));
+  src->state = malloc((n + 1) * sizeof(*src->state));
+  if (!src->line || !src->state) {
+    goto error;
+  }
+  src->line[0] = 0;
+  for (i=0, n=1; i<size; ++i) {
+    if (src->text[i] == '\n') {
+      src->line[n++] = i + 1;
+    }
+  }
+  if (size > 0 && src->text[size-1] != '\n') {
+    src->line[n++] = size + 1;
+  }
+  src->nlines = n - 1;
+  for (i=0; i<src->nlines; ++i) {
+    int len = src->line[i+1] - src->line[i] - 1;
+    if (len > src->maxlen) {
+      src->maxlen = len;
+    }
+  }
+  src->state[0] = 0;
+  src->nstates = 1;
+  return src;
+
+ error:
+  SDERROR("[luasrc] : could not load [%s]\n", fname);
+  luasrc_free(src);
+  return 0;
+}
+
+void luasrc_free(luasrc_t * src)
+{
+  if (src) {
+    free(src->text);
+    free(src->line);
+    free(src->state);
+    free(src);
+  }
+}
+
+int luasrc_lines(const luasrc_t * src)
+{
+  return src->nlines;
+}
+
+int luasrc_maxlen(const luasrc_t * src)
+{
+  return src->maxlen;
+}
+
+static int line_len(const luasrc_t * src, int i)
+{
+  int len = src->line[i+1] - src->line[i] - 1;
+  if (len > 0 && src->text[src->line[i] + len - 1] == '\r') {
+    --len;
+  }
+  return len;
+}
+
+/* Scanner state at start of line i; scans the lines before it once. */
+static int line_state(luasrc_t * src, int i)
+{
+  while (src->nstates <= i) {
+    int j = src->nstates - 1;
+    src->state[j+1] = lua_scanline(src->text + src->line[j],
+				   line_len(src, j), src->state[j], 0, 0, 0);
+    ++src->nstates;
+  }
+  return src->state[i];
+}
+
+int luasrc_spans(luasrc_t * src, int line, lua_LexSpan * spans, int max,
+		 const char ** text, int * len)
+{
+  int n;
+
+  if (line < 0 || line >= src->nlines) {
+    return -1;
+  }
+  *text = src->text + src->line[line];
+  *len = line_len(src, line);
+  lua_scanline(*text, *len, line_state(src, line), spans, max, &n);
+  return n;
+}
+
+static void zput(zmlbuf_t * z, const char * s, int len)
+{
+  if (z->err) {
+    return;
+  }
+  if (z->size + len > z->max) {
+    int max = z->max * 2 + len;
+    char * buf = realloc(z->buf, max);
+    if (!buf) {
+      z->err = 1;
+      return;
+    }
+    z->buf = buf;
+    z->max = max;
+  }
+  memcpy(z->buf + z->size, s, len);
+  z->size += len;
+}
+
+static void zopen(zmlbuf_t * z, int tag)
+{
+  char s[3] = { '<', tag, '>' };
+  zput(z, s, 3);
+}
+
+static void zclose(zmlbuf_t * z)
+{
+  zput(z, "</pre>", 6);
+}
+
+/* Put text inside macro tag : a "</pre>" in the text would end it. */
+static void zput_text(zmlbuf_t * z, const char * s, int len, int tag)
+{
+  const char * e;
+
+  while (len >= 6 && (e = memchr(s, '<', len - 5)) != 0) {
+    int n = e - s + 1;
+    zput(z, s, n);
+    if (!memcmp(e, "</pre>", 6)) {
+      zclose(z);
+      zopen(z, tag);
+    }
+    s += n;
+    len -= n;
+  }
+  zput(z, s, len);
+}
+
+char * luasrc_zml(luasrc_t * src, int first, int last, int * plen)
+{
+  zmlbuf_t z;
+  lua_LexSpan * spans;
+  int i, cur = 0;
+
+  if (first < 0) {
+    first = 0;
+  }
+  if (last >= src->nlines) {
+    last = src->nlines - 1;
+  }
+  spans = malloc((src->maxlen + 1) * sizeof(*spans));
+  z.size = z.err = 0;
+  z.max = 1024
+    + (last >= first ? src->line[last+1] - src->line[first] : 0) * 3;
+  z.buf = malloc(z.max);
+  if (!spans || !z.buf) {
+    goto error;
+  }
+
+  for (i=first; i<=last; ++i) {
+    const char * text;
+    int len, n, k;
+
+    n = luasrc_spans(src, i, spans, src->maxlen + 1, &text, &len);
+    for (k=0; k<n; ++k) {
+      const char * s = text + spans[k].start;
+      int l = spans[k].len, tag = kindtag[spans[k].kind];
+
+      if (tag == 'd') {
+	/* Function definition : whole dotted name, with an anchor. */
+	while (k+1 < n && spans[k+1].kind == LUA_LEXFUNCDEF) {
+	  l += spans[++k].len;
+	}
+	if (cur) {
+	  zclose(&z);
+	  cur = 0;
+	}
+	zput(&z, "<a name=\"", 9);
+	zput(&z, s, l);
+	zput(&z, "\"><d>", 5);
+	zput(&z, s, l);
+	zput(&z, "</pre></a>", 10);
+	continue;
+      }
+      if (!tag) {
+	tag = cur ? cur : 'c';
+      }
+      if (tag != cur) {
+	if (cur) {
+	  zclose(&z);
+	}
+	zopen(&z, tag);
+	cur = tag;
+      }
+      zput_text(&z, s, l, tag);
+    }
+    if (!cur) {
+      zopen(&z, 'c');
+      cur = 'c';
+    }
+    zput(&z, "\n", 1);
+  }
+  if (cur) {
+    zclose(&z);
+  }
+  zput(&z, "", 1);
+  if (z.err) {
+    goto error;
+  }
+  free(spans);
+  *plen = z.size - 1;
+  return z.buf;
+
+ error:
+  SDERROR("[luasrc] : zml out of memory\n");
+  free(spans);
+  free(z.buf);
+  return 0;
+}
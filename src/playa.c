@@ -18,6 +18,7 @@
 #include "driver_list.h"
 #include "file_wrapper.h"
 #include "fifo.h"
+#include "fs_cache.h"
 //#include "fft.h"
 
 #include "priorities.h"
@@ -46,6 +47,11 @@ static volatile unsigned int play_samples_start;
 static volatile unsigned int play_samples;
 static volatile int streamstatus = PLAYA_STATUS_INIT;
 
+/* Seek request, processed by the decoder thread. */
+static volatile int seek_pending;
+static unsigned int seek_ms;
+static int seek_result;
+
 static int out_buffer[1<<14];
 static int out_samples;
 static int out_count;
@@ -290,6 +296,28 @@ void sndstream_thread(void *cookie)
   SDDEBUG("<< %s()\n", __FUNCTION__);
 }
 
+/* Seek driver and drop fifo PCM of the old position. */
+static void real_playa_seek(void)
+{
+  playa_info_t info;
+
+  memset(&info,0,sizeof(info));
+  seek_result = driver->seek(((unsigned long long)seek_ms * 1000) >> 10,
+			     &info);
+  if (!seek_result) {
+    fifo_start();
+    if (next_frq != current_frq) {
+      stream_frq(current_frq = next_frq);
+    }
+    play_samples_start = 0;
+    play_samples = ((unsigned long long)seek_ms * current_frq) >> 10;
+    fade_ms = 128;
+    fade_v = 0;
+  }
+  SDDEBUG("%s(%u) := [%d]\n", __FUNCTION__, seek_ms, seek_result);
+  seek_pending = 0;
+}
+
 static void real_playa_update(void)
 {
   switch (playastatus) {
@@ -324,6 +352,9 @@ static void real_playa_update(void)
       if (!driver) {
 	SDERROR("No driver !\n");
 	status = INP_DECODE_ERROR;
+      } else if (seek_pending) {
+	real_playa_seek();
+	status = 0;
       } else if (!fifo_free()) {
 /* 	SDDEBUG("Fifo is full ... pass ...\n"); */
 	status = 0;
@@ -367,6 +398,7 @@ static void real_playa_update(void)
 
   case PLAYA_STATUS_STOPPING:
     {
+      seek_pending = 0;
       if (driver) {
 	driver->stop();
       }
@@ -619,6 +651,8 @@ int playa_start(const char *fn, int track, int immediat) {
   int e = -1;
   playa_info_t info;
   inp_driver_t *d = 0;
+  char cachefn[256];
+  const char *openfn;
 
   SDDEBUG(">> %s('%s',%d, %d)\n",__FUNCTION__, fn, track, immediat);
   SDINDENT;
@@ -658,10 +692,12 @@ int playa_start(const char *fn, int track, int immediat) {
     fade_v = 0;
   }
   
-  /* Start playa, get decoder info */
+  /* Start playa, get decoder info. Slow media are read through the
+     read-ahead cache. */
+  openfn = fs_cache_path(cachefn, sizeof(cachefn), fn);
 
   if (d)
-    e = d->start(fn, track, &info);
+    e = d->start(openfn, track, &info);
   else {
     /* VP : added support for multi driver */
     driver_list_lock(&inp_drivers);
@@ -671,7 +707,7 @@ int playa_start(const char *fn, int track, int immediat) {
 	 d=(inp_driver_t *)d->common.nxt) {
 
       if (d->extensions[0] == '*') {
-	e = d->start(fn, track, &info);
+	e = d->start(openfn, track, &info);
 	if (!e) {
 	  driver_reference(&d->common);
 	  break;
@@ -737,6 +773,20 @@ int playa_start(const char *fn, int track, int immediat) {
   return e;
 }
 
+int playa_seek(unsigned int ms)
+{
+  if (playastatus != PLAYA_STATUS_PLAYING || !driver || !driver->seek) {
+    return -1;
+  }
+  seek_ms = ms;
+  seek_result = -1;
+  seek_pending = 1;
+  while (seek_pending && playastatus == PLAYA_STATUS_PLAYING) {
+    playa_update();
+  }
+  return seek_pending ? -1 : seek_result;
+}
+
 int playa_volume(int volume) {
   int old = playavolume;
   if (volume >= 0) stream_volume(playavolume = volume);
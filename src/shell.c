@@ -26,6 +26,13 @@ static int input_pos;
 static int show_console = 0;
 static float console_y = CONSOLE_OUT_Y;
 
+/* Lua garbage collector work per frame. Halved when a frame is dropped,
+ * raised slowly while the frame rate holds. */
+#define GC_BUDGET_MIN  100
+#define GC_BUDGET_MAX  4000
+#define GC_BUDGET_INC  25
+static int gc_budget = 500;
+
 lef_prog_t * shell_lef;
 shell_shutdown_func_t shell_lef_shutdown_func;
 
@@ -36,14 +43,24 @@ char shell_lef_fname[256];
 //char * shell_lef_fname = DCPLAYA_HOME "/dynshell/dynshell.lez";
 
 static shell_command_func_t shell_command_func;
+static shell_yield_func_t shell_yield_func;
 
 
 
 #define MAX_COMMANDS 128
 
-static char * commands[MAX_COMMANDS];
-static int write_command;
-static int read_command;
+/* Minimum time between two yield points (ms). */
+#define YIELD_MS 20
+
+/* One FIFO per priority. */
+static shell_queued_t * queue_head[SHELL_PRIO_MAX];
+static shell_queued_t * queue_tail[SHELL_PRIO_MAX];
+static int queued;
+static int running;
+static shell_latency_t latency[SHELL_PRIO_MAX];
+
+static kthread_t * shell_thd;
+static uint32 last_yield;
 
 
 // HISTORY NOT IMPLEMENTED YET HERE (but implemented in LUA shell so who cares)
@@ -78,7 +95,8 @@ static void shell_update_keyboard()
 
   case KBD_KEY_F2<<8: // F2
     csl_putstring(csl_main_console, "dofile(home..[[autorun.lua]])\n");
-    shell_command("dofile(home..[[autorun.lua]])");
+    shell_command_prio("dofile(home..[[autorun.lua]])",
+		       SHELL_PRIO_INTERACTIVE, 0, 0);
     break;
 
   case 8:
@@ -92,7 +110,7 @@ static void shell_update_keyboard()
     csl_putchar(csl_main_console, '\n');
 
     input[input_pos] = 0;
-    shell_command(input);
+    shell_command_prio(input, SHELL_PRIO_INTERACTIVE, 0, 0);
 
     input_pos = 0;
 
@@ -161,11 +179,13 @@ static void shell_thread(void * param)
   /* VP : set the prio2 to 2 for the shell, so that lua will not get too 
      slow */
   thd_current->prio2 = LUA_THREAD_PRIORITY;
+  shell_thd = thd_current;
 
   for (;;) {
-    char * com;
+    shell_queued_t * q;
+    int result = -1;
 
-    while (write_command == read_command) {
+    while (q = shell_pop_command(SHELL_PRIO_BACKGROUND), !q) {
       thd_pass();
 
       /* Keyboard update */
@@ -176,16 +196,12 @@ static void shell_thread(void * param)
 
     hack = 1;
 
-    com = commands[read_command];
-
     if (shell_command_func) {
-      shell_command_func(com);
+      result = shell_command_func(q->command);
     } else {
-      printf("shell: don't know what to do with command '%s' (no shell loaded !)\n", com);
+      printf("shell: don't know what to do with command '%s' (no shell loaded !)\n", q->command);
     }
-
-    free(commands[read_command]);
-    read_command = (read_command+1)%MAX_COMMANDS;
+    shell_command_done(q, result);
 
     hack = 0;
 
@@ -251,9 +267,24 @@ void shell_shutdown()
 #warning "TODO"
 }
 
+int shell_gc_budget(void)
+{
+  return gc_budget;
+}
+
 void shell_update(float frameTime)
 {
 
+  /* Garbage collector frame budget */
+  if (frameTime > 1.5f/60.0f) {
+    gc_budget >>= 1;
+    if (gc_budget < GC_BUDGET_MIN) {
+      gc_budget = GC_BUDGET_MIN;
+    }
+  } else if (gc_budget < GC_BUDGET_MAX) {
+    gc_budget += GC_BUDGET_INC;
+  }
+
   /* Console movement handling */
   if (show_console/* || read_command != write_command*/) {
     console_y += 5 * frameTime * (CONSOLE_Y - console_y);
@@ -285,26 +316,55 @@ void unlockcommand(void)
 
 int shell_command(const char * com)
 {
+  return shell_command_prio(com, SHELL_PRIO_NORMAL, 0, 0);
+}
+
+int shell_command_prio(const char * com, int prio,
+		       shell_done_func_t done, void * cookie)
+{
+  shell_queued_t * q;
+  int len;
+
   //printf("COMMAND <%s>\n", com);
 
-  if (hack) {
-    if (shell_command_func) {
-      shell_command_func(com);
-    } else {
-      printf("shell: don't know what to do with command '%s' (no shell loaded !)\n", com);
-    }
-    return 0;
+  if (prio < SHELL_PRIO_BACKGROUND) {
+    prio = SHELL_PRIO_BACKGROUND;
+  } else if (prio >= SHELL_PRIO_MAX) {
+    prio = SHELL_PRIO_MAX - 1;
+  }
+
+  /* While a command is running (hack), new commands are queued the same
+   * way. They are run by the shell (see shell_pop_command()) or at the
+   * next yield point for interactive ones. */
+  len = strlen(com);
+  q = malloc(sizeof(*q) + len);
+  if (!q) {
+    printf("shell : could not enqueue command '%s'\n", com);
+    return -1;
   }
+  q->next = 0;
+  q->prio = prio;
+  q->done = done;
+  q->cookie = cookie;
+  q->stamp = (unsigned int) timer_ms_gettime64();
+  memcpy(q->command, com, len + 1);
 
   lockcommand();
 
-  if ((write_command+1) % MAX_COMMANDS != read_command) {
-    commands[write_command] = strdup(com);
-    write_command = (write_command+1) % MAX_COMMANDS;
-  } else {
+  if (queued >= MAX_COMMANDS) {
+    unlockcommand();
     printf("shell : command buffer full ! could not enqueue command '%s'\n", 
 	   com);
+    free(q);
+    return -1;
   }
+  if (queue_tail[prio]) {
+    queue_tail[prio]->next = q;
+  } else {
+    queue_head[prio] = q;
+  }
+  queue_tail[prio] = q;
+  ++queued;
 
   unlockcommand();
 
@@ -312,9 +372,100 @@ int shell_command(const char * com)
 
 }
 
+shell_queued_t * shell_pop_command(int min_prio)
+{
+  shell_queued_t * q = 0;
+  int prio, wait;
+
+  lockcommand();
+
+  for (prio = SHELL_PRIO_MAX - 1; prio >= min_prio && prio >= 0; --prio) {
+    q = queue_head[prio];
+    if (q) {
+      queue_head[prio] = q->next;
+      if (!q->next) {
+	queue_tail[prio] = 0;
+      }
+      q->next = 0;
+      --queued;
+      ++running;
+
+      wait = (unsigned int) timer_ms_gettime64() - q->stamp;
+      ++latency[prio].count;
+      latency[prio].wait_ms += wait;
+      if (wait > latency[prio].max_ms) {
+	latency[prio].max_ms = wait;
+      }
+      break;
+    }
+  }
+
+  unlockcommand();
+
+  return q;
+}
+
+void shell_command_done(shell_queued_t * q, int result)
+{
+  if (!q) {
+    return;
+  }
+  if (q->done) {
+    q->done(q->command, result, q->cookie);
+  }
+  lockcommand();
+  --running;
+  unlockcommand();
+  free(q);
+}
+
+void shell_latency(int prio, shell_latency_t * lat, int reset)
+{
+  if (prio < 0 || prio >= SHELL_PRIO_MAX) {
+    return;
+  }
+  lockcommand();
+  if (lat) {
+    *lat = latency[prio];
+  }
+  if (reset) {
+    memset(latency + prio, 0, sizeof(latency[prio]));
+  }
+  unlockcommand();
+}
+
+shell_yield_func_t shell_set_yield_func(shell_yield_func_t func)
+{
+  shell_yield_func_t old = shell_yield_func;
+
+  shell_yield_func = func;
+
+  return old;
+}
+
+void shell_yield(void)
+{
+  uint32 now;
+
+  /* Only the shell thread may run commands, and only inside one. */
+  if (thd_current != shell_thd || !hack) {
+    return;
+  }
+  now = (uint32) timer_ms_gettime64();
+  if (now - last_yield < YIELD_MS) {
+    return;
+  }
+  last_yield = now;
+
+  if (shell_yield_func) {
+    shell_yield_func();
+  }
+  thd_pass();
+}
+
 void shell_wait()
 {
-  while (write_command != read_command)
+  while (queued || running)
     thd_pass();
 }
 
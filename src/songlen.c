@@ -0,0 +1,277 @@
+/**
+ * @file    songlen.c
+ * @brief   Song length database.
+ *
+ * $Id$
+ */
+
+#include <kos/fs.h>
+#include <arch/spinlock.h>
+#include <malloc.h>
+#include <string.h>
+
+#include "dcplaya/config.h"
+#include "sysdebug.h"
+#include "songlen.h"
+
+/** One file of the database. */
+typedef struct {
+  unsigned char digest[MD5_SIZE];
+  unsigned short tracks;  /**< Number of subtunes.                  */
+  unsigned int first;     /**< Index of first subtune in lengths.   */
+} songlen_entry_t;
+
+typedef struct {
+  int count;                  /**< Number of entries.                */
+  songlen_entry_t * entry;    /**< Entries.                          */
+  unsigned int * length;      /**< Subtune lengths in ms.            */
+  unsigned int mask;          /**< Hash table size - 1.              */
+  int * hash;                 /**< Entry index + 1 (0 : empty slot). */
+} songlen_db_t;
+
+static songlen_db_t * db;
+static spinlock_t db_mutex;
+
+static void db_free(songlen_db_t * d)
+{
+  if (d) {
+    free(d->entry);
+    free(d->length);
+    free(d->hash);
+    free(d);
+  }
+}
+
+/* The digest is already uniform : use its first bytes as hash. */
+static unsigned int hash_of(const unsigned char * digest)
+{
+  return digest[0] | (digest[1] << 8) | (digest[2] << 16)
+    | ((unsigned int)digest[3] << 24);
+}
+
+static int hex_value(int c)
+{
+  if (c >= '0' && c <= '9') return c - '0';
+  if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+  if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+  return -1;
+}
+
+/* Parse "m:ss[.mmm][(flags)]" : returns ms, *ps after the time. */
+static unsigned int parse_time(const char ** ps, const char * end, int * ok)
+{
+  const char * s = *ps;
+  unsigned int min = 0, sec = 0, ms = 0, scale = 100;
+
+  *ok = 0;
+  while (s < end && *s >= '0' && *s <= '9') {
+    min = min * 10 + *s++ - '0';
+  }
+  if (s == *ps || s >= end || *s++ != ':') {
+    return 0;
+  }
+  while (s < end && *s >= '0' && *s <= '9') {
+    sec = sec * 10 + *s++ - '0';
+  }
+  if (s < end && *s == '.') {
+    for (++s; s < end && *s >= '0' && *s <= '9'; ++s) {
+      ms += (*s - '0') * scale;
+      scale /= 10;
+    }
+  }
+  if (s < end && *s == '(') {
+    while (s < end && *s++ != ')')
+      ;
+  }
+  *ps = s;
+  *ok = 1;
+  return (min * 60 + sec) * 1000 + ms;
+}
+
+/* Parse a "digest=times" line. Returns number of times or -1. */
+static int parse_line(songlen_db_t * d, const char * s, const char * end,
+		      int store)
+{
+  songlen_entry_t * e = d->entry + d->count;
+  int i, n;
+
+  if (end - s < MD5_SIZE * 2 + 1 || s[MD5_SIZE * 2] != '=') {
+    return -1;
+  }
+  for (i=0; i<MD5_SIZE; ++i) {
+    int hi = hex_value(s[i*2]), lo = hex_value(s[i*2+1]);
+    if (hi < 0 || lo < 0) {
+      return -1;
+    }
+    if (store) {
+      e->digest[i] = (hi << 4) | lo;
+    }
+  }
+  s += MD5_SIZE * 2 + 1;
+  for (n=0; n<65535; ++n) {
+    unsigned int ms;
+    int ok;
+
+    while (s < end && (*s == ' ' || *s == '\t')) {
+      ++s;
+    }
+    ms = parse_time(&s, end, &ok);
+    if (!ok) {
+      break;
+    }
+    if (store) {
+      d->length[e->first + n] = ms;
+    }
+  }
+  return n;
+}
+
+static char * read_file(const char * fname, int * psize)
+{
+  int fd, size;
+  char * buf = 0;
+
+  fd = fs_open(fname, O_RDONLY);
+  if (fd < 0) {
+    return 0;
+  }
+  size = fs_total(fd);
+  if (size >= 0) {
+    buf = malloc(size + 1);
+    if (buf && fs_read(fd, buf, size) != size) {
+      free(buf);
+      buf = 0;
+    }
+  }
+  fs_close(fd);
+  *psize = size;
+  return buf;
+}
+
+/* Two passes on the text : count, then store. */
+static songlen_db_t * db_build(const char * text, int size)
+{
+  songlen_db_t * d;
+  const char * s, * eol, * end = text + size;
+  int pass, entries = 0, lengths = 0;
+  unsigned int hsize;
+
+  d = calloc(1, sizeof(*d));
+  if (!d) {
+    return 0;
+  }
+  for (pass=0; pass<2; ++pass) {
+    int tracks = 0;
+
+    if (pass) {
+      /* One more entry to parse lines after the last one. */
+      d->entry = malloc((entries + 1) * sizeof(*d->entry));
+      d->length = malloc((lengths + 1) * sizeof(*d->length));
+      if (!d->entry || !d->length) {
+	goto error;
+      }
+    }
+    for (s=text; s<end; s=eol+1) {
+      int n;
+
+      eol = memchr(s, '\n', end - s);
+      if (!eol) {
+	eol = end;
+      }
+      if (pass) {
+	d->entry[d->count].first = tracks;
+      }
+      n = parse_line(d, s, eol, pass);
+      if (n > 0) {
+	if (pass) {
+	  d->entry[d->count++].tracks = n;
+	} else {
+	  ++entries;
+	}
+	tracks += n;
+      }
+    }
+    lengths = tracks;
+  }
+
+  for (hsize = 16; hsize < (unsigned int)d->count * 2; hsize <<= 1)
+    ;
+  d->mask = hsize - 1;
+  d->hash = calloc(hsize, sizeof(*d->hash));
+  if (!d->hash) {
+    goto error;
+  }
+  for (pass=0; pass<d->count; ++pass) {
+    unsigned int h = hash_of(d->entry[pass].digest);
+    while (d->hash[h & d->mask]) {
+      ++h;
+    }
+    d->hash[h & d->mask] = pass + 1;
+  }
+  return d;
+
+ error:
+  db_free(d);
+  return 0;
+}
+
+int songlen_load(const char * fname)
+{
+  songlen_db_t * d = 0, * old;
+  char * text;
+  int size, count = 0;
+
+  if (fname) {
+    text = read_file(fname, &size);
+    if (!text) {
+      SDERROR("[songlen] : could not read [%s]\n", fname);
+      return -1;
+    }
+    d = db_build(text, size);
+    free(text);
+    if (!d) {
+      SDERROR("[songlen] : no memory for [%s]\n", fname);
+      return -1;
+    }
+    count = d->count;
+    SDDEBUG("[songlen] : [%s] %d files\n", fname, count);
+  }
+
+  spinlock_lock(&db_mutex);
+  old = db;
+  db = d;
+  spinlock_unlock(&db_mutex);
+  db_free(old);
+  return count;
+}
+
+int songlen_count(void)
+{
+  int count;
+
+  spinlock_lock(&db_mutex);
+  count = db ? db->count : 0;
+  spinlock_unlock(&db_mutex);
+  return count;
+}
+
+unsigned int songlen_find(const unsigned char digest[MD5_SIZE], int track)
+{
+  unsigned int h, ms = 0;
+  int i;
+
+  spinlock_lock(&db_mutex);
+  if (db && track > 0) {
+    for (h = hash_of(digest); (i = db->hash[h & db->mask]) != 0; ++h) {
+      const songlen_entry_t * e = db->entry + i - 1;
+      if (!memcmp(e->digest, digest, MD5_SIZE)) {
+	if (track <= e->tracks) {
+	  ms = db->length[e->first + track - 1];
+	}
+	break;
+      }
+    }
+  }
+  spinlock_unlock(&db_mutex);
+  return ms;
+}